@@ -44,6 +44,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+
+#include <systemlib/name_hash.h>
 
 namespace device
 {
@@ -64,8 +67,128 @@ private:
 	px4_dev_t() {}
 };
 
-#define PX4_MAX_DEV 50
-static px4_dev_t *devmap[PX4_MAX_DEV];
+/*
+ * Registered devices are kept in an open addressing hash table keyed on
+ * the device name. The table doubles once it is 3/4 full (counting deleted
+ * slots), so there is no fixed limit on the number of devices.
+ */
+#define PX4_DEVMAP_INITIAL_SIZE 64
+
+static char devmap_deleted_marker;
+#define DEVMAP_DELETED ((px4_dev_t *)&devmap_deleted_marker)
+
+static px4_dev_t **devmap = NULL;
+static unsigned devmap_size = 0;
+static unsigned devmap_count = 0;	/* live entries */
+static unsigned devmap_used = 0;	/* live + deleted entries */
+static pthread_mutex_t devmap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline bool devmap_live(unsigned i)
+{
+	return devmap[i] != NULL && devmap[i] != DEVMAP_DELETED;
+}
+
+/* Returns the slot holding name, or -1. Must be called with devmap_lock held. */
+static int devmap_find(const char *name)
+{
+	if (devmap_size == 0) {
+		return -1;
+	}
+
+	unsigned mask = devmap_size - 1;
+	unsigned i = name_hash(name) & mask;
+
+	for (unsigned n = 0; n < devmap_size; n++, i = (i + 1) & mask) {
+		if (devmap[i] == NULL) {
+			return -1;
+		}
+
+		if (devmap[i] != DEVMAP_DELETED && strcmp(devmap[i]->name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Resize and rehash, dropping deleted slots. Must be called with devmap_lock held. */
+static int devmap_rehash()
+{
+	unsigned new_size = PX4_DEVMAP_INITIAL_SIZE;
+
+	while (new_size < (devmap_count + 1) * 2) {
+		new_size *= 2;
+	}
+
+	px4_dev_t **new_map = (px4_dev_t **)calloc(new_size, sizeof(px4_dev_t *));
+
+	if (new_map == NULL) {
+		return -ENOMEM;
+	}
+
+	for (unsigned i = 0; i < devmap_size; i++) {
+		if (devmap_live(i)) {
+			unsigned j = name_hash(devmap[i]->name) & (new_size - 1);
+
+			while (new_map[j] != NULL) {
+				j = (j + 1) & (new_size - 1);
+			}
+
+			new_map[j] = devmap[i];
+		}
+	}
+
+	free(devmap);
+	devmap = new_map;
+	devmap_size = new_size;
+	devmap_used = devmap_count;
+
+	return PX4_OK;
+}
+
+/* Must be called with devmap_lock held */
+static int devmap_insert(px4_dev_t *dev)
+{
+	if ((devmap_used + 1) * 4 > devmap_size * 3) {
+		int ret = devmap_rehash();
+
+		if (ret != PX4_OK) {
+			return ret;
+		}
+	}
+
+	unsigned mask = devmap_size - 1;
+	unsigned i = name_hash(dev->name) & mask;
+
+	while (devmap_live(i)) {
+		i = (i + 1) & mask;
+	}
+
+	if (devmap[i] == NULL) {
+		devmap_used++;
+	}
+
+	devmap[i] = dev;
+	devmap_count++;
+
+	return PX4_OK;
+}
+
+/* Must be called with devmap_lock held */
+static int devmap_remove(const char *name)
+{
+	int i = devmap_find(name);
+
+	if (i < 0) {
+		return -EINVAL;
+	}
+
+	delete devmap[i];
+	devmap[i] = DEVMAP_DELETED;
+	devmap_count--;
+
+	return PX4_OK;
+}
 
 /*
  * The standard NuttX operation dispatch table can't call C++ member functions
@@ -130,24 +253,28 @@ VDev::register_driver(const char *name, void *data)
 	if (name == NULL || data == NULL)
 		return -EINVAL;
 
+	pthread_mutex_lock(&devmap_lock);
+
 	// Make sure the device does not already exist
-	// FIXME - convert this to a map for efficiency
-	for (int i=0;i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && (strcmp(devmap[i]->name,name) == 0)) {
-			return -EEXIST;
-		}
-	}
-	for (int i=0;i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] == NULL) {
-			devmap[i] = new px4_dev_t(name, (void *)data);
+	if (devmap_find(name) >= 0) {
+		ret = -EEXIST;
+
+	} else {
+		px4_dev_t *dev = new px4_dev_t(name, (void *)data);
+
+		ret = (dev != NULL) ? devmap_insert(dev) : -ENOMEM;
+
+		if (ret == PX4_OK) {
 			PX4_DEBUG("Registered DEV %s", name);
-			ret = PX4_OK;
-			break;
+
+		} else {
+			PX4_ERR("Failed to grow devmap");
+			delete dev;
 		}
 	}
-	if (ret != PX4_OK) {
-		PX4_ERR("No free devmap entries - increase PX4_MAX_DEV");
-	}
+
+	pthread_mutex_unlock(&devmap_lock);
+
 	return ret;
 }
 
@@ -160,15 +287,14 @@ VDev::unregister_driver(const char *name)
 	if (name == NULL)
 		return -EINVAL;
 
-	for (int i=0;i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && (strcmp(name, devmap[i]->name) == 0)) {
-			delete devmap[i];
-			devmap[i] = NULL;
-			PX4_DEBUG("Unregistered DEV %s", name);
-			ret = PX4_OK;
-			break;
-		}
+	pthread_mutex_lock(&devmap_lock);
+	ret = devmap_remove(name);
+	pthread_mutex_unlock(&devmap_lock);
+
+	if (ret == PX4_OK) {
+		PX4_DEBUG("Unregistered DEV %s", name);
 	}
+
 	return ret;
 }
 
@@ -178,15 +304,16 @@ VDev::unregister_class_devname(const char *class_devname, unsigned class_instanc
 	PX4_DEBUG("VDev::unregister_class_devname");
 	char name[32];
 	snprintf(name, sizeof(name), "%s%u", class_devname, class_instance);
-	for (int i=0;i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strcmp(devmap[i]->name,name) == 0) {
-			delete devmap[i];
-			PX4_DEBUG("Unregistered class DEV %s", name);
-			devmap[i] = NULL;
-			return PX4_OK;
-		}
+
+	pthread_mutex_lock(&devmap_lock);
+	int ret = devmap_remove(name);
+	pthread_mutex_unlock(&devmap_lock);
+
+	if (ret == PX4_OK) {
+		PX4_DEBUG("Unregistered class DEV %s", name);
 	}
-	return -EINVAL;
+
+	return ret;
 }
 
 int
@@ -461,66 +588,81 @@ VDev::remove_poll_waiter(px4_pollfd_struct_t *fds)
 VDev *VDev::getDev(const char *path)
 {
 	PX4_DEBUG("VDev::getDev");
-	int i=0;
-	for (; i<PX4_MAX_DEV; ++i) {
-		//if (devmap[i]) {
-		//	printf("%s %s\n", devmap[i]->name, path);
-		//}
-		if (devmap[i] && (strcmp(devmap[i]->name, path) == 0)) {
-			return (VDev *)(devmap[i]->cdev);
-		}
+	VDev *dev = NULL;
+
+	pthread_mutex_lock(&devmap_lock);
+	int i = devmap_find(path);
+
+	if (i >= 0) {
+		dev = (VDev *)(devmap[i]->cdev);
 	}
-	return NULL;
+
+	pthread_mutex_unlock(&devmap_lock);
+
+	return dev;
 }
 
 void VDev::showDevices()
 {
-	int i=0;
 	PX4_INFO("Devices:");
-	for (; i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/dev/", 5) == 0) {
+	pthread_mutex_lock(&devmap_lock);
+	for (unsigned i=0; i<devmap_size; ++i) {
+		if (devmap_live(i) && strncmp(devmap[i]->name, "/dev/", 5) == 0) {
 			PX4_INFO("   %s", devmap[i]->name);
 		}
 	}
+	pthread_mutex_unlock(&devmap_lock);
 }
 
 void VDev::showTopics()
 {
-	int i=0;
 	PX4_INFO("Devices:");
-	for (; i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/obj/", 5) == 0) {
+	pthread_mutex_lock(&devmap_lock);
+	for (unsigned i=0; i<devmap_size; ++i) {
+		if (devmap_live(i) && strncmp(devmap[i]->name, "/obj/", 5) == 0) {
 			PX4_INFO("   %s", devmap[i]->name);
 		}
 	}
+	pthread_mutex_unlock(&devmap_lock);
 }
 
 void VDev::showFiles()
 {
-	int i=0;
 	PX4_INFO("Files:");
-	for (; i<PX4_MAX_DEV; ++i) {
-		if (devmap[i] && strncmp(devmap[i]->name, "/obj/", 5) != 0 &&
+	pthread_mutex_lock(&devmap_lock);
+	for (unsigned i=0; i<devmap_size; ++i) {
+		if (devmap_live(i) && strncmp(devmap[i]->name, "/obj/", 5) != 0 &&
 				 strncmp(devmap[i]->name, "/dev/", 5) != 0) {
 			PX4_INFO("   %s", devmap[i]->name);
 		}
 	}
+	pthread_mutex_unlock(&devmap_lock);
+}
+
+static const char *devmap_list(unsigned int *next, const char *prefix)
+{
+	const char *name = NULL;
+
+	pthread_mutex_lock(&devmap_lock);
+	for (;*next<devmap_size; (*next)++) {
+		if (devmap_live(*next) && strncmp(devmap[*next]->name, prefix, 5) == 0) {
+			name = devmap[(*next)++]->name;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&devmap_lock);
+
+	return name;
 }
 
 const char *VDev::topicList(unsigned int *next)
 {
-	for (;*next<PX4_MAX_DEV; (*next)++)
-		if (devmap[*next] && strncmp(devmap[(*next)]->name, "/obj/", 5) == 0)
-			return devmap[(*next)++]->name;
-	return NULL;
+	return devmap_list(next, "/obj/");
 }
 
 const char *VDev::devList(unsigned int *next)
 {
-	for (;*next<PX4_MAX_DEV; (*next)++)
-		if (devmap[*next] && strncmp(devmap[(*next)]->name, "/dev/", 5) == 0)
-			return devmap[(*next)++]->name;
-	return NULL;
+	return devmap_list(next, "/dev/");
 }
 
 } // namespace device
@@ -47,42 +47,128 @@
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
 #include <unistd.h>
 
 using namespace device;
 
 extern "C" {
 
-struct timerData {
-	sem_t &sem;
-	struct timespec &ts;
- 
-	timerData(sem_t &s, struct timespec &t) : sem(s), ts(t) {}
-	~timerData() {}
+/*
+ * The fd table is a two-level array of fixed size chunks. Chunks are
+ * allocated on demand and never freed, so px4_read/px4_write/px4_ioctl
+ * can look up an fd without taking a lock. Open and close take
+ * filemap_lock only to allocate or return fds from a free list in O(1).
+ *
+ * Each slot counts references: one for the open file, plus one for every
+ * call currently using it. A closed slot is only returned to the free list,
+ * and its embedded file_t reused, once the last reference is dropped.
+ */
+#define PX4_FD_CHUNK_SIZE	64
+#define PX4_MAX_FD_CHUNKS	256
+
+struct fd_chunk {
+	device::file_t *volatile map[PX4_FD_CHUNK_SIZE];
+	device::file_t files[PX4_FD_CHUNK_SIZE];
+	int refs[PX4_FD_CHUNK_SIZE];
+	int next_free[PX4_FD_CHUNK_SIZE];
 };
 
-static void *timer_handler(void *data)
+static fd_chunk *volatile filemap[PX4_MAX_FD_CHUNKS] = {};
+static unsigned filemap_chunks = 0;
+static int filemap_free = -1;
+static pthread_mutex_t filemap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int px4_errno;
+
+/* Must be called with filemap_lock held */
+static int alloc_fd()
 {
-	struct timerData *td = (struct timerData *)data;
+	if (filemap_free < 0) {
+		if (filemap_chunks >= PX4_MAX_FD_CHUNKS) {
+			return -1;
+		}
+
+		fd_chunk *chunk = new fd_chunk();
 
-	if (td->ts.tv_sec) {
-		sleep(td->ts.tv_sec);
+		if (chunk == NULL) {
+			return -1;
+		}
+
+		int base = filemap_chunks * PX4_FD_CHUNK_SIZE;
+
+		for (int i = 0; i < PX4_FD_CHUNK_SIZE; i++) {
+			chunk->next_free[i] = (i + 1 < PX4_FD_CHUNK_SIZE) ? base + i + 1 : -1;
+		}
+
+		__sync_synchronize();
+		filemap[filemap_chunks++] = chunk;
+		filemap_free = base;
 	}
-	usleep(td->ts.tv_nsec/1000);
-	sem_post(&(td->sem));
 
-	PX4_DEBUG("timer_handler: Timer expired");
-	return 0;
+	int fd = filemap_free;
+	filemap_free = filemap[fd / PX4_FD_CHUNK_SIZE]->next_free[fd % PX4_FD_CHUNK_SIZE];
+
+	return fd;
 }
 
-#define PX4_MAX_FD 100
-static device::file_t *filemap[PX4_MAX_FD] = {};
+/* Must be called with filemap_lock held */
+static void free_fd(int fd)
+{
+	fd_chunk *chunk = filemap[fd / PX4_FD_CHUNK_SIZE];
 
-int px4_errno;
+	chunk->next_free[fd % PX4_FD_CHUNK_SIZE] = filemap_free;
+	filemap_free = fd;
+}
+
+/* Drop a reference taken by get_file() or px4_open() */
+static void put_file(int fd)
+{
+	fd_chunk *chunk = filemap[fd / PX4_FD_CHUNK_SIZE];
+
+	if (__atomic_sub_fetch(&chunk->refs[fd % PX4_FD_CHUNK_SIZE], 1, __ATOMIC_ACQ_REL) == 0) {
+		/* closed and no longer used, the slot can be reused */
+		pthread_mutex_lock(&filemap_lock);
+		free_fd(fd);
+		pthread_mutex_unlock(&filemap_lock);
+	}
+}
 
-inline bool valid_fd(int fd)
+/*
+ * Look up an open fd and take a reference on it, so the file_t stays valid
+ * until put_file() even if the fd is closed meanwhile.
+ */
+static device::file_t *get_file(int fd)
 {
-	return (fd < PX4_MAX_FD && fd >= 0 && filemap[fd] != NULL);
+	if (fd < 0 || fd >= PX4_FD_CHUNK_SIZE * PX4_MAX_FD_CHUNKS) {
+		return NULL;
+	}
+
+	fd_chunk *chunk = filemap[fd / PX4_FD_CHUNK_SIZE];
+
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	int *refs = &chunk->refs[fd % PX4_FD_CHUNK_SIZE];
+	int n = __atomic_load_n(refs, __ATOMIC_ACQUIRE);
+
+	/* a slot without references is free or being set up, never revive it */
+	do {
+		if (n == 0) {
+			return NULL;
+		}
+	} while (!__atomic_compare_exchange_n(refs, &n, n + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+	device::file_t *filep = chunk->map[fd % PX4_FD_CHUNK_SIZE];
+
+	if (filep == NULL) {
+		/* being closed */
+		put_file(fd);
+	}
+
+	return filep;
 }
 
 int px4_open(const char *path, int flags, ...)
@@ -90,7 +176,7 @@ int px4_open(const char *path, int flags, ...)
 	PX4_DEBUG("px4_open");
 	VDev *dev = VDev::getDev(path);
 	int ret = 0;
-	int i;
+	int fd = -1;
 	mode_t mode;
 
 	if (!dev && (flags & (PX4_F_WRONLY|PX4_F_CREAT)) != 0 &&
@@ -107,16 +193,31 @@ int px4_open(const char *path, int flags, ...)
 		dev = VFile::createFile(path, mode);
 	}
 	if (dev) {
-		for (i=0; i<PX4_MAX_FD; ++i) {
-			if (filemap[i] == 0) {
-				filemap[i] = new device::file_t(flags,dev,i);
-				break;
+		pthread_mutex_lock(&filemap_lock);
+		fd = alloc_fd();
+		pthread_mutex_unlock(&filemap_lock);
+
+		if (fd >= 0) {
+			fd_chunk *chunk = filemap[fd / PX4_FD_CHUNK_SIZE];
+			device::file_t *filep = &chunk->files[fd % PX4_FD_CHUNK_SIZE];
+
+			*filep = device::file_t(flags, dev, fd);
+			ret = dev->open(filep);
+
+			if (ret < 0) {
+				pthread_mutex_lock(&filemap_lock);
+				free_fd(fd);
+				pthread_mutex_unlock(&filemap_lock);
+
+			} else {
+				// Publish the fd only once the file is fully set up,
+				// the open file holds the first reference
+				chunk->map[fd % PX4_FD_CHUNK_SIZE] = filep;
+				__atomic_store_n(&chunk->refs[fd % PX4_FD_CHUNK_SIZE], 1, __ATOMIC_RELEASE);
 			}
 		}
-		if (i < PX4_MAX_FD) {
-			ret = dev->open(filemap[i]);
-		}
 		else {
+			PX4_ERR("No free fd entries - increase PX4_MAX_FD_CHUNKS");
 			ret = -ENOENT;
 		}
 	}
@@ -127,20 +228,33 @@ int px4_open(const char *path, int flags, ...)
 		px4_errno = -ret;
 		return -1;
 	}
-	PX4_DEBUG("px4_open fd = %d", filemap[i]->fd);
-	return filemap[i]->fd;
+	PX4_DEBUG("px4_open fd = %d", fd);
+	return fd;
 }
 
 int px4_close(int fd)
 {
 	int ret;
-	if (valid_fd(fd)) {
-		VDev *dev = (VDev *)(filemap[fd]->vdev);
+	device::file_t *filep = get_file(fd);
+	device::file_t *expected = filep;
+
+	// Unpublish the fd, only one of several concurrent closes gets past this
+	if (filep && __atomic_compare_exchange_n(&filemap[fd / PX4_FD_CHUNK_SIZE]->map[fd % PX4_FD_CHUNK_SIZE],
+						 &expected, (device::file_t *)NULL, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		VDev *dev = (VDev *)(filep->vdev);
 		PX4_DEBUG("px4_close fd = %d", fd);
-		ret = dev->close(filemap[fd]);
-		filemap[fd] = NULL;
+		ret = dev->close(filep);
+
+		// Drop our reference and the one of the open file, the slot is
+		// reused once calls still using it are done
+		put_file(fd);
+		put_file(fd);
 	}
 	else { 
+		if (filep) {
+			put_file(fd);
+		}
+
                 ret = -EINVAL;
         }
 	if (ret < 0) {
@@ -153,10 +267,12 @@ int px4_close(int fd)
 ssize_t px4_read(int fd, void *buffer, size_t buflen)
 {
 	int ret;
-	if (valid_fd(fd)) {
-		VDev *dev = (VDev *)(filemap[fd]->vdev);
+	device::file_t *filep = get_file(fd);
+	if (filep) {
+		VDev *dev = (VDev *)(filep->vdev);
 		PX4_DEBUG("px4_read fd = %d", fd);
-		ret = dev->read(filemap[fd], (char *)buffer, buflen);
+		ret = dev->read(filep, (char *)buffer, buflen);
+		put_file(fd);
 	}
 	else { 
                 ret = -EINVAL;
@@ -171,10 +287,12 @@ ssize_t px4_read(int fd, void *buffer, size_t buflen)
 ssize_t px4_write(int fd, const void *buffer, size_t buflen)
 {
 	int ret;
-        if (valid_fd(fd)) {
-		VDev *dev = (VDev *)(filemap[fd]->vdev);
+	device::file_t *filep = get_file(fd);
+        if (filep) {
+		VDev *dev = (VDev *)(filep->vdev);
 		PX4_DEBUG("px4_write fd = %d", fd);
-		ret = dev->write(filemap[fd], (const char *)buffer, buflen);
+		ret = dev->write(filep, (const char *)buffer, buflen);
+		put_file(fd);
 	}
 	else { 
                 ret = -EINVAL;
@@ -190,9 +308,11 @@ int px4_ioctl(int fd, int cmd, unsigned long arg)
 {
 	PX4_DEBUG("px4_ioctl fd = %d", fd);
 	int ret = 0;
-        if (valid_fd(fd)) {
-		VDev *dev = (VDev *)(filemap[fd]->vdev);
-		ret = dev->ioctl(filemap[fd], cmd, arg);
+	device::file_t *filep = get_file(fd);
+        if (filep) {
+		VDev *dev = (VDev *)(filep->vdev);
+		ret = dev->ioctl(filep, cmd, arg);
+		put_file(fd);
 	}
 	else { 
                 ret = -EINVAL;
@@ -208,8 +328,10 @@ int px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout)
 {
 	sem_t sem;
 	int count = 0;
-	int ret;
+	int ret = 0;
 	unsigned int i;
+	unsigned int nsetup = 0;
+	unsigned int nheld = 0;
 	struct timespec ts;
 
 	PX4_DEBUG("Called px4_poll timeout = %d", timeout);
@@ -222,67 +344,79 @@ int px4_poll(px4_pollfd_struct_t *fds, nfds_t nfds, int timeout)
 		fds[i].revents = 0;
 		fds[i].priv    = NULL;
 
+		device::file_t *filep = get_file(fds[i].fd);
+		nheld = i + 1;
+
 		// If fd is valid
-		if (valid_fd(fds[i].fd))
+		if (filep)
 		{
-			VDev *dev = (VDev *)(filemap[fds[i].fd]->vdev);;
+			// The reference is held until teardown, so a concurrent
+			// close cannot recycle the file while it is polled.
+			// VDev::poll stores the same pointer here.
+			fds[i].priv = (void *)filep;
+
+			VDev *dev = (VDev *)(filep->vdev);
 			PX4_DEBUG("px4_poll: VDev->poll(setup) %d", fds[i].fd);
-			ret = dev->poll(filemap[fds[i].fd], &fds[i], true);
+			ret = dev->poll(filep, &fds[i], true);
 
 			if (ret < 0)
 				break;
 		}
+
+		nsetup = i + 1;
 	}
 
 	if (ret >= 0)
 	{
 		if (timeout >= 0)
 		{
-			pthread_t pt;
-			void *res;
-
-			ts.tv_sec = timeout/1000;
-			ts.tv_nsec = (timeout % 1000)*1000000;
-
-			// Create a timer to unblock
-			struct timerData td(sem, ts);
-			int rv = pthread_create(&pt, NULL, timer_handler, (void *)&td);
-			if (rv != 0) {
-				count = -1;
-				goto cleanup;
+			// Wait on the semaphore with an absolute deadline
+			// rather than spawning a thread to post it on timeout
+			px4_clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec += timeout / 1000;
+			ts.tv_nsec += (timeout % 1000) * 1000000;
+
+			if (ts.tv_nsec >= 1000000000) {
+				ts.tv_sec += 1;
+				ts.tv_nsec -= 1000000000;
 			}
-			sem_wait(&sem);
 
-			// Make sure timer thread is killed before sem goes
-			// out of scope
-			(void)pthread_cancel(pt);
-			(void)pthread_join(pt, &res);
-        	}
+			while (sem_timedwait(&sem, &ts) != 0) {
+				if (errno != EINTR) {
+					PX4_DEBUG("px4_poll: timeout expired");
+					break;
+				}
+			}
+		}
 		else
 		{
-			sem_wait(&sem);
+			while (sem_wait(&sem) != 0 && errno == EINTR) {}
 		}
 
-		// For each fd 
-		for (i=0; i<nfds; ++i)
+	}
+
+	// For each fd 
+	for (i=0; i<nheld; ++i)
+	{
+		device::file_t *filep = (device::file_t *)fds[i].priv;
+
+		// If fd was valid at setup
+		if (filep)
 		{
-			// If fd is valid
-			if (valid_fd(fds[i].fd))
+			if (ret >= 0 && i < nsetup)
 			{
-				VDev *dev = (VDev *)(filemap[fds[i].fd]->vdev);;
+				VDev *dev = (VDev *)(filep->vdev);
 				PX4_DEBUG("px4_poll: VDev->poll(teardown) %d", fds[i].fd);
-				ret = dev->poll(filemap[fds[i].fd], &fds[i], false);
-	
-				if (ret < 0)
-					break;
+				ret = dev->poll(filep, &fds[i], false);
 
-				if (fds[i].revents)
+				if (ret >= 0 && fds[i].revents)
 				count += 1;
 			}
+
+			put_file(fds[i].fd);
 		}
 	}
 
-cleanup:
 	sem_destroy(&sem);
 
 	return count;
@@ -70,7 +70,11 @@ typedef void	(* hrt_callout)(void *arg);
  * Callout record.
  */
 typedef struct hrt_call {
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+	struct dq_entry_s	link;		/* timer wheel slot, NULL flink while not queued, must start zeroed */
+#else
 	struct sq_entry_s	link;
+#endif
 
 	hrt_abstime		deadline;
 	hrt_abstime		period;
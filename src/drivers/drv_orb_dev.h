@@ -90,4 +90,13 @@
 /** Get the priority for the topic */
 #define ORBIOCGPRIORITY		_ORBIOC(14)
 
+/** Set the depth of the topic's publication queue, only valid before the first publication */
+#define ORBIOCSETQUEUESIZE	_ORBIOC(15)
+
+/** Borrow the next unread publication in place, sets *(const void **)arg */
+#define ORBIOCBORROW		_ORBIOC(16)
+
+/** Release a borrowed publication, fails with EAGAIN if it was overwritten while borrowed */
+#define ORBIOCRELEASE		_ORBIOC(17)
+
 #endif /* _DRV_UORB_H */
@@ -145,7 +145,12 @@
 #define BIT_INT_ANYRD_2CLEAR		0x10
 #define BIT_RAW_RDY_EN			0x01
 #define BIT_I2C_IF_DIS			0x10
+#define BIT_USER_CTRL_FIFO_EN		0x40
+#define BIT_USER_CTRL_FIFO_RST		0x04
 #define BIT_INT_STATUS_DATA		0x01
+#define BITS_FIFO_EN_TEMP		0x80
+#define BITS_FIFO_EN_GYRO		0x70
+#define BITS_FIFO_EN_ACCEL		0x08
 
 // Product ID Description for MPU6000
 // high 4 bits 	low 4 bits
@@ -175,6 +180,16 @@
 
 #define MPU6000_ONE_G					9.80665f
 
+/*
+  FIFO mode: the sensor queues every sample in its 1024 byte FIFO and
+  each poll reads all of them in SPI bursts of up to
+  MPU6000_FIFO_MAX_SAMPLES samples. The poll rate only sets how often
+  samples are delivered, not how many.
+ */
+#define MPU6000_FIFO_SIZE				1024
+#define MPU6000_FIFO_MAX_SAMPLES			16
+#define MPU6000_FIFO_DEFAULT_POLL_RATE			250
+
 #ifdef PX4_SPI_BUS_EXT
 #define EXTERNAL_BUS PX4_SPI_BUS_EXT
 #else
@@ -202,7 +217,8 @@ class MPU6000_gyro;
 class MPU6000 : public device::SPI
 {
 public:
-	MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation);
+	MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		bool fifo = false);
 	virtual ~MPU6000();
 
 	virtual int		init();
@@ -266,6 +282,7 @@ private:
 	perf_counter_t		_good_transfers;
 	perf_counter_t		_reset_retries;
 	perf_counter_t		_duplicates;
+	perf_counter_t		_fifo_overflows;
 	perf_counter_t		_system_latency_perf;
 	perf_counter_t		_controller_latency_perf;
 
@@ -281,10 +298,13 @@ private:
 
 	enum Rotation		_rotation;
 
+	// drain the sensor FIFO rather than read the data registers
+	bool			_fifo;
+
 	// this is used to support runtime checking of key
 	// configuration registers to detect SPI bus errors and sensor
 	// reset
-#define MPU6000_NUM_CHECKED_REGISTERS 9
+#define MPU6000_NUM_CHECKED_REGISTERS 10
 	static const uint8_t	_checked_registers[MPU6000_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_values[MPU6000_NUM_CHECKED_REGISTERS];
 	uint8_t			_checked_next;
@@ -333,6 +353,17 @@ private:
 	 */
 	void			measure();
 
+	/**
+	 * Fetch all samples queued in the sensor FIFO and update the report
+	 * buffers, with timestamps spaced at the sample rate.
+	 */
+	void			measure_fifo();
+
+	/**
+	 * Empty the sensor FIFO, after it overflowed.
+	 */
+	void			reset_fifo();
+
 	/**
 	 * Read a register from the MPU6000
 	 *
@@ -420,6 +451,17 @@ private:
 	*/
 	void _set_sample_rate(unsigned desired_sample_rate_hz);
 
+	/*
+	  rate the software filters run at, every sample in FIFO mode
+	 */
+	float _filter_sample_rate();
+
+	/*
+	  longest poll interval in microseconds that drains the FIFO
+	  before it overflows at the current sample rate
+	 */
+	unsigned _fifo_max_interval();
+
 	/*
 	  check that key registers still have the right value
 	 */
@@ -445,7 +487,48 @@ private:
 		uint8_t		gyro_y[2];
 		uint8_t		gyro_z[2];
 	};
+
+	/**
+	 * One sample as queued in the FIFO, in register order.
+	 */
+	struct MPUFIFOSample {
+		uint8_t		accel_x[2];
+		uint8_t		accel_y[2];
+		uint8_t		accel_z[2];
+		uint8_t		temp[2];
+		uint8_t		gyro_x[2];
+		uint8_t		gyro_y[2];
+		uint8_t		gyro_z[2];
+	};
+
+	/**
+	 * FIFO burst read, command byte followed by the samples.
+	 */
+	struct MPUFIFOReport {
+		uint8_t		cmd;
+		MPUFIFOSample	samples[MPU6000_FIFO_MAX_SAMPLES];
+	};
 #pragma pack(pop)
+
+	/**
+	 * A sample converted to native byte order.
+	 */
+	struct Report {
+		int16_t		accel_x;
+		int16_t		accel_y;
+		int16_t		accel_z;
+		int16_t		temp;
+		int16_t		gyro_x;
+		int16_t		gyro_y;
+		int16_t		gyro_z;
+	};
+
+	struct MPUFIFOReport	_fifo_report;
+
+	/**
+	 * Scale, filter, queue and publish one sample.
+	 */
+	void			process_sample(Report &report, hrt_abstime timestamp);
 };
 
 /*
@@ -460,7 +543,8 @@ const uint8_t MPU6000::_checked_registers[MPU6000_NUM_CHECKED_REGISTERS] = { MPU
 									     MPUREG_GYRO_CONFIG,
 									     MPUREG_ACCEL_CONFIG,
 									     MPUREG_INT_ENABLE,
-									     MPUREG_INT_PIN_CFG };
+									     MPUREG_INT_PIN_CFG,
+									     MPUREG_FIFO_EN };
 
 
 
@@ -497,7 +581,8 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int mpu6000_main(int argc, char *argv[]); }
 
-MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation) :
+MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev_e device, enum Rotation rotation,
+		 bool fifo) :
 	SPI("MPU6000", path_accel, bus, device, SPIDEV_MODE3, MPU6000_LOW_BUS_SPEED),
 	_gyro(new MPU6000_gyro(this, path_gyro)),
 	_product(0),
@@ -523,6 +608,7 @@ MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_good_transfers(perf_alloc(PC_COUNT, "mpu6000_good_transfers")),
 	_reset_retries(perf_alloc(PC_COUNT, "mpu6000_reset_retries")),
 	_duplicates(perf_alloc(PC_COUNT, "mpu6000_duplicates")),
+	_fifo_overflows(perf_alloc(PC_COUNT, "mpu6000_fifo_overflows")),
 	_system_latency_perf(perf_alloc_once(PC_ELAPSED, "sys_latency")),
 	_controller_latency_perf(perf_alloc_once(PC_ELAPSED, "ctrl_latency")),
 	_register_wait(0),
@@ -534,11 +620,13 @@ MPU6000::MPU6000(int bus, const char *path_accel, const char *path_gyro, spi_dev
 	_gyro_filter_y(MPU6000_GYRO_DEFAULT_RATE, MPU6000_GYRO_DEFAULT_DRIVER_FILTER_FREQ),
 	_gyro_filter_z(MPU6000_GYRO_DEFAULT_RATE, MPU6000_GYRO_DEFAULT_DRIVER_FILTER_FREQ),
 	_rotation(rotation),
+	_fifo(fifo),
 	_checked_next(0),
 	_in_factory_test(false),
 	_last_temperature(0),
 	_last_accel{},
-	_got_duplicate(false)
+	_got_duplicate(false),
+	_fifo_report{}
 {
 	// disable debug() calls
 	_debug_enabled = false;
@@ -594,6 +682,7 @@ MPU6000::~MPU6000()
 	perf_free(_good_transfers);
 	perf_free(_reset_retries);
 	perf_free(_duplicates);
+	perf_free(_fifo_overflows);
 }
 
 int
@@ -610,12 +699,12 @@ MPU6000::init()
 		return ret;
 	}
 
-	/* allocate basic report buffers */
-	_accel_reports = new ringbuffer::RingBuffer(2, sizeof(accel_report));
+	/* allocate basic report buffers, deep enough for a FIFO burst in FIFO mode */
+	_accel_reports = new ringbuffer::RingBuffer(_fifo ? MPU6000_FIFO_MAX_SAMPLES : 2, sizeof(accel_report));
 	if (_accel_reports == nullptr)
 		goto out;
 
-	_gyro_reports = new ringbuffer::RingBuffer(2, sizeof(gyro_report));
+	_gyro_reports = new ringbuffer::RingBuffer(_fifo ? MPU6000_FIFO_MAX_SAMPLES : 2, sizeof(gyro_report));
 	if (_gyro_reports == nullptr)
 		goto out;
 
@@ -648,6 +737,11 @@ MPU6000::init()
 
 	_accel_class_instance = register_class_devname(ACCEL_BASE_DEVICE_PATH);
 
+	if (_fifo) {
+		/* let the FIFO collect the first sample */
+		usleep(2000);
+	}
+
 	measure();
 
 	/* advertise sensor topic, measure manually to initialize valid report */
@@ -655,8 +749,16 @@ MPU6000::init()
 	_accel_reports->get(&arp);
 
 	/* measurement will have generated a report, publish */
-	_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
-		&_accel_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+	if (_fifo) {
+		/* queue every sample of a burst for the subscribers */
+		_accel_topic = orb_advertise_multi_queue(ORB_ID(sensor_accel), &arp,
+			&_accel_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH,
+			MPU6000_FIFO_MAX_SAMPLES);
+
+	} else {
+		_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
+			&_accel_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+	}
 
 	if (_accel_topic == nullptr) {
 		warnx("ADVERT FAIL");
@@ -667,8 +769,15 @@ MPU6000::init()
 	struct gyro_report grp;
 	_gyro_reports->get(&grp);
 
-	_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
-		&_gyro->_gyro_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+	if (_fifo) {
+		_gyro->_gyro_topic = orb_advertise_multi_queue(ORB_ID(sensor_gyro), &grp,
+			&_gyro->_gyro_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH,
+			MPU6000_FIFO_MAX_SAMPLES);
+
+	} else {
+		_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
+			&_gyro->_gyro_orb_class_instance, (is_external()) ? ORB_PRIO_MAX : ORB_PRIO_HIGH);
+	}
 
 	if (_gyro->_gyro_topic == nullptr) {
 		warnx("ADVERT FAIL");
@@ -745,6 +854,18 @@ int MPU6000::reset()
 	write_checked_reg(MPUREG_INT_PIN_CFG, BIT_INT_ANYRD_2CLEAR); // INT: Clear on any read
 	usleep(1000);
 
+	// FIFO: queue accel, temperature and gyro of every sample
+	if (_fifo) {
+		write_checked_reg(MPUREG_FIFO_EN, BITS_FIFO_EN_ACCEL | BITS_FIFO_EN_TEMP | BITS_FIFO_EN_GYRO);
+		write_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_RST);
+		usleep(1000);
+		write_checked_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN);
+
+	} else {
+		write_checked_reg(MPUREG_FIFO_EN, 0);
+	}
+	usleep(1000);
+
 	// Oscillator set
 	// write_reg(MPUREG_PWR_MGMT_1,MPU_CLK_SEL_PLLGYROZ);
 	usleep(1000);
@@ -799,6 +920,40 @@ MPU6000::_set_sample_rate(unsigned desired_sample_rate_hz)
 	if(div<1) div=1;
 	write_checked_reg(MPUREG_SMPLRT_DIV, div-1);
 	_sample_rate = 1000 / div;
+
+	if (_fifo) {
+		/* a faster sample rate fills the FIFO sooner, keep polling often enough */
+		if (_call_interval > _fifo_max_interval()) {
+			_call_interval = _fifo_max_interval();
+			_call.period = _call_interval;
+		}
+
+		// the software filters see every sample
+		float sample_rate = _filter_sample_rate();
+		_accel_filter_x.set_cutoff_frequency(sample_rate, _accel_filter_x.get_cutoff_freq());
+		_accel_filter_y.set_cutoff_frequency(sample_rate, _accel_filter_y.get_cutoff_freq());
+		_accel_filter_z.set_cutoff_frequency(sample_rate, _accel_filter_z.get_cutoff_freq());
+		_gyro_filter_x.set_cutoff_frequency(sample_rate, _gyro_filter_x.get_cutoff_freq());
+		_gyro_filter_y.set_cutoff_frequency(sample_rate, _gyro_filter_y.get_cutoff_freq());
+		_gyro_filter_z.set_cutoff_frequency(sample_rate, _gyro_filter_z.get_cutoff_freq());
+	}
+}
+
+float
+MPU6000::_filter_sample_rate()
+{
+	if (_fifo) {
+		return _sample_rate;
+	}
+
+	return 1.0e6f / _call_interval;
+}
+
+unsigned
+MPU6000::_fifo_max_interval()
+{
+	/* one sample of margin, a full FIFO counts as overflowed */
+	return (MPU6000_FIFO_SIZE / sizeof(MPUFIFOSample) - 1) * 1000000 / _sample_rate;
 }
 
 /*
@@ -831,6 +986,15 @@ MPU6000::_set_dlpf_filter(uint16_t frequency_hz)
 	} else {
 		filter = BITS_DLPF_CFG_2100HZ_NOLPF;
 	}
+
+	/*
+	  without the DLPF the gyro samples at 8kHz, and the FIFO
+	  timestamps assume the 1kHz base rate of _set_sample_rate()
+	 */
+	if (_fifo && (filter == BITS_DLPF_CFG_256HZ_NOLPF2 || filter == BITS_DLPF_CFG_2100HZ_NOLPF)) {
+		filter = BITS_DLPF_CFG_188HZ;
+	}
+
 	write_checked_reg(MPUREG_CONFIG, filter);
 }
 
@@ -1169,6 +1333,10 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 
 				/* switching to manual polling */
 			case SENSOR_POLLRATE_MANUAL:
+				/* reads spaced arbitrarily apart would overflow the FIFO */
+				if (_fifo)
+					return -EINVAL;
+
 				stop();
 				_call_interval = 0;
 				return OK;
@@ -1185,7 +1353,9 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 				return ioctl(filp, SENSORIOCSPOLLRATE, 1000);
 
 			case SENSOR_POLLRATE_DEFAULT:
-				return ioctl(filp, SENSORIOCSPOLLRATE, MPU6000_ACCEL_DEFAULT_RATE);
+				/* in FIFO mode every poll delivers the samples since the last one */
+				return ioctl(filp, SENSORIOCSPOLLRATE,
+					     _fifo ? MPU6000_FIFO_DEFAULT_POLL_RATE : MPU6000_ACCEL_DEFAULT_RATE);
 
 				/* adjust to a legal polling interval in Hz */
 			default: {
@@ -1199,9 +1369,17 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 					if (ticks < 1000)
 						return -EINVAL;
 
+					/* poll at least as often as the FIFO needs draining */
+					if (_fifo && ticks > _fifo_max_interval())
+						ticks = _fifo_max_interval();
+
+					/* update interval for next measurement */
+					/* XXX this is a bit shady, but no other way to adjust... */
+					_call_interval = ticks;
+
 					// adjust filters
 					float cutoff_freq_hz = _accel_filter_x.get_cutoff_freq();
-					float sample_rate = 1.0e6f/ticks;
+					float sample_rate = _filter_sample_rate();
 					_set_dlpf_filter(cutoff_freq_hz);
 					_accel_filter_x.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
 					_accel_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
@@ -1214,17 +1392,14 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 					_gyro_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz_gyro);
 					_gyro_filter_z.set_cutoff_frequency(sample_rate, cutoff_freq_hz_gyro);
 
-					/* update interval for next measurement */
-					/* XXX this is a bit shady, but no other way to adjust... */
-					_call_interval = ticks;
-
                                         /*
                                           set call interval faster then the sample time. We
                                           then detect when we have duplicate samples and reject
                                           them. This prevents aliasing due to a beat between the
-                                          stm32 clock and the mpu6000 clock
+                                          stm32 clock and the mpu6000 clock. The FIFO
+                                          has no duplicates.
                                          */
-                                        _call.period = _call_interval - MPU6000_TIMER_REDUCTION;
+                                        _call.period = _call_interval - (_fifo ? 0 : MPU6000_TIMER_REDUCTION);
 
 					/* if we need to start the poll state machine, do it */
 					if (want_start)
@@ -1273,9 +1448,9 @@ MPU6000::ioctl(struct file *filp, int cmd, unsigned long arg)
 		// set hardware filtering
 		_set_dlpf_filter(arg);
 		// set software filtering
-		_accel_filter_x.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_accel_filter_y.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_accel_filter_z.set_cutoff_frequency(1.0e6f / _call_interval, arg);
+		_accel_filter_x.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_accel_filter_y.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_accel_filter_z.set_cutoff_frequency(_filter_sample_rate(), arg);
 		return OK;
 
 	case ACCELIOCSSCALE:
@@ -1352,9 +1527,9 @@ MPU6000::gyro_ioctl(struct file *filp, int cmd, unsigned long arg)
 	case GYROIOCSLOWPASS:
 		// set hardware filtering
 		_set_dlpf_filter(arg);
-		_gyro_filter_x.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_gyro_filter_y.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_gyro_filter_z.set_cutoff_frequency(1.0e6f / _call_interval, arg);
+		_gyro_filter_x.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_gyro_filter_y.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_gyro_filter_z.set_cutoff_frequency(_filter_sample_rate(), arg);
 		return OK;
 
 	case GYROIOCSSCALE:
@@ -1504,7 +1679,7 @@ MPU6000::start()
 	/* start polling at the specified rate */
 	hrt_call_every(&_call,
                        1000,
-                       _call_interval-MPU6000_TIMER_REDUCTION,
+                       _call_interval - (_fifo ? 0 : MPU6000_TIMER_REDUCTION),
                        (hrt_callout)&MPU6000::measure_trampoline, this);
 }
 
@@ -1588,16 +1763,13 @@ MPU6000::measure()
 		return;
 	}
 
+	if (_fifo) {
+		measure_fifo();
+		return;
+	}
+
 	struct MPUReport mpu_report;
-	struct Report {
-		int16_t		accel_x;
-		int16_t		accel_y;
-		int16_t		accel_z;
-		int16_t		temp;
-		int16_t		gyro_x;
-		int16_t		gyro_y;
-		int16_t		gyro_z;
-	} report;
+	Report report;
 
 	/* start measuring */
 	perf_begin(_sample_perf);
@@ -1674,7 +1846,143 @@ MPU6000::measure()
 		return;
 	}
 
+	process_sample(report, hrt_absolute_time());
+
+	/* notify anyone waiting for data */
+	poll_notify(POLLIN);
+	_gyro->parent_poll_notify();
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU6000::measure_fifo()
+{
+	/* start measuring */
+	perf_begin(_sample_perf);
 
+	/*
+	 * Read how many bytes are queued, the newest sample was taken
+	 * at most one sample interval ago.
+	 */
+	uint8_t count[3] = { (uint8_t)(MPUREG_FIFO_COUNTH | DIR_READ), 0, 0 };
+
+        // sensor transfer at high clock speed
+        set_frequency(MPU6000_HIGH_BUS_SPEED);
+
+	if (OK != transfer(count, count, sizeof(count))) {
+		perf_count(_bad_transfers);
+		perf_end(_sample_perf);
+		return;
+	}
+
+	hrt_abstime now = hrt_absolute_time();
+	unsigned bytes = (count[1] << 8) | count[2];
+
+        check_registers();
+
+	if (bytes > MPU6000_FIFO_SIZE - sizeof(MPUFIFOSample)) {
+		// samples were lost and the FIFO may have lost its
+		// alignment to whole samples, start over
+		perf_count(_fifo_overflows);
+		reset_fifo();
+		perf_end(_sample_perf);
+		return;
+	}
+
+	unsigned samples = bytes / sizeof(MPUFIFOSample);
+
+	if (samples == 0) {
+		// no new sample since the last poll
+		perf_end(_sample_perf);
+		perf_count(_duplicates);
+		return;
+	}
+
+	const hrt_abstime interval = 1000000 / _sample_rate;
+	unsigned index = 0;
+	bool published = false;
+
+	/*
+	 * Fetch the samples in as few transfers as possible.
+	 */
+	while (index < samples) {
+		unsigned burst = samples - index;
+
+		if (burst > MPU6000_FIFO_MAX_SAMPLES)
+			burst = MPU6000_FIFO_MAX_SAMPLES;
+
+		_fifo_report.cmd = DIR_READ | MPUREG_FIFO_R_W;
+
+		if (OK != transfer((uint8_t *)&_fifo_report, (uint8_t *)&_fifo_report,
+				   1 + burst * sizeof(MPUFIFOSample))) {
+			perf_count(_bad_transfers);
+			break;
+		}
+
+		for (unsigned i = 0; i < burst; i++, index++) {
+			MPUFIFOSample &sample = _fifo_report.samples[i];
+			Report report;
+
+			/*
+			 * Convert from big to little endian
+			 */
+			report.accel_x = int16_t_from_bytes(sample.accel_x);
+			report.accel_y = int16_t_from_bytes(sample.accel_y);
+			report.accel_z = int16_t_from_bytes(sample.accel_z);
+
+			report.temp = int16_t_from_bytes(sample.temp);
+
+			report.gyro_x = int16_t_from_bytes(sample.gyro_x);
+			report.gyro_y = int16_t_from_bytes(sample.gyro_y);
+			report.gyro_z = int16_t_from_bytes(sample.gyro_z);
+
+			if (report.accel_x == 0 &&
+			    report.accel_y == 0 &&
+			    report.accel_z == 0 &&
+			    report.temp == 0 &&
+			    report.gyro_x == 0 &&
+			    report.gyro_y == 0 &&
+			    report.gyro_z == 0) {
+				// all zero data - probably a SPI bus error
+				perf_count(_bad_transfers);
+				continue;
+			}
+
+			perf_count(_good_transfers);
+
+			if (_register_wait != 0) {
+				// still drain the FIFO, but don't return any data yet
+				_register_wait--;
+				continue;
+			}
+
+			process_sample(report, now - (samples - 1 - index) * interval);
+			published = true;
+		}
+	}
+
+	if (published) {
+		/* notify anyone waiting for data */
+		poll_notify(POLLIN);
+		_gyro->parent_poll_notify();
+	}
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+MPU6000::reset_fifo()
+{
+	write_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_RST);
+	write_reg(MPUREG_USER_CTRL, BIT_I2C_IF_DIS | BIT_USER_CTRL_FIFO_EN);
+}
+
+void
+MPU6000::process_sample(Report &report, hrt_abstime timestamp)
+{
 	/*
 	 * Swap axes and negate y
 	 */
@@ -1701,7 +2009,7 @@ MPU6000::measure()
 	/*
 	 * Adjust and scale results to m/s^2.
 	 */
-	grb.timestamp = arb.timestamp = hrt_absolute_time();
+	grb.timestamp = arb.timestamp = timestamp;
 
 	// report the error count as the sum of the number of bad
 	// transfers and bad register reads. This allows the higher
@@ -1782,10 +2090,6 @@ MPU6000::measure()
 	_accel_reports->force(&arb);
 	_gyro_reports->force(&grb);
 
-	/* notify anyone waiting for data */
-	poll_notify(POLLIN);
-	_gyro->parent_poll_notify();
-
 	if (!(_pub_blocked)) {
 		/* log the time of this report */
 		perf_begin(_controller_latency_perf);
@@ -1798,9 +2102,6 @@ MPU6000::measure()
 		/* publish it */
 		orb_publish(ORB_ID(sensor_gyro), _gyro->_gyro_topic, &grb);
 	}
-
-	/* stop measuring */
-	perf_end(_sample_perf);
 }
 
 void
@@ -1814,6 +2115,8 @@ MPU6000::print_info()
 	perf_print_counter(_good_transfers);
 	perf_print_counter(_reset_retries);
 	perf_print_counter(_duplicates);
+	perf_print_counter(_fifo_overflows);
+	::printf("mode: %s\n", _fifo ? "FIFO" : "registers");
 	_accel_reports->print_info("accel queue");
 	_gyro_reports->print_info("gyro queue");
         ::printf("checked_next: %u\n", _checked_next);
@@ -1912,7 +2215,7 @@ namespace mpu6000
 MPU6000	*g_dev_int; // on internal bus
 MPU6000	*g_dev_ext; // on external bus
 
-void	start(bool, enum Rotation);
+void	start(bool, enum Rotation, bool);
 void	stop(bool);
 void	test(bool);
 void	reset(bool);
@@ -1929,7 +2232,7 @@ void	usage();
  * or failed to detect the sensor.
  */
 void
-start(bool external_bus, enum Rotation rotation)
+start(bool external_bus, enum Rotation rotation, bool fifo)
 {
 	int fd;
         MPU6000 **g_dev_ptr = external_bus?&g_dev_ext:&g_dev_int;
@@ -1943,12 +2246,12 @@ start(bool external_bus, enum Rotation rotation)
 	/* create the driver */
         if (external_bus) {
 #ifdef PX4_SPI_BUS_EXT
-		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation);
+		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_EXT, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_EXT_MPU, rotation, fifo);
 #else
 		errx(0, "External SPI not available");
 #endif
 	} else {
-		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation);
+		*g_dev_ptr = new MPU6000(PX4_SPI_BUS_SENSORS, path_accel, path_gyro, (spi_dev_e)PX4_SPIDEV_MPU, rotation, fifo);
 	}
 
 	if (*g_dev_ptr == nullptr)
@@ -2020,9 +2323,14 @@ test(bool external_bus)
 	if (fd_gyro < 0)
 		err(1, "%s open failed", path_gyro);
 
-	/* reset to manual polling */
-	if (ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MANUAL) < 0)
-		err(1, "reset to manual polling");
+	/* reset to manual polling, FIFO mode refuses it and keeps polling itself */
+	if (ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MANUAL) < 0) {
+		if (ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_DEFAULT) < 0)
+			err(1, "reset to default polling");
+
+		/* let a report arrive before the demand read */
+		usleep(20000);
+	}
 
 	/* do a simple demand read */
 	sz = read(fd, &a_report, sizeof(a_report));
@@ -2162,6 +2470,7 @@ usage()
 	warnx("options:");
 	warnx("    -X    (external bus)");
 	warnx("    -R rotation");
+	warnx("    -f    (read all samples from the FIFO)");
 }
 
 } // namespace
@@ -2172,13 +2481,17 @@ mpu6000_main(int argc, char *argv[])
 	bool external_bus = false;
 	int ch;
 	enum Rotation rotation = ROTATION_NONE;
+	bool fifo = false;
 
 	/* jump over start/off/etc and look at options first */
-	while ((ch = getopt(argc, argv, "XR:")) != EOF) {
+	while ((ch = getopt(argc, argv, "XR:f")) != EOF) {
 		switch (ch) {
 		case 'X':
 			external_bus = true;
 			break;
+		case 'f':
+			fifo = true;
+			break;
 		case 'R':
 			rotation = (enum Rotation)atoi(optarg);
 			break;
@@ -2195,7 +2508,7 @@ mpu6000_main(int argc, char *argv[])
 
 	 */
 	if (!strcmp(verb, "start")) {
-		mpu6000::start(external_bus, rotation);
+		mpu6000::start(external_bus, rotation, fifo);
 	}
 
 	if (!strcmp(verb, "stop")) {
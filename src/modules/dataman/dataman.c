@@ -51,6 +51,7 @@
 #include <string.h>
 #include <semaphore.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "dataman.h"
 #include <systemlib/param/param.h>
@@ -64,10 +65,13 @@
 __EXPORT int dataman_main(int argc, char *argv[]);
 __EXPORT ssize_t dm_read(dm_item_t item, unsigned char index, void *buffer, size_t buflen);
 __EXPORT ssize_t dm_write(dm_item_t  item, unsigned char index, dm_persitence_t persistence, const void *buffer, size_t buflen);
+__EXPORT ssize_t dm_read_range(dm_item_t item, unsigned char index, unsigned count, void *buffer, size_t buflen);
+__EXPORT ssize_t dm_write_range(dm_item_t item, unsigned char index, unsigned count, dm_persitence_t persistence, const void *buffer, size_t buflen);
 __EXPORT int dm_clear(dm_item_t item);
 __EXPORT void dm_lock(dm_item_t item);
 __EXPORT void dm_unlock(dm_item_t item);
 __EXPORT int dm_restart(dm_reset_reason restart_type);
+__EXPORT int dm_flush(void);
 
 /** Types of function calls supported by the worker task */
 typedef enum {
@@ -75,6 +79,9 @@ typedef enum {
 	dm_read_func,
 	dm_clear_func,
 	dm_restart_func,
+	dm_read_range_func,
+	dm_write_range_func,
+	dm_flush_func,
 	dm_number_of_funcs
 } dm_function_t;
 
@@ -105,6 +112,14 @@ typedef struct {
 		struct {
 			dm_reset_reason reason;
 		} restart_params;
+		struct {
+			dm_item_t item;
+			unsigned char index;
+			unsigned count;
+			dm_persitence_t persistence;
+			void *buf;
+			size_t buflen;
+		} range_params;
 	};
 } work_q_item_t;
 
@@ -155,6 +170,33 @@ static bool g_task_should_exit;	/**< if true, dataman task should exit */
 #define DM_SECTOR_HDR_SIZE 4	/* data manager per item header overhead */
 static const unsigned k_sector_size = DM_MAX_DATA_SIZE + DM_SECTOR_HDR_SIZE; /* total item sorage space */
 
+/* RAM mirror of the whole data manager file.
+ * When present, reads, writes, clears and restarts are served from memory in the caller's context and the
+ * worker thread only writes dirty sectors back to the file. Persistent items are flushed after a short
+ * coalescing delay, volatile items at the latest after DM_VOLATILE_FLUSH_INTERVAL.
+ */
+#define DM_FLUSH_DELAY_US		20000	/* time to collect further writes before flushing persistent items */
+#define DM_VOLATILE_FLUSH_INTERVAL_S	1	/* maximum age of unflushed volatile items */
+#define DM_IO_SECTORS		8	/* maximum number of sectors moved with one read() or write() */
+
+#ifdef __PX4_POSIX
+static bool g_cache_enabled = true;	/* plenty of RAM, always mirror the file */
+#else
+static bool g_cache_enabled = false;	/* about 100KB, must be requested with 'dataman start -c' */
+#endif
+static unsigned char *g_cache = NULL;	/* file contents, NULL if running without cache */
+static unsigned char *g_cache_dirty = NULL;	/* bitmap of sectors not yet written back */
+static unsigned g_cache_sectors;	/* number of sectors in the file */
+static unsigned g_cache_dirty_count;	/* number of bits set in g_cache_dirty */
+static struct timespec g_cache_dirty_since;	/* when g_cache_dirty_count last went from 0 to 1 */
+static bool g_flush_pending;		/* worker has been woken to flush persistent items */
+static sem_t g_cache_mutex;		/* protects the cache, bitmap and flush state */
+static unsigned g_flush_count;		/* number of write-back batches */
+static unsigned g_flush_errors;		/* number of failed write-backs */
+
+/* Sector buffer for multi-sector file I/O, only used by the worker thread */
+static unsigned char g_io_buf[DM_IO_SECTORS * (DM_MAX_DATA_SIZE + DM_SECTOR_HDR_SIZE)];
+
 static void init_q(work_q_t *q)
 {
 	sq_init(&(q->q));		/* Initialize the NuttX queue structure */
@@ -512,6 +554,484 @@ _restart(dm_reset_reason reason)
 	return result;
 }
 
+/* Calculate the offset in file of a range of items, -1 if any of them is out of range */
+static int
+calculate_range_offset(dm_item_t item, unsigned char index, unsigned count, size_t buflen)
+{
+	/* Make sure the whole range is valid, the item type itself is checked by calculate_offset() */
+	if (item >= DM_KEY_NUM_KEYS || (unsigned)index + count > g_per_item_max_index[item])
+		return -1;
+
+	/* Every item must fit into a sector */
+	if (buflen > DM_MAX_DATA_SIZE)
+		return -1;
+
+	return calculate_offset(item, index);
+}
+
+/* Retrieve consecutive items from the data manager file, DM_IO_SECTORS at a time */
+static ssize_t
+_read_range(dm_item_t item, unsigned char index, unsigned count, void *buf, size_t buflen)
+{
+	unsigned done = 0;
+	int offset = calculate_range_offset(item, index, count, buflen);
+
+	if (offset < 0)
+		return -1;
+
+	while (done < count) {
+		unsigned n = count - done;
+		ssize_t len = -1;
+
+		if (n > DM_IO_SECTORS)
+			n = DM_IO_SECTORS;
+
+		if (lseek(g_task_fd, offset, SEEK_SET) == offset)
+			len = read(g_task_fd, g_io_buf, n * k_sector_size);
+
+		/* Check for read error */
+		if (len < 0)
+			return -1;
+
+		/* Anything beyond the end of the file is an empty entry */
+		memset(g_io_buf + len, 0, n * k_sector_size - len);
+
+		for (unsigned i = 0; i < n; i++) {
+			unsigned char *sector = g_io_buf + i * k_sector_size;
+
+			/* Stop at the first item which is empty or of a different size */
+			if (sector[0] != buflen)
+				return done;
+
+			memcpy((unsigned char *)buf + done * buflen, sector + DM_SECTOR_HDR_SIZE, buflen);
+			done++;
+		}
+
+		offset += n * k_sector_size;
+	}
+
+	return done;
+}
+
+/* write consecutive items to the data manager file, DM_IO_SECTORS at a time */
+static ssize_t
+_write_range(dm_item_t item, unsigned char index, unsigned count, dm_persitence_t persistence, const void *buf, size_t buflen)
+{
+	unsigned done = 0;
+	int offset = calculate_range_offset(item, index, count, buflen);
+
+	if (offset < 0)
+		return -1;
+
+	while (done < count) {
+		unsigned n = count - done;
+
+		if (n > DM_IO_SECTORS)
+			n = DM_IO_SECTORS;
+
+		/* Whole sectors are written, the unused tail of each one is zeroed */
+		memset(g_io_buf, 0, n * k_sector_size);
+
+		for (unsigned i = 0; i < n; i++) {
+			unsigned char *sector = g_io_buf + i * k_sector_size;
+
+			sector[0] = buflen;
+			sector[1] = persistence;
+
+			if (buflen > 0) {
+				memcpy(sector + DM_SECTOR_HDR_SIZE, (const unsigned char *)buf + (done + i) * buflen, buflen);
+			}
+		}
+
+		ssize_t len = n * k_sector_size;
+
+		if (lseek(g_task_fd, offset, SEEK_SET) != offset || write(g_task_fd, g_io_buf, len) != len)
+			return -1;
+
+		done += n;
+		offset += len;
+	}
+
+	/* One sync for the whole range */
+	fsync(g_task_fd);
+
+	return done;
+}
+
+/* Set a sector's dirty bit, returns true if it is the first dirty one, cache mutex must be held */
+static bool
+_cache_set_dirty(unsigned sector)
+{
+	if (g_cache_dirty[sector / 8] & (1 << (sector % 8)))
+		return false;
+
+	g_cache_dirty[sector / 8] |= (1 << (sector % 8));
+
+	if (g_cache_dirty_count++ > 0)
+		return false;
+
+	clock_gettime(CLOCK_REALTIME, &g_cache_dirty_since);
+	return true;
+}
+
+/* Mark a cache sector as needing write-back, cache mutex must be held */
+static void
+_cache_mark_dirty(unsigned sector, dm_persitence_t persistence, bool *wake_worker)
+{
+	/* The worker may be blocked without a timeout, have it start the volatile flush timer */
+	if (_cache_set_dirty(sector))
+		*wake_worker = true;
+
+	/* Volatile items are picked up by the periodic flush, everything else wakes the worker */
+	if (persistence != DM_PERSIST_VOLATILE && !g_flush_pending) {
+		g_flush_pending = true;
+		*wake_worker = true;
+	}
+}
+
+/* Store one item in the RAM cache, cache mutex must be held */
+static void
+_cache_store(int offset, dm_persitence_t persistence, const void *buf, size_t count, bool *wake_worker)
+{
+	unsigned char *sector = g_cache + offset;
+
+	/* Avoid SD flash wear by only writing back items that actually changed */
+	if (sector[0] != count || sector[1] != persistence ||
+	    (count > 0 && memcmp(sector + DM_SECTOR_HDR_SIZE, buf, count) != 0)) {
+		sector[0] = count;
+		sector[1] = persistence;
+		sector[2] = 0;
+		sector[3] = 0;
+
+		if (count > 0) {
+			memcpy(sector + DM_SECTOR_HDR_SIZE, buf, count);
+		}
+
+		_cache_mark_dirty(offset / k_sector_size, persistence, wake_worker);
+	}
+}
+
+/* write to the RAM cache */
+static ssize_t
+_cache_write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const void *buf, size_t count)
+{
+	bool wake_worker = false;
+	int offset;
+
+	/* Get the offset for this item */
+	offset = calculate_offset(item, index);
+
+	/* If item type or index out of range, return error */
+	if (offset < 0)
+		return -1;
+
+	/* Make sure caller has not given us more data than we can handle */
+	if (count > DM_MAX_DATA_SIZE)
+		return -1;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		sem_post(&g_cache_mutex);
+		return -1;
+	}
+
+	_cache_store(offset, persistence, buf, count, &wake_worker);
+
+	sem_post(&g_cache_mutex);
+
+	if (wake_worker)
+		sem_post(&g_work_queued_sema);
+
+	return count;
+}
+
+/* Retrieve from the RAM cache */
+static ssize_t
+_cache_read(dm_item_t item, unsigned char index, void *buf, size_t count)
+{
+	ssize_t result;
+	int offset;
+
+	/* Get the offset for this item */
+	offset = calculate_offset(item, index);
+
+	/* If item type or index out of range, return error */
+	if (offset < 0)
+		return -1;
+
+	/* Make sure the caller hasn't asked for more data than we can handle */
+	if (count > DM_MAX_DATA_SIZE)
+		return -1;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		result = -1;
+
+	} else if (g_cache[offset] > count) {
+		/* We got more than requested!!! */
+		result = -1;
+
+	} else {
+		result = g_cache[offset];
+		memcpy(buf, g_cache + offset + DM_SECTOR_HDR_SIZE, result);
+	}
+
+	sem_post(&g_cache_mutex);
+
+	return result;
+}
+
+/* write consecutive items to the RAM cache */
+static ssize_t
+_cache_write_range(dm_item_t item, unsigned char index, unsigned count, dm_persitence_t persistence, const void *buf,
+		   size_t buflen)
+{
+	bool wake_worker = false;
+	int offset = calculate_range_offset(item, index, count, buflen);
+
+	if (offset < 0)
+		return -1;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		sem_post(&g_cache_mutex);
+		return -1;
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		_cache_store(offset, persistence, (const unsigned char *)buf + i * buflen, buflen, &wake_worker);
+		offset += k_sector_size;
+	}
+
+	sem_post(&g_cache_mutex);
+
+	if (wake_worker)
+		sem_post(&g_work_queued_sema);
+
+	return count;
+}
+
+/* Retrieve consecutive items from the RAM cache */
+static ssize_t
+_cache_read_range(dm_item_t item, unsigned char index, unsigned count, void *buf, size_t buflen)
+{
+	unsigned done = 0;
+	int offset = calculate_range_offset(item, index, count, buflen);
+
+	if (offset < 0)
+		return -1;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		sem_post(&g_cache_mutex);
+		return -1;
+	}
+
+	/* Stop at the first item which is empty or of a different size */
+	while (done < count && g_cache[offset] == buflen) {
+		memcpy((unsigned char *)buf + done * buflen, g_cache + offset + DM_SECTOR_HDR_SIZE, buflen);
+		offset += k_sector_size;
+		done++;
+	}
+
+	sem_post(&g_cache_mutex);
+
+	return done;
+}
+
+static int
+_cache_clear(dm_item_t item)
+{
+	bool wake_worker = false;
+
+	/* Get the offset of 1st item of this type */
+	int offset = calculate_offset(item, 0);
+
+	/* Check for item type out of range */
+	if (offset < 0)
+		return -1;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		sem_post(&g_cache_mutex);
+		return -1;
+	}
+
+	/* Clear all items of this type which hold data */
+	for (unsigned i = 0; i < g_per_item_max_index[item]; i++) {
+		if (g_cache[offset]) {
+			g_cache[offset] = 0;
+			_cache_mark_dirty(offset / k_sector_size, DM_PERSIST_POWER_ON_RESET, &wake_worker);
+		}
+
+		offset += k_sector_size;
+	}
+
+	sem_post(&g_cache_mutex);
+
+	if (wake_worker)
+		sem_post(&g_work_queued_sema);
+
+	return 0;
+}
+
+/** Tell the RAM cache about the type of the last reset */
+static int
+_cache_restart(dm_reset_reason reason)
+{
+	bool wake_worker = false;
+
+	sem_wait(&g_cache_mutex);
+
+	if (g_cache == NULL) {
+		sem_post(&g_cache_mutex);
+		return -1;
+	}
+
+	/* Same rules as _restart(): invalidate whatever does not survive this type of reset */
+	dm_persitence_t max_persistence = (reason == DM_INIT_REASON_POWER_ON) ?
+					  DM_PERSIST_POWER_ON_RESET : DM_PERSIST_IN_FLIGHT_RESET;
+
+	for (unsigned i = 0; i < g_cache_sectors; i++) {
+		unsigned char *sector = g_cache + i * k_sector_size;
+
+		if (sector[0] && sector[1] > max_persistence) {
+			sector[0] = 0;
+			_cache_mark_dirty(i, DM_PERSIST_POWER_ON_RESET, &wake_worker);
+		}
+	}
+
+	sem_post(&g_cache_mutex);
+
+	if (wake_worker)
+		sem_post(&g_work_queued_sema);
+
+	return 0;
+}
+
+/* Write dirty cache sectors back to the data manager file, called by the worker thread only */
+static int
+_cache_flush(void)
+{
+	unsigned sector = 0;
+	bool written = false;
+	int result = 0;
+
+	while (sector < g_cache_sectors) {
+		unsigned first, count = 0;
+
+		/* Grab the next run of dirty sectors, the file I/O itself is done without holding the lock */
+		sem_wait(&g_cache_mutex);
+
+		while (sector < g_cache_sectors && !(g_cache_dirty[sector / 8] & (1 << (sector % 8))))
+			sector++;
+
+		first = sector;
+
+		while (sector < g_cache_sectors && count < DM_IO_SECTORS &&
+		       (g_cache_dirty[sector / 8] & (1 << (sector % 8)))) {
+			g_cache_dirty[sector / 8] &= ~(1 << (sector % 8));
+			g_cache_dirty_count--;
+			sector++;
+			count++;
+		}
+
+		if (count > 0)
+			memcpy(g_io_buf, g_cache + first * k_sector_size, count * k_sector_size);
+
+		sem_post(&g_cache_mutex);
+
+		if (count == 0)
+			break;
+
+		int offset = first * k_sector_size;
+		ssize_t len = count * k_sector_size;
+
+		if (lseek(g_task_fd, offset, SEEK_SET) != offset || write(g_task_fd, g_io_buf, len) != len) {
+			/* Keep the sectors dirty so that the next flush retries them */
+			sem_wait(&g_cache_mutex);
+
+			for (unsigned i = first; i < first + count; i++)
+				_cache_set_dirty(i);
+
+			sem_post(&g_cache_mutex);
+
+			g_flush_errors++;
+			result = -1;
+			break;
+		}
+
+		written = true;
+	}
+
+	/* One sync for the whole batch */
+	if (written) {
+		fsync(g_task_fd);
+		g_flush_count++;
+	}
+
+	return result;
+}
+
+/* Load the data manager file into RAM, returns false if running without cache */
+static bool
+_cache_init(unsigned file_size)
+{
+	g_cache_sectors = file_size / k_sector_size;
+	g_cache_dirty_count = 0;
+	g_flush_pending = false;
+	g_flush_count = 0;
+	g_flush_errors = 0;
+
+	g_cache = (unsigned char *)malloc(file_size);
+	g_cache_dirty = (unsigned char *)calloc((g_cache_sectors + 7) / 8, 1);
+
+	if (g_cache == NULL || g_cache_dirty == NULL) {
+		warnx("No memory for %u byte RAM cache, using file only", file_size);
+		free(g_cache);
+		free(g_cache_dirty);
+		g_cache = NULL;
+		g_cache_dirty = NULL;
+		return false;
+	}
+
+	/* Whatever is beyond the end of the file is an empty item */
+	ssize_t len = -1;
+
+	if (lseek(g_task_fd, 0, SEEK_SET) == 0)
+		len = read(g_task_fd, g_cache, file_size);
+
+	if (len < 0)
+		len = 0;
+
+	memset(g_cache + len, 0, file_size - len);
+
+	sem_init(&g_cache_mutex, 1, 1);
+
+	return true;
+}
+
+/* Write back anything left and release the cache, called by the worker thread on exit */
+static void
+_cache_deinit(void)
+{
+	_cache_flush();
+
+	sem_wait(&g_cache_mutex);
+	free(g_cache);
+	free(g_cache_dirty);
+	g_cache = NULL;
+	g_cache_dirty = NULL;
+	sem_post(&g_cache_mutex);
+
+	sem_destroy(&g_cache_mutex);
+}
+
 /** Write to the data manager file */
 __EXPORT ssize_t
 dm_write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const void *buf, size_t count)
@@ -522,6 +1042,12 @@ dm_write(dm_item_t item, unsigned char index, dm_persitence_t persistence, const
 	if ((g_fd < 0) || g_task_should_exit)
 		return -1;
 
+	/* Served from RAM, the worker thread writes it back to the file later */
+	if (g_cache != NULL) {
+		g_func_counts[dm_write_func]++;
+		return _cache_write(item, index, persistence, buf, count);
+	}
+
 	/* get a work item and queue up a write request */
 	if ((work = create_work_item()) == NULL)
 		return -1;
@@ -547,6 +1073,12 @@ dm_read(dm_item_t item, unsigned char index, void *buf, size_t count)
 	if ((g_fd < 0) || g_task_should_exit)
 		return -1;
 
+	/* Served from RAM without a round trip through the worker thread */
+	if (g_cache != NULL) {
+		g_func_counts[dm_read_func]++;
+		return _cache_read(item, index, buf, count);
+	}
+
 	/* get a work item and queue up a read request */
 	if ((work = create_work_item()) == NULL)
 		return -1;
@@ -561,6 +1093,75 @@ dm_read(dm_item_t item, unsigned char index, void *buf, size_t count)
 	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
 }
 
+/** Write consecutive items to the data manager file */
+__EXPORT ssize_t
+dm_write_range(dm_item_t item, unsigned char index, unsigned count, dm_persitence_t persistence, const void *buf, size_t buflen)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit)
+		return -1;
+
+	if (count == 0)
+		return 0;
+
+	/* Served from RAM, the worker thread writes it back to the file later */
+	if (g_cache != NULL) {
+		g_func_counts[dm_write_range_func]++;
+		return _cache_write_range(item, index, count, persistence, buf, buflen);
+	}
+
+	/* get a work item and queue up a range write request */
+	if ((work = create_work_item()) == NULL)
+		return -1;
+
+	work->func = dm_write_range_func;
+	work->range_params.item = item;
+	work->range_params.index = index;
+	work->range_params.count = count;
+	work->range_params.persistence = persistence;
+	work->range_params.buf = (void *)buf;
+	work->range_params.buflen = buflen;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
+/** Retrieve consecutive items from the data manager file */
+__EXPORT ssize_t
+dm_read_range(dm_item_t item, unsigned char index, unsigned count, void *buf, size_t buflen)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit)
+		return -1;
+
+	if (count == 0)
+		return 0;
+
+	/* Served from RAM without a round trip through the worker thread */
+	if (g_cache != NULL) {
+		g_func_counts[dm_read_range_func]++;
+		return _cache_read_range(item, index, count, buf, buflen);
+	}
+
+	/* get a work item and queue up a range read request */
+	if ((work = create_work_item()) == NULL)
+		return -1;
+
+	work->func = dm_read_range_func;
+	work->range_params.item = item;
+	work->range_params.index = index;
+	work->range_params.count = count;
+	work->range_params.buf = buf;
+	work->range_params.buflen = buflen;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return (ssize_t)enqueue_work_item_and_wait_for_result(work);
+}
+
 __EXPORT int
 dm_clear(dm_item_t item)
 {
@@ -570,6 +1171,11 @@ dm_clear(dm_item_t item)
 	if ((g_fd < 0) || g_task_should_exit)
 		return -1;
 
+	if (g_cache != NULL) {
+		g_func_counts[dm_clear_func]++;
+		return _cache_clear(item);
+	}
+
 	/* get a work item and queue up a clear request */
 	if ((work = create_work_item()) == NULL)
 		return -1;
@@ -617,6 +1223,11 @@ dm_restart(dm_reset_reason reason)
 	if ((g_fd < 0) || g_task_should_exit)
 		return -1;
 
+	if (g_cache != NULL) {
+		g_func_counts[dm_restart_func]++;
+		return _cache_restart(reason);
+	}
+
 	/* get a work item and queue up a restart request */
 	if ((work = create_work_item()) == NULL)
 		return -1;
@@ -628,6 +1239,26 @@ dm_restart(dm_reset_reason reason)
 	return enqueue_work_item_and_wait_for_result(work);
 }
 
+/* Write back everything that is only held in RAM */
+__EXPORT int
+dm_flush(void)
+{
+	work_q_item_t *work;
+
+	/* Make sure data manager has been started and is not shutting down */
+	if ((g_fd < 0) || g_task_should_exit)
+		return -1;
+
+	/* get a work item and queue up a flush request */
+	if ((work = create_work_item()) == NULL)
+		return -1;
+
+	work->func = dm_flush_func;
+
+	/* Enqueue the item on the work queue and wait for the worker thread to complete processing it */
+	return enqueue_work_item_and_wait_for_result(work);
+}
+
 static int
 task_main(int argc, char *argv[])
 {
@@ -692,18 +1323,37 @@ task_main(int argc, char *argv[])
 		return -1;
 	}
 
+#ifdef __PX4_POSIX
+	/* Seeking does not grow the file here, do it so that a short last item cannot fail the size check on the next start */
+	if ((unsigned)lseek(g_task_fd, 0, SEEK_END) < max_offset && ftruncate(g_task_fd, max_offset) != 0) {
+		close(g_task_fd);
+		warnx("Could not size data manager file %s", k_data_manager_device_path);
+		sem_post(&g_init_sema); /* Don't want to hang startup */
+		return -1;
+	}
+#endif
+
 	fsync(g_task_fd);
 
+	if (g_cache_enabled)
+		_cache_init(max_offset);
+
 	printf("dataman: ");
 	/* see if we need to erase any items based on restart type */
 	int sys_restart_val;
 	if (param_get(param_find("SYS_RESTART_TYPE"), &sys_restart_val) == OK) {
 		if (sys_restart_val == DM_INIT_REASON_POWER_ON) {
 			printf("Power on restart");
-			_restart(DM_INIT_REASON_POWER_ON);
+			if (g_cache != NULL)
+				_cache_restart(DM_INIT_REASON_POWER_ON);
+			else
+				_restart(DM_INIT_REASON_POWER_ON);
 		} else if (sys_restart_val == DM_INIT_REASON_IN_FLIGHT) {
 			printf("In flight restart");
-			_restart(DM_INIT_REASON_IN_FLIGHT);
+			if (g_cache != NULL)
+				_cache_restart(DM_INIT_REASON_IN_FLIGHT);
+			else
+				_restart(DM_INIT_REASON_IN_FLIGHT);
 		} else {
 			printf("Unknown restart");
 		}
@@ -711,12 +1361,19 @@ task_main(int argc, char *argv[])
 		printf("Unknown restart");
 	}
 
+	/* Write back the restart invalidations before accepting requests */
+	if (g_cache != NULL) {
+		g_flush_pending = false;
+		_cache_flush();
+	}
+
 	/* We use two file descriptors, one for the caller context and one for the worker thread */
 	/* They are actually the same but we need to some way to reject caller request while the */
 	/* worker thread is shutting down but still processing requests */
 	g_fd = g_task_fd;
 
-	printf(", data manager file '%s' size is %d bytes\n", k_data_manager_device_path, max_offset);
+	printf(", data manager file '%s' size is %d bytes%s\n", k_data_manager_device_path, max_offset,
+	       (g_cache != NULL) ? ", cached in RAM" : "");
 
 	/* Tell startup that the worker thread has completed its initialization */
 	sem_post(&g_init_sema);
@@ -730,9 +1387,24 @@ task_main(int argc, char *argv[])
 			g_fd = -1;
 		}
 
+		bool flush = g_task_should_exit;
+
 		if (!g_task_should_exit) {
-			/* wait for work */
-			sem_wait(&g_work_queued_sema);
+			if (g_cache != NULL && g_cache_dirty_count > 0 && !g_flush_pending) {
+				/* only volatile items are dirty, write them back once the oldest is due */
+				struct timespec abstime;
+				sem_wait(&g_cache_mutex);
+				abstime = g_cache_dirty_since;
+				sem_post(&g_cache_mutex);
+				abstime.tv_sec += DM_VOLATILE_FLUSH_INTERVAL_S;
+
+				if (sem_timedwait(&g_work_queued_sema, &abstime) != 0)
+					flush = true;
+
+			} else {
+				/* wait for work */
+				sem_wait(&g_work_queued_sema);
+			}
 		}
 
 		/* Empty the work queue */
@@ -762,6 +1434,25 @@ task_main(int argc, char *argv[])
 				work->result = _restart(work->restart_params.reason);
 				break;
 
+			case dm_read_range_func:
+				g_func_counts[dm_read_range_func]++;
+				work->result =
+					_read_range(work->range_params.item, work->range_params.index, work->range_params.count,
+						    work->range_params.buf, work->range_params.buflen);
+				break;
+
+			case dm_write_range_func:
+				g_func_counts[dm_write_range_func]++;
+				work->result =
+					_write_range(work->range_params.item, work->range_params.index, work->range_params.count,
+						     work->range_params.persistence, work->range_params.buf, work->range_params.buflen);
+				break;
+
+			case dm_flush_func:
+				g_func_counts[dm_flush_func]++;
+				work->result = (g_cache != NULL) ? _cache_flush() : fsync(g_task_fd);
+				break;
+
 			default: /* should never happen */
 				work->result = -1;
 				break;
@@ -771,11 +1462,26 @@ task_main(int argc, char *argv[])
 			sem_post(&work->wait_sem);
 		}
 
+		if (g_cache != NULL && (flush || g_flush_pending)) {
+			/* Give writers a moment so that e.g. a whole mission upload goes out in a few batches */
+			if (!flush)
+				usleep(DM_FLUSH_DELAY_US);
+
+			sem_wait(&g_cache_mutex);
+			g_flush_pending = false;
+			sem_post(&g_cache_mutex);
+
+			_cache_flush();
+		}
+
 		/* time to go???? */
 		if ((g_task_should_exit) && (g_fd < 0))
 			break;
 	}
 
+	if (g_cache != NULL)
+		_cache_deinit();
+
 	close(g_task_fd);
 	g_task_fd = -1;
 
@@ -792,6 +1498,9 @@ task_main(int argc, char *argv[])
 	sem_destroy(&g_work_queued_sema);
 	sem_destroy(&g_sys_state_mutex);
 
+	/* Tell stop that everything is on file */
+	sem_post(&g_init_sema);
+
 	return 0;
 }
 
@@ -823,21 +1532,35 @@ status(void)
 	warnx("Reads    %d", g_func_counts[dm_read_func]);
 	warnx("Clears   %d", g_func_counts[dm_clear_func]);
 	warnx("Restarts %d", g_func_counts[dm_restart_func]);
+	warnx("Range reads %d, writes %d", g_func_counts[dm_read_range_func], g_func_counts[dm_write_range_func]);
+	warnx("Flushes  %d", g_func_counts[dm_flush_func]);
 	warnx("Max Q lengths work %d, free %d", g_work_q.max_size, g_free_q.max_size);
+
+	if (g_cache != NULL) {
+		warnx("RAM cache %u bytes, %u dirty, %u flushes, %u errors",
+		      g_cache_sectors * k_sector_size, g_cache_dirty_count, g_flush_count, g_flush_errors);
+	}
 }
 
 static void
 stop(void)
 {
+	sem_init(&g_init_sema, 1, 0);
+
 	/* Tell the worker task to shut down */
 	g_task_should_exit = true;
 	sem_post(&g_work_queued_sema);
+
+	/* wait for the dirty items to be written back and the file to be closed */
+	sem_wait(&g_init_sema);
+	sem_destroy(&g_init_sema);
 }
 
 static void
 usage(void)
 {
-	warnx("usage: dataman {start [-f datafile]|stop|status|poweronrestart|inflightrestart}");
+	warnx("usage: dataman {start [-f datafile] [-c]|stop|status|poweronrestart|inflightrestart}");
+	warnx("       -c  keep a RAM copy of the data file (default on POSIX)");
 }
 
 int
@@ -854,11 +1577,25 @@ dataman_main(int argc, char *argv[])
 			warnx("dataman already running");
 			return -1;
 		}
-		if (argc == 4 && strcmp(argv[2],"-f") == 0) {
-			k_data_manager_device_path = strdup(argv[3]);
-			warnx("dataman file set to: %s\n", k_data_manager_device_path);
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+				free(k_data_manager_device_path);
+				k_data_manager_device_path = strdup(argv[++i]);
+				warnx("dataman file set to: %s\n", k_data_manager_device_path);
+			}
+			else if (strcmp(argv[i], "-c") == 0) {
+				g_cache_enabled = true;
+			}
+			else {
+				free(k_data_manager_device_path);
+				k_data_manager_device_path = NULL;
+				usage();
+				return -1;
+			}
 		}
-		else {
+
+		/* without -f, a restart keeps using the file of the previous run */
+		if (k_data_manager_device_path == NULL) {
 			k_data_manager_device_path = strdup(default_device_path);
 		}
 
@@ -881,11 +1618,8 @@ dataman_main(int argc, char *argv[])
 		return -1;
 	}
 
-	if (!strcmp(argv[1], "stop")) {
+	if (!strcmp(argv[1], "stop"))
 		stop();
-		free(k_data_manager_device_path);
-		k_data_manager_device_path = NULL;
-	}
 	else if (!strcmp(argv[1], "status"))
 		status();
 	else if (!strcmp(argv[1], "poweronrestart"))
@@ -109,6 +109,34 @@ extern "C" {
 		size_t buflen			/* Length in bytes of data to retrieve */
 	);
 
+	/**
+	 * Retrieve count consecutive items of buflen bytes each, starting at index, into buffer.
+	 * Returns the number of items read, which stops short at the first item whose stored length
+	 * is not buflen (e.g. an empty one), or -1 on error.
+	 */
+	__EXPORT ssize_t
+	dm_read_range(
+		dm_item_t item,			/* The item type to retrieve */
+		unsigned char index,		/* The index of the first item */
+		unsigned count,			/* Number of items to retrieve */
+		void *buffer,			/* Pointer to caller data buffer, count * buflen bytes */
+		size_t buflen			/* Length in bytes of each item */
+	);
+
+	/**
+	 * Write count consecutive items of buflen bytes each, starting at index, from buffer.
+	 * Returns the number of items written or -1 on error.
+	 */
+	__EXPORT ssize_t
+	dm_write_range(
+		dm_item_t item,			/* The item type to store */
+		unsigned char index,		/* The index of the first item */
+		unsigned count,			/* Number of items to store */
+		dm_persitence_t persistence,	/* The persistence level of these items */
+		const void *buffer,		/* Pointer to caller data buffer, count * buflen bytes */
+		size_t buflen			/* Length in bytes of each item */
+	);
+
 	/** Lock all items of this type */
 	__EXPORT void
 	dm_lock(
@@ -133,6 +161,10 @@ extern "C" {
 		dm_reset_reason restart_type	/* The last reset type */
 	);
 
+	/** Write back all items that are so far only held in the RAM cache */
+	__EXPORT int
+	dm_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
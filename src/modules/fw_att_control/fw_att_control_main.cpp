@@ -346,7 +346,7 @@ FixedwingAttitudeControl::FixedwingAttitudeControl() :
 	_actuators_id(0),
 
 /* performance counters */
-	_loop_perf(perf_alloc(PC_ELAPSED, "fw att control")),
+	_loop_perf(perf_alloc(PC_HISTOGRAM, "fw att control")),
 	_nonfinite_input_perf(perf_alloc(PC_COUNT, "fw att control nonfinite input")),
 	_nonfinite_output_perf(perf_alloc(PC_COUNT, "fw att control nonfinite output")),
 /* states */
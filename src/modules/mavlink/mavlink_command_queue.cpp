@@ -0,0 +1,143 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_command_queue.cpp
+ * Bounded lock-free queue carrying stream configuration requests to the mavlink main loop.
+ *
+ * Every slot carries the queue position it is free for. Producers reserve
+ * positions with a compare-and-swap on the head, fill the slots and publish
+ * them by advancing their sequence. The single consumer frees slots in order,
+ * so a free last slot of a reservation implies all slots before it are free.
+ */
+
+#include <string.h>
+
+#include "mavlink_command_queue.h"
+
+MavlinkCommandQueue::MavlinkCommandQueue() :
+	_slots{},
+	_head(0),
+	_tail(0),
+	_completed(0),
+	_dropped(0)
+{
+	for (unsigned i = 0; i < CAPACITY; i++) {
+		_slots[i].seq = i;
+	}
+}
+
+bool
+MavlinkCommandQueue::push(const char *stream_name, float rate, uint32_t *ticket)
+{
+	return push(&stream_name, &rate, 1, ticket);
+}
+
+bool
+MavlinkCommandQueue::push(const char *const *stream_names, const float *rates, unsigned count, uint32_t *ticket)
+{
+	if (count == 0 || count > CAPACITY) {
+		return false;
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		if (strlen(stream_names[i]) >= NAME_LEN) {
+			return false;
+		}
+	}
+
+	uint32_t pos;
+
+	for (;;) {
+		pos = _head;
+		const slot &last = _slots[(pos + count - 1) & (CAPACITY - 1)];
+		int32_t diff = (int32_t)(last.seq - (pos + count - 1));
+
+		if (diff == 0) {
+			if (__sync_bool_compare_and_swap(&_head, pos, pos + count)) {
+				break;
+			}
+
+		} else if (diff < 0) {
+			/* consumer has not caught up */
+			__sync_fetch_and_add(&_dropped, count);
+			return false;
+		}
+
+		/* another producer got there first, retry */
+	}
+
+	for (unsigned i = 0; i < count; i++) {
+		slot &s = _slots[(pos + i) & (CAPACITY - 1)];
+		strcpy(s.cmd.stream_name, stream_names[i]);
+		s.cmd.rate = rates[i];
+
+		/* the command must be visible before the slot is published */
+		__sync_synchronize();
+		s.seq = pos + i + 1;
+	}
+
+	if (ticket != nullptr) {
+		*ticket = pos + count;
+	}
+
+	return true;
+}
+
+bool
+MavlinkCommandQueue::pop(command *cmd)
+{
+	slot &s = _slots[_tail & (CAPACITY - 1)];
+
+	if ((int32_t)(s.seq - (_tail + 1)) < 0) {
+		/* empty, or the producer is still filling the slot */
+		return false;
+	}
+
+	__sync_synchronize();
+	*cmd = s.cmd;
+	__sync_synchronize();
+
+	s.seq = _tail + CAPACITY;
+	_tail++;
+
+	return true;
+}
+
+void
+MavlinkCommandQueue::complete()
+{
+	__sync_synchronize();
+	_completed = _tail;
+}
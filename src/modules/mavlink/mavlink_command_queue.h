@@ -0,0 +1,111 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_command_queue.h
+ * Bounded lock-free queue carrying stream configuration requests to the mavlink main loop.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+class MavlinkCommandQueue
+{
+public:
+	static const unsigned CAPACITY = 16;		///< queued commands, must be a power of two
+	static const unsigned NAME_LEN = 32;		///< longest stream name plus terminator
+
+	struct command {
+		char stream_name[NAME_LEN];
+		float rate;
+	};
+
+	MavlinkCommandQueue();
+	~MavlinkCommandQueue() {}
+
+	/**
+	 * Queue a stream rate change, safe to call from any thread, never blocks.
+	 *
+	 * @param stream_name	Name of the stream, copied into the queue.
+	 * @param rate		Requested rate in Hz, 0 to disable the stream.
+	 * @param ticket	If not null, set to a value to pass to is_done().
+	 * @return		true if queued, false if the queue is full or the name too long.
+	 */
+	bool push(const char *stream_name, float rate, uint32_t *ticket = nullptr);
+
+	/**
+	 * Queue several stream rate changes at once. Either all of them are
+	 * queued in consecutive slots or none is.
+	 *
+	 * @param ticket	If not null, set to the ticket of the last command.
+	 */
+	bool push(const char *const *stream_names, const float *rates, unsigned count, uint32_t *ticket = nullptr);
+
+	/**
+	 * Take the oldest command off the queue. Must only be called from the consumer thread.
+	 *
+	 * @return		true if a command was copied to cmd.
+	 */
+	bool pop(command *cmd);
+
+	/**
+	 * Mark all commands taken off so far as applied. Called by the consumer
+	 * after it has acted on the commands it popped.
+	 */
+	void complete();
+
+	/**
+	 * Check whether a command queued with the given ticket has been applied.
+	 */
+	bool is_done(uint32_t ticket) const { return (int32_t)(_completed - ticket) >= 0; }
+
+	unsigned get_dropped() const { return _dropped; }
+
+private:
+	struct slot {
+		volatile uint32_t seq;	///< position this slot is free for, position + 1 once it is filled
+		command cmd;
+	};
+
+	slot _slots[CAPACITY];
+	volatile uint32_t _head;	///< next position to be reserved by a producer
+	uint32_t _tail;			///< next position to be read, consumer only
+	volatile uint32_t _completed;	///< all positions below this have been applied
+	volatile uint32_t _dropped;	///< commands rejected because the queue was full
+
+	/* do not allow copying this class */
+	MavlinkCommandQueue(const MavlinkCommandQueue &);
+	MavlinkCommandQueue &operator=(const MavlinkCommandQueue &);
+};
@@ -0,0 +1,250 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_frame_parser.cpp
+ * MAVLink 1.0 frame parser working on whole receive buffers.
+ *
+ * Frames are located with memchr on the start byte and validated with a
+ * table driven CRC over the contiguous frame. Frames are returned in place,
+ * only a frame cut off at the end of a buffer is carried over to the next.
+ */
+
+#include <string.h>
+
+#include "mavlink_frame_parser.h"
+
+/* CRC-16/MCRF4XX, the same as crc_accumulate() in the MAVLink checksum.h */
+static const uint16_t crc_table[256] = {
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+const uint8_t MavlinkFrameParser::STX;
+const unsigned MavlinkFrameParser::HEADER_LEN;
+const unsigned MavlinkFrameParser::CHECKSUM_LEN;
+const unsigned MavlinkFrameParser::MAX_FRAME_LEN;
+
+MavlinkFrameParser::MavlinkFrameParser(const uint8_t *crc_extra) :
+	_crc_extra(crc_extra),
+	_in(nullptr),
+	_in_end(nullptr),
+	_carry{},
+	_carry_len(0),
+	_carry_done(0),
+	_frames(0),
+	_crc_errors(0),
+	_skipped_bytes(0)
+{
+}
+
+uint16_t
+MavlinkFrameParser::crc_accumulate(uint16_t crc, const uint8_t *buf, size_t len)
+{
+	const uint8_t *end = buf + len;
+
+	while (buf < end) {
+		crc = (crc >> 8) ^ crc_table[(crc ^ *buf++) & 0xFF];
+	}
+
+	return crc;
+}
+
+void
+MavlinkFrameParser::feed(const uint8_t *buf, size_t len)
+{
+	_in = buf;
+	_in_end = buf + len;
+}
+
+bool
+MavlinkFrameParser::check_frame(const uint8_t *frame)
+{
+	unsigned payload_len = frame[1];
+
+	uint16_t crc = crc_accumulate(0xFFFF, &frame[1], HEADER_LEN - 1 + payload_len);
+	crc = crc_accumulate(crc, &_crc_extra[frame[5]], 1);
+
+	return (frame[HEADER_LEN + payload_len] == (uint8_t)(crc & 0xFF)) &&
+	       (frame[HEADER_LEN + payload_len + 1] == (uint8_t)(crc >> 8));
+}
+
+void
+MavlinkFrameParser::carry_resync(unsigned from)
+{
+	const uint8_t *p = nullptr;
+
+	if (from < _carry_len) {
+		p = (const uint8_t *)memchr(&_carry[from], STX, _carry_len - from);
+	}
+
+	if (p == nullptr) {
+		_skipped_bytes += _carry_len - from;
+		_carry_len = 0;
+		return;
+	}
+
+	unsigned offset = p - _carry;
+	_skipped_bytes += offset - from;
+	_carry_len -= offset;
+	memmove(_carry, p, _carry_len);
+}
+
+bool
+MavlinkFrameParser::next_carry(const uint8_t **frame, unsigned *len)
+{
+	/* drop the frame returned from the carry buffer last time */
+	if (_carry_done > 0) {
+		carry_resync(_carry_done);
+		_carry_done = 0;
+	}
+
+	while (_carry_len > 0) {
+		/* top up the carried frame from the new input */
+		unsigned need = (_carry_len < 2) ? 2 : _carry[1] + HEADER_LEN + CHECKSUM_LEN;
+
+		if (_carry_len < need) {
+			size_t n = need - _carry_len;
+
+			if (n > (size_t)(_in_end - _in)) {
+				n = _in_end - _in;
+			}
+
+			memcpy(&_carry[_carry_len], _in, n);
+			_carry_len += n;
+			_in += n;
+
+			if (_carry_len < need) {
+				/* input used up */
+				return false;
+			}
+
+			if (need == 2) {
+				/* now the frame length is known */
+				continue;
+			}
+		}
+
+		if (check_frame(_carry)) {
+			_frames++;
+			_carry_done = need;
+			*frame = _carry;
+			*len = need;
+			return true;
+		}
+
+		/* resync on the next start byte within the carried bytes */
+		_crc_errors++;
+		carry_resync(1);
+	}
+
+	return false;
+}
+
+bool
+MavlinkFrameParser::next(const uint8_t **frame, unsigned *len)
+{
+	if (next_carry(frame, len)) {
+		return true;
+	}
+
+	/* the carry buffer is empty here unless the input is used up */
+	while (_in < _in_end) {
+		const uint8_t *p = (const uint8_t *)memchr(_in, STX, _in_end - _in);
+
+		if (p == nullptr) {
+			_skipped_bytes += _in_end - _in;
+			_in = _in_end;
+			break;
+		}
+
+		_skipped_bytes += p - _in;
+
+		size_t available = _in_end - p;
+
+		if (available < 2 || available < (size_t)p[1] + HEADER_LEN + CHECKSUM_LEN) {
+			/* frame continues in the next buffer */
+			memcpy(_carry, p, available);
+			_carry_len = available;
+			_in = _in_end;
+			break;
+		}
+
+		unsigned frame_len = p[1] + HEADER_LEN + CHECKSUM_LEN;
+
+		if (check_frame(p)) {
+			_frames++;
+			_in = p + frame_len;
+			*frame = p;
+			*len = frame_len;
+			return true;
+		}
+
+		/* not a frame, or a corrupted one, look for the next start byte */
+		_crc_errors++;
+		_in = p + 1;
+	}
+
+	return false;
+}
@@ -0,0 +1,106 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_frame_parser.h
+ * MAVLink 1.0 frame parser working on whole receive buffers.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class MavlinkFrameParser
+{
+public:
+	static const uint8_t STX = 0xFE;
+	static const unsigned HEADER_LEN = 6;		///< STX, len, seq, sysid, compid, msgid
+	static const unsigned CHECKSUM_LEN = 2;
+	static const unsigned MAX_FRAME_LEN = HEADER_LEN + 255 + CHECKSUM_LEN;
+
+	/**
+	 * @param crc_extra	Per message id CRC seed, MAVLINK_MESSAGE_CRCS. Must outlive the parser.
+	 */
+	MavlinkFrameParser(const uint8_t *crc_extra);
+	~MavlinkFrameParser() {}
+
+	/**
+	 * Hand a received buffer to the parser. The buffer is parsed in place
+	 * and must stay valid until next() returns false. Only the tail of a
+	 * frame that continues in the next buffer is copied.
+	 */
+	void feed(const uint8_t *buf, size_t len);
+
+	/**
+	 * Get the next valid frame of the buffers fed so far.
+	 *
+	 * @param frame		Set to the frame, starting with STX and ending with the checksum.
+	 *			Valid until the next call to next() or feed().
+	 * @param len		Set to the length of the whole frame.
+	 * @return		true if a frame was found, false once the input is used up.
+	 */
+	bool next(const uint8_t **frame, unsigned *len);
+
+	/**
+	 * X.25 CRC as used by MAVLink, over a contiguous span.
+	 */
+	static uint16_t crc_accumulate(uint16_t crc, const uint8_t *buf, size_t len);
+
+	uint32_t get_frames() const { return _frames; }
+	uint32_t get_crc_errors() const { return _crc_errors; }
+	uint32_t get_skipped_bytes() const { return _skipped_bytes; }
+
+private:
+	const uint8_t *_crc_extra;
+
+	const uint8_t *_in;		///< unparsed part of the buffer being fed
+	const uint8_t *_in_end;
+
+	uint8_t _carry[MAX_FRAME_LEN];	///< start of a frame cut off at the end of a buffer
+	unsigned _carry_len;
+	unsigned _carry_done;		///< length of the frame last returned from _carry
+
+	uint32_t _frames;
+	uint32_t _crc_errors;
+	uint32_t _skipped_bytes;
+
+	bool check_frame(const uint8_t *frame);
+	bool next_carry(const uint8_t **frame, unsigned *len);
+	void carry_resync(unsigned from);
+
+	/* do not allow copying this class */
+	MavlinkFrameParser(const MavlinkFrameParser &);
+	MavlinkFrameParser &operator=(const MavlinkFrameParser &);
+};
@@ -54,16 +54,23 @@ int buf_size_2 = 0;
 MavlinkFTP::MavlinkFTP(Mavlink* mavlink) :
 	MavlinkStream(mavlink),
 	_session_info{},
+	_read_ahead{},
+	_read_ahead_next(0),
+	_file_pos(UINT32_MAX),
 	_utRcvMsgFunc{},
 	_worker_data{}
 {
 	// initialize session
 	_session_info.fd = -1;
+
+	pthread_mutex_init(&_session_mutex, NULL);
 }
 
 MavlinkFTP::~MavlinkFTP()
 {
-	
+	_closeSession();
+
+	pthread_mutex_destroy(&_session_mutex);
 }
 
 const char*
@@ -154,14 +161,21 @@ MavlinkFTP::handle_message(const mavlink_message_t *msg)
 #endif
 		
 		if (ftp_request.target_system == _getServerSystemId()) {
-			_process_request(&ftp_request, msg->sysid);
+			pthread_mutex_lock(&_session_mutex);
+			bool reply = _process_request(&ftp_request, msg->sysid);
+			pthread_mutex_unlock(&_session_mutex);
+
+			if (reply) {
+				_reply(&ftp_request);
+			}
 			return;
 		}
 	}
 }
 
-/// @brief Processes an FTP message
-void
+/// @brief Processes an FTP message, _session_mutex must be held
+///	@return true if the response in ftp_req must be sent, false if it is sent by the stream
+bool
 MavlinkFTP::_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t target_system_id)
 {
 	bool stream_send = false;
@@ -272,8 +286,10 @@ out:
 	if (!stream_send || errorCode != kErrNone) {
 		// respond to the request
 		ftp_req->target_system = target_system_id;
-		_reply(ftp_req);
+		return true;
 	}
+
+	return false;
 }
 
 /// @brief Sends the specified FTP response message out through mavlink
@@ -461,6 +477,12 @@ MavlinkFTP::_workOpen(PayloadHeader* payload, int oflag)
 	_session_info.fd = fd;
 	_session_info.file_size = fileSize;
 	_session_info.stream_download = false;
+	_session_info.stream_window = 0;
+	_file_pos = 0;
+
+	if (oflag == O_RDONLY) {
+		_readAheadAlloc();
+	}
 
 	payload->session = 0;
 	payload->size = sizeof(uint32_t);
@@ -485,13 +507,9 @@ MavlinkFTP::_workRead(PayloadHeader* payload)
 		warnx("request past EOF");
 		return kErrEOF;
 	}
-		
-	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-		warnx("seek fail");
-		return kErrFailErrno;
-	}
 
-	int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+	// Retransmits of recently streamed data are served from the read-ahead blocks
+	int bytes_read = _readFile(payload->offset, &payload->data[0], kMaxDataLength);
 	if (bytes_read < 0) {
 		// Negative return indicates error other than eof
 		warnx("read fail %d", bytes_read);
@@ -504,22 +522,44 @@ MavlinkFTP::_workRead(PayloadHeader* payload)
 }
 
 /// @brief Responds to a Stream command
+///
+/// Without data the file is streamed in bursts of kBurstChunkLength bytes, each burst
+/// has to be requested again. With a uint32_t window in data the stream runs until
+/// EOF, at most window bytes ahead of the last acknowledged offset. The client
+/// acknowledges by sending the same request with the offset it has received up to,
+/// and asks for missing packets with kCmdReadFile.
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workBurst(PayloadHeader* payload, uint8_t target_system_id)
 {
 	if (payload->session != 0 && _session_info.fd < 0) {
 		return kErrInvalidSession;
 	}
-	
+
+	uint32_t window = 0;
+	if (payload->size == sizeof(uint32_t)) {
+		window = *((uint32_t*)payload->data);
+	}
+
 #ifdef MAVLINK_FTP_DEBUG
-	warnx("FTP: burst offset:%d", payload->offset);
+	warnx("FTP: burst offset:%d window:%d", payload->offset, window);
 #endif
+	// An offset the windowed stream has already passed is an acknowledgement, slide the window
+	if (window > 0 && _session_info.stream_window > 0 &&
+	    (_session_info.stream_download || _session_info.stream_offset >= _session_info.file_size) &&
+	    payload->offset >= _session_info.stream_acked && payload->offset <= _session_info.stream_offset) {
+		_session_info.stream_acked = payload->offset;
+		_session_info.stream_window = window;
+		return kErrNone;
+	}
+
 	// Setup for streaming sends
 	_session_info.stream_download = true;
 	_session_info.stream_offset = payload->offset;
 	_session_info.stream_chunk_transmitted = 0;
 	_session_info.stream_seq_number = payload->seq_number + 1;
 	_session_info.stream_target_system_id = target_system_id;
+	_session_info.stream_window = window;
+	_session_info.stream_acked = payload->offset;
 
 	return kErrNone;
 }
@@ -532,6 +572,11 @@ MavlinkFTP::_workWrite(PayloadHeader* payload)
 		return kErrInvalidSession;
 	}
 
+	// Written data must not be served from stale read-ahead blocks
+	_read_ahead[0].length = 0;
+	_read_ahead[1].length = 0;
+	_file_pos = UINT32_MAX;
+
 	if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
 		// Unable to see to the specified location
 		warnx("seek fail");
@@ -649,9 +694,7 @@ MavlinkFTP::_workTerminate(PayloadHeader* payload)
 		return kErrInvalidSession;
 	}
 	
-	::close(_session_info.fd);
-	_session_info.fd = -1;
-	_session_info.stream_download = false;
+	_closeSession();
 	
 	payload->size = 0;
 
@@ -662,11 +705,7 @@ MavlinkFTP::_workTerminate(PayloadHeader* payload)
 MavlinkFTP::ErrorCode
 MavlinkFTP::_workReset(PayloadHeader* payload)
 {
-	if (_session_info.fd != -1) {
-		::close(_session_info.fd);
-		_session_info.fd = -1;
-		_session_info.stream_download = false;
-	}
+	_closeSession();
 
 	payload->size = 0;
 	
@@ -779,6 +818,121 @@ MavlinkFTP::_data_as_cstring(PayloadHeader* payload)
 	return (char *)&(payload->data[0]);
 }
 
+/// @brief Closes the session file and releases its read-ahead memory
+void
+MavlinkFTP::_closeSession(void)
+{
+	if (_session_info.fd >= 0) {
+		::close(_session_info.fd);
+		_session_info.fd = -1;
+	}
+
+	_session_info.stream_download = false;
+	_session_info.stream_window = 0;
+	_file_pos = UINT32_MAX;
+	_readAheadFree();
+}
+
+/// @brief Allocates the read-ahead blocks for a read session, reads go straight to the file if this fails
+void
+MavlinkFTP::_readAheadAlloc(void)
+{
+	_readAheadFree();
+
+	uint8_t *data = new uint8_t[2 * kReadAheadLength];
+	if (data == nullptr) {
+		return;
+	}
+
+	_read_ahead[0].data = data;
+	_read_ahead[1].data = data + kReadAheadLength;
+}
+
+void
+MavlinkFTP::_readAheadFree(void)
+{
+	delete[] _read_ahead[0].data;
+
+	for (unsigned i = 0; i < 2; i++) {
+		_read_ahead[i].data = nullptr;
+		_read_ahead[i].length = 0;
+	}
+
+	_read_ahead_next = 0;
+}
+
+/// @brief Reads from the session file at offset, through the read-ahead blocks if there are any.
+/// The file is read in aligned kReadAheadLength blocks and only seeked when not read sequentially.
+/// @return bytes read, less than len at end of file, -1 with errno set on failure
+int
+MavlinkFTP::_readFile(uint32_t offset, uint8_t *dst, unsigned len)
+{
+	if (_read_ahead[0].data == nullptr) {
+		if (_file_pos != offset && lseek(_session_info.fd, offset, SEEK_SET) < 0) {
+			_file_pos = UINT32_MAX;
+			return -1;
+		}
+
+		int bytes_read = ::read(_session_info.fd, dst, len);
+		_file_pos = (bytes_read < 0) ? UINT32_MAX : offset + bytes_read;
+		return bytes_read;
+	}
+
+	unsigned copied = 0;
+
+	while (copied < len) {
+		ReadAheadBlock *block = nullptr;
+
+		for (unsigned i = 0; i < 2; i++) {
+			if (offset >= _read_ahead[i].offset && offset < _read_ahead[i].offset + _read_ahead[i].length) {
+				block = &_read_ahead[i];
+				_read_ahead_next = i ^ 1;
+				break;
+			}
+		}
+
+		if (block == nullptr) {
+			// Refill the least recently used block with the aligned block containing offset
+			block = &_read_ahead[_read_ahead_next];
+			_read_ahead_next ^= 1;
+			block->length = 0;
+
+			uint32_t block_offset = offset - (offset % kReadAheadLength);
+
+			if (_file_pos != block_offset && lseek(_session_info.fd, block_offset, SEEK_SET) < 0) {
+				_file_pos = UINT32_MAX;
+				return (copied > 0) ? (int)copied : -1;
+			}
+
+			int bytes_read = ::read(_session_info.fd, block->data, kReadAheadLength);
+			if (bytes_read < 0) {
+				_file_pos = UINT32_MAX;
+				return (copied > 0) ? (int)copied : -1;
+			}
+
+			block->offset = block_offset;
+			block->length = bytes_read;
+			_file_pos = block_offset + bytes_read;
+
+			if (offset >= block->offset + block->length) {
+				// end of file
+				break;
+			}
+		}
+
+		unsigned n = block->offset + block->length - offset;
+		if (n > len - copied) {
+			n = len - copied;
+		}
+
+		memcpy(&dst[copied], &block->data[offset - block->offset], n);
+		copied += n;
+		offset += n;
+	}
+
+	return copied;
+}
+
 /// @brief Copy file (with limited space)
 int
 MavlinkFTP::_copy_file(const char *src_path, const char *dst_path, size_t length)
@@ -838,6 +992,14 @@ MavlinkFTP::_copy_file(const char *src_path, const char *dst_path, size_t length
 }
 
 void MavlinkFTP::send(const hrt_abstime t)
+{
+	pthread_mutex_lock(&_session_mutex);
+	_streamSend();
+	pthread_mutex_unlock(&_session_mutex);
+}
+
+/// @brief Sends stream download packets, _session_mutex must be held
+void MavlinkFTP::_streamSend(void)
 {
 	// Anything to stream?
 	if (!_session_info.stream_download) {
@@ -860,6 +1022,18 @@ void MavlinkFTP::send(const hrt_abstime t)
 	bool more_data;
 	do {
 		more_data = false;
+
+		// The session may have been terminated while the previous packet was sent
+		if (!_session_info.stream_download) {
+			return;
+		}
+
+		// Windowed bursts wait for the client to acknowledge, the EOF Nak is always sent
+		if (_session_info.stream_window > 0 &&
+		    _session_info.stream_offset < _session_info.file_size &&
+		    _session_info.stream_offset - _session_info.stream_acked >= _session_info.stream_window) {
+			return;
+		}
 		
 		ErrorCode error_code = kErrNone;
 		
@@ -885,16 +1059,7 @@ void MavlinkFTP::send(const hrt_abstime t)
 		}
 		
 		if (error_code == kErrNone) {
-			if (lseek(_session_info.fd, payload->offset, SEEK_SET) < 0) {
-				error_code = kErrFailErrno;
-#ifdef MAVLINK_FTP_DEBUG
-				warnx("stream download: seek fail");
-#endif
-			}
-		}
-		
-		if (error_code == kErrNone) {
-			int bytes_read = ::read(_session_info.fd, &payload->data[0], kMaxDataLength);
+			int bytes_read = _readFile(payload->offset, &payload->data[0], kMaxDataLength);
 			if (bytes_read < 0) {
 				// Negative return indicates error other than eof
 				error_code = kErrFailErrno;
@@ -923,8 +1088,8 @@ void MavlinkFTP::send(const hrt_abstime t)
 #ifndef MAVLINK_FTP_UNIT_TEST
 			if (max_bytes_to_send < (get_size()*2)) {
 				more_data = false;
-				/* perform transfers in 35K chunks - this is determined empirical */
-				if (_session_info.stream_chunk_transmitted > 35000) {
+				/* without a window, perform transfers in fixed chunks */
+				if (_session_info.stream_window == 0 && _session_info.stream_chunk_transmitted > kBurstChunkLength) {
 					payload->burst_complete = true;
 					_session_info.stream_download = false;
 					_session_info.stream_chunk_transmitted = 0;
@@ -940,7 +1105,11 @@ void MavlinkFTP::send(const hrt_abstime t)
 		}
 		
 		ftp_msg.target_system = _session_info.stream_target_system_id;
+
+		// The packet is a copy, requests can be handled while it is sent
+		pthread_mutex_unlock(&_session_mutex);
 		_reply(&ftp_msg);
+		pthread_mutex_lock(&_session_mutex);
 	} while (more_data);
 }
 
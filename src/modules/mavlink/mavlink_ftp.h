@@ -38,6 +38,7 @@
  
 #include <dirent.h>
 #include <queue.h>
+#include <pthread.h>
 
 #include <systemlib/err.h>
 
@@ -99,7 +100,7 @@ public:
 		kCmdTruncateFile,	///< Truncate file at <path> to <offset> length
 		kCmdRename,		///< Rename <path1> to <path2>
 		kCmdCalcFileCRC32,	///< Calculate CRC32 for file at <path>
-		kCmdBurstReadFile,	///< Burst download session file
+		kCmdBurstReadFile,	///< Burst download session file, optional uint32_t window in data, see _workBurst
 		
 		kRspAck = 128,		///< Ack response
 		kRspNak			///< Nak response
@@ -126,7 +127,7 @@ public:
 private:
 	char		*_data_as_cstring(PayloadHeader* payload);
 	
-	void		_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t target_system_id);
+	bool		_process_request(mavlink_file_transfer_protocol_t* ftp_req, uint8_t target_system_id);
 	void		_reply(mavlink_file_transfer_protocol_t* ftp_req);
 	int		_copy_file(const char *src_path, const char *dst_path, size_t length);
 
@@ -143,6 +144,12 @@ private:
 	ErrorCode	_workTruncateFile(PayloadHeader *payload);
 	ErrorCode	_workRename(PayloadHeader *payload);
 	ErrorCode	_workCalcFileCRC32(PayloadHeader *payload);
+
+	int		_readFile(uint32_t offset, uint8_t *dst, unsigned len);
+	void		_readAheadAlloc(void);
+	void		_readAheadFree(void);
+	void		_closeSession(void);
+	void		_streamSend(void);
 	
 	uint8_t _getServerSystemId(void);
 	uint8_t _getServerComponentId(void);
@@ -157,6 +164,12 @@ private:
 	
 	/// @brief Maximum data size in RequestHeader::data
 	static const uint8_t	kMaxDataLength = MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN - sizeof(PayloadHeader);
+
+	/// @brief Size of a read-ahead block, a multiple of the SD card sector size
+	static const unsigned	kReadAheadLength = 1024;
+
+	/// @brief Bytes sent per burst if the client does not ask for a window, determined empirically
+	static const unsigned	kBurstChunkLength = 35000;
 	
 	struct SessionInfo {
 		int		fd;
@@ -166,8 +179,25 @@ private:
 		uint16_t	stream_seq_number;
 		uint8_t		stream_target_system_id;
 		unsigned	stream_chunk_transmitted;
+		uint32_t	stream_window;		///< bytes the stream may run ahead of stream_acked, 0 for fixed size bursts
+		uint32_t	stream_acked;		///< the client has received everything below this offset
 	};
 	struct SessionInfo _session_info;	///< Session info, fd=-1 for no active session
+
+	/// @brief Read-ahead block. There are two, so the block being streamed can be refilled
+	/// while retransmits of the previous one are still served from memory.
+	struct ReadAheadBlock {
+		uint32_t	offset;		///< file offset of data[0]
+		uint32_t	length;		///< valid bytes, 0 if empty
+		uint8_t		*data;
+	};
+	ReadAheadBlock	_read_ahead[2];
+	unsigned	_read_ahead_next;	///< block to refill next
+	uint32_t	_file_pos;		///< current position of the session fd, UINT32_MAX if unknown
+
+	/// @brief Protects the session and read-ahead state. Requests are handled on the receiver
+	/// thread while send() streams from the mavlink thread. Not held while a reply is sent.
+	pthread_mutex_t	_session_mutex;
 	
 	ReceiveMessageFunc_t	_utRcvMsgFunc;	///< Unit test override for mavlink message sending
 	void			*_worker_data;	///< Additional parameter to _utRcvMsgFunc;
@@ -41,6 +41,7 @@
 
 #include <px4_config.h>
 #include <px4_getopt.h>
+#include <px4_posix.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -98,6 +99,16 @@ static const int ERROR = -1;
 #define MAX_DATA_RATE				1000000	///< max data rate in bytes/s
 #define MAIN_LOOP_DELAY 			10000	///< 100 Hz @ 1000 bytes/s data rate
 #define FLOW_CONTROL_DISABLE_THRESHOLD		40	///< picked so that some messages still would fit it.
+#define MAVLINK_TX_RING_MIN_SIZE		(4 * MAVLINK_MAX_PACKET_LEN + 1)	///< four full packets, plus the empty slot marker
+#define MAVLINK_TX_RING_MAX_SIZE		(16 * MAVLINK_MAX_PACKET_LEN + 1)	///< the ring is flushed early when full, no need to hold more
+
+#ifdef MAVLINK_UDP
+#define DEFAULT_UDP_PORT			14556	///< local port
+#define DEFAULT_REMOTE_PORT			14550	///< GCS port
+#define DEFAULT_REMOTE_IP			"127.0.0.1"
+#define DEFAULT_UDP_DATA_RATE			100000	///< bytes/s, there is no baud rate to derive it from
+#define MIN_UDP_LOOP_DELAY			1000	///< gives each sendmmsg batch a useful size
+#endif
 
 static Mavlink *_mavlink_instances = nullptr;
 
@@ -154,6 +165,15 @@ Mavlink::Mavlink() :
 	_ftp_on(false),
 #ifndef __PX4_POSIX
 	_uart_fd(-1),
+#endif
+#ifdef MAVLINK_UDP
+	_udp(),
+	_network_port(DEFAULT_UDP_PORT),
+	_remote_port(DEFAULT_REMOTE_PORT),
+	_remote_ip(DEFAULT_REMOTE_IP),
+	_udp_device_name{},
+	_tx_budget(0),
+	_tx_budget_time(0),
 #endif
 	_baudrate(57600),
 	_datarate(1000),
@@ -161,8 +181,7 @@ Mavlink::Mavlink() :
 	_rate_mult(1.0f),
 	_mavlink_param_queue_index(0),
 	mavlink_link_termination_allowed(false),
-	_subscribe_to_stream(nullptr),
-	_subscribe_to_stream_rate(0.0f),
+	_stream_commands(),
 	_flow_control_enabled(true),
 	_last_write_success_time(0),
 	_last_write_try_time(0),
@@ -175,6 +194,11 @@ Mavlink::Mavlink() :
 	_rate_rx(0.0f),
 	_rstatus {},
 	_message_buffer {},
+#ifndef __PX4_POSIX
+	_tx_ring {},
+	_tx_kernel_free(0),
+	_tx_ring_bytes(0),
+#endif
 	_message_buffer_mutex {},
 	_send_mutex {},
 	_param_initialized(false),
@@ -185,8 +209,18 @@ Mavlink::Mavlink() :
 	_param_forward_externalsp(0),
 	_system_type(0),
 
+	_stream_schedule(nullptr),
+	_stream_schedule_size(0),
+	_stream_schedule_capacity(0),
+	_stream_schedule_dirty(true),
+	_stream_schedule_rate_mult(1.0f),
+
 	/* performance counters */
 	_loop_perf(perf_alloc(PC_ELAPSED, "mavlink_el")),
+#ifndef __PX4_POSIX
+	_tx_write_perf(perf_alloc(PC_COUNT, "mavlink_txw")),
+	_tx_saved_perf(perf_alloc(PC_COUNT, "mavlink_txsv")),
+#endif
 	_txerr_perf(perf_alloc(PC_COUNT, "mavlink_txe"))
 {
 #ifdef __PX4_NUTTX
@@ -244,6 +278,10 @@ Mavlink::~Mavlink()
 {
 	perf_free(_loop_perf);
 	perf_free(_txerr_perf);
+#ifndef __PX4_POSIX
+	perf_free(_tx_write_perf);
+	perf_free(_tx_saved_perf);
+#endif
 
 	if (_task_running) {
 		/* task wakes up every 10ms or so at the longest */
@@ -766,11 +804,13 @@ Mavlink::get_free_tx_buf()
 	int buf_free = 0;
 
 #ifndef __PX4_POSIX
+	/* the UART buffer is only queried on flush, what the ring holds is already spoken for,
+	 * the ring itself is flushed early when full and does not limit the space */
+	buf_free = _tx_kernel_free - tx_ring_count();
 
-// No FIONWRITE on Linux
-#if !defined(__PX4_LINUX)
-	(void) ioctl(_uart_fd, FIONWRITE, (unsigned long)&buf_free);
-#endif
+	if (buf_free < 0) {
+		buf_free = 0;
+	}
 
 	if (get_flow_control_enabled() && buf_free < FLOW_CONTROL_DISABLE_THRESHOLD) {
 		/* Disable hardware flow control:
@@ -784,6 +824,9 @@ Mavlink::get_free_tx_buf()
 			enable_flow_control(false);
 		}
 	}
+#elif defined(MAVLINK_UDP)
+	/* no kernel buffer to ask, the budget follows the configured data rate */
+	buf_free = _tx_budget;
 #endif
 
 	return buf_free;
@@ -840,17 +883,19 @@ Mavlink::send_message(const uint8_t msgid, const void *msg, uint8_t component_ID
 	buf[MAVLINK_NUM_HEADER_BYTES + payload_len + 1] = (uint8_t)(checksum >> 8);
 
 #ifndef __PX4_POSIX
-	/* send message to UART */
-	ssize_t ret = ::write(_uart_fd, buf, packet_len);
 
-	if (ret != (int) packet_len) {
+	/* queue for the UART write at the end of the loop iteration */
+	if (!tx_ring_write(buf, packet_len)) {
 		count_txerr();
 		count_txerrbytes(packet_len);
-
-	} else {
-		_last_write_success_time = _last_write_try_time;
-		count_txbytes(packet_len);
 	}
+
+#elif defined(MAVLINK_UDP)
+	/* queue for the batched send at the end of the loop iteration */
+	_udp.add(buf, packet_len);
+	_tx_budget -= packet_len;
+	_last_write_success_time = _last_write_try_time;
+	count_txbytes(packet_len);
 #endif
 
 	pthread_mutex_unlock(&_send_mutex);
@@ -892,22 +937,67 @@ Mavlink::resend_message(mavlink_message_t *msg)
 	buf[MAVLINK_NUM_HEADER_BYTES + msg->len + 1] = (uint8_t)(msg->checksum >> 8);
 
 #ifndef __PX4_POSIX
-	/* send message to UART */
-	ssize_t ret = ::write(_uart_fd, buf, packet_len);
 
-	if (ret != (int) packet_len) {
+	/* queue for the UART write at the end of the loop iteration */
+	if (!tx_ring_write(buf, packet_len)) {
 		count_txerr();
 		count_txerrbytes(packet_len);
-
-	} else {
-		_last_write_success_time = _last_write_try_time;
-		count_txbytes(packet_len);
 	}
+
+#elif defined(MAVLINK_UDP)
+	/* queue for the batched send at the end of the loop iteration */
+	_udp.add(buf, packet_len);
+	_tx_budget -= packet_len;
+	_last_write_success_time = _last_write_try_time;
+	count_txbytes(packet_len);
 #endif
 
 	pthread_mutex_unlock(&_send_mutex);
 }
 
+#ifdef MAVLINK_UDP
+void
+Mavlink::set_udp_remote(const struct sockaddr_in &addr)
+{
+	const struct sockaddr_in &remote = _udp.get_remote();
+
+	/* only the receive thread changes the address, no need to lock to compare */
+	if (addr.sin_addr.s_addr == remote.sin_addr.s_addr && addr.sin_port == remote.sin_port) {
+		return;
+	}
+
+	pthread_mutex_lock(&_send_mutex);
+	_udp.set_remote(addr);
+	pthread_mutex_unlock(&_send_mutex);
+
+	warnx("%s: sending to %s:%u", _device_name, inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+}
+
+void
+Mavlink::udp_flush()
+{
+	pthread_mutex_lock(&_send_mutex);
+
+	unsigned dropped = _udp.flush();
+
+	while (dropped-- > 0) {
+		count_txerr();
+	}
+
+	/* refill the budget, allowing bursts of up to 100 ms worth of data */
+	hrt_abstime now = hrt_absolute_time();
+	uint64_t refill = (now - _tx_budget_time) * _datarate / 1000000;
+	unsigned burst = _datarate / 10 + MAVLINK_MAX_PACKET_LEN;
+
+	if (refill > 0) {
+		_tx_budget = (_tx_budget + refill > burst) ? burst : _tx_budget + refill;
+		_tx_budget_time = now;
+	}
+
+	pthread_mutex_unlock(&_send_mutex);
+}
+#endif
+
 void
 Mavlink::handle_message(const mavlink_message_t *msg)
 {
@@ -1027,6 +1117,8 @@ Mavlink::configure_stream(const char *stream_name, const float rate)
 	/* calculate interval in us, 0 means disabled stream */
 	unsigned int interval = interval_from_rate(rate);
 
+	_stream_schedule_dirty = true;
+
 	/* search if stream exists */
 	MavlinkStream *stream;
 	LL_FOREACH(_streams, stream) {
@@ -1077,6 +1169,8 @@ Mavlink::adjust_stream_rates(const float multiplier)
 		return;
 	}
 
+	_stream_schedule_dirty = true;
+
 	/* search if stream exists */
 	MavlinkStream *stream;
 	LL_FOREACH(_streams, stream) {
@@ -1094,34 +1188,23 @@ Mavlink::adjust_stream_rates(const float multiplier)
 	}
 }
 
-void
-Mavlink::configure_stream_threadsafe(const char *stream_name, const float rate)
+int
+Mavlink::configure_stream_threadsafe(const char *stream_name, const float rate, uint32_t *ticket)
 {
-	/* orb subscription must be done from the main thread,
-	 * set _subscribe_to_stream and _subscribe_to_stream_rate fields
-	 * which polled in mavlink main loop */
-	if (!_task_should_exit) {
-		/* wait for previous subscription completion */
-		while (_subscribe_to_stream != nullptr) {
-			usleep(MAIN_LOOP_DELAY / 2);
-		}
-
-		/* copy stream name */
-		unsigned n = strlen(stream_name) + 1;
-		char *s = new char[n];
-		strcpy(s, stream_name);
-
-		/* set subscription task */
-		_subscribe_to_stream_rate = rate;
-		_subscribe_to_stream = s;
-
-		/* wait for subscription */
-		do {
-			usleep(MAIN_LOOP_DELAY / 2);
-		} while (_subscribe_to_stream != nullptr);
+	return configure_streams_threadsafe(&stream_name, &rate, 1, ticket);
+}
 
-		delete s;
+int
+Mavlink::configure_streams_threadsafe(const char *const *stream_names, const float *rates, unsigned count,
+				      uint32_t *ticket)
+{
+	/* orb subscription must be done from the main thread,
+	 * queue the request and let the main loop apply it */
+	if (_task_should_exit || !_stream_commands.push(stream_names, rates, count, ticket)) {
+		return ERROR;
 	}
+
+	return OK;
 }
 
 int
@@ -1208,6 +1291,130 @@ Mavlink::message_buffer_write(const void *ptr, int size)
 	return true;
 }
 
+#ifndef __PX4_POSIX
+int
+Mavlink::tx_ring_init(int size)
+{
+	_tx_ring.size = size;
+	_tx_ring.write_ptr = 0;
+	_tx_ring.read_ptr = 0;
+	_tx_ring.messages = 0;
+	_tx_ring.data = (uint8_t *)malloc(_tx_ring.size);
+
+	if (_tx_ring.data == nullptr) {
+		_tx_ring.size = 0;
+		return ERROR;
+	}
+
+	return OK;
+}
+
+void
+Mavlink::tx_ring_destroy()
+{
+	_tx_ring.size = 0;
+	_tx_ring.write_ptr = 0;
+	_tx_ring.read_ptr = 0;
+	free(_tx_ring.data);
+	_tx_ring.data = nullptr;
+}
+
+int
+Mavlink::tx_ring_count()
+{
+	int n = _tx_ring.write_ptr - _tx_ring.read_ptr;
+
+	if (n < 0) {
+		n += _tx_ring.size;
+	}
+
+	return n;
+}
+
+bool
+Mavlink::tx_ring_write(const uint8_t *buf, int size)
+{
+	if (size > _tx_ring.size - 1 - tx_ring_count()) {
+		/* more sent in this iteration than the ring holds, write out what is queued */
+		tx_ring_flush();
+
+		if (size > _tx_ring.size - 1 - tx_ring_count()) {
+			return false;
+		}
+	}
+
+	int n = _tx_ring.size - _tx_ring.write_ptr;	// bytes to end of the buffer
+
+	if (n < size) {
+		// message goes over end of the buffer
+		memcpy(&_tx_ring.data[_tx_ring.write_ptr], buf, n);
+		memcpy(&_tx_ring.data[0], &buf[n], size - n);
+
+	} else {
+		memcpy(&_tx_ring.data[_tx_ring.write_ptr], buf, size);
+	}
+
+	_tx_ring.write_ptr = (_tx_ring.write_ptr + size) % _tx_ring.size;
+	_tx_ring.messages++;
+	return true;
+}
+
+void
+Mavlink::tx_ring_flush()
+{
+	unsigned writes = 0;
+
+	/* at most two writes, one if the data does not wrap around */
+	while (_tx_ring.read_ptr != _tx_ring.write_ptr) {
+		int n = (_tx_ring.write_ptr > _tx_ring.read_ptr) ?
+			_tx_ring.write_ptr - _tx_ring.read_ptr : _tx_ring.size - _tx_ring.read_ptr;
+
+		ssize_t ret = ::write(_uart_fd, &_tx_ring.data[_tx_ring.read_ptr], n);
+		writes++;
+		perf_count(_tx_write_perf);
+
+		if (ret <= 0) {
+			/* keep the data, the next iteration tries again */
+			break;
+		}
+
+		_tx_ring.read_ptr = (_tx_ring.read_ptr + ret) % _tx_ring.size;
+		_tx_ring_bytes += ret;
+		count_txbytes(ret);
+
+		if (ret < n) {
+			/* UART buffer full */
+			break;
+		}
+	}
+
+	if (_tx_ring.read_ptr == _tx_ring.write_ptr) {
+		/* keep the next batch contiguous */
+		_tx_ring.read_ptr = 0;
+		_tx_ring.write_ptr = 0;
+
+		if (writes > 0) {
+			_last_write_success_time = _last_write_try_time;
+		}
+	}
+
+	for (unsigned i = writes; i < _tx_ring.messages; i++) {
+		perf_count(_tx_saved_perf);
+	}
+
+	_tx_ring.messages = 0;
+
+	int buf_free = 0;
+
+// No FIONWRITE on Linux
+#if !defined(__PX4_LINUX)
+	(void) ioctl(_uart_fd, FIONWRITE, (unsigned long)&buf_free);
+#endif
+
+	_tx_kernel_free = buf_free;
+}
+#endif
+
 int
 Mavlink::message_buffer_get_ptr(void **ptr, bool *is_part)
 {
@@ -1279,6 +1486,115 @@ Mavlink::update_rate_mult()
 	_rate_mult = fminf(1.0f, ((float)_datarate - const_rate) / rate);
 }
 
+void
+Mavlink::stream_schedule_sift_down(unsigned i)
+{
+	stream_schedule_entry entry = _stream_schedule[i];
+
+	for (;;) {
+		unsigned child = 2 * i + 1;
+
+		if (child >= _stream_schedule_size) {
+			break;
+		}
+
+		if (child + 1 < _stream_schedule_size && _stream_schedule[child + 1].due < _stream_schedule[child].due) {
+			child++;
+		}
+
+		if (entry.due <= _stream_schedule[child].due) {
+			break;
+		}
+
+		_stream_schedule[i] = _stream_schedule[child];
+		i = child;
+	}
+
+	_stream_schedule[i] = entry;
+}
+
+void
+Mavlink::stream_schedule_rebuild()
+{
+	unsigned count = 0;
+	MavlinkStream *stream;
+	LL_FOREACH(_streams, stream) {
+		count++;
+	}
+
+	if (count > _stream_schedule_capacity) {
+		delete[] _stream_schedule;
+		_stream_schedule = new stream_schedule_entry[count];
+		_stream_schedule_capacity = count;
+	}
+
+	_stream_schedule_size = 0;
+
+	LL_FOREACH(_streams, stream) {
+		_stream_schedule[_stream_schedule_size].due = stream->get_next_due();
+		_stream_schedule[_stream_schedule_size].stream = stream;
+		_stream_schedule_size++;
+	}
+
+	for (unsigned i = _stream_schedule_size / 2; i > 0; i--) {
+		stream_schedule_sift_down(i - 1);
+	}
+
+	_stream_schedule_rate_mult = _rate_mult;
+	_stream_schedule_dirty = false;
+}
+
+void
+Mavlink::update_streams(hrt_abstime t)
+{
+	if (_stream_schedule_dirty || _stream_schedule_rate_mult != _rate_mult) {
+		stream_schedule_rebuild();
+	}
+
+	while (_stream_schedule_size > 0 && _stream_schedule[0].due <= t) {
+		MavlinkStream *stream = _stream_schedule[0].stream;
+
+		stream->update(t);
+
+		/* never reschedule into the past, that would spin here */
+		hrt_abstime due = stream->get_next_due();
+		_stream_schedule[0].due = (due > t) ? due : t + 1;
+		stream_schedule_sift_down(0);
+	}
+}
+
+int
+Mavlink::stream_wait_timeout()
+{
+	if (_stream_schedule_dirty) {
+		return 0;
+	}
+
+	/* other threads hand work to the main loop (stream requests, passed messages),
+	 * so never sleep longer than the old fixed loop did */
+	hrt_abstime timeout = MAIN_LOOP_DELAY;
+
+	if ((_passing_on || _ftp_on) && _main_loop_delay < timeout) {
+		timeout = _main_loop_delay;
+	}
+
+	if (_stream_schedule_size > 0) {
+		hrt_abstime now = hrt_absolute_time();
+		hrt_abstime due = _stream_schedule[0].due;
+
+		if (due <= now) {
+			return 0;
+		}
+
+		if (due - now < timeout) {
+			timeout = due - now;
+		}
+	}
+
+	/* round up, waking before the stream is due would only poll again */
+	return (timeout + 999) / 1000;
+}
+
 int
 Mavlink::task_main(int argc, char *argv[])
 {
@@ -1299,7 +1615,13 @@ Mavlink::task_main(int argc, char *argv[])
 	int myoptind=1;
 	const char *myoptarg = NULL;
 
-	while ((ch = px4_getopt(argc, argv, "b:r:d:m:fpvwx", &myoptind, &myoptarg)) != EOF) {
+#ifdef MAVLINK_UDP
+	const char *optstring = "b:r:d:m:fpvwxu:o:t:";
+#else
+	const char *optstring = "b:r:d:m:fpvwx";
+#endif
+
+	while ((ch = px4_getopt(argc, argv, optstring, &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'b':
 			_baudrate = strtoul(myoptarg, NULL, 10);
@@ -1362,6 +1684,21 @@ Mavlink::task_main(int argc, char *argv[])
 			_ftp_on = true;
 			break;
 
+#ifdef MAVLINK_UDP
+
+		case 'u':
+			_network_port = strtoul(myoptarg, NULL, 10);
+			break;
+
+		case 'o':
+			_remote_port = strtoul(myoptarg, NULL, 10);
+			break;
+
+		case 't':
+			_remote_ip = myoptarg;
+			break;
+#endif
+
 		default:
 			err_flag = true;
 			break;
@@ -1373,6 +1710,17 @@ Mavlink::task_main(int argc, char *argv[])
 		return ERROR;
 	}
 
+#ifdef MAVLINK_UDP
+
+	if (_datarate == 0) {
+		_datarate = DEFAULT_UDP_DATA_RATE;
+	}
+
+	/* the instance is identified by its port, e.g. for mavlink stream -d udp:14556 */
+	snprintf(_udp_device_name, sizeof(_udp_device_name), "udp:%u", _network_port);
+	_device_name = _udp_device_name;
+#endif
+
 	if (_datarate == 0) {
 		/* convert bits to bytes and use 1/2 of bandwidth by default */
 		_datarate = _baudrate / 20;
@@ -1402,11 +1750,40 @@ Mavlink::task_main(int argc, char *argv[])
 		warn("could not open %s", _device_name);
 		return ERROR;
 	}
+#elif defined(MAVLINK_UDP)
+
+	if (_udp.open(_network_port, _remote_ip, _remote_port) != OK) {
+		warnx("could not open UDP port %u to %s:%u", _network_port, _remote_ip, _remote_port);
+		return ERROR;
+	}
+
+	_tx_budget = _datarate / 10;
+	_tx_budget_time = hrt_absolute_time();
 #endif
 
 	/* initialize send mutex */
 	pthread_mutex_init(&_send_mutex, NULL);
 
+#ifndef __PX4_POSIX
+
+	/* one loop iteration worth of messages at the configured data rate, written to the UART in one go */
+	int tx_ring_size = (uint64_t)_datarate * MAIN_LOOP_DELAY / 1000000 + 1;
+
+	if (tx_ring_size < MAVLINK_TX_RING_MIN_SIZE) {
+		tx_ring_size = MAVLINK_TX_RING_MIN_SIZE;
+
+	} else if (tx_ring_size > MAVLINK_TX_RING_MAX_SIZE) {
+		tx_ring_size = MAVLINK_TX_RING_MAX_SIZE;
+	}
+
+	if (OK != tx_ring_init(tx_ring_size)) {
+		warnx("tx ring:");
+		return ERROR;
+	}
+
+	tx_ring_flush();
+#endif
+
 	/* initialize mavlink text message buffering */
 	mavlink_logbuffer_init(&_logbuffer, 5);
 
@@ -1522,17 +1899,32 @@ Mavlink::task_main(int argc, char *argv[])
 		break;
 	}
 
-	/* set main loop delay depending on data rate to minimize CPU overhead */
+	/* set main loop delay depending on data rate, bounds the wait while messages are passed on */
 	_main_loop_delay = (MAIN_LOOP_DELAY * 1000) / _datarate;
 
+#ifdef MAVLINK_UDP
+
+	if (_main_loop_delay < MIN_UDP_LOOP_DELAY) {
+		_main_loop_delay = MIN_UDP_LOOP_DELAY;
+	}
+
+#endif
+
 	/* now the instance is fully initialized and we can bump the instance count */
 	LL_APPEND(_mavlink_instances, this);
 
 	send_autopilot_capabilites();
 
+	/* wake up for parameter and status changes, streams are woken by their deadline */
+	px4_pollfd_struct_t fds[2];
+	fds[0].fd = param_sub->get_fd();
+	fds[0].events = POLLIN;
+	fds[1].fd = status_sub->get_fd();
+	fds[1].events = POLLIN;
+
 	while (!_task_should_exit) {
 		/* main loop */
-		usleep(_main_loop_delay);
+		px4_poll(fds, sizeof(fds) / sizeof(fds[0]), stream_wait_timeout());
 
 		perf_begin(_loop_perf);
 
@@ -1552,30 +1944,34 @@ Mavlink::task_main(int argc, char *argv[])
 			set_manual_input_mode_generation(status.rc_input_mode == vehicle_status_s::RC_IN_MODE_GENERATED);
 		}
 
-		/* check for requested subscriptions */
-		if (_subscribe_to_stream != nullptr) {
-			if (OK == configure_stream(_subscribe_to_stream, _subscribe_to_stream_rate)) {
-				if (_subscribe_to_stream_rate > 0.0f) {
-					warnx("stream %s on device %s enabled with rate %.1f Hz", _subscribe_to_stream, _device_name,
-					      (double)_subscribe_to_stream_rate);
+		/* apply stream configuration requested by other threads */
+		MavlinkCommandQueue::command stream_cmd;
+		bool stream_cmds_applied = false;
+
+		while (_stream_commands.pop(&stream_cmd)) {
+			if (OK == configure_stream(stream_cmd.stream_name, stream_cmd.rate)) {
+				if (stream_cmd.rate > 0.0f) {
+					warnx("stream %s on device %s enabled with rate %.1f Hz", stream_cmd.stream_name, _device_name,
+					      (double)stream_cmd.rate);
 
 				} else {
-					warnx("stream %s on device %s disabled", _subscribe_to_stream, _device_name);
+					warnx("stream %s on device %s disabled", stream_cmd.stream_name, _device_name);
 				}
 
 			} else {
-				warnx("stream %s on device %s not found", _subscribe_to_stream, _device_name);
+				warnx("stream %s on device %s not found", stream_cmd.stream_name, _device_name);
 			}
 
-			_subscribe_to_stream = nullptr;
+			stream_cmds_applied = true;
 		}
 
-		/* update streams */
-		MavlinkStream *stream;
-		LL_FOREACH(_streams, stream) {
-			stream->update(t);
+		if (stream_cmds_applied) {
+			_stream_commands.complete();
 		}
 
+		/* update the streams that are due */
+		update_streams(t);
+
 		/* pass messages from other UARTs or FTP worker */
 		if (_passing_on || _ftp_on) {
 
@@ -1624,6 +2020,14 @@ Mavlink::task_main(int argc, char *argv[])
 			}
 		}
 
+#ifndef __PX4_POSIX
+		pthread_mutex_lock(&_send_mutex);
+		tx_ring_flush();
+		pthread_mutex_unlock(&_send_mutex);
+#elif defined(MAVLINK_UDP)
+		udp_flush();
+#endif
+
 		/* update TX/RX rates*/
 		if (t > _bytes_timestamp + 1000000) {
 			if (_bytes_timestamp != 0) {
@@ -1642,9 +2046,6 @@ Mavlink::task_main(int argc, char *argv[])
 		perf_end(_loop_perf);
 	}
 
-	delete _subscribe_to_stream;
-	_subscribe_to_stream = nullptr;
-
 	/* delete streams */
 	MavlinkStream *stream_to_del = nullptr;
 	MavlinkStream *stream_next = _streams;
@@ -1657,6 +2058,11 @@ Mavlink::task_main(int argc, char *argv[])
 
 	_streams = nullptr;
 
+	delete[] _stream_schedule;
+	_stream_schedule = nullptr;
+	_stream_schedule_size = 0;
+	_stream_schedule_capacity = 0;
+
 	/* delete subscriptions */
 	MavlinkOrbSubscription *sub_to_del = nullptr;
 	MavlinkOrbSubscription *sub_next = _subscriptions;
@@ -1678,6 +2084,10 @@ Mavlink::task_main(int argc, char *argv[])
 
 	/* close UART */
 	::close(_uart_fd);
+
+	tx_ring_destroy();
+#elif defined(MAVLINK_UDP)
+	_udp.close();
 #endif
 
 	/* close mavlink logging device */
@@ -1807,6 +2217,21 @@ Mavlink::display_status()
 	printf("\ttxerr: %.3f kB/s\n", (double)_rate_txerr);
 	printf("\trx: %.3f kB/s\n", (double)_rate_rx);
 	printf("\trate mult: %.3f\n", (double)_rate_mult);
+
+	if (_stream_commands.get_dropped() > 0) {
+		printf("\tstream requests dropped: %u\n", _stream_commands.get_dropped());
+	}
+
+#ifndef __PX4_POSIX
+	uint64_t writes = perf_event_count(_tx_write_perf);
+	printf("\ttx writes: %llu, saved: %llu, %.1f bytes/write\n", (unsigned long long)writes,
+	       (unsigned long long)perf_event_count(_tx_saved_perf),
+	       (writes > 0) ? (double)_tx_ring_bytes / writes : 0.0);
+#endif
+#ifdef MAVLINK_UDP
+	printf("\tudp: %u datagrams in %u send calls, %u dropped\n",
+	       (unsigned)_udp.get_sent(), (unsigned)_udp.get_syscalls(), (unsigned)_udp.get_dropped());
+#endif
 }
 
 int
@@ -1855,7 +2280,17 @@ Mavlink::stream_command(int argc, char *argv[])
 		Mavlink *inst = get_instance_for_device(device_name);
 
 		if (inst != nullptr) {
-			inst->configure_stream_threadsafe(stream_name, rate);
+			uint32_t ticket;
+
+			if (OK != inst->configure_stream_threadsafe(stream_name, rate, &ticket)) {
+				warnx("stream %s: request queue full", stream_name);
+				return 1;
+			}
+
+			/* the shell may wait, give the main loop a few iterations to apply it */
+			for (unsigned i = 0; i < 100 && !inst->stream_config_done(ticket); i++) {
+				usleep(MAIN_LOOP_DELAY / 2);
+			}
 
 		} else {
 
@@ -1876,6 +2311,9 @@ Mavlink::stream_command(int argc, char *argv[])
 static void usage()
 {
 	warnx("usage: mavlink {start|stop-all|stream} [-d device] [-b baudrate]\n\t[-r rate][-m mode] [-s stream] [-f] [-p] [-v] [-w] [-x]");
+#ifdef MAVLINK_UDP
+	warnx("\t[-u local udp port] [-o remote udp port] [-t partner ip]");
+#endif
 }
 
 int mavlink_main(int argc, char *argv[])
@@ -64,6 +64,13 @@
 #include "mavlink_mission.h"
 #include "mavlink_parameters.h"
 #include "mavlink_ftp.h"
+#include "mavlink_command_queue.h"
+
+#if defined(__PX4_POSIX) && !defined(__PX4_QURT)
+/* there is no serial port to talk to on POSIX, use UDP */
+#define MAVLINK_UDP
+#include "mavlink_udp_batch.h"
+#endif
 
 #ifdef __PX4_NUTTX
 class Mavlink
@@ -119,6 +126,16 @@ public:
 	int			get_uart_fd();
 #endif
 
+#ifdef MAVLINK_UDP
+	int			get_socket_fd() { return _udp.get_fd(); }
+
+	/**
+	 * Send to the given address from now on, used by the receiver to
+	 * answer whichever GCS is talking to us.
+	 */
+	void			set_udp_remote(const struct sockaddr_in &addr);
+#endif
+
 	/**
 	 * Get the MAVLink system id.
 	 *
@@ -157,7 +174,7 @@ public:
 	/**
 	 * Get the free space in the transmit buffer
 	 *
-	 * @return free space in the UART TX buffer
+	 * @return free space in the UART TX buffer, less what is waiting in the TX ring
 	 */
 	unsigned		get_free_tx_buf();
 
@@ -221,7 +238,25 @@ public:
 
 	mavlink_channel_t	get_channel();
 
-	void			configure_stream_threadsafe(const char *stream_name, float rate);
+	/**
+	 * Request a stream rate change from any thread, applied by the main loop.
+	 * Never blocks.
+	 *
+	 * @param ticket	If not null, set to a value to pass to stream_config_done().
+	 * @return		OK if queued, ERROR if the command queue is full.
+	 */
+	int			configure_stream_threadsafe(const char *stream_name, float rate, uint32_t *ticket = nullptr);
+
+	/**
+	 * Request several stream rate changes from any thread, queued all or none.
+	 */
+	int			configure_streams_threadsafe(const char *const *stream_names, const float *rates, unsigned count,
+			uint32_t *ticket = nullptr);
+
+	/**
+	 * Check whether the main loop has applied the request with the given ticket.
+	 */
+	bool			stream_config_done(uint32_t ticket) { return _stream_commands.is_done(ticket); }
 
 	bool			_task_should_exit;	/**< if true, mavlink task should exit */
 
@@ -347,6 +382,15 @@ private:
 	bool			_ftp_on;
 #ifndef __PX4_QURT
 	int			_uart_fd;
+#endif
+#ifdef MAVLINK_UDP
+	MavlinkUDPBatch		_udp;			///< datagrams of the current loop iteration
+	unsigned short		_network_port;
+	unsigned short		_remote_port;
+	const char		*_remote_ip;
+	char			_udp_device_name[16];	///< "udp:<port>", used as device name of the instance
+	unsigned		_tx_budget;		///< bytes that may still be queued, refilled at _datarate
+	uint64_t		_tx_budget_time;
 #endif
 	int			_baudrate;
 	int			_datarate;		///< data rate for normal streams (attitude, position, etc.)
@@ -362,8 +406,7 @@ private:
 
 	bool			mavlink_link_termination_allowed;
 
-	char 			*_subscribe_to_stream;
-	float			_subscribe_to_stream_rate;
+	MavlinkCommandQueue	_stream_commands;	/**< stream configuration requested by other threads */
 
 	bool			_flow_control_enabled;
 	uint64_t		_last_write_success_time;
@@ -388,6 +431,24 @@ private:
 
 	mavlink_message_buffer	_message_buffer;
 
+#ifndef __PX4_POSIX
+	/**
+	 * Messages sent during one loop iteration, written to the UART
+	 * in one go by tx_ring_flush().
+	 */
+	struct mavlink_tx_ring {
+		int write_ptr;
+		int read_ptr;
+		int size;
+		uint8_t *data;
+		unsigned messages;	///< messages added since the last flush
+	};
+
+	mavlink_tx_ring		_tx_ring;
+	int			_tx_kernel_free;	///< free UART TX buffer as of the last flush
+	uint64_t		_tx_ring_bytes;		///< bytes written from the ring
+#endif
+
 	pthread_mutex_t		_message_buffer_mutex;
 	pthread_mutex_t		_send_mutex;
 
@@ -400,11 +461,38 @@ private:
 
 	unsigned		_system_type;
 
+	/**
+	 * Streams ordered by the time they are due next, a binary min-heap
+	 * so the main loop only touches streams that have something to do.
+	 */
+	struct stream_schedule_entry {
+		hrt_abstime due;
+		MavlinkStream *stream;
+	};
+
+	stream_schedule_entry	*_stream_schedule;
+	unsigned		_stream_schedule_size;
+	unsigned		_stream_schedule_capacity;
+	bool			_stream_schedule_dirty;		///< streams or intervals changed, rebuild before use
+	float			_stream_schedule_rate_mult;	///< rate multiplier the due times were computed with
+
 	perf_counter_t		_loop_perf;			/**< loop performance counter */
+#ifndef __PX4_POSIX
+	perf_counter_t		_tx_write_perf;			/**< UART writes */
+	perf_counter_t		_tx_saved_perf;			/**< writes saved by coalescing messages */
+#endif
 	perf_counter_t		_txerr_perf;			/**< TX error counter */
 
 	void			mavlink_update_system();
 
+#ifdef MAVLINK_UDP
+	/**
+	 * Send the datagrams queued during this loop iteration and refill
+	 * the data rate budget.
+	 */
+	void			udp_flush();
+#endif
+
 #ifndef __PX4_QURT
 	int			mavlink_open_uart(int baudrate, const char *uart_name, struct termios *uart_config_original);
 #endif
@@ -434,11 +522,47 @@ private:
 
 	void pass_message(const mavlink_message_t *msg);
 
+#ifndef __PX4_POSIX
+	int tx_ring_init(int size);
+
+	void tx_ring_destroy();
+
+	int tx_ring_count();
+
+	/**
+	 * Queue a packet in the TX ring, flushing the ring first if it is full.
+	 * Call with _send_mutex held.
+	 *
+	 * @return false if the packet did not fit and was dropped
+	 */
+	bool tx_ring_write(const uint8_t *buf, int size);
+
+	/**
+	 * Write everything queued in the TX ring to the UART and refresh
+	 * the free space of the UART TX buffer. Call with _send_mutex held.
+	 */
+	void tx_ring_flush();
+#endif
+
 	/**
 	 * Update rate mult so total bitrate will be equal to _datarate.
 	 */
 	void update_rate_mult();
 
+	void stream_schedule_rebuild();
+
+	void stream_schedule_sift_down(unsigned i);
+
+	/**
+	 * Update all streams that are due at time t.
+	 */
+	void update_streams(hrt_abstime t);
+
+	/**
+	 * @return time in ms until the next stream is due, capped at the old fixed loop delay
+	 */
+	int stream_wait_timeout();
+
 #ifdef __PX4_NUTTX
 	static int	mavlink_dev_ioctl(struct file *filep, int cmd, unsigned long arg);
 #else
@@ -65,6 +65,7 @@
 #include <uORB/topics/manual_control_setpoint.h>
 #include <uORB/topics/telemetry_status.h>
 #include <uORB/topics/debug_key_value.h>
+#include <uORB/topics/perf_counter.h>
 #include <uORB/topics/airspeed.h>
 #include <uORB/topics/battery_status.h>
 #include <uORB/topics/navigation_capabilities.h>
@@ -2113,6 +2114,83 @@ protected:
 	}
 };
 
+/**
+ * Streams perf counter snapshots (see 'perf stream') as DEBUG_VECT messages:
+ * x is the event count, y the mean time and z the p99 time for histogram
+ * counters or the maximum time otherwise, all times in microseconds.
+ *
+ * DEBUG_VECT names hold 9 characters, so the name is the counter's position
+ * in the list followed by as much of its name as fits, e.g. "12:mavlink".
+ * One snapshot is sent per call, the stream rate should be at least the
+ * number of counters divided by the 'perf stream' interval.
+ */
+class MavlinkStreamPerfCounter : public MavlinkStream
+{
+public:
+	const char *get_name() const
+	{
+		return MavlinkStreamPerfCounter::get_name_static();
+	}
+
+	static const char *get_name_static()
+	{
+		return "PERF_COUNTER";
+	}
+
+	uint8_t get_id()
+	{
+		return MAVLINK_MSG_ID_DEBUG_VECT;
+	}
+
+	static MavlinkStream *new_instance(Mavlink *mavlink)
+	{
+		return new MavlinkStreamPerfCounter(mavlink);
+	}
+
+	unsigned get_size()
+	{
+		return (_perf_sub >= 0) ? MAVLINK_MSG_ID_DEBUG_VECT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES : 0;
+	}
+
+private:
+	/* the topic is queued, so read it directly rather than through MavlinkOrbSubscription */
+	int _perf_sub;
+
+	/* do not allow top copying this class */
+	MavlinkStreamPerfCounter(MavlinkStreamPerfCounter &);
+	MavlinkStreamPerfCounter& operator = (const MavlinkStreamPerfCounter &);
+
+protected:
+	explicit MavlinkStreamPerfCounter(Mavlink *mavlink) : MavlinkStream(mavlink),
+		_perf_sub(orb_subscribe(ORB_ID(perf_counter)))
+	{}
+
+	~MavlinkStreamPerfCounter()
+	{
+		orb_unsubscribe(_perf_sub);
+	}
+
+	void send(const hrt_abstime t)
+	{
+		struct perf_counter_s perf;
+		bool updated = false;
+
+		/* one message per call, as accounted for by get_size() */
+		if (orb_check(_perf_sub, &updated) == OK && updated &&
+		    orb_copy(ORB_ID(perf_counter), _perf_sub, &perf) == OK) {
+			mavlink_debug_vect_t msg;
+
+			msg.time_usec = perf.timestamp;
+			/* the index keeps truncated names apart, snprintf terminates */
+			snprintf(msg.name, sizeof(msg.name), "%u:%s", (unsigned)perf.index, (const char *)perf.name);
+			msg.x = perf.event_count;
+			msg.y = perf.mean;
+			msg.z = (perf.type == perf_counter_s::TYPE_HISTOGRAM) ? perf.p99 : perf.time_most;
+
+			_mavlink->send_message(MAVLINK_MSG_ID_DEBUG_VECT, &msg);
+		}
+	}
+};
 
 class MavlinkStreamCameraCapture : public MavlinkStream
 {
@@ -2295,6 +2373,7 @@ const StreamListItem *streams_list[] = {
 	new StreamListItem(&MavlinkStreamActuatorControlTarget<2>::new_instance, &MavlinkStreamActuatorControlTarget<2>::get_name_static),
 	new StreamListItem(&MavlinkStreamActuatorControlTarget<3>::new_instance, &MavlinkStreamActuatorControlTarget<3>::get_name_static),
 	new StreamListItem(&MavlinkStreamNamedValueFloat::new_instance, &MavlinkStreamNamedValueFloat::get_name_static),
+	new StreamListItem(&MavlinkStreamPerfCounter::new_instance, &MavlinkStreamPerfCounter::get_name_static),
 	new StreamListItem(&MavlinkStreamCameraCapture::new_instance, &MavlinkStreamCameraCapture::get_name_static),
 	new StreamListItem(&MavlinkStreamDistanceSensor::new_instance, &MavlinkStreamDistanceSensor::get_name_static),
 	nullptr
@@ -79,6 +79,8 @@ MavlinkMissionManager::MavlinkMissionManager(Mavlink *mavlink) : MavlinkStream(m
 	_transfer_current_seq(0),
 	_transfer_partner_sysid(0),
 	_transfer_partner_compid(0),
+	_item_buffer_start(0),
+	_item_buffer_count(0),
 	_offboard_mission_sub(-1),
 	_mission_result_sub(-1),
 	_offboard_mission_pub(nullptr),
@@ -166,6 +168,58 @@ MavlinkMissionManager::update_active_mission(int dataman_id, unsigned count, int
 	}
 }
 
+int
+MavlinkMissionManager::flush_item_buffer()
+{
+	dm_item_t dm_item = DM_KEY_WAYPOINTS_OFFBOARD(_transfer_dataman_id);
+	unsigned count = _item_buffer_count;
+
+	_item_buffer_count = 0;
+
+	if (dm_write_range(dm_item, _item_buffer_start, count, DM_PERSIST_POWER_ON_RESET,
+			   _item_buffer, sizeof(struct mission_item_s)) != (ssize_t)count) {
+		return ERROR;
+	}
+
+	return OK;
+}
+
+int
+MavlinkMissionManager::read_mission_item(unsigned seq, struct mission_item_s *mission_item)
+{
+	dm_item_t dm_item = DM_KEY_WAYPOINTS_OFFBOARD(_dataman_id);
+
+	if (_state != MAVLINK_WPM_STATE_SENDLIST || seq >= _count) {
+		if (dm_read(dm_item, seq, mission_item, sizeof(struct mission_item_s)) != sizeof(struct mission_item_s)) {
+			return ERROR;
+		}
+
+		return OK;
+	}
+
+	/* the partner requests the items in order, fetch the next few with one dataman request */
+	if (seq < _item_buffer_start || seq >= _item_buffer_start + _item_buffer_count) {
+		unsigned count = _count - seq;
+
+		if (count > MAVLINK_MISSION_ITEM_BUFFER) {
+			count = MAVLINK_MISSION_ITEM_BUFFER;
+		}
+
+		ssize_t res = dm_read_range(dm_item, seq, count, _item_buffer, sizeof(struct mission_item_s));
+
+		_item_buffer_start = seq;
+		_item_buffer_count = (res > 0) ? res : 0;
+
+		if (_item_buffer_count == 0) {
+			return ERROR;
+		}
+	}
+
+	memcpy(mission_item, &_item_buffer[seq - _item_buffer_start], sizeof(struct mission_item_s));
+
+	return OK;
+}
+
 void
 MavlinkMissionManager::send_mission_ack(uint8_t sysid, uint8_t compid, uint8_t type)
 {
@@ -222,10 +276,9 @@ MavlinkMissionManager::send_mission_count(uint8_t sysid, uint8_t compid, uint16_
 void
 MavlinkMissionManager::send_mission_item(uint8_t sysid, uint8_t compid, uint16_t seq)
 {
-	dm_item_t dm_item = DM_KEY_WAYPOINTS_OFFBOARD(_dataman_id);
 	struct mission_item_s mission_item;
 
-	if (dm_read(dm_item, seq, &mission_item, sizeof(struct mission_item_s)) == sizeof(struct mission_item_s)) {
+	if (read_mission_item(seq, &mission_item) == OK) {
 		_time_last_sent = hrt_absolute_time();
 
 		/* create mission_item_s from mavlink_mission_item_t */
@@ -307,6 +360,11 @@ MavlinkMissionManager::send(const hrt_abstime now)
 		send_mission_current(_current_seq);
 
 		if (mission_result.item_do_jump_changed) {
+			/* items read ahead for the list transfer may be outdated now */
+			if (_state == MAVLINK_WPM_STATE_SENDLIST) {
+				_item_buffer_count = 0;
+			}
+
 			/* send a mission item again if the remaining DO_JUMPs has changed */
 			send_mission_item(_transfer_partner_sysid, _transfer_partner_compid,
 					  (uint16_t)mission_result.item_changed_index);
@@ -462,6 +520,7 @@ MavlinkMissionManager::handle_mission_request_list(const mavlink_message_t *msg)
 				_state = MAVLINK_WPM_STATE_SENDLIST;
 				_transfer_seq = 0;
 				_transfer_count = _count;
+				_item_buffer_count = 0;
 				_transfer_partner_sysid = msg->sysid;
 				_transfer_partner_compid = msg->compid;
 
@@ -592,6 +651,7 @@ MavlinkMissionManager::handle_mission_count(const mavlink_message_t *msg)
 			_transfer_count = wpc.count;
 			_transfer_dataman_id = _dataman_id == 0 ? 1 : 0;	// use inactive storage for transmission
 			_transfer_current_seq = -1;
+			_item_buffer_count = 0;
 
 		} else if (_state == MAVLINK_WPM_STATE_GETLIST) {
 			_time_last_recv = hrt_absolute_time();
@@ -664,9 +724,15 @@ MavlinkMissionManager::handle_mission_item(const mavlink_message_t *msg)
 			return;
 		}
 
-		dm_item_t dm_item = DM_KEY_WAYPOINTS_OFFBOARD(_transfer_dataman_id);
+		/* collect the items and store them in batches, the last one completes the transfer */
+		if (_item_buffer_count == 0) {
+			_item_buffer_start = wp.seq;
+		}
+
+		_item_buffer[_item_buffer_count++] = mission_item;
 
-		if (dm_write(dm_item, wp.seq, DM_PERSIST_POWER_ON_RESET, &mission_item, sizeof(struct mission_item_s)) != sizeof(struct mission_item_s)) {
+		if ((_item_buffer_count == MAVLINK_MISSION_ITEM_BUFFER || wp.seq + 1u == _transfer_count) &&
+		    flush_item_buffer() != OK) {
 			if (_verbose) { warnx("WPM: MISSION_ITEM ERROR: error writing seq %u to dataman ID %i", wp.seq, _transfer_dataman_id); }
 
 			send_mission_ack(_transfer_partner_sysid, _transfer_partner_compid, MAV_MISSION_ERROR);
@@ -43,6 +43,7 @@
 #pragma once
 
 #include <uORB/uORB.h>
+#include <uORB/topics/mission.h>
 
 #include "mavlink_bridge_header.h"
 #include "mavlink_rate_limiter.h"
@@ -66,6 +67,7 @@ enum MAVLINK_WPM_CODES {
 
 #define MAVLINK_MISSION_PROTOCOL_TIMEOUT_DEFAULT 5000000    ///< Protocol communication action timeout in useconds
 #define MAVLINK_MISSION_RETRY_TIMEOUT_DEFAULT 500000        ///< Protocol communication retry timeout in useconds
+#define MAVLINK_MISSION_ITEM_BUFFER 8                       ///< Mission items moved from/to dataman in one request
 
 class MavlinkMissionManager : public MavlinkStream {
 public:
@@ -118,6 +120,10 @@ private:
 	unsigned		_transfer_partner_sysid;		///< Partner system ID for current transmission
 	unsigned		_transfer_partner_compid;		///< Partner component ID for current transmission
 
+	struct mission_item_s	_item_buffer[MAVLINK_MISSION_ITEM_BUFFER];	///< Received items not yet stored, or items read ahead for sending
+	unsigned		_item_buffer_start;			///< Sequence of the first item in the buffer
+	unsigned		_item_buffer_count;			///< Number of items in the buffer
+
 	int			_offboard_mission_sub;
 	int			_mission_result_sub;
 	orb_advert_t		_offboard_mission_pub;
@@ -134,6 +140,16 @@ private:
 
 	int update_active_mission(int dataman_id, unsigned count, int seq);
 
+	/**
+	 *  @brief Writes the buffered items of the current transmission to dataman
+	 */
+	int flush_item_buffer();
+
+	/**
+	 *  @brief Reads an item of the active mission, reading ahead while sending the list
+	 */
+	int read_mission_item(unsigned seq, struct mission_item_s *mission_item);
+
 	/**
 	 *  @brief Sends an waypoint ack message
 	 */
@@ -73,6 +73,12 @@ MavlinkOrbSubscription::get_instance() const
 	return _instance;
 }
 
+int
+MavlinkOrbSubscription::get_fd() const
+{
+	return _fd;
+}
+
 bool
 MavlinkOrbSubscription::update(uint64_t *time, void* data)
 {
@@ -79,6 +79,11 @@ public:
 	orb_id_t get_topic() const;
 	int get_instance() const;
 
+	/**
+	 * Get the subscription handle, e.g. to poll on it.
+	 */
+	int get_fd() const;
+
 private:
 	const orb_id_t _topic;		///< topic metadata
 	const int _instance;		///< get topic instance
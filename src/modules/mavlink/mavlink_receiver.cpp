@@ -91,9 +91,12 @@ __END_DECLS
 
 static const float mg2ms2 = CONSTANTS_ONE_G / 1000.0f;
 
+static const uint8_t mavlink_message_crcs[256] = MAVLINK_MESSAGE_CRCS;
+
 MavlinkReceiver::MavlinkReceiver(Mavlink *parent) :
 	_mavlink(parent),
 	status{},
+	_parser(mavlink_message_crcs),
 	hil_local_pos{},
 	hil_land_detector{},
 	_control_mode{},
@@ -1107,12 +1110,24 @@ MavlinkReceiver::handle_message_request_data_stream(mavlink_message_t *msg)
 	if (req.target_system == mavlink_system.sysid && req.target_component == mavlink_system.compid && req.req_message_rate != 0) {
 		float rate = req.start_stop ? (1000.0f / req.req_message_rate) : 0.0f;
 
+		/* hand all matching streams to the main loop in one go, without waiting for it */
+		const char *names[MavlinkCommandQueue::CAPACITY];
+		float rates[MavlinkCommandQueue::CAPACITY];
+		unsigned count = 0;
+
 		MavlinkStream *stream;
 		LL_FOREACH(_mavlink->get_streams(), stream) {
-			if (req.req_stream_id == stream->get_id()) {
-				_mavlink->configure_stream_threadsafe(stream->get_name(), rate);
+			if (req.req_stream_id == stream->get_id() && count < MavlinkCommandQueue::CAPACITY) {
+				names[count] = stream->get_name();
+				rates[count] = rate;
+				count++;
 			}
 		}
+
+		/* a full queue is counted and shown in the status output */
+		if (count > 0) {
+			_mavlink->configure_streams_threadsafe(names, rates, count);
+		}
 	}
 }
 
@@ -1613,26 +1628,39 @@ MavlinkReceiver::handle_message_hil_state_quaternion(mavlink_message_t *msg)
 
 
 /**
- * Receive data from UART.
+ * Receive data from UART, or from the UDP socket on POSIX.
  */
 void *
 MavlinkReceiver::receive_thread(void *arg)
 {
-#ifndef __PX4_POSIX
-	int uart_fd = _mavlink->get_uart_fd();
+#if !defined(__PX4_POSIX) || defined(MAVLINK_UDP)
+#ifdef MAVLINK_UDP
+	int fd = _mavlink->get_socket_fd();
+
+	/* a datagram has to be read in one go */
+	uint8_t buf[1500];
+	struct sockaddr_in srcaddr;
+	socklen_t addrlen;
+#else
+	int fd = _mavlink->get_uart_fd();
+
+	/* the parser takes whole buffers, read as much as a poll wakeup typically brings */
+	uint8_t buf[128];
+#endif
 
 	const int timeout = 500;
-	uint8_t buf[32];
 
 	mavlink_message_t msg;
 
+#ifndef __PX4_POSIX
 	/* set thread name */
 	char thread_name[24];
 	sprintf(thread_name, "mavlink_rcv_if%d", _mavlink->get_instance_id());
 	prctl(PR_SET_NAME, thread_name, getpid());
+#endif
 
 	struct pollfd fds[1];
-	fds[0].fd = uart_fd;
+	fds[0].fd = fd;
 	fds[0].events = POLLIN;
 
 	ssize_t nread = 0;
@@ -1640,25 +1668,46 @@ MavlinkReceiver::receive_thread(void *arg)
 	while (!_mavlink->_task_should_exit) {
 		if (poll(fds, 1, timeout) > 0) {
 
+#ifdef MAVLINK_UDP
+			addrlen = sizeof(srcaddr);
+			nread = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&srcaddr, &addrlen);
+
+			if (nread > 0) {
+				/* answer whoever is talking to us */
+				_mavlink->set_udp_remote(srcaddr);
+			}
+
+#else
+
 			/* non-blocking read. read may return negative values */
-			if ((nread = ::read(uart_fd, buf, sizeof(buf))) < (ssize_t)sizeof(buf)) {
+			if ((nread = ::read(fd, buf, sizeof(buf))) < (ssize_t)sizeof(buf)) {
 				/* to avoid reading very small chunks wait for data before reading */
 				usleep(1000);
 			}
 
-			/* if read failed, this loop won't execute */
-			for (ssize_t i = 0; i < nread; i++) {
-				if (mavlink_parse_char(_mavlink->get_channel(), buf[i], &msg, &status)) {
+#endif
+
+			if (nread > 0) {
+				const uint8_t *frame;
+				unsigned frame_len;
+
+				_parser.feed(buf, nread);
+
+				while (_parser.next(&frame, &frame_len)) {
+					frame_to_message(frame, &msg);
+
 					/* handle generic messages and commands */
 					handle_message(&msg);
 
 					/* handle packet with parent object */
 					_mavlink->handle_message(&msg);
 				}
-			}
 
-			/* count received bytes */
-			_mavlink->count_rxbytes(nread);
+				status.parse_error = _parser.get_crc_errors();
+
+				/* count received bytes */
+				_mavlink->count_rxbytes(nread);
+			}
 		}
 	}
 #endif
@@ -1666,6 +1715,23 @@ MavlinkReceiver::receive_thread(void *arg)
 	return NULL;
 }
 
+void
+MavlinkReceiver::frame_to_message(const uint8_t *frame, mavlink_message_t *msg)
+{
+	msg->magic = frame[0];
+	msg->len = frame[1];
+	msg->seq = frame[2];
+	msg->sysid = frame[3];
+	msg->compid = frame[4];
+	msg->msgid = frame[5];
+	memcpy(_MAV_PAYLOAD_NON_CONST(msg), &frame[MAVLINK_NUM_HEADER_BYTES], msg->len);
+	msg->checksum = frame[MAVLINK_NUM_HEADER_BYTES + msg->len] |
+			(frame[MAVLINK_NUM_HEADER_BYTES + msg->len + 1] << 8);
+
+	status.current_rx_seq = msg->seq;
+	status.packet_rx_success_count++;
+}
+
 void MavlinkReceiver::print_status()
 {
 
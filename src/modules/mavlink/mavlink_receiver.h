@@ -76,6 +76,7 @@
 #include <uORB/topics/distance_sensor.h>
 
 #include "mavlink_ftp.h"
+#include "mavlink_frame_parser.h"
 
 #define PX4_EPOCH_SECS 1234567890ULL
 
@@ -144,12 +145,18 @@ private:
 	* Use timesync if available, monotonic boot time otherwise
 	*/
 	uint64_t sync_stamp(uint64_t usec);
+
+	/**
+	 * Fill a message from a frame found by the parser.
+	 */
+	void frame_to_message(const uint8_t *frame, mavlink_message_t *msg);
 	/**
 	* Exponential moving average filter to smooth time offset
 	*/
 	void smooth_time_offset(uint64_t offset_ns);
 
 	mavlink_status_t status;
+	MavlinkFrameParser _parser;
 	struct vehicle_local_position_s hil_local_pos;
 	struct vehicle_land_detected_s hil_land_detector;
 	struct vehicle_control_mode_s _control_mode;
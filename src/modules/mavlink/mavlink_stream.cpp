@@ -95,3 +95,15 @@ MavlinkStream::update(const hrt_abstime t)
 
 	return -1;
 }
+
+hrt_abstime
+MavlinkStream::get_next_due()
+{
+	unsigned int interval = _interval;
+
+	if (!const_rate()) {
+		interval /= _mavlink->get_rate_mult();
+	}
+
+	return _last_sent + interval;
+}
@@ -73,6 +73,11 @@ public:
 	 * @return 0 if updated / sent, -1 if unchanged
 	 */
 	int update(const hrt_abstime t);
+
+	/**
+	 * Get the time the stream is due next, at the current rate multiplier
+	 */
+	hrt_abstime get_next_due();
 	virtual const char *get_name() const = 0;
 	virtual uint8_t get_id() = 0;
 
@@ -38,6 +38,7 @@
 #include <crc32.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <drivers/drv_hrt.h>
 
 #include "mavlink_ftp_test.h"
 #include "../mavlink_ftp.h"
@@ -554,6 +555,295 @@ bool MavlinkFtpTest::_burst_test(void)
 	return true;
 }
 
+/// @brief Contents of the generated download test file at offset
+uint8_t MavlinkFtpTest::_download_byte(uint32_t offset)
+{
+	return (uint8_t)((offset * 7) ^ (offset >> 8));
+}
+
+/// @brief Creates a download test file of the given size on microsd
+bool MavlinkFtpTest::_create_download_file(uint32_t size)
+{
+	uint8_t buf[512];
+	
+	ut_compare("mkdir failed", ::mkdir(_unittest_microsd_dir, S_IRWXU | S_IRWXG | S_IRWXO), 0);
+	int fd = ::open(_unittest_microsd_file, O_CREAT | O_WRONLY);
+	ut_assert("open failed", fd != -1);
+	
+	for (uint32_t offset = 0; offset < size; offset += sizeof(buf)) {
+		uint32_t n = (size - offset < sizeof(buf)) ? size - offset : sizeof(buf);
+		
+		for (uint32_t i = 0; i < n; i++) {
+			buf[i] = _download_byte(offset + i);
+		}
+		
+		if (::write(fd, buf, n) != (ssize_t)n) {
+			::close(fd);
+			ut_assert("write failed", false);
+		}
+	}
+	
+	::close(fd);
+	
+	return true;
+}
+
+/// @brief Opens the download test file for reading
+bool MavlinkFtpTest::_open_download_file(uint8_t *session)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	
+	payload.opcode = MavlinkFTP::kCmdOpenFileRO;
+	payload.offset = 0;
+	
+	bool success = _send_receive_msg(&payload,				// FTP payload header
+					 strlen(_unittest_microsd_file)+1,	// size in bytes of data
+					 (uint8_t*)_unittest_microsd_file,	// Data to start into FTP message payload
+					 &reply);				// Payload inside FTP message response
+	if (!success) {
+		return false;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	*session = reply->session;
+	
+	return true;
+}
+
+/// @brief Reads the packets lost on the link with Read commands
+bool MavlinkFtpTest::_read_holes(WindowInfo *window_info, uint8_t session)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+	
+	for (unsigned i = 0; i < window_info->hole_count; i++) {
+		payload.opcode = MavlinkFTP::kCmdReadFile;
+		payload.session = session;
+		payload.offset = window_info->holes[i];
+		
+		bool success = _send_receive_msg(&payload,	// FTP payload header
+						 0,		// size in bytes of data
+						 nullptr,	// Data to start into FTP message payload
+						 &reply);	// Payload inside FTP message response
+		if (!success) {
+			return false;
+		}
+		
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+		ut_compare("Offset incorrect", reply->offset, window_info->holes[i]);
+		
+		for (unsigned j = 0; j < reply->size; j++) {
+			ut_compare("File contents differ", reply->data[j], _download_byte(reply->offset + j));
+		}
+		
+		window_info->received += reply->size;
+		
+		if (reply->offset == window_info->next_offset) {
+			window_info->next_offset += reply->size;
+		}
+	}
+	
+	window_info->hole_count = 0;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_window, window_info);
+	
+	return true;
+}
+
+/// @brief Downloads the test file with a burst, acknowledging every window and reading lost packets again
+bool MavlinkFtpTest::_window_download(WindowInfo *window_info, uint8_t session)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	mavlink_message_t			msg;
+	hrt_abstime				t = 0;
+	
+	window_info->ftp_test_class = this;
+	window_info->acked = 0;
+	window_info->next_offset = 0;
+	window_info->received = 0;
+	window_info->hole_count = 0;
+	window_info->packets = 0;
+	window_info->eof = false;
+	window_info->failed = false;
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_window, window_info);
+	
+	payload.opcode = MavlinkFTP::kCmdBurstReadFile;
+	payload.session = session;
+	payload.offset = 0;
+	
+	for (unsigned rounds = 0; !window_info->eof; rounds++) {
+		// Start the burst, or acknowledge what has been received so far
+		_setup_ftp_msg(&payload,
+			       window_info->window > 0 ? sizeof(uint32_t) : 0,
+			       (uint8_t*)&window_info->window,
+			       &msg);
+		_ftp_server->handle_message(&msg);
+		
+		// Stream until the window is full or EOF is reached
+		unsigned packets = window_info->packets;
+		_ftp_server->send(t);
+		
+		ut_assert("Incorrect stream message", !window_info->failed);
+		ut_assert("Stream stalled", rounds < window_info->file_size);
+		
+		if (window_info->packets == packets) {
+			// Nothing came, the last packet of the window was lost. Time out and read it again.
+			ut_assert("Too many lost packets", window_info->hole_count < sizeof(window_info->holes) / sizeof(window_info->holes[0]));
+			window_info->holes[window_info->hole_count++] = window_info->next_offset;
+		}
+		
+		if (!_read_holes(window_info, session)) {
+			return false;
+		}
+		
+		window_info->acked = window_info->next_offset;
+		payload.offset = window_info->acked;
+	}
+	
+	ut_compare("Bytes missing", window_info->received, window_info->file_size);
+	ut_compare("All packets should have been sent", _ftp_server->get_size(), 0);
+	
+	_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+	
+	return true;
+}
+
+/// @brief Tests windowed burst downloads over a lossless and a lossy link.
+bool MavlinkFtpTest::_burst_window_test(void)
+{
+	struct _testCase {
+		uint32_t	window;
+		unsigned	drop_every;
+	};
+	static const struct _testCase rgTestCases[] = {
+		{ 2048,	0 },	// lossless
+		{ 2048,	7 },	// lossy, lost packets are read again
+		{ 100,	5 },	// window smaller than a packet still makes progress
+	};
+	
+	const uint32_t file_size = 16 * 1024 + 17;
+	
+	if (!_create_download_file(file_size)) {
+		return false;
+	}
+	
+	for (size_t i=0; i<sizeof(rgTestCases)/sizeof(rgTestCases[0]); i++) {
+		uint8_t session;
+		WindowInfo window_info = {};
+		
+		if (!_open_download_file(&session)) {
+			return false;
+		}
+		
+		window_info.file_size = file_size;
+		window_info.window = rgTestCases[i].window;
+		window_info.drop_every = rgTestCases[i].drop_every;
+		window_info.check_contents = true;
+		
+		if (!_window_download(&window_info, session)) {
+			return false;
+		}
+		
+		MavlinkFTP::PayloadHeader		payload;
+		const MavlinkFTP::PayloadHeader		*reply;
+		
+		payload.opcode = MavlinkFTP::kCmdTerminateSession;
+		payload.session = session;
+		
+		bool success = _send_receive_msg(&payload,	// FTP payload header
+						 0,		// size in bytes of data
+						 nullptr,	// Data to start into FTP message payload
+						 &reply);	// Payload inside FTP message response
+		if (!success) {
+			return false;
+		}
+		
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	}
+	
+	return true;
+}
+
+/// @brief Measures download throughput over a loopback link: a Read command per packet,
+/// a burst without window and a windowed burst.
+bool MavlinkFtpTest::_burst_benchmark(void)
+{
+	MavlinkFTP::PayloadHeader		payload;
+	const MavlinkFTP::PayloadHeader		*reply;
+	uint8_t					session;
+	
+	const uint32_t file_size = 128 * 1024;
+	
+	if (!_create_download_file(file_size)) {
+		return false;
+	}
+	
+	// Read command per packet
+	if (!_open_download_file(&session)) {
+		return false;
+	}
+	
+	hrt_abstime start = hrt_absolute_time();
+	
+	payload.opcode = MavlinkFTP::kCmdReadFile;
+	payload.session = session;
+	payload.offset = 0;
+	
+	while (payload.offset < file_size) {
+		payload.opcode = MavlinkFTP::kCmdReadFile;
+		
+		bool success = _send_receive_msg(&payload,	// FTP payload header
+						 0,		// size in bytes of data
+						 nullptr,	// Data to start into FTP message payload
+						 &reply);	// Payload inside FTP message response
+		if (!success) {
+			return false;
+		}
+		
+		ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+		ut_assert("No progress", reply->size > 0);
+		payload.offset += reply->size;
+	}
+	
+	hrt_abstime read_time = hrt_absolute_time() - start;
+	
+	// Bursts, closing and reopening the session for each to start cold
+	static const uint32_t windows[] = { 0, 8192 };
+	hrt_abstime burst_time[2];
+	
+	for (unsigned i = 0; i < 2; i++) {
+		WindowInfo window_info = {};
+		
+		_ftp_server->set_unittest_worker(MavlinkFtpTest::receive_message_handler_generic, this);
+		payload.opcode = MavlinkFTP::kCmdTerminateSession;
+		payload.session = session;
+		
+		if (!_send_receive_msg(&payload, 0, nullptr, &reply) || !_open_download_file(&session)) {
+			return false;
+		}
+		
+		window_info.file_size = file_size;
+		window_info.window = windows[i];
+		
+		start = hrt_absolute_time();
+		
+		if (!_window_download(&window_info, session)) {
+			return false;
+		}
+		
+		burst_time[i] = hrt_absolute_time() - start;
+	}
+	
+	printf("FTP download of %u bytes: read %u B/s, burst %u B/s, windowed burst %u B/s\n", (unsigned)file_size,
+	       (unsigned)(file_size * 1000000ULL / (read_time + 1)),
+	       (unsigned)(file_size * 1000000ULL / (burst_time[0] + 1)),
+	       (unsigned)(file_size * 1000000ULL / (burst_time[1] + 1)));
+	
+	return true;
+}
+
 /// @brief Tests for correct reponse to a Read command on an invalid session.
 bool MavlinkFtpTest::_read_badsession_test(void)
 {
@@ -813,6 +1103,66 @@ bool MavlinkFtpTest::_receive_message_handler_burst(const mavlink_file_transfer_
 	return true;
 }
 
+/// Static method used as callback from MavlinkFTP for windowed burst testing.
+void MavlinkFtpTest::receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data)
+{
+	WindowInfo* window_info = (WindowInfo*)worker_data;
+	
+	if (!window_info->ftp_test_class->_receive_message_handler_window(ftp_req, window_info)) {
+		window_info->failed = true;
+	}
+}
+
+bool MavlinkFtpTest::_receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_msg, WindowInfo* window_info)
+{
+	const MavlinkFTP::PayloadHeader* reply = reinterpret_cast<const MavlinkFTP::PayloadHeader *>(ftp_msg->payload);
+	uint32_t full_packet_bytes = MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN - sizeof(MavlinkFTP::PayloadHeader);
+	
+	ut_compare("Target system id mismatch", ftp_msg->target_system, clientSystemId);
+	ut_compare("Incorrect request opcode", reply->req_opcode, MavlinkFTP::kCmdBurstReadFile);
+	
+	window_info->packets++;
+	
+	if (reply->opcode == MavlinkFTP::kRspNak) {
+		// The EOF Nak is never lost, this client has no timeouts
+		ut_compare("Incorrect error code", reply->data[0], MavlinkFTP::kErrEOF);
+		
+		for (uint32_t offset = window_info->next_offset; offset < window_info->file_size; offset += full_packet_bytes) {
+			ut_assert("Too many lost packets", window_info->hole_count < sizeof(window_info->holes) / sizeof(window_info->holes[0]));
+			window_info->holes[window_info->hole_count++] = offset;
+		}
+		
+		window_info->eof = true;
+		return true;
+	}
+	
+	ut_compare("Didn't get Ack back", reply->opcode, MavlinkFTP::kRspAck);
+	
+	if (window_info->window > 0) {
+		ut_assert("Stream ran past the window", reply->offset - window_info->acked < window_info->window);
+	}
+	
+	if (window_info->drop_every > 0 && (window_info->packets % window_info->drop_every) == 0) {
+		// Lost on the link
+		return true;
+	}
+	
+	// Lost packets show up as a gap in the offsets, all but the last packet are full
+	for (uint32_t offset = window_info->next_offset; offset < reply->offset; offset += full_packet_bytes) {
+		ut_assert("Too many lost packets", window_info->hole_count < sizeof(window_info->holes) / sizeof(window_info->holes[0]));
+		window_info->holes[window_info->hole_count++] = offset;
+	}
+	
+	for (unsigned i = 0; window_info->check_contents && i < reply->size; i++) {
+		ut_compare("File contents differ", reply->data[i], _download_byte(reply->offset + i));
+	}
+	
+	window_info->next_offset = reply->offset + reply->size;
+	window_info->received += reply->size;
+	
+	return true;
+}
+
 /// @brief Decode and validate the incoming message
 bool MavlinkFtpTest::_decode_message(const mavlink_file_transfer_protocol_t	*ftp_msg,	///< Incoming FTP message
 				     const MavlinkFTP::PayloadHeader		**payload)	///< Payload inside FTP message response
@@ -897,6 +1247,8 @@ bool MavlinkFtpTest::run_tests(void)
 	ut_run_test(_read_test);
 	ut_run_test(_read_badsession_test);
 	ut_run_test(_burst_test);
+	ut_run_test(_burst_window_test);
+	ut_run_test(_burst_benchmark);
 	ut_run_test(_removedirectory_test);
 	ut_run_test(_createdirectory_test);
 	ut_run_test(_removefile_test);
@@ -61,6 +61,25 @@ public:
 	
 	static void receive_message_handler_burst(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data);
 	
+	/// Worker data for windowed burst handler, the client end of a loopback link
+	struct WindowInfo {
+		MavlinkFtpTest*		ftp_test_class;
+		uint32_t		file_size;
+		uint32_t		window;		///< 0 for a burst without window
+		uint32_t		acked;		///< offset last acknowledged to the server
+		uint32_t		next_offset;	///< offset following the last packet received
+		uint32_t		received;	///< bytes received, including retransmits
+		uint32_t		holes[32];	///< offsets of lost packets to read again
+		unsigned		hole_count;
+		unsigned		packets;
+		unsigned		drop_every;	///< lose every n-th packet on the link, 0 for none
+		bool			check_contents;	///< compare received data, off for benchmarking
+		bool			eof;
+		bool			failed;
+	};
+	
+	static void receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, void *worker_data);
+	
 	static const uint8_t serverSystemId = 50;	///< System ID for server
 	static const uint8_t serverComponentId = 1;	///< Component ID for server
 	static const uint8_t serverChannel = 0;		///< Channel to send to
@@ -87,6 +106,8 @@ private:
 	bool _read_test(void);
 	bool _read_badsession_test(void);
 	bool _burst_test(void);
+	bool _burst_window_test(void);
+	bool _burst_benchmark(void);
 	bool _removedirectory_test(void);
 	bool _createdirectory_test(void);
 	bool _removefile_test(void);
@@ -120,6 +141,13 @@ private:
 	};
 	
 	bool _receive_message_handler_burst(const mavlink_file_transfer_protocol_t* ftp_req, BurstInfo* burst_info);
+	bool _receive_message_handler_window(const mavlink_file_transfer_protocol_t* ftp_req, WindowInfo* window_info);
+	
+	bool _create_download_file(uint32_t size);
+	bool _open_download_file(uint8_t *session);
+	bool _window_download(WindowInfo *window_info, uint8_t session);
+	bool _read_holes(WindowInfo *window_info, uint8_t session);
+	static uint8_t _download_byte(uint32_t offset);
 	
 	MavlinkFTP*	_ftp_server;
 	uint16_t	_expected_seq_number;
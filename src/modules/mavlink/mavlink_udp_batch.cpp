@@ -0,0 +1,213 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_udp_batch.cpp
+ * UDP transport that coalesces the datagrams of one mavlink loop iteration.
+ */
+
+#include <px4_defines.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mavlink_udp_batch.h"
+
+MavlinkUDPBatch::MavlinkUDPBatch() :
+	_fd(-1),
+	_remote{},
+	_count(0),
+	_len{},
+	_buf{},
+	_sent(0),
+	_dropped(0),
+	_dropped_unreported(0),
+	_syscalls(0)
+{
+}
+
+MavlinkUDPBatch::~MavlinkUDPBatch()
+{
+	close();
+}
+
+int
+MavlinkUDPBatch::open(unsigned short local_port, const char *remote_ip, unsigned short remote_port)
+{
+	struct sockaddr_in local = {};
+
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(local_port);
+
+	_remote.sin_family = AF_INET;
+	_remote.sin_port = htons(remote_port);
+
+	if (inet_pton(AF_INET, remote_ip, &_remote.sin_addr) != 1) {
+		return -EINVAL;
+	}
+
+	_fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (_fd < 0) {
+		return -errno;
+	}
+
+	if (::bind(_fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+		int ret = -errno;
+		close();
+		return ret;
+	}
+
+	/* a slow GCS must never stall the mavlink loop, drop instead */
+	int flags = fcntl(_fd, F_GETFL, 0);
+	fcntl(_fd, F_SETFL, flags | O_NONBLOCK);
+
+	return OK;
+}
+
+void
+MavlinkUDPBatch::close()
+{
+	if (_fd >= 0) {
+		::close(_fd);
+		_fd = -1;
+	}
+
+	_count = 0;
+}
+
+bool
+MavlinkUDPBatch::set_remote(const struct sockaddr_in &addr)
+{
+	if (addr.sin_addr.s_addr == _remote.sin_addr.s_addr && addr.sin_port == _remote.sin_port) {
+		return false;
+	}
+
+	_remote = addr;
+	return true;
+}
+
+bool
+MavlinkUDPBatch::add(const uint8_t *buf, unsigned len)
+{
+	if (len > MAX_PACKET_LEN) {
+		return false;
+	}
+
+	if (_count == MAX_PACKETS) {
+		/* reported by the next flush() */
+		_dropped_unreported += send_batch();
+	}
+
+	memcpy(_buf[_count], buf, len);
+	_len[_count] = len;
+	_count++;
+
+	return true;
+}
+
+unsigned
+MavlinkUDPBatch::flush()
+{
+	unsigned dropped = send_batch() + _dropped_unreported;
+	_dropped_unreported = 0;
+
+	return dropped;
+}
+
+unsigned
+MavlinkUDPBatch::send_batch()
+{
+	unsigned sent = 0;
+
+	if (_count == 0) {
+		return 0;
+	}
+
+#ifdef __PX4_LINUX
+	struct iovec iov[MAX_PACKETS];
+	struct mmsghdr msgs[MAX_PACKETS];
+
+	memset(msgs, 0, sizeof(msgs));
+
+	for (unsigned i = 0; i < _count; i++) {
+		iov[i].iov_base = _buf[i];
+		iov[i].iov_len = _len[i];
+		msgs[i].msg_hdr.msg_name = &_remote;
+		msgs[i].msg_hdr.msg_namelen = sizeof(_remote);
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	/* sendmmsg stops at the first datagram the socket refuses, skip it and carry on */
+	unsigned next = 0;
+
+	while (next < _count) {
+		int ret = ::sendmmsg(_fd, &msgs[next], _count - next, 0);
+		_syscalls++;
+
+		if (ret > 0) {
+			sent += ret;
+			next += ret;
+
+		} else if (ret < 0 && errno == EINTR) {
+			continue;
+
+		} else {
+			/* refused, counted as dropped below */
+			next++;
+		}
+	}
+
+#else
+
+	for (unsigned i = 0; i < _count; i++) {
+		if (::sendto(_fd, _buf[i], _len[i], 0, (struct sockaddr *)&_remote, sizeof(_remote)) == (ssize_t)_len[i]) {
+			sent++;
+		}
+
+		_syscalls++;
+	}
+
+#endif
+
+	unsigned dropped = _count - sent;
+	_sent += sent;
+	_dropped += dropped;
+	_count = 0;
+
+	return dropped;
+}
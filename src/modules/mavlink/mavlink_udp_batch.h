@@ -0,0 +1,124 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+
+/**
+ * @file mavlink_udp_batch.h
+ * UDP transport that coalesces the datagrams of one mavlink loop iteration.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+class MavlinkUDPBatch
+{
+public:
+	static const unsigned MAX_PACKETS = 32;		///< datagrams per batch, a full batch is flushed on add()
+	static const unsigned MAX_PACKET_LEN = 280;	///< large enough for any MAVLink 1.0 frame
+
+	MavlinkUDPBatch();
+	~MavlinkUDPBatch();
+
+	/**
+	 * Open a non-blocking UDP socket bound to local_port on all interfaces.
+	 *
+	 * @param local_port	Port to receive on, 0 for an ephemeral port.
+	 * @param remote_ip	Default destination, e.g. "127.0.0.1" for a local GCS.
+	 * @param remote_port	Default destination port.
+	 * @return		OK on success, -errno otherwise.
+	 */
+	int			open(unsigned short local_port, const char *remote_ip, unsigned short remote_port);
+
+	void			close();
+
+	int			get_fd() { return _fd; }
+
+	/**
+	 * Change the destination, e.g. to the address a GCS is sending from.
+	 * Queued datagrams go to the new address.
+	 *
+	 * @return		true if the address changed.
+	 */
+	bool			set_remote(const struct sockaddr_in &addr);
+
+	const struct sockaddr_in &get_remote() { return _remote; }
+
+	/**
+	 * Queue one datagram, flushing first if the batch is full.
+	 *
+	 * @return		false if the datagram is too long.
+	 */
+	bool			add(const uint8_t *buf, unsigned len);
+
+	/**
+	 * Send all queued datagrams, with one sendmmsg call where available.
+	 *
+	 * @return		Number of datagrams that were not sent, including
+	 *			those dropped by flushes in add() since the last call.
+	 */
+	unsigned		flush();
+
+	unsigned		queued() { return _count; }
+
+	uint32_t		get_sent() { return _sent; }		///< datagrams sent
+	uint32_t		get_dropped() { return _dropped; }	///< datagrams the socket refused
+	uint32_t		get_syscalls() { return _syscalls; }	///< send calls made
+
+private:
+	int			_fd;
+	struct sockaddr_in	_remote;
+
+	unsigned		_count;
+	uint16_t		_len[MAX_PACKETS];
+	uint8_t			_buf[MAX_PACKETS][MAX_PACKET_LEN];
+
+	uint32_t		_sent;
+	uint32_t		_dropped;
+	unsigned		_dropped_unreported;	///< dropped by add(), not yet returned by flush()
+	uint32_t		_syscalls;
+
+	/**
+	 * Send the queued datagrams, skipping any the socket refuses.
+	 *
+	 * @return		Number of datagrams that were not sent.
+	 */
+	unsigned		send_batch();
+
+	/* do not allow copying this class */
+	MavlinkUDPBatch(const MavlinkUDPBatch &);
+	MavlinkUDPBatch operator=(const MavlinkUDPBatch &);
+};
@@ -46,7 +46,13 @@ SRCS 		 +=	mavlink.c \
 			mavlink_stream.cpp \
 			mavlink_rate_limiter.cpp \
 			mavlink_receiver.cpp \
-			mavlink_ftp.cpp 
+			mavlink_ftp.cpp \
+			mavlink_command_queue.cpp \
+			mavlink_frame_parser.cpp
+
+ifeq ($(PX4_TARGET_OS),posix)
+SRCS		 +=	mavlink_udp_batch.cpp
+endif
 
 INCLUDE_DIRS	 += $(MAVLINK_SRC)/include/mavlink
 
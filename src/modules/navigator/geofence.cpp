@@ -52,6 +52,7 @@
 #include <mavlink/mavlink_log.h>
 #include <geo/geo.h>
 #include <drivers/drv_hrt.h>
+#include <math.h>
 
 #define GEOFENCE_OFF 0
 #define GEOFENCE_FILE_ONLY 1
@@ -77,6 +78,10 @@ Geofence::Geofence() :
 	_altitude_min(0),
 	_altitude_max(0),
 	_verticesCount(0),
+	_fence_sub(-1),
+	_zones(),
+	_zones_loaded(false),
+	_distance_to_boundary(INFINITY),
 	_param_geofence_mode(this, "MODE"),
 	_param_altitude_mode(this, "ALTMODE"),
 	_param_source(this, "SOURCE"),
@@ -92,7 +97,9 @@ Geofence::Geofence() :
 
 Geofence::~Geofence()
 {
-
+	if (_fence_sub >= 0) {
+		orb_unsubscribe(_fence_sub);
+	}
 }
 
 
@@ -138,6 +145,9 @@ bool Geofence::inside(const struct vehicle_global_position_s &global_position,
 
 bool Geofence::inside(double lat, double lon, float altitude)
 {
+	/* before the max distance checks, they return early */
+	_distance_to_boundary = distanceToFence(lat, lon, altitude);
+
 	if (_param_geofence_mode.get() >= GEOFENCE_MAX_DISTANCES_ONLY) {
 		int32_t max_horizontal_distance = _param_max_hor_distance.get();
 		int32_t max_vertical_distance = _param_max_ver_distance.get();
@@ -150,6 +160,14 @@ bool Geofence::inside(double lat, double lon, float altitude)
 								   _home_pos.lat, _home_pos.lon, _home_pos.alt,
 								   &dist_xy, &dist_z);
 
+				if (max_vertical_distance > 0) {
+					_distance_to_boundary = fminf(_distance_to_boundary, max_vertical_distance - dist_z);
+				}
+
+				if (max_horizontal_distance > 0) {
+					_distance_to_boundary = fminf(_distance_to_boundary, max_horizontal_distance - dist_xy);
+				}
+
 				if (max_vertical_distance > 0 && (dist_z > max_vertical_distance)) {
 					if (hrt_elapsed_time(&_last_vertical_range_warning) > GEOFENCE_RANGE_WARNING_LIMIT) {
 						mavlink_log_critical(_mavlinkFd, "Geofence exceeded max vertical distance by %.1f m",
@@ -200,6 +218,8 @@ bool Geofence::inside_polygon(double lat, double lon, float altitude)
 		return true;
 	}
 
+	updateFence();
+
 	if (valid()) {
 
 		if (!isEmpty()) {
@@ -208,46 +228,128 @@ bool Geofence::inside_polygon(double lat, double lon, float altitude)
 				return false;
 			}
 
-			/*Horizontal check */
-			/* Adaptation of algorithm originally presented as
-			 * PNPOLY - Point Inclusion in Polygon Test
-			 * W. Randolph Franklin (WRF) */
+			/* Horizontal check, the vertices are read from dataman once and kept as zones */
+			if (!_zones_loaded && !loadZones()) {
+				/* not supposed to happen unless the datamanager can't access the SD card, etc. */
+				return false;
+			}
 
-			bool c = false;
+			return _zones.inside(lat, lon);
 
-			struct fence_vertex_s temp_vertex_i;
-			struct fence_vertex_s temp_vertex_j;
+		} else {
+			/* Empty fence --> accept all points */
+			return true;
+		}
 
-			/* Red until fence is finished */
-			for (unsigned i = 0, j = _verticesCount - 1; i < _verticesCount; j = i++) {
-				if (dm_read(DM_KEY_FENCE_POINTS, i, &temp_vertex_i, sizeof(struct fence_vertex_s)) != sizeof(struct fence_vertex_s)) {
-					break;
-				}
+	} else {
+		/* Invalid fence --> accept all points */
+		return true;
+	}
+}
 
-				if (dm_read(DM_KEY_FENCE_POINTS, j, &temp_vertex_j, sizeof(struct fence_vertex_s)) != sizeof(struct fence_vertex_s)) {
-					break;
+void
+Geofence::updateFence()
+{
+	/* subscribe from the navigator task, not from the constructor */
+	if (_fence_sub < 0) {
+		_fence_sub = orb_subscribe(ORB_ID(fence));
+	}
+
+	bool updated = false;
+	orb_check(_fence_sub, &updated);
+
+	if (updated) {
+		struct fence_s fence;
+		orb_copy(ORB_ID(fence), _fence_sub, &fence);
+
+		_verticesCount = fence.count;
+		_zones_loaded = false;
+	}
+}
+
+float
+Geofence::distanceToFence(double lat, double lon, float altitude)
+{
+	if ((_param_geofence_mode.get() == GEOFENCE_OFF)
+	    || (_param_geofence_mode.get() == GEOFENCE_MAX_DISTANCES_ONLY)) {
+		return INFINITY;
+	}
+
+	updateFence();
+
+	if (!valid() || isEmpty()) {
+		return INFINITY;
+	}
+
+	if (!_zones_loaded && !loadZones()) {
+		/* inside_polygon() treats this as a violation */
+		return -INFINITY;
+	}
+
+	float distance = fminf(altitude - _altitude_min, _altitude_max - altitude);
+
+	return fminf(distance, _zones.distance(lat, lon));
+}
+
+bool
+Geofence::loadZones()
+{
+	struct fence_vertex_s vertices[fence_s::GEOFENCE_MAX_VERTICES];
+	float lat[fence_s::GEOFENCE_MAX_VERTICES];
+	float lon[fence_s::GEOFENCE_MAX_VERTICES];
+
+	if (_verticesCount > fence_s::GEOFENCE_MAX_VERTICES ||
+	    dm_read_range(DM_KEY_FENCE_POINTS, 0, _verticesCount, vertices,
+			  sizeof(struct fence_vertex_s)) != (ssize_t)_verticesCount) {
+		return false;
+	}
+
+	_zones.clear();
+
+	unsigned i = 0;
+
+	while (i < _verticesCount) {
+		const struct fence_vertex_s &first = vertices[i];
+
+		switch (first.type) {
+		case fence_vertex_s::FENCE_VERTEX_POLYGON_INCLUSION:
+		case fence_vertex_s::FENCE_VERTEX_POLYGON_EXCLUSION: {
+				unsigned start = i;
+
+				while (i < _verticesCount && vertices[i].type == first.type && vertices[i].zone == first.zone) {
+					lat[i - start] = vertices[i].lat;
+					lon[i - start] = vertices[i].lon;
+					i++;
 				}
 
-				// skip vertex 0 (return point)
-				if (((double)temp_vertex_i.lon >= lon) != ((double)temp_vertex_j.lon >= lon) &&
-				    (lat <= (double)(temp_vertex_j.lat - temp_vertex_i.lat) * (lon - (double)temp_vertex_i.lon) /
-				     (double)(temp_vertex_j.lon - temp_vertex_i.lon) + (double)temp_vertex_i.lat)) {
-					c = !c;
+				if (!_zones.add_polygon(first.type == fence_vertex_s::FENCE_VERTEX_POLYGON_INCLUSION,
+							lat, lon, i - start)) {
+					warnx("Geofence: ignoring polygon at vertex %u", start);
 				}
 
+				break;
 			}
 
-			return c;
+		case fence_vertex_s::FENCE_VERTEX_CIRCLE_INCLUSION:
+		case fence_vertex_s::FENCE_VERTEX_CIRCLE_EXCLUSION:
+			if (!_zones.add_circle(first.type == fence_vertex_s::FENCE_VERTEX_CIRCLE_INCLUSION,
+					       first.lat, first.lon, first.radius)) {
+				warnx("Geofence: ignoring circle at vertex %u", i);
+			}
 
-		} else {
-			/* Empty fence --> accept all points */
-			return true;
-		}
+			i++;
+			break;
 
-	} else {
-		/* Invalid fence --> accept all points */
-		return true;
+		default:
+			warnx("Geofence: ignoring vertex %u of unknown type %u", i, first.type);
+			i++;
+			break;
+		}
 	}
+
+	_zones_loaded = true;
+
+	return true;
 }
 
 bool
@@ -258,9 +360,9 @@ Geofence::valid()
 		return true;
 	}
 
-	// Otherwise
-	if ((_verticesCount < 4) || (_verticesCount > fence_s::GEOFENCE_MAX_VERTICES)) {
-		warnx("Fence must have at least 3 sides and not more than %d", fence_s::GEOFENCE_MAX_VERTICES - 1);
+	// Otherwise, single zones are checked when they are loaded
+	if (_verticesCount > fence_s::GEOFENCE_MAX_VERTICES) {
+		warnx("Fence must not have more than %d vertices", fence_s::GEOFENCE_MAX_VERTICES);
 		return false;
 	}
 
@@ -300,9 +402,12 @@ Geofence::addPoint(int argc, char *argv[])
 		last = 1;
 	}
 
+	memset(&vertex, 0, sizeof(vertex));
 	vertex.lat = (float)lat;
 	vertex.lon = (float)lon;
 
+	_zones_loaded = false;
+
 	if (dm_write(DM_KEY_FENCE_POINTS, ix, DM_PERSIST_POWER_ON_RESET, &vertex, sizeof(vertex)) == sizeof(vertex)) {
 		if (last) {
 			publishFence((unsigned)ix + 1);
@@ -317,11 +422,15 @@ Geofence::addPoint(int argc, char *argv[])
 void
 Geofence::publishFence(unsigned vertices)
 {
+	struct fence_s fence;
+	memset(&fence, 0, sizeof(fence));
+	fence.count = vertices;
+
 	if (_fence_pub == nullptr) {
-		_fence_pub = orb_advertise(ORB_ID(fence), &vertices);
+		_fence_pub = orb_advertise(ORB_ID(fence), &fence);
 
 	} else {
-		orb_publish(ORB_ID(fence), _fence_pub, &vertices);
+		orb_publish(ORB_ID(fence), _fence_pub, &fence);
 	}
 }
 
@@ -332,6 +441,8 @@ Geofence::loadFromFile(const char *filename)
 	char		line[120];
 	int			pointCounter = 0;
 	bool		gotVertical = false;
+	uint8_t		polygonType = fence_vertex_s::FENCE_VERTEX_POLYGON_INCLUSION;
+	uint8_t		zone = 0;
 	const char commentChar = '#';
 	int rc = ERROR;
 
@@ -370,9 +481,53 @@ Geofence::loadFromFile(const char *filename)
 		if (gotVertical) {
 			/* Parse the line as a geofence point */
 			struct fence_vertex_s vertex;
+			memset(&vertex, 0, sizeof(vertex));
+			char keyword[16] = "";
+			char kind[16] = "";
+
+			/* "polygon inclusion|exclusion" starts a new polygon, the vertices before the first one form an inclusion polygon */
+			if (sscanf(line, "%15s %15s", keyword, kind) == 2 && strcmp(keyword, "polygon") == 0) {
+				if (strcmp(kind, "inclusion") == 0) {
+					polygonType = fence_vertex_s::FENCE_VERTEX_POLYGON_INCLUSION;
+
+				} else if (strcmp(kind, "exclusion") == 0) {
+					polygonType = fence_vertex_s::FENCE_VERTEX_POLYGON_EXCLUSION;
+
+				} else {
+					warnx("Geofence: unknown polygon type %s", kind);
+					goto error;
+				}
+
+				zone++;
+				continue;
+			}
+
+			vertex.type = polygonType;
+			vertex.zone = zone;
+
+			/* "circle inclusion|exclusion lat lon radius" is a circle stored as a single vertex */
+			if (strcmp(keyword, "circle") == 0) {
+				if (sscanf(line, "%15s %15s %f %f %f", keyword, kind, &vertex.lat, &vertex.lon, &vertex.radius) != 5) {
+					warnx("Scanf to parse geofence circle failed.");
+					goto error;
+				}
+
+				if (strcmp(kind, "inclusion") == 0) {
+					vertex.type = fence_vertex_s::FENCE_VERTEX_CIRCLE_INCLUSION;
+
+				} else if (strcmp(kind, "exclusion") == 0) {
+					vertex.type = fence_vertex_s::FENCE_VERTEX_CIRCLE_EXCLUSION;
+
+				} else {
+					warnx("Geofence: unknown circle type %s", kind);
+					goto error;
+				}
+
+				/* vertices following the circle continue the polygon as a new zone */
+				zone++;
 
-			/* if the line starts with DMS, this means that the coordinate is given as degree minute second instead of decimal degrees */
-			if (line[textStart] == 'D' && line[textStart + 1] == 'M' && line[textStart + 2] == 'S') {
+			} else if (line[textStart] == 'D' && line[textStart + 1] == 'M' && line[textStart + 2] == 'S') {
+				/* if the line starts with DMS, this means that the coordinate is given as degree minute second instead of decimal degrees */
 				/* Handle degree minute second format */
 				float lat_d, lat_m, lat_s, lon_d, lon_m, lon_s;
 
@@ -433,5 +588,6 @@ error:
 int Geofence::clearDm()
 {
 	dm_clear(DM_KEY_FENCE_POINTS);
+	_zones_loaded = false;
 	return OK;
 }
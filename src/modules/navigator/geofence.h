@@ -50,6 +50,8 @@
 #include <controllib/block/BlockParam.hpp>
 #include <drivers/drv_hrt.h>
 
+#include "geofence_zones.h"
+
 #define GEOFENCE_FILENAME "/fs/microsd/etc/geofence.txt"
 
 class Geofence : public control::SuperBlock
@@ -83,6 +85,14 @@ public:
 
 	bool inside_polygon(double lat, double lon, float altitude);
 
+	/**
+	 * Return the signed distance in meters to the nearest geofence limit at the last check.
+	 *
+	 * Negative if a limit is violated, also before the violation counter triggers.
+	 * INFINITY if no limit is active.
+	 */
+	float getDistanceToBoundary() { return _distance_to_boundary; }
+
 	int clearDm();
 
 	bool valid();
@@ -118,6 +128,12 @@ private:
 
 	unsigned 			_verticesCount;
 
+	int			_fence_sub;			/**< fence topic, announces vertex changes */
+	GeofenceZones		_zones;				/**< zones built from the fence vertices in dataman */
+	bool			_zones_loaded;			/**< _zones matches dataman */
+
+	float			_distance_to_boundary;
+
 	/* Params */
 	control::BlockParamInt _param_geofence_mode;
 	control::BlockParamInt _param_altitude_mode;
@@ -132,6 +148,24 @@ private:
 
 	bool inside(double lat, double lon, float altitude);
 	bool inside(const struct vehicle_global_position_s &global_position);
+
+	/**
+	 * Take over the vertex count of a fence topic update and drop the zones.
+	 */
+	void updateFence();
+
+	/**
+	 * Read the vertices from dataman and build the zones.
+	 *
+	 * Consecutive polygon vertices with the same type and zone index form one polygon,
+	 * malformed zones are skipped.
+	 */
+	bool loadZones();
+
+	/**
+	 * Signed distance to the altitude limits and zones of the fence, see getDistanceToBoundary().
+	 */
+	float distanceToFence(double lat, double lon, float altitude);
 	bool inside(const struct vehicle_global_position_s &global_position, float baro_altitude_amsl);
 };
 
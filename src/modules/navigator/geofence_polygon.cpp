@@ -0,0 +1,338 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_polygon.cpp
+ * In-memory edge table of a geofence polygon for fast containment checks
+ */
+
+#include "geofence_polygon.h"
+
+#include <math.h>
+#include <stddef.h>
+
+/* meters per degree of latitude on a spherical earth */
+static const double METERS_PER_DEGREE = 6371000.0 * M_PI / 180.0;
+
+/* target size of the bucket index, in edge references per edge */
+static const unsigned INDEX_REFS_PER_EDGE = 8;
+
+GeofencePolygon::GeofencePolygon() :
+	_ref_lat(0.0),
+	_ref_lon(0.0),
+	_scale_x(0.0),
+	_scale_y(0.0),
+	_box_x_min(0.0f),
+	_box_x_max(0.0f),
+	_box_y_min(0.0f),
+	_box_y_max(0.0f),
+	_points(nullptr),
+	_point_count(0),
+	_edges(nullptr),
+	_edge_count(0),
+	_bucket_width(0.0f),
+	_bucket_count(0),
+	_bucket_start(nullptr),
+	_bucket_edges(nullptr)
+{
+}
+
+GeofencePolygon::~GeofencePolygon()
+{
+	clear();
+}
+
+void
+GeofencePolygon::clear()
+{
+	delete[] _points;
+	delete[] _edges;
+	delete[] _bucket_start;
+	delete[] _bucket_edges;
+
+	_points = nullptr;
+	_point_count = 0;
+	_edges = nullptr;
+	_edge_count = 0;
+	_bucket_start = nullptr;
+	_bucket_edges = nullptr;
+	_bucket_count = 0;
+}
+
+bool
+GeofencePolygon::build(const float *lat, const float *lon, unsigned count)
+{
+	clear();
+
+	if (count < 3) {
+		return false;
+	}
+
+	_points = new Point[count];
+	_edges = new Edge[count];
+
+	if (_points == nullptr || _edges == nullptr) {
+		clear();
+		return false;
+	}
+
+	_ref_lat = lat[0];
+	_ref_lon = lon[0];
+	_scale_y = METERS_PER_DEGREE;
+	_scale_x = METERS_PER_DEGREE * cos(_ref_lat * M_PI / 180.0);
+
+	_box_x_min = _box_x_max = 0.0f;
+	_box_y_min = _box_y_max = 0.0f;
+
+	for (unsigned i = 0; i < count; i++) {
+		to_planar(lat[i], lon[i], &_points[i].x, &_points[i].y);
+	}
+
+	_point_count = count;
+
+	for (unsigned i = 0, j = count - 1; i < count; j = i++) {
+		float xi = _points[i].x;
+		float yi = _points[i].y;
+		float xj = _points[j].x;
+		float yj = _points[j].y;
+
+		_box_x_min = fminf(_box_x_min, xi);
+		_box_x_max = fmaxf(_box_x_max, xi);
+		_box_y_min = fminf(_box_y_min, yi);
+		_box_y_max = fmaxf(_box_y_max, yi);
+
+		/* a ray along y never crosses an edge parallel to it */
+		if (xi == xj) {
+			continue;
+		}
+
+		Edge &edge = _edges[_edge_count++];
+		edge.x_min = fminf(xi, xj);
+		edge.x_max = fmaxf(xi, xj);
+		edge.x0 = xi;
+		edge.y0 = yi;
+		edge.slope = (yj - yi) / (xj - xi);
+	}
+
+	/* the index is an optimization only, the linear scan gives the same result */
+	build_index();
+
+	return true;
+}
+
+unsigned
+GeofencePolygon::bucket(float x) const
+{
+	float b = (x - _box_x_min) / _bucket_width;
+
+	if (b <= 0.0f) {
+		return 0;
+
+	} else if (b >= (float)(_bucket_count - 1)) {
+		return _bucket_count - 1;
+	}
+
+	return (unsigned)b;
+}
+
+bool
+GeofencePolygon::build_index()
+{
+	unsigned refs = 0;
+
+	if (_edge_count < INDEX_MIN_EDGES || _edge_count > UINT16_MAX) {
+		return false;
+	}
+
+	/*
+	 * An edge lands in about span / width * buckets + 1 buckets. Use one bucket per edge
+	 * unless long edges, e.g. the spikes of a star shape, would blow up the index.
+	 */
+	float width, span;
+	width = _box_x_max - _box_x_min;
+	span = 0.0f;
+
+	for (unsigned e = 0; e < _edge_count; e++) {
+		span += _edges[e].x_max - _edges[e].x_min;
+	}
+
+	_bucket_count = _edge_count;
+
+	if (span > 0.0f && (INDEX_REFS_PER_EDGE - 1) * _edge_count * width / span < _bucket_count) {
+		_bucket_count = (unsigned)((INDEX_REFS_PER_EDGE - 1) * _edge_count * width / span);
+	}
+
+	if (_bucket_count < 2 || !(width > 0.0f)) {
+		_bucket_count = 0;
+		return false;
+	}
+
+	_bucket_width = width / _bucket_count;
+	_bucket_start = new unsigned[_bucket_count + 1];
+
+	if (_bucket_start == nullptr) {
+		goto fail;
+	}
+
+	/* count the edges per bucket, an edge belongs to all buckets its x range touches */
+	for (unsigned b = 0; b <= _bucket_count; b++) {
+		_bucket_start[b] = 0;
+	}
+
+	for (unsigned e = 0; e < _edge_count; e++) {
+		unsigned first = bucket(_edges[e].x_min);
+		unsigned last = bucket(_edges[e].x_max);
+
+		for (unsigned b = first; b <= last; b++) {
+			_bucket_start[b + 1]++;
+		}
+
+		refs += last - first + 1;
+
+		/* guard against the estimate being way off */
+		if (refs > _edge_count * (INDEX_REFS_PER_EDGE + 2)) {
+			goto fail;
+		}
+	}
+
+	for (unsigned b = 0; b < _bucket_count; b++) {
+		_bucket_start[b + 1] += _bucket_start[b];
+	}
+
+	_bucket_edges = new uint16_t[refs];
+
+	if (_bucket_edges == nullptr) {
+		goto fail;
+	}
+
+	/* fill, using the start offsets as insert positions and shifting them back afterwards */
+	for (unsigned e = 0; e < _edge_count; e++) {
+		unsigned first = bucket(_edges[e].x_min);
+		unsigned last = bucket(_edges[e].x_max);
+
+		for (unsigned b = first; b <= last; b++) {
+			_bucket_edges[_bucket_start[b]++] = e;
+		}
+	}
+
+	for (unsigned b = _bucket_count; b > 0; b--) {
+		_bucket_start[b] = _bucket_start[b - 1];
+	}
+
+	_bucket_start[0] = 0;
+
+	return true;
+
+fail:
+	delete[] _bucket_start;
+	_bucket_start = nullptr;
+	_bucket_count = 0;
+	return false;
+}
+
+bool
+GeofencePolygon::inside(double lat, double lon) const
+{
+	float x, y;
+	to_planar(lat, lon, &x, &y);
+
+	/* bounding box reject, no edge can be crossed from out there */
+	if (_edge_count == 0 || x <= _box_x_min || x > _box_x_max ||
+	    y < _box_y_min || y > _box_y_max) {
+		return false;
+	}
+
+	bool c = false;
+
+	if (_bucket_count > 0) {
+		unsigned b = bucket(x);
+
+		for (unsigned k = _bucket_start[b]; k < _bucket_start[b + 1]; k++) {
+			if (crosses(_edges[_bucket_edges[k]], x, y)) {
+				c = !c;
+			}
+		}
+
+	} else {
+		for (unsigned e = 0; e < _edge_count; e++) {
+			if (crosses(_edges[e], x, y)) {
+				c = !c;
+			}
+		}
+	}
+
+	return c;
+}
+
+float
+GeofencePolygon::distance(double lat, double lon) const
+{
+	float x, y;
+	to_planar(lat, lon, &x, &y);
+
+	float min_dist_sq = INFINITY;
+
+	for (unsigned i = 0, j = _point_count - 1; i < _point_count; j = i++) {
+		/* closest point on the segment from vertex j to vertex i */
+		float dx = _points[i].x - _points[j].x;
+		float dy = _points[i].y - _points[j].y;
+		float px = x - _points[j].x;
+		float py = y - _points[j].y;
+		float len_sq = dx * dx + dy * dy;
+		float t = (len_sq > 0.0f) ? (px * dx + py * dy) / len_sq : 0.0f;
+
+		if (t < 0.0f) {
+			t = 0.0f;
+
+		} else if (t > 1.0f) {
+			t = 1.0f;
+		}
+
+		float ex = px - t * dx;
+		float ey = py - t * dy;
+		min_dist_sq = fminf(min_dist_sq, ex * ex + ey * ey);
+	}
+
+	return sqrtf(min_dist_sq);
+}
+
+float
+GeofencePolygon::box_distance(double lat, double lon) const
+{
+	float x, y;
+	to_planar(lat, lon, &x, &y);
+
+	float dx = fmaxf(fmaxf(_box_x_min - x, x - _box_x_max), 0.0f);
+	float dy = fmaxf(fmaxf(_box_y_min - y, y - _box_y_max), 0.0f);
+
+	return sqrtf(dx * dx + dy * dy);
+}
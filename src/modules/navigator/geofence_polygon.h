@@ -0,0 +1,152 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_polygon.h
+ * In-memory edge table of a geofence polygon for fast containment checks
+ */
+
+#ifndef GEOFENCE_POLYGON_H_
+#define GEOFENCE_POLYGON_H_
+
+#include <stdint.h>
+
+class GeofencePolygon
+{
+public:
+	GeofencePolygon();
+	~GeofencePolygon();
+
+	/**
+	 * Build the edge table of a closed polygon.
+	 *
+	 * The vertices are converted to planar coordinates in meters around the
+	 * first vertex. The conversion is a per-axis scaling of latitude and
+	 * longitude, so edges stay the straight lat/lon lines the PNPOLY test on
+	 * raw coordinates uses and the containment result does not change.
+	 * Fences with many edges additionally get a bucket index.
+	 *
+	 * @param lat vertex latitudes in degrees
+	 * @param lon vertex longitudes in degrees
+	 * @param count number of vertices, the last one connects back to the first
+	 * @return false if there are less than 3 vertices or no memory
+	 */
+	bool build(const float *lat, const float *lon, unsigned count);
+
+	/**
+	 * Drop the edge table.
+	 */
+	void clear();
+
+	/**
+	 * Return whether a point is inside the polygon.
+	 *
+	 * Same crossing rule as the PNPOLY test on raw coordinates: an edge counts
+	 * if the point's longitude is in (lon_min, lon_max] of the edge and the
+	 * point is at or south of it.
+	 */
+	bool inside(double lat, double lon) const;
+
+	/**
+	 * Return the distance in meters from a point to the nearest edge.
+	 */
+	float distance(double lat, double lon) const;
+
+	/**
+	 * Return the distance in meters from a point to the bounding box, zero inside it.
+	 *
+	 * This is a cheap lower bound for distance().
+	 */
+	float box_distance(double lat, double lon) const;
+
+	bool empty() const { return _point_count == 0; }
+
+	bool indexed() const { return _bucket_count > 0; }
+
+	/** Minimum number of edges before the bucket index is built */
+	static const unsigned INDEX_MIN_EDGES = 32;
+
+private:
+	struct Point {
+		float x;
+		float y;
+	};
+
+	/* edge with x in (x_min, x_max], vertical edges never cross and are not stored */
+	struct Edge {
+		float x_min;
+		float x_max;
+		float x0;		/**< x of the edge's first vertex */
+		float y0;		/**< y of the edge's first vertex */
+		float slope;		/**< dy/dx */
+	};
+
+	double		_ref_lat;	/**< latitude of the planar origin in degrees */
+	double		_ref_lon;	/**< longitude of the planar origin in degrees */
+	double		_scale_x;	/**< meters per degree of longitude */
+	double		_scale_y;	/**< meters per degree of latitude */
+
+	float		_box_x_min;	/**< bounding box of all vertices */
+	float		_box_x_max;
+	float		_box_y_min;
+	float		_box_y_max;
+
+	Point		*_points;	/**< all vertices in planar coordinates */
+	unsigned	_point_count;
+
+	Edge		*_edges;
+	unsigned	_edge_count;
+
+	/* the bounding box is split into equally wide slices along x, each lists the edges overlapping it */
+	float		_bucket_width;
+	unsigned	_bucket_count;
+	unsigned	*_bucket_start;	/**< _bucket_count + 1 offsets into _bucket_edges */
+	uint16_t	*_bucket_edges;	/**< edge indices, grouped by bucket */
+
+	bool build_index();
+	unsigned bucket(float x) const;
+	void to_planar(double lat, double lon, float *x, float *y) const
+	{
+		*x = (float)((lon - _ref_lon) * _scale_x);
+		*y = (float)((lat - _ref_lat) * _scale_y);
+	}
+	bool crosses(const Edge &edge, float x, float y) const
+	{
+		return x > edge.x_min && x <= edge.x_max && y <= edge.y0 + (x - edge.x0) * edge.slope;
+	}
+
+	/* do not allow copying this class */
+	GeofencePolygon(const GeofencePolygon &);
+	GeofencePolygon &operator=(const GeofencePolygon &);
+};
+
+#endif /* GEOFENCE_POLYGON_H_ */
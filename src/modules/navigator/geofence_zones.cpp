@@ -0,0 +1,189 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_zones.cpp
+ * Set of inclusion and exclusion zones making up a geofence
+ */
+
+#include "geofence_zones.h"
+
+#include <math.h>
+
+/* meters per degree of latitude, same spherical earth as GeofencePolygon */
+static const double METERS_PER_DEGREE = 6371000.0 * M_PI / 180.0;
+
+GeofenceZones::GeofenceZones() :
+	_polygon_count(0),
+	_circle_count(0),
+	_inclusion_count(0)
+{
+}
+
+void
+GeofenceZones::clear()
+{
+	for (unsigned i = 0; i < _polygon_count; i++) {
+		_polygons[i].clear();
+	}
+
+	_polygon_count = 0;
+	_circle_count = 0;
+	_inclusion_count = 0;
+}
+
+bool
+GeofenceZones::add_polygon(bool inclusion, const float *lat, const float *lon, unsigned count)
+{
+	if (_polygon_count >= MAX_POLYGONS || !_polygons[_polygon_count].build(lat, lon, count)) {
+		return false;
+	}
+
+	_polygon_inclusion[_polygon_count++] = inclusion;
+	_inclusion_count += inclusion;
+
+	return true;
+}
+
+bool
+GeofenceZones::add_circle(bool inclusion, double lat, double lon, float radius)
+{
+	if (_circle_count >= MAX_CIRCLES || !(radius > 0.0f)) {
+		return false;
+	}
+
+	Circle &circle = _circles[_circle_count++];
+	circle.lat = lat;
+	circle.lon = lon;
+	circle.scale_x = METERS_PER_DEGREE * cos(lat * M_PI / 180.0);
+	circle.radius = radius;
+	circle.inclusion = inclusion;
+
+	_inclusion_count += inclusion;
+
+	return true;
+}
+
+float
+GeofenceZones::circle_distance(const Circle &circle, double lat, double lon) const
+{
+	/* distance from the center in the same planar approximation the polygons use */
+	float dx = (float)((lon - circle.lon) * circle.scale_x);
+	float dy = (float)((lat - circle.lat) * METERS_PER_DEGREE);
+
+	return sqrtf(dx * dx + dy * dy);
+}
+
+bool
+GeofenceZones::inside(double lat, double lon) const
+{
+	/* any exclusion zone rejects */
+	for (unsigned i = 0; i < _polygon_count; i++) {
+		if (!_polygon_inclusion[i] && _polygons[i].inside(lat, lon)) {
+			return false;
+		}
+	}
+
+	for (unsigned i = 0; i < _circle_count; i++) {
+		if (!_circles[i].inclusion && circle_distance(_circles[i], lat, lon) <= _circles[i].radius) {
+			return false;
+		}
+	}
+
+	if (_inclusion_count == 0) {
+		return true;
+	}
+
+	/* any inclusion zone accepts */
+	for (unsigned i = 0; i < _polygon_count; i++) {
+		if (_polygon_inclusion[i] && _polygons[i].inside(lat, lon)) {
+			return true;
+		}
+	}
+
+	for (unsigned i = 0; i < _circle_count; i++) {
+		if (_circles[i].inclusion && circle_distance(_circles[i], lat, lon) <= _circles[i].radius) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+float
+GeofenceZones::distance(double lat, double lon) const
+{
+	/*
+	 * Signed distance, positive on the allowed side: the union of the inclusion zones
+	 * takes the maximum, subtracting the exclusion zones the minimum.
+	 */
+	float inclusion = (_inclusion_count > 0) ? -INFINITY : INFINITY;
+	float exclusion = INFINITY;
+
+	/* circles first, they are cheap and tighten the bounds used to skip polygons */
+	for (unsigned i = 0; i < _circle_count; i++) {
+		float d = _circles[i].radius - circle_distance(_circles[i], lat, lon);
+
+		if (_circles[i].inclusion) {
+			inclusion = fmaxf(inclusion, d);
+
+		} else {
+			exclusion = fminf(exclusion, -d);
+		}
+	}
+
+	for (unsigned i = 0; i < _polygon_count; i++) {
+		const GeofencePolygon &polygon = _polygons[i];
+
+		/* no point outside the bounding box can do better than the distance to it */
+		float bound = polygon.box_distance(lat, lon);
+
+		if (_polygon_inclusion[i]) {
+			if (bound > 0.0f && -bound <= inclusion) {
+				continue;
+			}
+
+			float d = polygon.distance(lat, lon);
+			inclusion = fmaxf(inclusion, polygon.inside(lat, lon) ? d : -d);
+
+		} else {
+			if (bound > 0.0f && bound >= exclusion) {
+				continue;
+			}
+
+			float d = polygon.distance(lat, lon);
+			exclusion = fminf(exclusion, polygon.inside(lat, lon) ? -d : d);
+		}
+	}
+
+	return fminf(inclusion, exclusion);
+}
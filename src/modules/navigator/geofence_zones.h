@@ -0,0 +1,117 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+/**
+ * @file geofence_zones.h
+ * Set of inclusion and exclusion zones making up a geofence
+ */
+
+#ifndef GEOFENCE_ZONES_H_
+#define GEOFENCE_ZONES_H_
+
+#include "geofence_polygon.h"
+
+class GeofenceZones
+{
+public:
+	GeofenceZones();
+
+	static const unsigned MAX_POLYGONS = 8;
+	static const unsigned MAX_CIRCLES = 16;
+
+	/**
+	 * Remove all zones.
+	 */
+	void clear();
+
+	/**
+	 * Add a polygon zone, see GeofencePolygon::build().
+	 *
+	 * @param inclusion true if the vehicle has to stay inside, false if it has to stay outside
+	 * @return false if the polygon is invalid or there are too many polygons
+	 */
+	bool add_polygon(bool inclusion, const float *lat, const float *lon, unsigned count);
+
+	/**
+	 * Add a circular zone.
+	 *
+	 * @param inclusion true if the vehicle has to stay inside, false if it has to stay outside
+	 * @param radius radius in meters
+	 * @return false if the radius is not positive or there are too many circles
+	 */
+	bool add_circle(bool inclusion, double lat, double lon, float radius);
+
+	bool empty() const { return _polygon_count == 0 && _circle_count == 0; }
+
+	/**
+	 * Return whether a point is in the allowed area.
+	 *
+	 * The allowed area is the union of all inclusion zones, or everywhere if there
+	 * are none, minus the union of all exclusion zones.
+	 */
+	bool inside(double lat, double lon) const;
+
+	/**
+	 * Return the signed horizontal distance in meters to the boundary of the allowed area.
+	 *
+	 * Positive inside the allowed area, negative outside, INFINITY if there are no zones.
+	 * Overlapping zones are combined like signed distance fields, so the magnitude is
+	 * exact for a single zone and a safe estimate near where zones meet.
+	 */
+	float distance(double lat, double lon) const;
+
+private:
+	struct Circle {
+		double lat;		/**< center latitude in degrees */
+		double lon;		/**< center longitude in degrees */
+		double scale_x;		/**< meters per degree of longitude at the center */
+		float radius;		/**< radius in meters */
+		bool inclusion;
+	};
+
+	GeofencePolygon	_polygons[MAX_POLYGONS];
+	bool		_polygon_inclusion[MAX_POLYGONS];
+	unsigned	_polygon_count;
+
+	Circle		_circles[MAX_CIRCLES];
+	unsigned	_circle_count;
+
+	unsigned	_inclusion_count;	/**< number of inclusion zones of either shape */
+
+	float circle_distance(const Circle &circle, double lat, double lon) const;
+
+	/* do not allow copying this class */
+	GeofenceZones(const GeofenceZones &);
+	GeofenceZones &operator=(const GeofenceZones &);
+};
+
+#endif /* GEOFENCE_ZONES_H_ */
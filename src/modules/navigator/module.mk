@@ -48,6 +48,8 @@ SRCS		= navigator_main.cpp \
 		  rtl_params.c \
 		  mission_feasibility_checker.cpp \
 		  geofence.cpp \
+		  geofence_polygon.cpp \
+		  geofence_zones.cpp \
 		  geofence_params.c \
 		  datalinkloss.cpp \
 		  datalinkloss_params.c \
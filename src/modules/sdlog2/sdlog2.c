@@ -100,6 +100,7 @@
 #include <uORB/topics/vtol_vehicle_status.h>
 #include <uORB/topics/time_offset.h>
 #include <uORB/topics/mc_att_ctrl_status.h>
+#include <uORB/topics/perf_counter.h>
 
 #include <systemlib/systemlib.h>
 #include <systemlib/param/param.h>
@@ -1092,6 +1093,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 		struct vtol_vehicle_status_s vtol_status;
 		struct time_offset_s time_offset;
 		struct mc_att_ctrl_status_s mc_att_ctrl_status;
+		struct perf_counter_s perf_counter;
 	} buf;
 
 	memset(&buf, 0, sizeof(buf));
@@ -1138,6 +1140,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 			struct log_ENCD_s log_ENCD;
 			struct log_TSYN_s log_TSYN;
 			struct log_MACS_s log_MACS;
+			struct log_PERF_s log_PERF;
 		} body;
 	} log_msg = {
 		LOG_PACKET_HEADER_INIT(0)
@@ -1180,6 +1183,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 		int encoders_sub;
 		int tsync_sub;
 		int mc_att_ctrl_status_sub;
+		int perf_counter_sub;
 	} subs;
 
 	subs.cmd_sub = -1;
@@ -1213,6 +1217,7 @@ int sdlog2_thread_main(int argc, char *argv[])
 	subs.wind_sub = -1;
 	subs.tsync_sub = -1;
 	subs.mc_att_ctrl_status_sub = -1;
+	subs.perf_counter_sub = -1;
 	subs.encoders_sub = -1;
 
 	/* add new topics HERE */
@@ -1903,6 +1908,24 @@ int sdlog2_thread_main(int argc, char *argv[])
 			LOGBUFFER_WRITE_AND_COUNT(MACS);
 		}
 
+		/* --- PERFORMANCE COUNTERS --- */
+		/* queued topic, log every counter published since the last iteration */
+		while (copy_if_updated(ORB_ID(perf_counter), &subs.perf_counter_sub, &buf.perf_counter)) {
+			log_msg.msg_type = LOG_PERF_MSG;
+			memset(log_msg.body.log_PERF.name, 0, sizeof(log_msg.body.log_PERF.name));
+			strncpy(log_msg.body.log_PERF.name, (const char *)buf.perf_counter.name, sizeof(log_msg.body.log_PERF.name) - 1);
+			log_msg.body.log_PERF.events = buf.perf_counter.event_count;
+			log_msg.body.log_PERF.overruns = buf.perf_counter.event_overruns;
+			log_msg.body.log_PERF.mean = buf.perf_counter.mean;
+			log_msg.body.log_PERF.rms = buf.perf_counter.rms;
+			log_msg.body.log_PERF.min = buf.perf_counter.time_least;
+			log_msg.body.log_PERF.max = buf.perf_counter.time_most;
+			log_msg.body.log_PERF.p50 = buf.perf_counter.p50;
+			log_msg.body.log_PERF.p99 = buf.perf_counter.p99;
+			log_msg.body.log_PERF.p999 = buf.perf_counter.p999;
+			LOGBUFFER_WRITE_AND_COUNT(PERF);
+		}
+
 		/* signal the other thread new data, but not yet unlock */
 		if (logbuffer_count(&lb) > MIN_BYTES_TO_WRITE) {
 			/* only request write if several packets can be written at once */
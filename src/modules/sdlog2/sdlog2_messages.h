@@ -465,6 +465,21 @@ struct log_MACS_s {
 	float yaw_rate_integ;
 };
 
+/* --- PERF - PERFORMANCE COUNTER SNAPSHOT */
+#define LOG_PERF_MSG 45
+struct log_PERF_s {
+	char name[16];
+	uint32_t events;
+	uint32_t overruns;
+	float mean;
+	float rms;
+	uint32_t min;
+	uint32_t max;
+	uint32_t p50;
+	uint32_t p99;
+	uint32_t p999;
+};
+
 /********** SYSTEM MESSAGES, ID > 0x80 **********/
 
 /* --- TIME - TIME STAMP --- */
@@ -534,6 +549,7 @@ static const struct log_format_s log_formats[] = {
 	LOG_FORMAT(ENCD, "qfqf",	"cnt0,vel0,cnt1,vel1"),
 	LOG_FORMAT(TSYN, "Q", 		"TimeOffset"),
 	LOG_FORMAT(MACS, "fff", "RRint,PRint,YRint"),
+	LOG_FORMAT(PERF, "NIIffIIIII", "Name,Events,Ovr,Mean,RMS,Min,Max,P50,P99,P999"),
 
 	/* system-level messages, ID >= 0x80 */
 	/* FMT: don't write format of format message, it's useless */
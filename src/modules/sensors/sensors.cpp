@@ -526,7 +526,7 @@ Sensors::Sensors() :
 	_diff_pres_pub(nullptr),
 
 	/* performance counters */
-	_loop_perf(perf_alloc(PC_ELAPSED, "sensor task update")),
+	_loop_perf(perf_alloc(PC_HISTOGRAM, "sensor task update")),
 
 	_param_rc_values{},
 	_board_rotation{},
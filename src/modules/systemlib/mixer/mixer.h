@@ -458,15 +458,19 @@ enum class MultirotorGeometry : MultirotorGeometryUnderlyingType;
 class __EXPORT MultirotorMixer : public Mixer
 {
 public:
-	/**
+	/** largest rotor count of any geometry, a multiple of the SIMD width */
+	static const unsigned MAX_ROTORS = 8;
 
-	 * Precalculated rotor mix.
+	/**
+	 * Precalculated rotor mix for a whole geometry, one array per scale
+	 * so that the mix passes can work on several rotors at once. Entries
+	 * past the rotor count are zero.
 	 */
-	struct Rotor {
-		float	roll_scale;	/**< scales roll for this rotor */
-		float	pitch_scale;	/**< scales pitch for this rotor */
-		float	yaw_scale;	/**< scales yaw for this rotor */
-		float	out_scale;	/**< scales total out for this rotor */
+	struct RotorTable {
+		float	roll_scale[MAX_ROTORS];
+		float	pitch_scale[MAX_ROTORS];
+		float	yaw_scale[MAX_ROTORS];
+		float	out_scale[MAX_ROTORS];
 	};
 
 	/**
@@ -518,6 +522,22 @@ public:
 	virtual unsigned		mix(float *outputs, unsigned space, uint16_t *status_reg);
 	virtual void			groups_required(uint32_t &groups);
 
+	/**
+	 * Mix a batch of control vectors without going through the control
+	 * callback, e.g. for offline analysis of a geometry.
+	 *
+	 * @param controls		count groups of roll, pitch, yaw and thrust,
+	 *				in the same units as control group 0.
+	 * @param count			The number of control vectors.
+	 * @param outputs		Array receiving the rotor outputs of each
+	 *				vector back to back.
+	 * @param space			The number of available entries in the output array.
+	 * @param status_regs		Optional array of count saturation status words.
+	 * @return			The number of control vectors that were mixed.
+	 */
+	unsigned			mix_batch(const float *controls, unsigned count,
+						  float *outputs, unsigned space, uint16_t *status_regs);
+
 private:
 	float				_roll_scale;
 	float				_pitch_scale;
@@ -528,7 +548,10 @@ private:
 	multirotor_motor_limits_s 	_limits;
 
 	unsigned			_rotor_count;
-	const Rotor			*_rotors;
+	const RotorTable		*_rotors;
+
+	unsigned			mix_controls(float roll, float pitch, float yaw, float thrust,
+						     float *outputs, uint16_t *status_reg);
 
 	/* do not allow to copy due to ptr data members */
 	MultirotorMixer(const MultirotorMixer&);
@@ -50,6 +50,14 @@
 #include <unistd.h>
 #include <math.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MIXER_SIMD_NEON
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#define MIXER_SIMD_SSE
+#endif
+
 #include <px4iofirmware/protocol.h>
 
 #include "mixer.h"
@@ -75,6 +83,131 @@ float constrain(float val, float min, float max)
 	return (val < min) ? min : ((val > max) ? max : val);
 }
 
+/*
+ * The kernels below run over the rotor table four rotors at a time. lanes is
+ * the rotor count rounded up to a multiple of four; the table is zero padded
+ * up to MAX_ROTORS, so padded rotors produce zero and never move min / max.
+ */
+
+/* rp[i] = roll * roll_scale[i] + pitch * pitch_scale[i] */
+void mix_roll_pitch(const MultirotorMixer::RotorTable *t, unsigned lanes, float roll, float pitch, float *rp)
+{
+#if defined(MIXER_SIMD_NEON)
+	for (unsigned i = 0; i < lanes; i += 4) {
+		float32x4_t v = vmulq_n_f32(vld1q_f32(&t->roll_scale[i]), roll);
+		vst1q_f32(&rp[i], vmlaq_n_f32(v, vld1q_f32(&t->pitch_scale[i]), pitch));
+	}
+#elif defined(MIXER_SIMD_SSE)
+	const __m128 r = _mm_set1_ps(roll);
+	const __m128 p = _mm_set1_ps(pitch);
+
+	for (unsigned i = 0; i < lanes; i += 4) {
+		__m128 v = _mm_add_ps(_mm_mul_ps(r, _mm_loadu_ps(&t->roll_scale[i])),
+				      _mm_mul_ps(p, _mm_loadu_ps(&t->pitch_scale[i])));
+		_mm_storeu_ps(&rp[i], v);
+	}
+#else
+	for (unsigned i = 0; i < lanes; i++) {
+		rp[i] = roll * t->roll_scale[i] + pitch * t->pitch_scale[i];
+	}
+#endif
+}
+
+/* min / max of (rp[i] + thrust) * out_scale[i], starting from zero */
+void mix_range(const MultirotorMixer::RotorTable *t, unsigned lanes, const float *rp, float thrust,
+	       float &min_out, float &max_out)
+{
+#if defined(MIXER_SIMD_NEON)
+	const float32x4_t th = vdupq_n_f32(thrust);
+	float32x4_t lo = vdupq_n_f32(0.0f);
+	float32x4_t hi = lo;
+
+	for (unsigned i = 0; i < lanes; i += 4) {
+		float32x4_t v = vmulq_f32(vaddq_f32(vld1q_f32(&rp[i]), th), vld1q_f32(&t->out_scale[i]));
+		lo = vminq_f32(lo, v);
+		hi = vmaxq_f32(hi, v);
+	}
+
+	float32x2_t l = vpmin_f32(vget_low_f32(lo), vget_high_f32(lo));
+	float32x2_t h = vpmax_f32(vget_low_f32(hi), vget_high_f32(hi));
+	min_out = vget_lane_f32(vpmin_f32(l, l), 0);
+	max_out = vget_lane_f32(vpmax_f32(h, h), 0);
+#elif defined(MIXER_SIMD_SSE)
+	const __m128 th = _mm_set1_ps(thrust);
+	__m128 lo = _mm_setzero_ps();
+	__m128 hi = lo;
+
+	for (unsigned i = 0; i < lanes; i += 4) {
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&rp[i]), th), _mm_loadu_ps(&t->out_scale[i]));
+		/* operand order matches the scalar compares, a NaN output is ignored */
+		lo = _mm_min_ps(v, lo);
+		hi = _mm_max_ps(v, hi);
+	}
+
+	lo = _mm_min_ps(lo, _mm_movehl_ps(lo, lo));
+	hi = _mm_max_ps(hi, _mm_movehl_ps(hi, hi));
+	min_out = _mm_cvtss_f32(_mm_min_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+	max_out = _mm_cvtss_f32(_mm_max_ss(hi, _mm_shuffle_ps(hi, hi, 1)));
+#else
+	min_out = 0.0f;
+	max_out = 0.0f;
+
+	for (unsigned i = 0; i < lanes; i++) {
+		float out = (rp[i] + thrust) * t->out_scale[i];
+
+		if (out < min_out) {
+			min_out = out;
+		}
+
+		if (out > max_out) {
+			max_out = out;
+		}
+	}
+#endif
+}
+
+/* out[i] = rp[i] * rp_scale + yaw * yaw_scale[i] + thrust + boost, mapped to [idle_speed,1] */
+void mix_final(const MultirotorMixer::RotorTable *t, unsigned lanes, const float *rp, float rp_scale,
+	       float yaw, float thrust, float boost, float idle_speed, float *out)
+{
+#if defined(MIXER_SIMD_NEON)
+	const float32x4_t th = vdupq_n_f32(thrust);
+	const float32x4_t bo = vdupq_n_f32(boost);
+	const float32x4_t idle = vdupq_n_f32(idle_speed);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+
+	for (unsigned i = 0; i < lanes; i += 4) {
+		float32x4_t v = vmulq_n_f32(vld1q_f32(&rp[i]), rp_scale);
+		v = vmlaq_n_f32(v, vld1q_f32(&t->yaw_scale[i]), yaw);
+		v = vaddq_f32(vaddq_f32(v, th), bo);
+		v = vmlaq_n_f32(idle, v, 1.0f - idle_speed);
+		vst1q_f32(&out[i], vminq_f32(vmaxq_f32(v, idle), one));
+	}
+#elif defined(MIXER_SIMD_SSE)
+	const __m128 rps = _mm_set1_ps(rp_scale);
+	const __m128 y = _mm_set1_ps(yaw);
+	const __m128 th = _mm_set1_ps(thrust);
+	const __m128 bo = _mm_set1_ps(boost);
+	const __m128 idle = _mm_set1_ps(idle_speed);
+	const __m128 range = _mm_set1_ps(1.0f - idle_speed);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	for (unsigned i = 0; i < lanes; i += 4) {
+		__m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&rp[i]), rps),
+				      _mm_mul_ps(y, _mm_loadu_ps(&t->yaw_scale[i])));
+		v = _mm_add_ps(_mm_add_ps(v, th), bo);
+		v = _mm_add_ps(idle, _mm_mul_ps(v, range));
+		/* operand order matches constrain(), a NaN output is passed through */
+		_mm_storeu_ps(&out[i], _mm_min_ps(one, _mm_max_ps(idle, v)));
+	}
+#else
+	for (unsigned i = 0; i < lanes; i++) {
+		float v = rp[i] * rp_scale + yaw * t->yaw_scale[i] + thrust + boost;
+		out[i] = constrain(idle_speed + (v * (1.0f - idle_speed)), idle_speed, 1.0f);
+	}
+#endif
+}
+
 } // anonymous namespace
 
 MultirotorMixer::MultirotorMixer(ControlCallback control_cb,
@@ -199,6 +332,33 @@ MultirotorMixer::from_text(Mixer::ControlCallback control_cb, uintptr_t cb_handl
 
 unsigned
 MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
+{
+	return mix_controls(get_control(0, 0), get_control(0, 1), get_control(0, 2), get_control(0, 3),
+			    outputs, status_reg);
+}
+
+unsigned
+MultirotorMixer::mix_batch(const float *controls, unsigned count, float *outputs, unsigned space,
+			   uint16_t *status_regs)
+{
+	unsigned mixed = 0;
+
+	while (mixed < count && space >= _rotor_count) {
+		mix_controls(controls[0], controls[1], controls[2], controls[3],
+			     outputs, (status_regs != NULL) ? &status_regs[mixed] : NULL);
+
+		controls += 4;
+		outputs += _rotor_count;
+		space -= _rotor_count;
+		mixed++;
+	}
+
+	return mixed;
+}
+
+unsigned
+MultirotorMixer::mix_controls(float roll, float pitch, float yaw, float thrust, float *outputs,
+			      uint16_t *status_reg)
 {
 	/* Summary of mixing strategy:
 	1) mix roll, pitch and thrust without yaw.
@@ -211,12 +371,17 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	4) scale all outputs to range [idle_speed,1]
 	*/
 
-	float		roll    = constrain(get_control(0, 0) * _roll_scale, -1.0f, 1.0f);
-	float		pitch   = constrain(get_control(0, 1) * _pitch_scale, -1.0f, 1.0f);
-	float		yaw     = constrain(get_control(0, 2) * _yaw_scale, -1.0f, 1.0f);
-	float		thrust  = constrain(get_control(0, 3), 0.0f, 1.0f);
-	float		min_out = 0.0f;
-	float		max_out = 0.0f;
+	roll    = constrain(roll * _roll_scale, -1.0f, 1.0f);
+	pitch   = constrain(pitch * _pitch_scale, -1.0f, 1.0f);
+	yaw     = constrain(yaw * _yaw_scale, -1.0f, 1.0f);
+	thrust  = constrain(thrust, 0.0f, 1.0f);
+	float		min_out;
+	float		max_out;
+
+	/* rotors rounded up to whole SIMD vectors, see the kernels above */
+	const unsigned	lanes = (_rotor_count + 3) & ~3u;
+	float		rp[MAX_ROTORS];	/* roll / pitch share of each rotor, common to all passes */
+	float		bounded[MAX_ROTORS];
 
 	// clean register for saturation status flags
 	if (status_reg != NULL) {
@@ -227,23 +392,8 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	float thrust_decrease_factor = 0.6f;
 
 	/* perform initial mix pass yielding unbounded outputs, ignore yaw */
-	for (unsigned i = 0; i < _rotor_count; i++) {
-		float out = roll * _rotors[i].roll_scale +
-			    pitch * _rotors[i].pitch_scale +
-			    thrust;
-
-		out *= _rotors[i].out_scale;
-
-		/* calculate min and max output values */
-		if (out < min_out) {
-			min_out = out;
-		}
-		if (out > max_out) {
-			max_out = out;
-		}
-
-		outputs[i] = out;
-	}
+	mix_roll_pitch(_rotors, lanes, roll, pitch, rp);
+	mix_range(_rotors, lanes, rp, thrust, min_out, max_out);
 
 	float boost = 0.0f;				// value added to demanded thrust (can also be negative)
 	float roll_pitch_scale = 1.0f;	// scale for demanded roll and pitch
@@ -296,17 +446,15 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 
 	// mix again but now with thrust boost, scale roll/pitch and also add yaw
 	for(unsigned i = 0; i < _rotor_count; i++) {
-		float out = (roll * _rotors[i].roll_scale +
-			    pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
-				yaw * _rotors[i].yaw_scale +
+		float out = rp[i] * roll_pitch_scale +
+				yaw * _rotors->yaw_scale[i] +
 			    thrust + boost;
 
-		out *= _rotors[i].out_scale;
+		out *= _rotors->out_scale[i];
 
 		// scale yaw if it violates limits. inform about yaw limit reached
 		if(out < 0.0f) {
-			yaw = -((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
-				roll_pitch_scale + thrust + boost)/_rotors[i].yaw_scale;
+			yaw = -(rp[i] * roll_pitch_scale + thrust + boost)/_rotors->yaw_scale[i];
 			if(status_reg != NULL) {
 				(*status_reg) |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
 			}
@@ -315,8 +463,7 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 			// allow to reduce thrust to get some yaw response
 			float thrust_reduction = fminf(0.15f, out - 1.0f);
 			thrust -= thrust_reduction;
-			yaw = (1.0f - ((roll * _rotors[i].roll_scale + pitch * _rotors[i].pitch_scale) *
-				roll_pitch_scale + thrust + boost))/_rotors[i].yaw_scale;
+			yaw = (1.0f - (rp[i] * roll_pitch_scale + thrust + boost))/_rotors->yaw_scale[i];
 			if(status_reg != NULL) {
 				(*status_reg) |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
 			}
@@ -324,14 +471,8 @@ MultirotorMixer::mix(float *outputs, unsigned space, uint16_t *status_reg)
 	}
 
 	/* last mix, add yaw and scale outputs to range idle_speed...1 */
-	for (unsigned i = 0; i < _rotor_count; i++) {
-		outputs[i] = (roll * _rotors[i].roll_scale +
-			    pitch * _rotors[i].pitch_scale) * roll_pitch_scale +
-				yaw * _rotors[i].yaw_scale +
-			    thrust + boost;
-
-		outputs[i] = constrain(_idle_speed + (outputs[i] * (1.0f - _idle_speed)), _idle_speed, 1.0f);
-	}
+	mix_final(_rotors, lanes, rp, roll_pitch_scale, yaw, thrust, boost, _idle_speed, bounded);
+	memcpy(outputs, bounded, _rotor_count * sizeof(float));
 
 	return _rotor_count;
 }
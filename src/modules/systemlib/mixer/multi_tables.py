@@ -183,19 +183,26 @@ def printEnum():
     print("}; // enum class MultirotorGeometry\n")
 
 def printScaleTables():
+    maxRotors = 8
     for table in tables:
-        print("const MultirotorMixer::Rotor _config_{}[] = {{".format(variableName(table)))
+        assert len(table) <= maxRotors
+        scales = [[], [], [], []]
         for row in table:
             angle, yawScale, thrustScale = unpackScales(row)
-            rollScale = rcos(angle + 90)
-            pitchScale = rcos(angle)
-            print("\t{{ {:9f}, {:9f}, {:9f}, {:9f} }},".format(rollScale, pitchScale, yawScale, thrustScale))
+            scales[0] += [rcos(angle + 90)]
+            scales[1] += [rcos(angle)]
+            scales[2] += [yawScale]
+            scales[3] += [thrustScale]
+        print("const MultirotorMixer::RotorTable _config_{} = {{".format(variableName(table)))
+        for column in scales:
+            column += [0.0] * (maxRotors - len(column))
+            print("\t{{ {} }},".format(", ".join("{:9f}".format(value) for value in column)))
         print("};\n")
 
 def printScaleTablesIndex():
-    print("const MultirotorMixer::Rotor *_config_index[] = {")
+    print("const MultirotorMixer::RotorTable *_config_index[] = {")
     for table in tables:
-        print("\t&_config_{}[0],".format(variableName(table)))
+        print("\t&_config_{},".format(variableName(table)))
     print("};\n")
 
 
@@ -50,6 +50,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <systemlib/err.h>
+#include <systemlib/name_hash.h>
 #include <errno.h>
 #include <semaphore.h>
 
@@ -73,11 +74,38 @@
 #ifdef __PX4_QURT
 #define PARAM_OPEN	px4_open
 #define PARAM_CLOSE	px4_close
+#define PARAM_READ	px4_read
+#define PARAM_WRITE	px4_write
+#define PARAM_FSYNC	px4_fsync
 #else
 #define PARAM_OPEN	open
 #define PARAM_CLOSE	close
+#define PARAM_READ	read
+#define PARAM_WRITE	write
+#define PARAM_FSYNC	fsync
 #endif
 
+/**
+ * Parameter journal.
+ *
+ * The default parameter file starts with a complete BSON document holding
+ * all modified values, followed by journal records.  Each record is a BSON
+ * document holding only the values changed since the previous save, and
+ * starts with a PARAM_JOURNAL_MARKER element.  The journal is terminated by
+ * a zero document length, which the next record overwrites.
+ *
+ * There is no fixed journal size.  The records may take up as many bytes
+ * as the parameter document in front of them, but at least
+ * PARAM_JOURNAL_MIN_SIZE (see param_journal_limit()).  A save that would
+ * grow the journal past that rewrites (compacts) the whole file instead, so
+ * a load never reads much more than twice what a compacted file holds.  A
+ * load stops replaying at a record longer than that limit.
+ */
+#ifndef PARAM_JOURNAL_MIN_SIZE
+#define PARAM_JOURNAL_MIN_SIZE	2048
+#endif
+#define PARAM_JOURNAL_MARKER	"_journal"
+
 /**
  * Array of static parameter info.
  */
@@ -127,12 +155,52 @@ get_param_info_count(void)
 	return param_info_count;
 }
 
+/**
+ * Open addressing hash table mapping parameter names to handles.
+ *
+ * The set of parameters is only known once the __param section has been
+ * linked, so the table is built on first lookup rather than at compile time.
+ * Slots hold the handle + 1, zero marks an empty slot.
+ *
+ * A table is completely filled before its pointer is published, and never
+ * modified afterwards, so lookups do not need the parameter lock.
+ */
+struct param_hash_s {
+	const struct param_info_s *base;
+	unsigned count;
+	unsigned size;
+	uint16_t slots[];
+};
+
+static struct param_hash_s *param_hash = NULL;
+
 /** flexible array holding modified parameter values */
 UT_array	*param_values;
 
 /** array info for the modified parameters array */
 const UT_icd	param_icd = {sizeof(struct param_wbuf_s), NULL, NULL, NULL};
 
+/** offset of the journal terminator in the default file, or -1 if the file must be rewritten */
+static off_t param_journal_end = -1;
+
+/** size of the parameter document the journal follows in the default file */
+static off_t param_journal_start = -1;
+
+/** offset the last import stopped at, or -1 if unknown */
+static off_t param_import_end = -1;
+
+/** size of the parameter document of the last import, or -1 if unknown */
+static off_t param_import_start = -1;
+
+/**
+ * Room for journal records behind a parameter document of the given size.
+ */
+static off_t
+param_journal_limit(off_t start)
+{
+	return (start > PARAM_JOURNAL_MIN_SIZE) ? start : PARAM_JOURNAL_MIN_SIZE;
+}
+
 /** parameter update topic */
 ORB_DEFINE(parameter_update, struct parameter_update_s);
 
@@ -178,25 +246,41 @@ handle_in_range(param_t param)
 }
 
 /**
- * Compare two modifid parameter structures to determine ordering.
+ * Binary search the (sorted) modified parameter array.
+ *
+ * bsearch is not available on all targets, so this is done by hand.
  *
- * This function is suitable for passing to qsort or bsearch.
+ * @param param			The parameter being searched.
+ * @param pos			Set to the index of the parameter if found, or
+ *				the index it should be inserted at if not.
+ * @return			The structure holding the modified value, or
+ *				NULL if the parameter has not been modified.
  */
-static int
-param_compare_values(const void *a, const void *b)
+static struct param_wbuf_s *
+param_search_changed(param_t param, unsigned *pos)
 {
-	struct param_wbuf_s *pa = (struct param_wbuf_s *)a;
-	struct param_wbuf_s *pb = (struct param_wbuf_s *)b;
+	unsigned lo = 0;
+	unsigned hi = (param_values != NULL) ? utarray_len(param_values) : 0;
 
-	if (pa->param < pb->param) {
-		return -1;
-	}
+	while (lo < hi) {
+		unsigned mid = lo + (hi - lo) / 2;
+		struct param_wbuf_s *s = (struct param_wbuf_s *)_utarray_eltptr(param_values, mid);
 
-	if (pa->param > pb->param) {
-		return 1;
+		if (s->param == param) {
+			*pos = mid;
+			return s;
+		}
+
+		if (s->param < param) {
+			lo = mid + 1;
+
+		} else {
+			hi = mid;
+		}
 	}
 
-	return 0;
+	*pos = lo;
+	return NULL;
 }
 
 /**
@@ -209,27 +293,81 @@ param_compare_values(const void *a, const void *b)
 static struct param_wbuf_s *
 param_find_changed(param_t param)
 {
-	struct param_wbuf_s	*s = NULL;
+	unsigned pos;
 
 	param_assert_locked();
 
-	if (param_values != NULL) {
-#if 0	/* utarray_find requires bsearch, not available */
-		struct param_wbuf_s key;
-		key.param = param;
-		s = utarray_find(param_values, &key, param_compare_values);
-#else
+	return param_search_changed(param, &pos);
+}
 
-		while ((s = (struct param_wbuf_s *)utarray_next(param_values, s)) != NULL) {
-			if (s->param == param) {
-				break;
-			}
+/**
+ * Get the name hash table, building it if the parameter set has changed.
+ *
+ * Concurrent first lookups may each build a table; only one of them is
+ * published and the others are freed by the thread that built them.
+ *
+ * @return			The table, or NULL if lookups must fall back
+ *				to a linear search.
+ */
+static const struct param_hash_s *
+param_hash_get(void)
+{
+	unsigned count = get_param_info_count();
+	struct param_hash_s *cur = __atomic_load_n(&param_hash, __ATOMIC_ACQUIRE);
+
+	if (cur != NULL && cur->base == param_info_base && cur->count == count) {
+		return cur;
+	}
+
+	/* handles are stored in 16 bits */
+	if (count == 0 || count >= UINT16_MAX) {
+		return NULL;
+	}
+
+	/* power of two size, at most 3/4 full */
+	unsigned size = 16;
+
+	while (size * 3 < count * 4) {
+		size <<= 1;
+	}
+
+	struct param_hash_s *table = calloc(1, sizeof(*table) + size * sizeof(table->slots[0]));
+
+	if (table == NULL) {
+		return NULL;
+	}
+
+	table->base = param_info_base;
+	table->count = count;
+	table->size = size;
+
+	for (param_t param = 0; param < count; param++) {
+		unsigned slot = name_hash(param_info_base[param].name) & (size - 1);
+
+		while (table->slots[slot] != 0) {
+			slot = (slot + 1) & (size - 1);
 		}
 
-#endif
+		table->slots[slot] = param + 1;
+	}
+
+	/* publish the filled table, unless another thread got there first */
+	if (__atomic_compare_exchange_n(&param_hash, &cur, table, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		/*
+		 * The replaced table belongs to a previous parameter set, which
+		 * only happens when unit tests swap the parameter array.  It is
+		 * leaked, readers hold no reference and may still be using it.
+		 */
+		return table;
 	}
 
-	return s;
+	free(table);
+
+	if (cur != NULL && cur->base == param_info_base && cur->count == count) {
+		return cur;
+	}
+
+	return NULL;
 }
 
 static void
@@ -254,7 +392,30 @@ param_find_internal(const char *name, bool notification)
 {
 	param_t param;
 
-	/* perform a linear search of the known parameters */
+	const struct param_hash_s *table = param_hash_get();
+
+	if (table != NULL) {
+		unsigned slot = name_hash(name) & (table->size - 1);
+
+		while (table->slots[slot] != 0) {
+			param = table->slots[slot] - 1;
+
+			if (!strcmp(param_info_base[param].name, name)) {
+				if (notification) {
+					param_set_used_internal(param);
+				}
+
+				return param;
+			}
+
+			slot = (slot + 1) & (table->size - 1);
+		}
+
+		/* not found */
+		return PARAM_INVALID;
+	}
+
+	/* no hash table, perform a linear search of the known parameters */
 
 	for (param = 0; handle_in_range(param); param++) {
 		if (!strcmp(param_info_base[param].name, name)) {
@@ -512,7 +673,8 @@ param_set_internal(param_t param, const void *val, bool mark_saved, bool notify_
 
 	if (handle_in_range(param)) {
 
-		struct param_wbuf_s *s = param_find_changed(param);
+		unsigned pos;
+		struct param_wbuf_s *s = param_search_changed(param, &pos);
 
 		if (s == NULL) {
 
@@ -523,12 +685,9 @@ param_set_internal(param_t param, const void *val, bool mark_saved, bool notify_
 				.unsaved = false
 			};
 
-			/* add it to the array and sort */
-			utarray_push_back(param_values, &buf);
-			utarray_sort(param_values, param_compare_values);
-
-			/* find it after sorting */
-			s = param_find_changed(param);
+			/* insert it in place to keep the array sorted */
+			utarray_insert(param_values, &buf, pos);
+			s = (struct param_wbuf_s *)_utarray_eltptr(param_values, pos);
 		}
 
 		/* update the changed value */
@@ -632,6 +791,9 @@ param_reset(param_t param)
 		if (s != NULL) {
 			int pos = utarray_eltidx(param_values, s);
 			utarray_erase(param_values, pos, 1);
+
+			/* the journal cannot record a removal, rewrite on next save */
+			param_journal_end = -1;
 		}
 
 		param_found = true;
@@ -657,6 +819,7 @@ param_reset_all(void)
 
 	/* mark as reset / deleted */
 	param_values = NULL;
+	param_journal_end = -1;
 
 	param_unlock();
 
@@ -707,9 +870,17 @@ param_set_default_file(const char *filename)
 	}
 
 	if (filename) {
-		param_user_file = strdup(filename);
+		/* not strdup: it is not declared in strict C99 builds */
+		param_user_file = malloc(strlen(filename) + 1);
+
+		if (param_user_file != NULL) {
+			strcpy(param_user_file, filename);
+		}
 	}
 
+	/* the journal position refers to the previous file */
+	param_journal_end = -1;
+
 	return 0;
 }
 
@@ -719,6 +890,84 @@ param_get_default_file(void)
 	return (param_user_file != NULL) ? param_user_file : param_default_file;
 }
 
+static int
+param_export_internal(struct bson_encoder_s *encoder, bool only_unsaved, bool mark_saved);
+
+static int
+param_export_fd(int fd, bool only_unsaved, bool mark_saved);
+
+/**
+ * Append the values changed since the last save to the journal.
+ *
+ * @param filename		The default parameter file.
+ * @return			OK if the journal is up to date, otherwise the
+ *				file has to be rewritten.
+ */
+static int
+param_journal_append(const char *filename)
+{
+#ifdef __PX4_QURT
+	/* no seekable storage */
+	return ERROR;
+#else
+	struct bson_encoder_s encoder;
+	int32_t terminator = 0;
+	int result = ERROR;
+	int fd = -1;
+
+	if (param_journal_end < 0) {
+		return ERROR;
+	}
+
+	bson_encoder_init_buf(&encoder, NULL, 0);
+
+	if (bson_encoder_append_int(&encoder, PARAM_JOURNAL_MARKER, 1) ||
+	    param_export_internal(&encoder, true, true) ||
+	    bson_encoder_fini(&encoder)) {
+		goto out;
+	}
+
+	int len = bson_encoder_buf_size(&encoder);
+
+	/* marker element only, nothing changed */
+	if (len == 4 + 1 + sizeof(PARAM_JOURNAL_MARKER) + 4 + 1) {
+		result = OK;
+		goto out;
+	}
+
+	if (param_journal_end - param_journal_start + len + (off_t)sizeof(terminator) >
+	    param_journal_limit(param_journal_start)) {
+		debug("journal full, compacting");
+		goto out;
+	}
+
+	fd = PARAM_OPEN(filename, O_WRONLY);
+
+	if (fd < 0 ||
+	    lseek(fd, param_journal_end, SEEK_SET) != param_journal_end ||
+	    PARAM_WRITE(fd, bson_encoder_buf_data(&encoder), len) != len ||
+	    PARAM_WRITE(fd, &terminator, sizeof(terminator)) != sizeof(terminator)) {
+		debug("journal append failed");
+		goto out;
+	}
+
+	PARAM_FSYNC(fd);
+
+	param_journal_end += len;
+	result = OK;
+
+out:
+
+	if (fd >= 0) {
+		PARAM_CLOSE(fd);
+	}
+
+	free(bson_encoder_buf_data(&encoder));
+
+	return result;
+#endif
+}
+
 int
 param_save_default(void)
 {
@@ -727,6 +976,13 @@ param_save_default(void)
 
 	const char *filename = param_get_default_file();
 
+	/* only write what changed if the journal has room */
+	if (param_journal_append(filename) == OK) {
+		return OK;
+	}
+
+	param_journal_end = -1;
+
 	/* write parameters to temp file */
 	fd = PARAM_OPEN(filename, O_WRONLY | O_CREAT, 0x777);
 
@@ -735,10 +991,24 @@ param_save_default(void)
 		return ERROR;
 	}
 
-	res = param_export(fd, false);
+	res = param_export_fd(fd, false, true);
 
 	if (res != OK) {
 		warnx("failed to write parameters to file: %s", filename);
+
+	} else {
+#ifndef __PX4_QURT
+		/* terminate the (empty) journal, stale data may follow */
+		int32_t terminator = 0;
+		off_t end = lseek(fd, 0, SEEK_CUR);
+
+		if (end >= 0 && PARAM_WRITE(fd, &terminator, sizeof(terminator)) == sizeof(terminator)) {
+			PARAM_FSYNC(fd);
+			param_journal_start = end;
+			param_journal_end = end;
+		}
+
+#endif
 	}
 
 	PARAM_CLOSE(fd);
@@ -779,14 +1049,56 @@ param_load_default(void)
 int
 param_export(int fd, bool only_unsaved)
 {
-	struct param_wbuf_s *s = NULL;
+	/*
+	 * The values stay unsaved, fd is usually not the default file.  If it
+	 * is, the journal position no longer matches it: rewrite on next save.
+	 */
+	param_journal_end = -1;
+
+	return param_export_fd(fd, only_unsaved, false);
+}
+
+/**
+ * Write modified parameter values to a file as a BSON document.
+ *
+ * @param fd			File descriptor to write to.
+ * @param only_unsaved		Only write values changed since the last save.
+ * @param mark_saved		Mark the written values as saved to the default file.
+ * @return			Zero on success.
+ */
+static int
+param_export_fd(int fd, bool only_unsaved, bool mark_saved)
+{
 	struct bson_encoder_s encoder;
+	int	result;
+
+	bson_encoder_init_file(&encoder, fd);
+
+	result = param_export_internal(&encoder, only_unsaved, mark_saved);
+
+	if (result == 0) {
+		result = bson_encoder_fini(&encoder);
+	}
+
+	return result;
+}
+
+/**
+ * Append modified parameter values to a BSON document.
+ *
+ * @param encoder		The encoder to append to.
+ * @param only_unsaved		Only append values changed since the last save.
+ * @param mark_saved		Mark the appended values as saved to the default file.
+ * @return			Zero on success.
+ */
+static int
+param_export_internal(struct bson_encoder_s *encoder, bool only_unsaved, bool mark_saved)
+{
+	struct param_wbuf_s *s = NULL;
 	int	result = -1;
 
 	param_lock();
 
-	bson_encoder_init_file(&encoder, fd);
-
 	/* no modified parameters -> we are done */
 	if (param_values == NULL) {
 		result = 0;
@@ -806,7 +1118,9 @@ param_export(int fd, bool only_unsaved)
 			continue;
 		}
 
-		s->unsaved = false;
+		if (mark_saved) {
+			s->unsaved = false;
+		}
 
 		/* append the appropriate BSON type object */
 
@@ -815,7 +1129,7 @@ param_export(int fd, bool only_unsaved)
 		case PARAM_TYPE_INT32:
 			param_get(s->param, &i);
 
-			if (bson_encoder_append_int(&encoder, param_name(s->param), i)) {
+			if (bson_encoder_append_int(encoder, param_name(s->param), i)) {
 				debug("BSON append failed for '%s'", param_name(s->param));
 				goto out;
 			}
@@ -825,7 +1139,7 @@ param_export(int fd, bool only_unsaved)
 		case PARAM_TYPE_FLOAT:
 			param_get(s->param, &f);
 
-			if (bson_encoder_append_double(&encoder, param_name(s->param), f)) {
+			if (bson_encoder_append_double(encoder, param_name(s->param), f)) {
 				debug("BSON append failed for '%s'", param_name(s->param));
 				goto out;
 			}
@@ -833,7 +1147,7 @@ param_export(int fd, bool only_unsaved)
 			break;
 
 		case PARAM_TYPE_STRUCT ... PARAM_TYPE_STRUCT_MAX:
-			if (bson_encoder_append_binary(&encoder,
+			if (bson_encoder_append_binary(encoder,
 						       param_name(s->param),
 						       BSON_BIN_BINARY,
 						       param_size(s->param),
@@ -855,15 +1169,13 @@ param_export(int fd, bool only_unsaved)
 out:
 	param_unlock();
 
-	if (result == 0) {
-		result = bson_encoder_fini(&encoder);
-	}
-
 	return result;
 }
 
 struct param_import_state {
 	bool mark_saved;
+	bool journal;		/**< decoding a journal record */
+	bool marker_seen;	/**< journal record marker has been decoded */
 };
 
 static int
@@ -884,6 +1196,20 @@ param_import_callback(bson_decoder_t decoder, void *private, bson_node_t node)
 		return 0;
 	}
 
+	/*
+	 * Journal records must start with the marker, anything else is stale
+	 * or corrupt data.
+	 */
+	if (state->journal && !state->marker_seen) {
+		if (node->type != BSON_INT32 || strcmp(node->name, PARAM_JOURNAL_MARKER)) {
+			debug("not a journal record");
+			return -1;
+		}
+
+		state->marker_seen = true;
+		return 1;
+	}
+
 	/*
 	 * Find the parameter this node represents.  If we don't know it,
 	 * ignore the node.
@@ -974,6 +1300,70 @@ out:
 	return result;
 }
 
+/**
+ * Replay the journal records following the parameter document.
+ *
+ * Replay stops at the terminator, at the end of the file or at the first
+ * incomplete or invalid record (e.g. a save interrupted by power loss).
+ * param_import_end is set to where the next record should be written.
+ */
+static void
+param_import_journal(int fd, struct param_import_state *state)
+{
+#ifndef __PX4_QURT
+
+	param_import_start = lseek(fd, 0, SEEK_CUR);
+
+	for (;;) {
+		struct bson_decoder_s decoder;
+		int32_t len;
+		int result;
+
+		param_import_end = lseek(fd, 0, SEEK_CUR);
+
+		if (PARAM_READ(fd, &len, sizeof(len)) != sizeof(len) ||
+		    len <= (int32_t)sizeof(len) || len > param_journal_limit(param_import_start)) {
+			break;
+		}
+
+		uint8_t *buf = malloc(len);
+
+		if (buf == NULL) {
+			break;
+		}
+
+		memcpy(buf, &len, sizeof(len));
+
+		if (PARAM_READ(fd, buf + sizeof(len), len - sizeof(len)) != (int)(len - sizeof(len)) ||
+		    buf[len - 1] != BSON_EOO) {
+			free(buf);
+			break;
+		}
+
+		state->journal = true;
+		state->marker_seen = false;
+
+		if (bson_decoder_init_buf(&decoder, buf, len, param_import_callback, state)) {
+			result = -1;
+
+		} else {
+			do {
+				result = bson_decoder_next(&decoder);
+
+			} while (result > 0);
+		}
+
+		free(buf);
+
+		if (result < 0) {
+			debug("invalid journal record");
+			break;
+		}
+	}
+
+#endif
+}
+
 static int
 param_import_internal(int fd, bool mark_saved)
 {
@@ -981,18 +1371,27 @@ param_import_internal(int fd, bool mark_saved)
 	int result = -1;
 	struct param_import_state state;
 
+	param_import_end = -1;
+	param_import_start = -1;
+
 	if (bson_decoder_init_file(&decoder, fd, param_import_callback, &state)) {
 		debug("decoder init failed");
 		goto out;
 	}
 
 	state.mark_saved = mark_saved;
+	state.journal = false;
+	state.marker_seen = false;
 
 	do {
 		result = bson_decoder_next(&decoder);
 
 	} while (result > 0);
 
+	if (result == 0) {
+		param_import_journal(fd, &state);
+	}
+
 out:
 
 	if (result < 0) {
@@ -1008,11 +1407,43 @@ param_import(int fd)
 	return param_import_internal(fd, false);
 }
 
+/**
+ * @return			True if fd refers to the default parameter file.
+ */
+static bool
+param_is_default_file(int fd)
+{
+#ifdef __PX4_QURT
+	/* no journal, see param_journal_append */
+	return false;
+#else
+	struct stat fd_st;
+	struct stat file_st;
+
+	return fstat(fd, &fd_st) == 0 &&
+	       stat(param_get_default_file(), &file_st) == 0 &&
+	       fd_st.st_dev == file_st.st_dev &&
+	       fd_st.st_ino == file_st.st_ino;
+#endif
+}
+
 int
 param_load(int fd)
 {
 	param_reset_all();
-	return param_import_internal(fd, true);
+
+	int result = param_import_internal(fd, true);
+
+	/*
+	 * Subsequent saves append to the journal of the loaded default file,
+	 * as it is loaded by 'param load' at boot as well.
+	 */
+	if (result == 0 && param_is_default_file(fd)) {
+		param_journal_start = param_import_start;
+		param_journal_end = param_import_end;
+	}
+
+	return result;
 }
 
 void
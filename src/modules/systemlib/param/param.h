@@ -254,8 +254,11 @@ __EXPORT void		param_reset_excludes(const char *excludes[], int num_excludes);
 /**
  * Export changed parameters to a file.
  *
+ * Values stay marked as unsaved, only param_save_default() marks them saved.
+ *
  * @param fd		File descriptor to export to.
- * @param only_unsaved	Only export changed parameters that have not yet been exported.
+ * @param only_unsaved	Only export changed parameters that have not yet been saved
+ *			to the default file.
  * @return		Zero on success, nonzero on failure.
  */
 __EXPORT int		param_export(int fd, bool only_unsaved);
@@ -276,6 +279,8 @@ __EXPORT int		param_import(int fd);
  *
  * This function resets all parameters to their default values, then loads new
  * values from a file.
+ If the file is the default parameter file, later
+ * param_save_default() calls append to its journal.
  *
  * @param fd		File descriptor to import from.  (Currently expected to be a file.)
  * @return		Zero on success, nonzero if an error occurred during import.
@@ -44,6 +44,13 @@
 #include <drivers/drv_hrt.h>
 #include <math.h>
 #include "perf_counter.h"
+#include "name_hash.h"
+
+#ifdef __PX4_NUTTX
+#include <nuttx/irq.h>
+#else
+#include <pthread.h>
+#endif
 
 #ifdef __PX4_QURT
 #define dprintf(...) 
@@ -56,6 +63,10 @@ struct perf_ctr_header {
 	sq_entry_t		link;	/**< list linkage */
 	enum perf_counter_type	type;	/**< counter type */
 	const char		*name;	/**< counter name */
+	struct perf_ctr_header	*hash_next;	/**< name hash chain */
+#ifndef __PX4_NUTTX
+	pthread_mutex_t		lock;	/**< update lock */
+#endif
 };
 
 /**
@@ -96,11 +107,103 @@ struct perf_ctr_interval {
 	float			M2;
 };
 
+/**
+ * PC_HISTOGRAM counter.
+ *
+ * Values below 4us have a bucket each, above that every power of two is
+ * split into four buckets, giving at most 25% error on reported percentiles.
+ * The last bucket collects everything above PERF_HISTOGRAM_OCTAVES powers of
+ * two (about 8s).
+ */
+#define PERF_HISTOGRAM_OCTAVES	23
+#define PERF_HISTOGRAM_BUCKETS	((PERF_HISTOGRAM_OCTAVES - 1) * 4 + 1)
+
+struct perf_ctr_histogram {
+	struct perf_ctr_elapsed	elapsed;	/**< must be first, shares the PC_ELAPSED logic */
+	uint32_t		buckets[PERF_HISTOGRAM_BUCKETS];
+};
+
 /**
  * List of all known counters.
  */
 static sq_queue_t	perf_counters;
+static unsigned		perf_counters_count;
+
+/**
+ * Counters hashed by name, for perf_alloc_once and perf_find.
+ */
+#define PERF_HASH_SIZE		64
+static struct perf_ctr_header	*perf_hash[PERF_HASH_SIZE];
+
+/*
+ * The counter list is locked while adding or removing counters.  Counter
+ * updates use a per-counter mutex, as counters are usually only updated from
+ * a single thread and uncontended.  A mutex rather than a spinlock, so a
+ * high priority task never spins on a lock held by a preempted lower
+ * priority one.  On NuttX counters are also updated from interrupt handlers,
+ * so both simply mask interrupts there.
+ */
+#ifdef __PX4_NUTTX
+
+#define PERF_LIST_LOCK()	irqstate_t list_flags = irqsave()
+#define PERF_LIST_UNLOCK()	irqrestore(list_flags)
+#define PERF_LOCK(_h)		irqstate_t flags = irqsave()
+#define PERF_UNLOCK(_h)		irqrestore(flags)
+
+#else
+
+static pthread_mutex_t perf_counters_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define PERF_LIST_LOCK()	pthread_mutex_lock(&perf_counters_mutex)
+#define PERF_LIST_UNLOCK()	pthread_mutex_unlock(&perf_counters_mutex)
+#define PERF_LOCK(_h)		pthread_mutex_lock(&(_h)->lock)
+#define PERF_UNLOCK(_h)		pthread_mutex_unlock(&(_h)->lock)
+
+#endif
+
+/**
+ * Find a counter by name, the list must be locked.
+ */
+static perf_counter_t
+perf_find_locked(const char *name)
+{
+	perf_counter_t handle = perf_hash[name_hash(name) % PERF_HASH_SIZE];
+
+	while (handle != NULL && strcmp(handle->name, name)) {
+		handle = handle->hash_next;
+	}
+
+	return handle;
+}
+
+static unsigned
+perf_histogram_bucket(uint64_t value)
+{
+	if (value < 4) {
+		return value;
+	}
+
+	unsigned octave = 63 - __builtin_clzll(value);
+
+	if (octave >= PERF_HISTOGRAM_OCTAVES) {
+		return PERF_HISTOGRAM_BUCKETS - 1;
+	}
+
+	return (octave - 1) * 4 + ((value >> (octave - 2)) & 3);
+}
 
+/**
+ * Smallest value that falls into a histogram bucket.
+ */
+static uint64_t
+perf_histogram_bucket_min(unsigned bucket)
+{
+	if (bucket < 4) {
+		return bucket;
+	}
+
+	return (uint64_t)(4 + bucket % 4) << (bucket / 4 - 1);
+}
 
 perf_counter_t
 perf_alloc(enum perf_counter_type type, const char *name)
@@ -121,6 +224,10 @@ perf_alloc(enum perf_counter_type type, const char *name)
 
 		break;
 
+	case PC_HISTOGRAM:
+		ctr = (perf_counter_t)calloc(sizeof(struct perf_ctr_histogram), 1);
+		break;
+
 	default:
 		break;
 	}
@@ -128,7 +235,18 @@ perf_alloc(enum perf_counter_type type, const char *name)
 	if (ctr != NULL) {
 		ctr->type = type;
 		ctr->name = name;
+#ifndef __PX4_NUTTX
+		pthread_mutex_init(&ctr->lock, NULL);
+#endif
+
+		unsigned h = name_hash(name) % PERF_HASH_SIZE;
+
+		PERF_LIST_LOCK();
 		sq_addfirst(&ctr->link, &perf_counters);
+		perf_counters_count++;
+		ctr->hash_next = perf_hash[h];
+		perf_hash[h] = ctr;
+		PERF_LIST_UNLOCK();
 	}
 
 	return ctr;
@@ -137,32 +255,55 @@ perf_alloc(enum perf_counter_type type, const char *name)
 perf_counter_t
 perf_alloc_once(enum perf_counter_type type, const char *name)
 {
-	perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
-
-	while (handle != NULL) {
-		if (!strcmp(handle->name, name)) {
-			if (type == handle->type) {
-				/* they are the same counter */
-				return handle;
-			} else {
-				/* same name but different type, assuming this is an error and not intended */
-				return NULL;
-			}
-		}
-		handle = (perf_counter_t)sq_next(&handle->link);
+	PERF_LIST_LOCK();
+	perf_counter_t handle = perf_find_locked(name);
+	PERF_LIST_UNLOCK();
+
+	if (handle != NULL) {
+		/* same name but different type, assuming this is an error and not intended */
+		return (type == handle->type) ? handle : NULL;
 	}
 
 	/* if the execution reaches here, no existing counter of that name was found */
 	return perf_alloc(type, name);
 }
 
+perf_counter_t
+perf_find(const char *name)
+{
+	PERF_LIST_LOCK();
+	perf_counter_t handle = perf_find_locked(name);
+	PERF_LIST_UNLOCK();
+
+	return handle;
+}
+
 void
 perf_free(perf_counter_t handle)
 {
 	if (handle == NULL)
 		return;
 
+	PERF_LIST_LOCK();
+
 	sq_rem(&handle->link, &perf_counters);
+	perf_counters_count--;
+
+	perf_counter_t *prev = &perf_hash[name_hash(handle->name) % PERF_HASH_SIZE];
+
+	while (*prev != NULL && *prev != handle) {
+		prev = &(*prev)->hash_next;
+	}
+
+	if (*prev != NULL) {
+		*prev = handle->hash_next;
+	}
+
+	PERF_LIST_UNLOCK();
+
+#ifndef __PX4_NUTTX
+	pthread_mutex_destroy(&handle->lock);
+#endif
 	free(handle);
 }
 
@@ -174,13 +315,23 @@ perf_count(perf_counter_t handle)
 
 	switch (handle->type) {
 	case PC_COUNT:
-		((struct perf_ctr_count *)handle)->event_count++;
+#ifdef __PX4_NUTTX
+		{
+			PERF_LOCK(handle);
+			((struct perf_ctr_count *)handle)->event_count++;
+			PERF_UNLOCK(handle);
+		}
+#else
+		__sync_fetch_and_add(&((struct perf_ctr_count *)handle)->event_count, 1);
+#endif
 		break;
 
 	case PC_INTERVAL: {
 		struct perf_ctr_interval *pci = (struct perf_ctr_interval *)handle;
 		hrt_abstime now = hrt_absolute_time();
 
+		PERF_LOCK(handle);
+
 		switch (pci->event_count) {
 		case 0:
 			pci->time_first = now;
@@ -208,6 +359,8 @@ perf_count(perf_counter_t handle)
 		}
 		pci->time_last = now;
 		pci->event_count++;
+
+		PERF_UNLOCK(handle);
 		break;
 	}
 
@@ -224,6 +377,7 @@ perf_begin(perf_counter_t handle)
 
 	switch (handle->type) {
 	case PC_ELAPSED:
+	case PC_HISTOGRAM:
 		((struct perf_ctr_elapsed *)handle)->time_start = hrt_absolute_time();
 		break;
 
@@ -232,6 +386,46 @@ perf_begin(perf_counter_t handle)
 	}
 }
 
+/**
+ * Add a measurement to a PC_ELAPSED or PC_HISTOGRAM counter.
+ */
+static void
+perf_elapsed_add(perf_counter_t handle, int64_t elapsed)
+{
+	struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
+
+	PERF_LOCK(handle);
+
+	if (elapsed < 0) {
+		pce->event_overruns++;
+	} else {
+
+		pce->event_count++;
+		pce->time_total += elapsed;
+
+		if ((pce->time_least > (uint64_t)elapsed) || (pce->time_least == 0))
+			pce->time_least = elapsed;
+
+		if (pce->time_most < (uint64_t)elapsed)
+			pce->time_most = elapsed;
+
+		// maintain mean and variance of the elapsed time in seconds
+		// Knuth/Welford recursive mean and variance of update intervals (via Wikipedia)
+		float dt = elapsed / 1e6f;
+		float delta_intvl = dt - pce->mean;
+		pce->mean += delta_intvl / pce->event_count;
+		pce->M2 += delta_intvl * (dt - pce->mean);
+
+		if (handle->type == PC_HISTOGRAM) {
+			((struct perf_ctr_histogram *)handle)->buckets[perf_histogram_bucket(elapsed)]++;
+		}
+
+		pce->time_start = 0;
+	}
+
+	PERF_UNLOCK(handle);
+}
+
 void
 perf_end(perf_counter_t handle)
 {
@@ -239,34 +433,12 @@ perf_end(perf_counter_t handle)
 		return;
 
 	switch (handle->type) {
-	case PC_ELAPSED: {
+	case PC_ELAPSED:
+	case PC_HISTOGRAM: {
 			struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
 
 			if (pce->time_start != 0) {
-				int64_t elapsed = hrt_absolute_time() - pce->time_start;
-
-				if (elapsed < 0) {
-					pce->event_overruns++;
-				} else {
-
-					pce->event_count++;
-					pce->time_total += elapsed;
-
-					if ((pce->time_least > (uint64_t)elapsed) || (pce->time_least == 0))
-						pce->time_least = elapsed;
-
-					if (pce->time_most < (uint64_t)elapsed)
-						pce->time_most = elapsed;
-
-					// maintain mean and variance of the elapsed time in seconds
-					// Knuth/Welford recursive mean and variance of update intervals (via Wikipedia)
-					float dt = elapsed / 1e6f;
-					float delta_intvl = dt - pce->mean;
-					pce->mean += delta_intvl / pce->event_count;
-					pce->M2 += delta_intvl * (dt - pce->mean);
-
-					pce->time_start = 0;
-				}
+				perf_elapsed_add(handle, hrt_absolute_time() - pce->time_start);
 			}
 		}
 		break;
@@ -286,32 +458,9 @@ perf_set(perf_counter_t handle, int64_t elapsed)
 	}
 
 	switch (handle->type) {
-	case PC_ELAPSED: {
-			struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
-
-			if (elapsed < 0) {
-				pce->event_overruns++;
-			} else {
-
-				pce->event_count++;
-				pce->time_total += elapsed;
-
-				if ((pce->time_least > (uint64_t)elapsed) || (pce->time_least == 0))
-					pce->time_least = elapsed;
-
-				if (pce->time_most < (uint64_t)elapsed)
-					pce->time_most = elapsed;
-
-				// maintain mean and variance of the elapsed time in seconds
-				// Knuth/Welford recursive mean and variance of update intervals (via Wikipedia)
-				float dt = elapsed / 1e6f;
-				float delta_intvl = dt - pce->mean;
-				pce->mean += delta_intvl / pce->event_count;
-				pce->M2 += delta_intvl * (dt - pce->mean);
-
-				pce->time_start = 0;
-			}
-		}
+	case PC_ELAPSED:
+	case PC_HISTOGRAM:
+		perf_elapsed_add(handle, elapsed);
 		break;
 
 	default:
@@ -326,7 +475,8 @@ perf_cancel(perf_counter_t handle)
 		return;
 
 	switch (handle->type) {
-	case PC_ELAPSED: {
+	case PC_ELAPSED:
+	case PC_HISTOGRAM: {
 			struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
 
 			pce->time_start = 0;
@@ -346,11 +496,22 @@ perf_reset(perf_counter_t handle)
 	if (handle == NULL)
 		return;
 
+	PERF_LOCK(handle);
+
 	switch (handle->type) {
 	case PC_COUNT:
 		((struct perf_ctr_count *)handle)->event_count = 0;
 		break;
 
+	case PC_HISTOGRAM: {
+		struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+		memset(pch->buckets, 0, sizeof(pch->buckets));
+		pch->elapsed.event_overruns = 0;
+		pch->elapsed.mean = 0;
+		pch->elapsed.M2 = 0;
+	}
+	/* FALLTHROUGH */
+
 	case PC_ELAPSED: {
 		struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
 		pce->event_count = 0;
@@ -372,6 +533,44 @@ perf_reset(perf_counter_t handle)
 		break;
 	}
 	}
+
+	PERF_UNLOCK(handle);
+}
+
+uint64_t
+perf_percentile(perf_counter_t handle, unsigned permille)
+{
+	if (handle == NULL || handle->type != PC_HISTOGRAM)
+		return 0;
+
+	struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+	uint64_t result = 0;
+
+	PERF_LOCK(handle);
+
+	/* rank of the requested sample, rounded up */
+	uint64_t rank = (pch->elapsed.event_count * permille + 999) / 1000;
+	uint64_t seen = 0;
+
+	if (rank > 0) {
+		for (unsigned b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+			seen += pch->buckets[b];
+
+			if (seen >= rank) {
+				/* report the upper bound of the bucket, but never more than was seen */
+				result = (b + 1 < PERF_HISTOGRAM_BUCKETS) ? perf_histogram_bucket_min(b + 1) - 1 : pch->elapsed.time_most;
+
+				if (result > pch->elapsed.time_most)
+					result = pch->elapsed.time_most;
+
+				break;
+			}
+		}
+	}
+
+	PERF_UNLOCK(handle);
+
+	return result;
 }
 
 void
@@ -393,7 +592,8 @@ perf_print_counter_fd(int fd, perf_counter_t handle)
 		       (unsigned long long)((struct perf_ctr_count *)handle)->event_count);
 		break;
 
-	case PC_ELAPSED: {
+	case PC_ELAPSED:
+	case PC_HISTOGRAM: {
 		struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
 		float rms = sqrtf(pce->M2 / (pce->event_count-1));
 
@@ -406,6 +606,14 @@ perf_print_counter_fd(int fd, perf_counter_t handle)
 			(unsigned long long)pce->time_least,
 			(unsigned long long)pce->time_most,
 			(double)(1e6f * rms));
+
+		if (handle->type == PC_HISTOGRAM) {
+			dprintf(fd, "%s: p50 %lluus p99 %lluus p999 %lluus\n",
+				handle->name,
+				(unsigned long long)perf_percentile(handle, 500),
+				(unsigned long long)perf_percentile(handle, 990),
+				(unsigned long long)perf_percentile(handle, 999));
+		}
 		break;
 	}
 
@@ -428,6 +636,29 @@ perf_print_counter_fd(int fd, perf_counter_t handle)
 	}
 }
 
+void
+perf_print_histogram_fd(int fd, perf_counter_t handle)
+{
+	if (handle == NULL || handle->type != PC_HISTOGRAM)
+		return;
+
+	struct perf_ctr_histogram *pch = (struct perf_ctr_histogram *)handle;
+
+	dprintf(fd, "%s:\n  bucket (us) : events\n", handle->name);
+
+	for (unsigned b = 0; b < PERF_HISTOGRAM_BUCKETS; b++) {
+		if (pch->buckets[b] == 0)
+			continue;
+
+		if (b + 1 < PERF_HISTOGRAM_BUCKETS) {
+			dprintf(fd, "  %8llu : %lu\n", (unsigned long long)perf_histogram_bucket_min(b), (unsigned long)pch->buckets[b]);
+
+		} else {
+			dprintf(fd, " >%8llu : %lu\n", (unsigned long long)perf_histogram_bucket_min(b), (unsigned long)pch->buckets[b]);
+		}
+	}
+}
+
 uint64_t
 perf_event_count(perf_counter_t handle)
 {
@@ -438,7 +669,8 @@ perf_event_count(perf_counter_t handle)
 	case PC_COUNT:
 		return ((struct perf_ctr_count *)handle)->event_count;
 
-	case PC_ELAPSED: {
+	case PC_ELAPSED:
+	case PC_HISTOGRAM: {
 		struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
 		return pce->event_count;
 	}
@@ -454,14 +686,159 @@ perf_event_count(perf_counter_t handle)
 	return 0;
 }
 
+perf_counter_t
+perf_iterate(perf_counter_t handle)
+{
+	PERF_LIST_LOCK();
+	perf_counter_t next = (handle == NULL) ? (perf_counter_t)sq_peek(&perf_counters) : (perf_counter_t)sq_next(&handle->link);
+	PERF_LIST_UNLOCK();
+
+	return next;
+}
+
+const char *
+perf_name(perf_counter_t handle)
+{
+	return (handle != NULL) ? handle->name : NULL;
+}
+
 void
-perf_print_all(int fd)
+perf_snapshot(perf_counter_t handle, struct perf_counter_snapshot_s *snapshot)
+{
+	memset(snapshot, 0, sizeof(*snapshot));
+
+	if (handle == NULL)
+		return;
+
+	snapshot->type = handle->type;
+
+	if (handle->type == PC_HISTOGRAM) {
+		snapshot->p50 = perf_percentile(handle, 500);
+		snapshot->p99 = perf_percentile(handle, 990);
+		snapshot->p999 = perf_percentile(handle, 999);
+	}
+
+	PERF_LOCK(handle);
+
+	switch (handle->type) {
+	case PC_COUNT:
+		snapshot->event_count = ((struct perf_ctr_count *)handle)->event_count;
+		break;
+
+	case PC_ELAPSED:
+	case PC_HISTOGRAM: {
+		struct perf_ctr_elapsed *pce = (struct perf_ctr_elapsed *)handle;
+		snapshot->event_count = pce->event_count;
+		snapshot->event_overruns = pce->event_overruns;
+		snapshot->time_total = pce->time_total;
+		snapshot->time_least = pce->time_least;
+		snapshot->time_most = pce->time_most;
+		snapshot->mean = 1e6f * pce->mean;
+		snapshot->rms = (pce->event_count > 1) ? 1e6f * sqrtf(pce->M2 / (pce->event_count - 1)) : 0.0f;
+		break;
+	}
+
+	case PC_INTERVAL: {
+		struct perf_ctr_interval *pci = (struct perf_ctr_interval *)handle;
+		snapshot->event_count = pci->event_count;
+		snapshot->time_least = pci->time_least;
+		snapshot->time_most = pci->time_most;
+		snapshot->mean = 1e6f * pci->mean;
+		snapshot->rms = (pci->event_count > 1) ? 1e6f * sqrtf(pci->M2 / (pci->event_count - 1)) : 0.0f;
+		break;
+	}
+	}
+
+	PERF_UNLOCK(handle);
+}
+
+unsigned
+perf_snapshot_index(unsigned index, struct perf_counter_snapshot_s *snapshot, char *name, size_t name_len)
 {
-	perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
+	PERF_LIST_LOCK();
+
+	unsigned count = perf_counters_count;
 
-	while (handle != NULL) {
-		perf_print_counter_fd(fd, handle);
-		handle = (perf_counter_t)sq_next(&handle->link);
+	/* only walk up to the wanted counter, on NuttX this runs with interrupts off */
+	if (index < count) {
+		perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
+
+		for (unsigned i = 0; i < index; i++) {
+			handle = (perf_counter_t)sq_next(&handle->link);
+		}
+
+		perf_snapshot(handle, snapshot);
+		strncpy(name, handle->name, name_len - 1);
+		name[name_len - 1] = '\0';
+	}
+
+	PERF_LIST_UNLOCK();
+
+	return count;
+}
+
+/**
+ * Print a counter copied out by perf_snapshot_index, no locks are held.
+ */
+static void
+perf_print_snapshot_fd(int fd, const char *name, const struct perf_counter_snapshot_s *snapshot)
+{
+	switch (snapshot->type) {
+	case PC_COUNT:
+		dprintf(fd, "%s: %llu events\n",
+			name,
+			(unsigned long long)snapshot->event_count);
+		break;
+
+	case PC_ELAPSED:
+	case PC_HISTOGRAM:
+		dprintf(fd, "%s: %llu events, %llu overruns, %lluus elapsed, %lluus avg, min %lluus max %lluus %5.3fus rms\n",
+			name,
+			(unsigned long long)snapshot->event_count,
+			(unsigned long long)snapshot->event_overruns,
+			(unsigned long long)snapshot->time_total,
+			(unsigned long long)(snapshot->event_count > 0 ? snapshot->time_total / snapshot->event_count : 0),
+			(unsigned long long)snapshot->time_least,
+			(unsigned long long)snapshot->time_most,
+			(double)snapshot->rms);
+
+		if (snapshot->type == PC_HISTOGRAM) {
+			dprintf(fd, "%s: p50 %lluus p99 %lluus p999 %lluus\n",
+				name,
+				(unsigned long long)snapshot->p50,
+				(unsigned long long)snapshot->p99,
+				(unsigned long long)snapshot->p999);
+		}
+		break;
+
+	case PC_INTERVAL:
+		dprintf(fd, "%s: %llu events, %lluus avg, min %lluus max %lluus %5.3fus rms\n",
+			name,
+			(unsigned long long)snapshot->event_count,
+			(unsigned long long)snapshot->mean,
+			(unsigned long long)snapshot->time_least,
+			(unsigned long long)snapshot->time_most,
+			(double)snapshot->rms);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void
+perf_print_all(int fd)
+{
+	struct perf_counter_snapshot_s snapshot;
+	char name[64];
+
+	/*
+	 * Copy one counter at a time under the list lock and print it after
+	 * unlocking: on NuttX the lock masks interrupts, and writing to a
+	 * console or serial fd may block.
+	 */
+	for (unsigned index = 0; index < perf_snapshot_index(index, &snapshot, name, sizeof(name)); index++) {
+		perf_print_snapshot_fd(fd, name, &snapshot);
 	}
 }
 
@@ -483,12 +860,31 @@ perf_print_latency(int fd)
 void
 perf_reset_all(void)
 {
-	perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
+	/*
+	 * Reset one counter per list lock, so interrupts are only masked for
+	 * one short walk at a time on NuttX.  Counters may be allocated or
+	 * freed concurrently; the list is never walked unlocked.
+	 */
+	for (unsigned index = 0; ; index++) {
+		PERF_LIST_LOCK();
+
+		perf_counter_t handle = (perf_counter_t)sq_peek(&perf_counters);
+
+		for (unsigned i = 0; i < index && handle != NULL; i++) {
+			handle = (perf_counter_t)sq_next(&handle->link);
+		}
 
-	while (handle != NULL) {
-		perf_reset(handle);
-		handle = (perf_counter_t)sq_next(&handle->link);
+		if (handle != NULL) {
+			perf_reset(handle);
+		}
+
+		PERF_LIST_UNLOCK();
+
+		if (handle == NULL) {
+			break;
+		}
 	}
+
 	for (int i = 0; i <= latency_bucket_count; i++) {
 		latency_counters[i] = 0;
 	}
@@ -48,12 +48,33 @@
 enum perf_counter_type {
 	PC_COUNT,		/**< count the number of times an event occurs */
 	PC_ELAPSED,		/**< measure the time elapsed performing an event */
-	PC_INTERVAL		/**< measure the interval between instances of an event */
+	PC_INTERVAL,		/**< measure the interval between instances of an event */
+	PC_HISTOGRAM		/**< like PC_ELAPSED, also recording the distribution of elapsed times */
 };
 
 struct perf_ctr_header;
 typedef struct perf_ctr_header	*perf_counter_t;
 
+/**
+ * Point in time copy of a counter's statistics, see perf_snapshot.
+ *
+ * Times are in microseconds.  Fields that do not apply to the counter type
+ * are zero.
+ */
+struct perf_counter_snapshot_s {
+	enum perf_counter_type	type;
+	uint64_t		event_count;
+	uint64_t		event_overruns;	/**< PC_ELAPSED, PC_HISTOGRAM */
+	uint64_t		time_total;	/**< PC_ELAPSED, PC_HISTOGRAM */
+	uint64_t		time_least;
+	uint64_t		time_most;
+	float			mean;		/**< mean elapsed time or interval */
+	float			rms;
+	uint64_t		p50;		/**< PC_HISTOGRAM */
+	uint64_t		p99;		/**< PC_HISTOGRAM */
+	uint64_t		p999;		/**< PC_HISTOGRAM */
+};
+
 __BEGIN_DECLS
 
 /**
@@ -76,6 +97,15 @@ __EXPORT extern perf_counter_t	perf_alloc(enum perf_counter_type type, const cha
  */
 __EXPORT extern perf_counter_t	perf_alloc_once(enum perf_counter_type type, const char *name);
 
+/**
+ * Find an existing counter by name.
+ *
+ * @param name			The counter name.
+ * @return			Handle for the counter, or NULL if no counter
+ *				of that name exists.
+ */
+__EXPORT extern perf_counter_t	perf_find(const char *name);
+
 /**
  * Free a counter.
  *
@@ -158,6 +188,14 @@ __EXPORT extern void		perf_print_counter(perf_counter_t handle);
  */
 __EXPORT extern void		perf_print_counter_fd(int fd, perf_counter_t handle);
 
+/**
+ * Print the distribution recorded by a PC_HISTOGRAM counter.
+ *
+ * @param fd			File descriptor to print to - e.g. 0 for stdout
+ * @param handle		The counter to print.
+ */
+__EXPORT extern void		perf_print_histogram_fd(int fd, perf_counter_t handle);
+
 /**
  * Print all of the performance counters.
  *
@@ -185,6 +223,62 @@ __EXPORT extern void		perf_reset_all(void);
  */
 __EXPORT extern uint64_t	perf_event_count(perf_counter_t handle);
 
+/**
+ * Iterate over all counters.
+ *
+ * Counters must not be freed while iterating.
+ *
+ * @param handle		The previous counter, or NULL to get the first one.
+ * @return			The next counter, or NULL after the last one.
+ */
+__EXPORT extern perf_counter_t	perf_iterate(perf_counter_t handle);
+
+/**
+ * Return the name of a counter.
+ *
+ * @param handle		The counter returned from perf_alloc.
+ * @return			The counter name.
+ */
+__EXPORT extern const char	*perf_name(perf_counter_t handle);
+
+/**
+ * Copy the current statistics of a counter.
+ *
+ * @param handle		The counter returned from perf_alloc.
+ * @param snapshot		Filled with the counter statistics.
+ */
+__EXPORT extern void		perf_snapshot(perf_counter_t handle, struct perf_counter_snapshot_s *snapshot);
+
+/**
+ * Copy the current statistics and name of the counter at a position in the
+ * counter list.
+ *
+ * The list is locked while copying, so unlike perf_iterate this is safe
+ * against counters being freed concurrently.
+ *
+ * @param index			Position of the counter in the list.
+ * @param snapshot		Filled with the counter statistics.
+ * @param name			Filled with the counter name.
+ * @param name_len		Size of the name buffer.
+ * @return			The number of counters.  snapshot and name are
+ *				only valid if index is below it.
+ */
+__EXPORT extern unsigned	perf_snapshot_index(unsigned index, struct perf_counter_snapshot_s *snapshot,
+		char *name, size_t name_len);
+
+/**
+ * Return a percentile of the elapsed times recorded by a PC_HISTOGRAM counter.
+ *
+ * The result is the upper bound of the histogram bucket the percentile falls
+ * into, so it may overestimate by up to 25%.
+ *
+ * @param handle		The counter returned from perf_alloc.
+ * @param permille		The percentile in tenths of a percent, e.g. 990 for p99.
+ * @return			The percentile in microseconds, or 0 if the counter
+ *				is not a PC_HISTOGRAM or has no events.
+ */
+__EXPORT extern uint64_t	perf_percentile(perf_counter_t handle, unsigned permille);
+
 __END_DECLS
 
 #endif
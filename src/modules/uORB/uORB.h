@@ -188,6 +188,43 @@ extern orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const v
 					int priority) __EXPORT;
 
 
+/**
+ * Advertise as the publisher of a queued topic.
+ *
+ * A queued topic keeps the last queue_size publications in a ring. Each
+ * subscriber reads them in order with orb_copy or orb_borrow and only
+ * loses publications once it falls more than queue_size behind. A queue
+ * size of 1 behaves like orb_advertise.
+ *
+ * The queue size can only be set before the topic is first published.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param data		A pointer to the initial data to be published.
+ * @param queue_size	Maximum number of buffered publications.
+ * @return		nullptr on error, otherwise returns a handle
+ *			that can be used to publish to the topic.
+ */
+extern orb_advert_t orb_advertise_queue(const struct orb_metadata *meta, const void *data,
+					unsigned queue_size) __EXPORT;
+
+/**
+ * Advertise as the publisher of a queued topic instance, see
+ * orb_advertise_multi and orb_advertise_queue.
+ *
+ * @param meta		The uORB metadata (usually from the ORB_ID() macro)
+ *			for the topic.
+ * @param data		A pointer to the initial data to be published.
+ * @param instance	Pointer to an integer which will yield the instance ID (0-based)
+ *			of the publication.
+ * @param priority	The priority of the instance.
+ * @param queue_size	Maximum number of buffered publications.
+ * @return		nullptr on error, otherwise returns a handle
+ *			that can be used to publish to the topic.
+ */
+extern orb_advert_t orb_advertise_multi_queue(const struct orb_metadata *meta, const void *data, int *instance,
+		int priority, unsigned queue_size) __EXPORT;
+
 /**
  * Publish new data to a topic.
  *
@@ -288,6 +325,32 @@ extern int	orb_unsubscribe(int handle) __EXPORT;
  */
 extern int	orb_copy(const struct orb_metadata *meta, int handle, void *buffer) __EXPORT;
 
+/**
+ * Borrow the next unread publication of a topic in place.
+ *
+ * This is the zero-copy counterpart of orb_copy: *buffer is pointed at the
+ * publication inside the topic's queue. The publisher is never blocked, so
+ * the data must be handed back with orb_release before it is trusted; if the
+ * publisher wrapped around the queue onto the borrowed slot in the meantime,
+ * orb_release fails and the data must be discarded.
+ *
+ * @param handle	A handle returned from orb_subscribe.
+ * @param buffer	Set to the borrowed publication.
+ * @return		OK on success, ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_borrow(int handle, const void **buffer) __EXPORT;
+
+/**
+ * Release a publication obtained with orb_borrow.
+ *
+ * Like orb_copy, this marks the publication as read for this handle.
+ *
+ * @param handle	A handle returned from orb_subscribe.
+ * @return		OK if the borrowed data was not overwritten while borrowed,
+ *			ERROR otherwise with errno set accordingly.
+ */
+extern int	orb_release(int handle) __EXPORT;
+
 /**
  * Check whether a topic has been published to since the last orb_copy.
  *
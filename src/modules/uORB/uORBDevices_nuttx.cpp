@@ -52,6 +52,8 @@ uORB::DeviceNode::DeviceNode
   _data(nullptr),
   _last_update(0),
   _generation(0),
+  _write_generation(0),
+  _queue_size(1),
   _publisher(0),
   _priority(priority)
 {
@@ -155,7 +157,7 @@ uORB::DeviceNode::read(struct file *filp, char *buffer, size_t buflen)
   SubscriberData *sd = (SubscriberData *)filp_to_sd(filp);
 
   /* if the object has not been written yet, return zero */
-  if (_data == nullptr)
+  if (_data == nullptr || _generation == 0)
     return 0;
 
   /* if the caller's buffer is the wrong size, that's an error */
@@ -167,12 +169,14 @@ uORB::DeviceNode::read(struct file *filp, char *buffer, size_t buflen)
    */
   irqstate_t flags = irqsave();
 
+  unsigned generation = next_generation(sd, _generation);
+
   /* if the caller doesn't want the data, don't give it to them */
   if (nullptr != buffer)
-    memcpy(buffer, _data, _meta->o_size);
+    memcpy(buffer, generation_data(generation), _meta->o_size);
 
   /* track the last generation that the file has seen */
-  sd->generation = _generation;
+  sd->generation = generation + 1;
 
   /* set priority */
   sd->priority = _priority;
@@ -207,7 +211,7 @@ uORB::DeviceNode::write(struct file *filp, const char *buffer, size_t buflen)
 
       /* re-check size */
       if (nullptr == _data)
-        _data = new uint8_t[_meta->o_size];
+        _data = new uint8_t[_meta->o_size * _queue_size];
 
       unlock();
     }
@@ -221,14 +225,15 @@ uORB::DeviceNode::write(struct file *filp, const char *buffer, size_t buflen)
   if (_meta->o_size != buflen)
     return -EIO;
 
-  /* Perform an atomic copy. */
+  /* Perform an atomic copy into the next queue entry. */
   irqstate_t flags = irqsave();
-  memcpy(_data, buffer, _meta->o_size);
-  irqrestore(flags);
+  _write_generation = _generation + 1;
+  memcpy(generation_data(_generation), buffer, _meta->o_size);
 
   /* update the timestamp and generation count */
   _last_update = hrt_absolute_time();
   _generation++;
+  irqrestore(flags);
 
   /* notify any poll waiters */
   poll_notify(POLLIN);
@@ -262,6 +267,40 @@ uORB::DeviceNode::ioctl(struct file *filp, int cmd, unsigned long arg)
     *(int *)arg = sd->priority;
     return OK;
 
+  case ORBIOCSETQUEUESIZE: {
+      lock();
+      int ret = update_queue_size(arg);
+      unlock();
+      return ret;
+    }
+
+  case ORBIOCBORROW: {
+      if (_data == nullptr || _generation == 0)
+        return -ENODATA;
+
+      irqstate_t flags = irqsave();
+      sd->borrowed_generation = next_generation(sd, _generation);
+      sd->borrowed = true;
+      *(const void **)arg = generation_data(sd->borrowed_generation);
+      irqrestore(flags);
+      return OK;
+    }
+
+  case ORBIOCRELEASE: {
+      if (!sd->borrowed)
+        return -EINVAL;
+
+      irqstate_t flags = irqsave();
+
+      bool torn = overwritten(sd->borrowed_generation);
+
+      sd->generation = sd->borrowed_generation + 1;
+      sd->borrowed = false;
+      sd->update_reported = false;
+      irqrestore(flags);
+      return torn ? -EAGAIN : OK;
+    }
+
   default:
     /* give it to the superclass */
     return CDev::ioctl(filp, cmd, arg);
@@ -403,6 +442,37 @@ out:
   return ret;
 }
 
+unsigned
+uORB::DeviceNode::next_generation(SubscriberData *sd, unsigned generation)
+{
+  /* the subscriber's next publication has been overwritten, skip to the oldest one left */
+  if (generation - sd->generation > _queue_size)
+    return generation - _queue_size;
+
+  /* nothing unread, hand out the latest publication again */
+  if (sd->generation == generation)
+    return generation - 1;
+
+  return sd->generation;
+}
+
+int
+uORB::DeviceNode::update_queue_size(unsigned queue_size)
+{
+  if (queue_size == _queue_size)
+    return OK;
+
+  if (queue_size < 1)
+    return -EINVAL;
+
+  /* the queue is allocated on the first publication and cannot be resized after that */
+  if (_data != nullptr)
+    return -EBUSY;
+
+  _queue_size = queue_size;
+  return OK;
+}
+
 void
 uORB::DeviceNode::update_deferred()
 {
@@ -59,6 +59,8 @@ uORB::DeviceNode::DeviceNode(const struct orb_metadata *meta, const char *name,
   _data(nullptr),
   _last_update(0),
   _generation(0),
+  _write_generation(0),
+  _queue_size(1),
   _publisher(0),
   _priority(priority)
 {
@@ -167,7 +169,7 @@ uORB::DeviceNode::read(device::file_t *filp, char *buffer, size_t buflen)
   SubscriberData *sd = (SubscriberData *)filp_to_sd(filp);
 
   /* if the object has not been written yet, return zero */
-  if (_data == nullptr)
+  if (_data == nullptr || _generation == 0)
     return 0;
 
   /* if the caller's buffer is the wrong size, that's an error */
@@ -175,16 +177,32 @@ uORB::DeviceNode::read(device::file_t *filp, char *buffer, size_t buflen)
     return -EIO;
 
   /*
-   * Perform an atomic copy & state update
+   * Perform a lock-free copy: the publisher never waits for readers.
+   * If a write to the entry started while we were copying it, the copy
+   * may be torn and is redone under the lock, which excludes the
+   * publisher, so a busy publisher cannot starve the reader.
    */
-  lock();
+  unsigned generation = next_generation(sd, _generation);
+  __sync_synchronize();
 
   /* if the caller doesn't want the data, don't give it to them */
   if (nullptr != buffer)
-    memcpy(buffer, _data, _meta->o_size);
+    memcpy(buffer, generation_data(generation), _meta->o_size);
+
+  __sync_synchronize();
+
+  if (overwritten(generation)) {
+    lock();
+    generation = next_generation(sd, _generation);
+
+    if (nullptr != buffer)
+      memcpy(buffer, generation_data(generation), _meta->o_size);
+
+    unlock();
+  }
 
   /* track the last generation that the file has seen */
-  sd->generation = _generation;
+  sd->generation = generation + 1;
 
   /* set priority */
   sd->priority = _priority;
@@ -195,8 +213,6 @@ uORB::DeviceNode::read(device::file_t *filp, char *buffer, size_t buflen)
    */
   sd->update_reported = false;
 
-  unlock();
-
   return _meta->o_size;
 }
 
@@ -218,7 +234,7 @@ uORB::DeviceNode::write(device::file_t *filp, const char *buffer, size_t buflen)
 
     /* re-check size */
     if (nullptr == _data)
-      _data = new uint8_t[_meta->o_size];
+      _data = new uint8_t[_meta->o_size * _queue_size];
 
     unlock();
 
@@ -231,14 +247,21 @@ uORB::DeviceNode::write(device::file_t *filp, const char *buffer, size_t buflen)
   if (_meta->o_size != buflen)
     return -EIO;
 
-  /* Perform an atomic copy. */
+  /*
+   * Copy into the next queue entry. The lock only serialises publishers;
+   * readers detect a concurrent write through _write_generation.
+   */
   lock();
-  memcpy(_data, buffer, _meta->o_size);
-  unlock();
+  _write_generation = _generation + 1;
+  __sync_synchronize();
+
+  memcpy(generation_data(_generation), buffer, _meta->o_size);
 
   /* update the timestamp and generation count */
   _last_update = hrt_absolute_time();
+  __sync_synchronize();
   _generation++;
+  unlock();
 
   /* notify any poll waiters */
   poll_notify(POLLIN);
@@ -273,6 +296,36 @@ uORB::DeviceNode::ioctl(device::file_t *filp, int cmd, unsigned long arg)
     *(int *)arg = sd->priority;
     return PX4_OK;
 
+  case ORBIOCSETQUEUESIZE: {
+      lock();
+      int ret = update_queue_size(arg);
+      unlock();
+      return ret;
+    }
+
+  case ORBIOCBORROW:
+    if (_data == nullptr || _generation == 0)
+      return -ENODATA;
+
+    sd->borrowed_generation = next_generation(sd, _generation);
+    sd->borrowed = true;
+    __sync_synchronize();
+    *(const void **)arg = generation_data(sd->borrowed_generation);
+    return PX4_OK;
+
+  case ORBIOCRELEASE: {
+      if (!sd->borrowed)
+        return -EINVAL;
+
+      __sync_synchronize();
+      bool torn = overwritten(sd->borrowed_generation);
+
+      sd->generation = sd->borrowed_generation + 1;
+      sd->borrowed = false;
+      sd->update_reported = false;
+      return torn ? -EAGAIN : PX4_OK;
+    }
+
   default:
     /* give it to the superclass */
     return VDev::ioctl(filp, cmd, arg);
@@ -419,6 +472,37 @@ out:
   return ret;
 }
 
+unsigned
+uORB::DeviceNode::next_generation(SubscriberData *sd, unsigned generation)
+{
+  /* the subscriber's next publication has been overwritten, skip to the oldest one left */
+  if (generation - sd->generation > _queue_size)
+    return generation - _queue_size;
+
+  /* nothing unread, hand out the latest publication again */
+  if (sd->generation == generation)
+    return generation - 1;
+
+  return sd->generation;
+}
+
+int
+uORB::DeviceNode::update_queue_size(unsigned queue_size)
+{
+  if (queue_size == _queue_size)
+    return PX4_OK;
+
+  if (queue_size < 1)
+    return -EINVAL;
+
+  /* the queue is allocated on the first publication and cannot be resized after that */
+  if (_data != nullptr)
+    return -EBUSY;
+
+  _queue_size = queue_size;
+  return PX4_OK;
+}
+
 void
 uORB::DeviceNode::update_deferred()
 {
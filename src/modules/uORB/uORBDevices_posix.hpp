@@ -70,17 +70,51 @@ private:
     void    *poll_priv; /**< saved copy of fds->f_priv while poll is active */
     bool    update_reported; /**< true if we have reported the update via poll/check */
     int   priority; /**< priority of publisher */
+    unsigned  borrowed_generation; /**< generation handed out by the last ORBIOCBORROW */
+    bool    borrowed; /**< true between ORBIOCBORROW and ORBIOCRELEASE */
   };
 
   const struct orb_metadata *_meta; /**< object metadata information */
-  uint8_t     *_data;   /**< allocated object buffer */
+  uint8_t     *_data;   /**< allocated object buffer, _queue_size entries of _meta->o_size */
   hrt_abstime   _last_update; /**< time the object was last updated */
   volatile unsigned   _generation;  /**< object generation count */
+  volatile unsigned   _write_generation;  /**< count of writes started, ahead of _generation while a write is in progress */
+  unsigned    _queue_size; /**< number of publications kept in _data */
   pid_t     _publisher; /**< if nonzero, current publisher */
   const int   _priority;  /**< priority of topic */
 
   SubscriberData    *filp_to_sd(device::file_t *filp);
 
+  /**
+   * Find the generation a subscriber reads next.
+   *
+   * Skips ahead if the subscriber fell so far behind that its next
+   * publication has been overwritten, and falls back to the latest
+   * publication if it has already read everything.
+   *
+   * @param sd    The subscriber.
+   * @param generation  Snapshot of _generation, must be nonzero.
+   */
+  unsigned    next_generation(SubscriberData *sd, unsigned generation);
+
+  /**
+   * Check whether the queue entry of a generation has been (or is being)
+   * overwritten. The entry is reused by the write that starts generation
+   * + _queue_size, so a reader that sees this return false after copying
+   * the entry got consistent data.
+   */
+  bool      overwritten(unsigned generation) { return (_write_generation - generation) > _queue_size; }
+
+  /**
+   * Pointer to the queue entry holding a generation.
+   */
+  uint8_t     *generation_data(unsigned generation) { return _data + (generation % _queue_size) * _meta->o_size; }
+
+  /**
+   * Change the queue depth; only possible before the first publication.
+   */
+  int     update_queue_size(unsigned queue_size);
+
   /**
    * Perform a deferred update for a rate-limited subscriber.
    */
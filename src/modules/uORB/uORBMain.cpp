@@ -42,7 +42,7 @@ extern "C" { __EXPORT int uorb_main(int argc, char *argv[]); }
 static uORB::DeviceMaster *g_dev = nullptr;
 static void usage()
 {
-  warnx("Usage: uorb 'start', 'test', 'latency_test' or 'status'");
+  warnx("Usage: uorb 'start', 'test [latency|throughput]', 'latency_test', 'contention_test' or 'status'");
 }
 
 
@@ -91,6 +91,14 @@ uorb_main(int argc, char *argv[])
   if (!strcmp(argv[1], "test"))
   {
     uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+
+    /* benchmarks, output is CSV on stdout */
+    if (argc > 2 && !strcmp(argv[2], "latency")) {
+      return t.latency_benchmark();
+    } else if (argc > 2 && !strcmp(argv[2], "throughput")) {
+      return t.throughput_benchmark();
+    }
+
     return t.test();
   }
 
@@ -109,6 +117,15 @@ uorb_main(int argc, char *argv[])
     }
   }
 
+  /*
+   * Test concurrent readers against a publisher.
+   */
+  if (!strcmp(argv[1], "contention_test")) {
+
+    uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+    return t.contention_test();
+  }
+
   /*
    * Print driver information.
    */
@@ -109,6 +109,39 @@ class uORB::Manager
   orb_advert_t orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance,
             int priority) ;
 
+  /**
+   * Advertise as the publisher of a queued topic.
+   *
+   * A queued topic keeps the last queue_size publications in a ring. Each
+   * subscriber reads them in order with orb_copy or orb_borrow and only
+   * loses publications once it falls more than queue_size behind.
+   *
+   * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+   *      for the topic.
+   * @param data    A pointer to the initial data to be published.
+   * @param queue_size  Maximum number of buffered publications.
+   * @return    nullptr on error, otherwise returns a handle
+   *      that can be used to publish to the topic.
+   */
+  orb_advert_t orb_advertise_queue(const struct orb_metadata *meta, const void *data, unsigned queue_size) ;
+
+  /**
+   * Advertise as the publisher of a queued topic instance, see
+   * orb_advertise_multi and orb_advertise_queue.
+   *
+   * @param meta    The uORB metadata (usually from the ORB_ID() macro)
+   *      for the topic.
+   * @param data    A pointer to the initial data to be published.
+   * @param instance  Pointer to an integer which will yield the instance ID (0-based)
+   *      of the publication.
+   * @param priority  The priority of the instance.
+   * @param queue_size  Maximum number of buffered publications.
+   * @return    nullptr on error, otherwise returns a handle
+   *      that can be used to publish to the topic.
+   */
+  orb_advert_t orb_advertise_multi_queue(const struct orb_metadata *meta, const void *data, int *instance,
+                                         int priority, unsigned queue_size) ;
+
 
   /**
    * Publish new data to a topic.
@@ -210,6 +243,26 @@ class uORB::Manager
    */
   int  orb_copy(const struct orb_metadata *meta, int handle, void *buffer) ;
 
+  /**
+   * Borrow the next unread publication of a topic in place.
+   *
+   * The data must be handed back with orb_release before it is trusted.
+   *
+   * @param handle  A handle returned from orb_subscribe.
+   * @param buffer  Set to the borrowed publication.
+   * @return    OK on success, ERROR otherwise with errno set accordingly.
+   */
+  int  orb_borrow(int handle, const void **buffer) ;
+
+  /**
+   * Release a publication obtained with orb_borrow.
+   *
+   * @param handle  A handle returned from orb_subscribe.
+   * @return    OK if the borrowed data was not overwritten while borrowed,
+   *      ERROR otherwise with errno set accordingly.
+   */
+  int  orb_release(int handle) ;
+
   /**
    * Check whether a topic has been published to since the last orb_copy.
    *
@@ -314,6 +367,20 @@ class uORB::Manager
       int priority = ORB_PRIO_DEFAULT
   );
 
+  /**
+   * Common implementation for orb_advertise_multi, orb_advertise_queue and
+   * orb_advertise_multi_queue.
+   */
+  orb_advert_t
+  advertise
+  (
+      const struct orb_metadata *meta,
+      const void *data,
+      int *instance,
+      int priority,
+      unsigned queue_size
+  );
+
  private: // data members
   static Manager _Instance;
 
@@ -82,6 +82,23 @@ orb_advert_t uORB::Manager::orb_advertise(const struct orb_metadata *meta, const
 }
 
 orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance, int priority)
+{
+  return advertise(meta, data, instance, priority, 1);
+}
+
+orb_advert_t uORB::Manager::orb_advertise_queue(const struct orb_metadata *meta, const void *data, unsigned queue_size)
+{
+  return advertise(meta, data, nullptr, ORB_PRIO_DEFAULT, queue_size);
+}
+
+orb_advert_t uORB::Manager::orb_advertise_multi_queue(const struct orb_metadata *meta, const void *data, int *instance,
+    int priority, unsigned queue_size)
+{
+  return advertise(meta, data, instance, priority, queue_size);
+}
+
+orb_advert_t uORB::Manager::advertise(const struct orb_metadata *meta, const void *data, int *instance, int priority,
+                                      unsigned queue_size)
 {
   int result, fd;
   orb_advert_t advertiser;
@@ -91,8 +108,13 @@ orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta,
   if (fd == ERROR)
     return nullptr;
 
-  /* get the advertiser handle and close the node */
+  /* get the advertiser handle */
   result = ioctl(fd, ORBIOCGADVERTISER, (unsigned long)&advertiser);
+
+  /* size the publication queue before the initial publish, then close the node */
+  if (result != ERROR && queue_size > 1)
+    result = ioctl(fd, ORBIOCSETQUEUESIZE, queue_size);
+
   close(fd);
   if (result == ERROR)
     return nullptr;
@@ -143,6 +165,16 @@ int uORB::Manager::orb_copy(const struct orb_metadata *meta, int handle, void *b
   return OK;
 }
 
+int uORB::Manager::orb_borrow(int handle, const void **buffer)
+{
+  return ioctl(handle, ORBIOCBORROW, (unsigned long)(uintptr_t)buffer);
+}
+
+int uORB::Manager::orb_release(int handle)
+{
+  return ioctl(handle, ORBIOCRELEASE, 0);
+}
+
 int uORB::Manager::orb_check(int handle, bool *updated)
 {
   return ioctl(handle, ORBIOCUPDATED, (unsigned long)(uintptr_t)updated);
@@ -82,6 +82,23 @@ orb_advert_t uORB::Manager::orb_advertise(const struct orb_metadata *meta, const
 }
 
 orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta, const void *data, int *instance, int priority)
+{
+  return advertise(meta, data, instance, priority, 1);
+}
+
+orb_advert_t uORB::Manager::orb_advertise_queue(const struct orb_metadata *meta, const void *data, unsigned queue_size)
+{
+  return advertise(meta, data, nullptr, ORB_PRIO_DEFAULT, queue_size);
+}
+
+orb_advert_t uORB::Manager::orb_advertise_multi_queue(const struct orb_metadata *meta, const void *data, int *instance,
+    int priority, unsigned queue_size)
+{
+  return advertise(meta, data, instance, priority, queue_size);
+}
+
+orb_advert_t uORB::Manager::advertise(const struct orb_metadata *meta, const void *data, int *instance, int priority,
+                                      unsigned queue_size)
 {
   int result, fd;
   orb_advert_t advertiser;
@@ -95,14 +112,26 @@ orb_advert_t uORB::Manager::orb_advertise_multi(const struct orb_metadata *meta,
     return nullptr;
   }
 
-  /* get the advertiser handle and close the node */
+  /* get the advertiser handle */
   result = px4_ioctl(fd, ORBIOCGADVERTISER, (unsigned long)&advertiser);
-  px4_close(fd);
   if (result == ERROR) {
     warnx("px4_ioctl ORBIOCGADVERTISER  failed. fd = %d", fd);
+    px4_close(fd);
     return nullptr;
   }
 
+  /* size the publication queue before the initial publish, then close the node */
+  if (queue_size > 1) {
+    result = px4_ioctl(fd, ORBIOCSETQUEUESIZE, queue_size);
+    if (result == ERROR) {
+      warnx("px4_ioctl ORBIOCSETQUEUESIZE failed. fd = %d", fd);
+      px4_close(fd);
+      return nullptr;
+    }
+  }
+
+  px4_close(fd);
+
   /* the advertiser must perform an initial publish to initialise the object */
   result = orb_publish(meta, advertiser, data);
   if (result == ERROR) {
@@ -151,6 +180,16 @@ int uORB::Manager::orb_copy(const struct orb_metadata *meta, int handle, void *b
   return PX4_OK;
 }
 
+int uORB::Manager::orb_borrow(int handle, const void **buffer)
+{
+  return px4_ioctl(handle, ORBIOCBORROW, (unsigned long)(uintptr_t)buffer);
+}
+
+int uORB::Manager::orb_release(int handle)
+{
+  return px4_ioctl(handle, ORBIOCRELEASE, 0);
+}
+
 int uORB::Manager::orb_check(int handle, bool *updated)
 {
   return px4_ioctl(handle, ORBIOCUPDATED, (unsigned long)(uintptr_t)updated);
@@ -246,12 +246,414 @@ int uORBTest::UnitTest::test()
   if (prio != ORB_PRIO_MIN)
     return test_fail("prio: %d", prio);
 
+  if (PX4_OK != test_queue())
+    return test_fail("queue test failed");
+
   if (PX4_OK != latency_test<struct orb_test>(ORB_ID(orb_test), false))
     return test_fail("latency test failed");
 
   return test_note("PASS");
 }
 
+int uORBTest::UnitTest::test_queue()
+{
+  test_note("try queued topic");
+
+  struct orb_test t, u;
+  const unsigned queue_size = 4;
+  bool updated;
+
+  /* subscribe first so the node already exists when it is advertised */
+  int sfd = orb_subscribe(ORB_ID(orb_test_queue));
+
+  if (sfd < 0)
+    return test_fail("queue subscribe failed: %d", errno);
+
+  t.val = 0;
+  orb_advert_t ptopic = orb_advertise_queue(ORB_ID(orb_test_queue), &t, queue_size);
+
+  if (ptopic == nullptr)
+    return test_fail("queue advertise failed: %d", errno);
+
+  /* publish less than a full queue, every publication must be seen in order */
+  for (int i = 1; i < (int)queue_size; i++) {
+    t.val = i;
+    orb_publish(ORB_ID(orb_test_queue), ptopic, &t);
+  }
+
+  for (int i = 0; i < (int)queue_size; i++) {
+    orb_check(sfd, &updated);
+
+    if (!updated)
+      return test_fail("queue: missing update %d", i);
+
+    orb_copy(ORB_ID(orb_test_queue), sfd, &u);
+
+    if (u.val != i)
+      return test_fail("queue: got %d expected %d", u.val, i);
+  }
+
+  orb_check(sfd, &updated);
+
+  if (updated)
+    return test_fail("queue: spurious update");
+
+  /* overflow the queue, only the last queue_size publications remain */
+  for (int i = 10; i < 20; i++) {
+    t.val = i;
+    orb_publish(ORB_ID(orb_test_queue), ptopic, &t);
+  }
+
+  orb_copy(ORB_ID(orb_test_queue), sfd, &u);
+
+  if (u.val != 20 - (int)queue_size)
+    return test_fail("queue overflow: got %d expected %d", u.val, 20 - queue_size);
+
+  /* borrow the next one in place */
+  const struct orb_test *b;
+
+  if (PX4_OK != orb_borrow(sfd, (const void **)&b))
+    return test_fail("queue: borrow failed");
+
+  if (b->val != 21 - (int)queue_size)
+    return test_fail("queue borrow: got %d expected %d", b->val, 21 - queue_size);
+
+  if (PX4_OK != orb_release(sfd))
+    return test_fail("queue: release failed");
+
+  /* a borrow that the publisher laps must fail on release */
+  orb_borrow(sfd, (const void **)&b);
+
+  for (int i = 20; i < 30; i++) {
+    t.val = i;
+    orb_publish(ORB_ID(orb_test_queue), ptopic, &t);
+  }
+
+  if (PX4_OK == orb_release(sfd))
+    return test_fail("queue: overwritten borrow released");
+
+  orb_unsubscribe(sfd);
+
+  return test_note("queue PASS");
+}
+
+int uORBTest::UnitTest::pubsubcontention_main(void)
+{
+  int sfd = orb_subscribe(ORB_ID(orb_test_contention));
+  struct orb_test_medium t;
+  unsigned copies = 0;
+  unsigned torn = 0;
+
+  while (contention_running) {
+    bool updated = false;
+    orb_check(sfd, &updated);
+
+    if (!updated) {
+      usleep(100);
+      continue;
+    }
+
+    orb_copy(ORB_ID(orb_test_contention), sfd, &t);
+    copies++;
+
+    /* the publisher fills the payload with the low byte of val, anything else is a torn read */
+    for (unsigned i = 0; i < sizeof(t.junk); i++) {
+      if (t.junk[i] != (char)t.val) {
+        torn++;
+        break;
+      }
+    }
+  }
+
+  orb_unsubscribe(sfd);
+
+  __sync_fetch_and_add(&contention_copies, copies);
+  __sync_fetch_and_add(&contention_torn, torn);
+  __sync_fetch_and_add(&contention_done, 1);
+
+  return PX4_OK;
+}
+
+int uORBTest::UnitTest::contention_test()
+{
+  test_note("---------------- CONTENTION TEST ------------------");
+
+  const unsigned num_subscribers = 16;
+  const hrt_abstime duration = 2000000;
+  struct orb_test_medium t;
+
+  memset(&t, 0, sizeof(t));
+  orb_advert_t ptopic = orb_advertise(ORB_ID(orb_test_contention), &t);
+
+  if (ptopic == nullptr)
+    return test_fail("advertise failed: %d", errno);
+
+  contention_running = true;
+  contention_done = 0;
+  contention_copies = 0;
+  contention_torn = 0;
+
+  char * const args[1] = { NULL };
+
+  for (unsigned i = 0; i < num_subscribers; i++) {
+    if (px4_task_spawn_cmd("uorb_contention",
+               SCHED_DEFAULT,
+               SCHED_PRIORITY_MAX - 5,
+               1500,
+               (px4_main_t)&uORBTest::UnitTest::pubsubcontention_threadEntry,
+               args) < 0) {
+      contention_running = false;
+      return test_fail("failed launching task");
+    }
+  }
+
+  /* give the subscribers time to start */
+  usleep(100000);
+
+  unsigned publications = 0;
+  hrt_abstime publish_time = 0;
+  hrt_abstime publish_max = 0;
+  hrt_abstime start = hrt_absolute_time();
+
+  while (hrt_elapsed_time(&start) < duration) {
+    t.val = publications;
+    t.time = hrt_absolute_time();
+    memset(t.junk, (char)t.val, sizeof(t.junk));
+
+    hrt_abstime before = hrt_absolute_time();
+    orb_publish(ORB_ID(orb_test_contention), ptopic, &t);
+    hrt_abstime elapsed = hrt_elapsed_time(&before);
+
+    publish_time += elapsed;
+    publish_max = (elapsed > publish_max) ? elapsed : publish_max;
+    publications++;
+
+    /* simulate a 1 kHz publisher */
+    usleep(1000);
+  }
+
+  contention_running = false;
+
+  for (unsigned i = 0; i < 100 && contention_done < num_subscribers; i++) {
+    usleep(10000);
+  }
+
+  test_note("publisher: %u publications, mean %.2f us, max %u us",
+            publications, (double)publish_time / publications, (unsigned)publish_max);
+  test_note("%u subscribers: %u copies, %u torn", num_subscribers, contention_copies, contention_torn);
+
+  if (contention_done < num_subscribers)
+    return test_fail("subscribers did not finish");
+
+  if (contention_torn > 0)
+    return test_fail("torn reads");
+
+  return test_note("PASS");
+}
+
+bool uORBTest::UnitTest::bench_spawn(unsigned count, px4_main_t entry)
+{
+  char * const args[1] = { NULL };
+
+  for (unsigned i = 0; i < count; i++) {
+    if (px4_task_spawn_cmd("uorb_bench",
+               SCHED_DEFAULT,
+               SCHED_PRIORITY_MAX - 5,
+               1500,
+               entry,
+               args) < 0) {
+      /* the tasks already started would otherwise never return */
+      bench_stop(i);
+      return false;
+    }
+  }
+
+  /* wait until all subscribers are in place */
+  for (unsigned i = 0; i < 100 && bench_ready < count; i++)
+    usleep(10000);
+
+  if (bench_ready != count) {
+    bench_stop(count);
+    return false;
+  }
+
+  return true;
+}
+
+void uORBTest::UnitTest::bench_stop(unsigned count)
+{
+  bench_running = false;
+
+  for (unsigned i = 0; i < 100 && bench_done < count; i++)
+    usleep(10000);
+}
+
+int uORBTest::UnitTest::benchlatency_main(void)
+{
+  int sfd = orb_subscribe(bench_topic);
+  struct orb_test_large t;
+  px4_pollfd_struct_t fds[1];
+
+  fds[0].fd = sfd;
+  fds[0].events = POLLIN;
+
+  /* all test structs start with val and time, so the largest one fits them all */
+  orb_copy(bench_topic, sfd, &t);
+  __sync_fetch_and_add(&bench_ready, 1);
+
+  while (bench_running) {
+    int pret = px4_poll(&fds[0], 1, 100);
+
+    if (pret <= 0 || !(fds[0].revents & POLLIN))
+      continue;
+
+    orb_copy(bench_topic, sfd, &t);
+    hrt_abstime latency = hrt_elapsed_time(&t.time);
+
+    /* bucket b holds latencies in [2^(b-1), 2^b) us */
+    unsigned b = 0;
+
+    while (b < bench_latency_buckets - 1 && (1u << b) <= latency)
+      b++;
+
+    bench_latency_hist[b]++;
+    bench_latency_sum += latency;
+    bench_latency_max = (latency > bench_latency_max) ? latency : bench_latency_max;
+    bench_latency_count++;
+  }
+
+  orb_unsubscribe(sfd);
+  __sync_fetch_and_add(&bench_done, 1);
+
+  return PX4_OK;
+}
+
+int uORBTest::UnitTest::benchthroughput_main(void)
+{
+  unsigned instance = __sync_fetch_and_add(&bench_instance_next, 1) % bench_instances;
+  int sfd = orb_subscribe_multi(bench_topic, instance);
+  struct orb_test_large t;
+  unsigned copies = 0;
+
+  __sync_fetch_and_add(&bench_ready, 1);
+
+  while (bench_running) {
+    bool updated = false;
+    orb_check(sfd, &updated);
+
+    if (!updated) {
+      usleep(50);
+      continue;
+    }
+
+    orb_copy(bench_topic, sfd, &t);
+    copies++;
+  }
+
+  orb_unsubscribe(sfd);
+
+  __sync_fetch_and_add(&bench_copies, copies);
+  __sync_fetch_and_add(&bench_done, 1);
+
+  return PX4_OK;
+}
+
+int uORBTest::UnitTest::throughput_benchmark_run(unsigned subscribers, unsigned instances)
+{
+  const hrt_abstime duration = 1000000;
+  struct orb_test t;
+
+  memset(&t, 0, sizeof(t));
+
+  bench_topic = ORB_ID(orb_bench_multi);
+  bench_instances = instances;
+  bench_running = true;
+  bench_ready = 0;
+  bench_done = 0;
+  bench_copies = 0;
+  bench_instance_next = 0;
+
+  if (!bench_spawn(subscribers, (px4_main_t)&uORBTest::UnitTest::benchthroughput_threadEntry))
+    return test_fail("failed launching tasks");
+
+  unsigned publications = 0;
+  hrt_abstime start = hrt_absolute_time();
+
+  while (hrt_elapsed_time(&start) < duration) {
+    t.val = publications;
+    t.time = hrt_absolute_time();
+    orb_publish(ORB_ID(orb_bench_multi), bench_pub[publications % instances], &t);
+    publications++;
+  }
+
+  hrt_abstime elapsed = hrt_elapsed_time(&start);
+  bench_stop(subscribers);
+
+  printf("throughput,%u,%u,%.0f,%.0f\n", subscribers, instances,
+         publications * 1e6 / elapsed, bench_copies * 1e6 / elapsed);
+
+  return PX4_OK;
+}
+
+int uORBTest::UnitTest::latency_benchmark()
+{
+  printf("# latency_hist,topic,lower_us,upper_us,count\n");
+  printf("# latency,topic,size,samples,mean_us,p50_us,p99_us,max_us\n");
+
+  if (PX4_OK != latency_benchmark_topic<struct orb_test>(ORB_ID(orb_bench_small)))
+    return uORB::ERROR;
+
+  if (PX4_OK != latency_benchmark_topic<struct orb_test_medium>(ORB_ID(orb_bench_medium)))
+    return uORB::ERROR;
+
+  if (PX4_OK != latency_benchmark_topic<struct orb_test_large>(ORB_ID(orb_bench_large)))
+    return uORB::ERROR;
+
+  return PX4_OK;
+}
+
+int uORBTest::UnitTest::throughput_benchmark()
+{
+  printf("# copy,topic,size,copy_ns,publish_ns\n");
+
+  if (PX4_OK != copy_benchmark_topic<struct orb_test>(ORB_ID(orb_bench_small)))
+    return uORB::ERROR;
+
+  if (PX4_OK != copy_benchmark_topic<struct orb_test_medium>(ORB_ID(orb_bench_medium)))
+    return uORB::ERROR;
+
+  if (PX4_OK != copy_benchmark_topic<struct orb_test_large>(ORB_ID(orb_bench_large)))
+    return uORB::ERROR;
+
+  /* advertise every instance up front so their numbering is deterministic */
+  for (unsigned i = 0; i < ORB_MULTI_MAX_INSTANCES; i++) {
+    if (bench_pub[i] == nullptr) {
+      struct orb_test t;
+      int instance;
+
+      memset(&t, 0, sizeof(t));
+      bench_pub[i] = orb_advertise_multi(ORB_ID(orb_bench_multi), &t, &instance, ORB_PRIO_DEFAULT);
+
+      if (bench_pub[i] == nullptr)
+        return test_fail("advertise instance %u failed: %d", i, errno);
+    }
+  }
+
+  printf("# throughput,subscribers,instances,publications_per_s,copies_per_s\n");
+
+  for (unsigned subscribers = 1; subscribers <= 16; subscribers *= 2) {
+    if (PX4_OK != throughput_benchmark_run(subscribers, 1))
+      return uORB::ERROR;
+  }
+
+  for (unsigned subscribers = ORB_MULTI_MAX_INSTANCES; subscribers <= 16; subscribers *= 2) {
+    if (PX4_OK != throughput_benchmark_run(subscribers, ORB_MULTI_MAX_INSTANCES))
+      return uORB::ERROR;
+  }
+
+  return PX4_OK;
+}
+
 int uORBTest::UnitTest::info()
 {
   return OK;
@@ -283,6 +685,24 @@ int uORBTest::UnitTest::test_note(const char *fmt, ...)
   return OK;
 }
 
+int uORBTest::UnitTest::pubsubcontention_threadEntry(char* const argv[])
+{
+  uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+  return t.pubsubcontention_main();
+}
+
+int uORBTest::UnitTest::benchlatency_threadEntry(char* const argv[])
+{
+  uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+  return t.benchlatency_main();
+}
+
+int uORBTest::UnitTest::benchthroughput_threadEntry(char* const argv[])
+{
+  uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
+  return t.benchthroughput_main();
+}
+
 int uORBTest::UnitTest::pubsubtest_threadEntry(char* const argv[])
 {
   uORBTest::UnitTest &t = uORBTest::UnitTest::instance();
@@ -43,6 +43,7 @@ struct orb_test {
 };
 ORB_DEFINE(orb_test, struct orb_test);
 ORB_DEFINE(orb_multitest, struct orb_test);
+ORB_DEFINE(orb_test_queue, struct orb_test);
 
 struct orb_test_medium {
   int val;
@@ -50,6 +51,7 @@ struct orb_test_medium {
   char junk[64];
 };
 ORB_DEFINE(orb_test_medium, struct orb_test_medium);
+ORB_DEFINE(orb_test_contention, struct orb_test_medium);
 
 struct orb_test_large {
   int val;
@@ -58,6 +60,11 @@ struct orb_test_large {
 };
 ORB_DEFINE(orb_test_large, struct orb_test_large);
 
+ORB_DEFINE(orb_bench_small, struct orb_test);
+ORB_DEFINE(orb_bench_medium, struct orb_test_medium);
+ORB_DEFINE(orb_bench_large, struct orb_test_large);
+ORB_DEFINE(orb_bench_multi, struct orb_test);
+
 
 namespace uORBTest
 {
@@ -73,6 +80,9 @@ public:
   ~UnitTest() {}
   int test();
   template<typename S> int latency_test(orb_id_t T, bool print);
+  int contention_test();
+  int latency_benchmark();
+  int throughput_benchmark();
   int info();
 
 private:
@@ -86,6 +96,40 @@ private:
   bool pubsubtest_print;
   int pubsubtest_res = OK;
 
+  static int pubsubcontention_threadEntry(char* const argv[]);
+  int pubsubcontention_main(void);
+  volatile bool contention_running = false;
+  volatile unsigned contention_done = 0;
+  volatile unsigned contention_copies = 0;
+  volatile unsigned contention_torn = 0;
+
+  /* benchmark state shared with the benchmark subscriber tasks */
+  static const unsigned bench_latency_buckets = 16;
+  orb_id_t bench_topic = nullptr;
+  unsigned bench_instances = 1;
+  orb_advert_t bench_pub[ORB_MULTI_MAX_INSTANCES] = {};
+  volatile bool bench_running = false;
+  volatile unsigned bench_ready = 0;
+  volatile unsigned bench_done = 0;
+  volatile unsigned bench_copies = 0;
+  volatile unsigned bench_instance_next = 0;
+  unsigned bench_latency_hist[bench_latency_buckets] = {};
+  hrt_abstime bench_latency_sum = 0;
+  hrt_abstime bench_latency_max = 0;
+  unsigned bench_latency_count = 0;
+
+  static int benchlatency_threadEntry(char* const argv[]);
+  static int benchthroughput_threadEntry(char* const argv[]);
+  int benchlatency_main(void);
+  int benchthroughput_main(void);
+  template<typename S> int latency_benchmark_topic(orb_id_t T);
+  template<typename S> int copy_benchmark_topic(orb_id_t T);
+  int throughput_benchmark_run(unsigned subscribers, unsigned instances);
+  bool bench_spawn(unsigned count, px4_main_t entry);
+  void bench_stop(unsigned count);
+
+  int test_queue();
+
   int test_fail(const char *fmt, ...);
   int test_note(const char *fmt, ...);
 };
@@ -135,4 +179,106 @@ int uORBTest::UnitTest::latency_test(orb_id_t T, bool print)
   return pubsubtest_res;
 }
 
+template<typename S>
+int uORBTest::UnitTest::latency_benchmark_topic(orb_id_t T)
+{
+  const unsigned publications = 1000;
+  S t;
+
+  memset(&t, 0, sizeof(t));
+  t.time = hrt_absolute_time();
+
+  orb_advert_t ptopic = orb_advertise(T, &t);
+
+  if (ptopic == nullptr)
+    return test_fail("advertise %s failed: %d", T->o_name, errno);
+
+  bench_topic = T;
+  bench_running = true;
+  bench_ready = 0;
+  bench_done = 0;
+  bench_latency_sum = 0;
+  bench_latency_max = 0;
+  bench_latency_count = 0;
+  memset(bench_latency_hist, 0, sizeof(bench_latency_hist));
+
+  if (!bench_spawn(1, (px4_main_t)&uORBTest::UnitTest::benchlatency_threadEntry))
+    return test_fail("failed launching task");
+
+  for (unsigned i = 0; i < publications; i++) {
+    t.val = i;
+    t.time = hrt_absolute_time();
+    orb_publish(T, ptopic, &t);
+
+    /* simulate a 1 kHz publisher */
+    usleep(1000);
+  }
+
+  bench_stop(1);
+
+  if (bench_latency_count == 0)
+    return test_fail("%s: no wakeups", T->o_name);
+
+  /* percentiles are reported as the upper bound of the bucket they fall into */
+  unsigned p50 = 0, p99 = 0, seen = 0;
+
+  for (unsigned b = 0; b < bench_latency_buckets; b++) {
+    seen += bench_latency_hist[b];
+
+    if (p50 == 0 && seen * 2 >= bench_latency_count)
+      p50 = 1u << b;
+
+    if (p99 == 0 && seen * 100 >= bench_latency_count * 99)
+      p99 = 1u << b;
+
+    printf("latency_hist,%s,%u,%u,%u\n", T->o_name, (b == 0) ? 0 : 1u << (b - 1), 1u << b,
+           bench_latency_hist[b]);
+  }
+
+  printf("latency,%s,%u,%u,%.2f,%u,%u,%u\n", T->o_name, (unsigned)T->o_size, bench_latency_count,
+         (double)bench_latency_sum / bench_latency_count, p50, p99, (unsigned)bench_latency_max);
+
+  return PX4_OK;
+}
+
+template<typename S>
+int uORBTest::UnitTest::copy_benchmark_topic(orb_id_t T)
+{
+  const unsigned copies = 10000;
+  S t;
+
+  memset(&t, 0, sizeof(t));
+
+  orb_advert_t ptopic = orb_advertise(T, &t);
+
+  if (ptopic == nullptr)
+    return test_fail("advertise %s failed: %d", T->o_name, errno);
+
+  int sfd = orb_subscribe(T);
+
+  if (sfd < 0)
+    return test_fail("subscribe %s failed: %d", T->o_name, errno);
+
+  hrt_abstime start = hrt_absolute_time();
+
+  for (unsigned i = 0; i < copies; i++)
+    orb_copy(T, sfd, &t);
+
+  hrt_abstime copy_time = hrt_elapsed_time(&start);
+
+  start = hrt_absolute_time();
+
+  for (unsigned i = 0; i < copies; i++)
+    orb_publish(T, ptopic, &t);
+
+  hrt_abstime publish_time = hrt_elapsed_time(&start);
+
+  orb_unsubscribe(sfd);
+
+  printf("copy,%s,%u,%.1f,%.1f\n", T->o_name, (unsigned)T->o_size,
+         (double)copy_time * 1000.0 / copies, (double)publish_time * 1000.0 / copies);
+
+  return PX4_OK;
+}
+
 #endif // _uORBTest_UnitTest_hpp_
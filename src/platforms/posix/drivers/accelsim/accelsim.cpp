@@ -53,6 +53,7 @@
 #include <math.h>
 #include <unistd.h>
 #include <px4_getopt.h>
+#include <px4_workqueue.h>
 
 #include <systemlib/perf_counter.h>
 #include <systemlib/err.h>
@@ -127,6 +128,9 @@ private:
 	struct hrt_call		_accel_call;
 	struct hrt_call		_mag_call;
 
+	struct work_s		_accel_work;
+	struct work_s		_mag_work;
+
 	unsigned		_call_accel_interval;
 	unsigned		_call_mag_interval;
 
@@ -200,7 +204,8 @@ private:
 	 * generic hrt wrapper yet.
 	 *
 	 * Called by the HRT in interrupt context at the specified rate if
-	 * automatic polling is enabled.
+	 * automatic polling is enabled, queues the measurement on the
+	 * worker pool.
 	 *
 	 * @param arg		Instance pointer for the driver that is polling.
 	 */
@@ -213,6 +218,14 @@ private:
 	 */
 	static void		mag_measure_trampoline(void *arg);
 
+	/**
+	 * Static trampolines from the work queue context.
+	 *
+	 * @param arg		Instance pointer for the driver that is polling.
+	 */
+	static void		measure_work_trampoline(void *arg);
+	static void		mag_measure_work_trampoline(void *arg);
+
 	/**
 	 * Fetch accel measurements from the sensor and update the report ring.
 	 */
@@ -356,6 +369,8 @@ ACCELSIM::ACCELSIM(const char* path, enum Rotation rotation) :
 	_mag(new ACCELSIM_mag(this)),
 	_accel_call{},
 	_mag_call{},
+	_accel_work{},
+	_mag_work{},
 	_call_accel_interval(0),
 	_call_mag_interval(0),
 	_accel_reports(nullptr),
@@ -955,6 +970,8 @@ ACCELSIM::stop()
 {
 	hrt_cancel(&_accel_call);
 	hrt_cancel(&_mag_call);
+	work_cancel(POOLWORK, &_accel_work);
+	work_cancel(POOLWORK, &_mag_work);
 }
 
 void
@@ -963,8 +980,10 @@ ACCELSIM::measure_trampoline(void *arg)
 	//PX4_INFO("ACCELSIM::measure_trampoline");
 	ACCELSIM *dev = (ACCELSIM *)arg;
 
-	/* make another measurement */
-	dev->measure();
+	/* skip this tick if the last measurement has not started yet */
+	if (dev->_accel_work.worker == nullptr) {
+		work_queue(POOLWORK, &dev->_accel_work, (worker_t)&ACCELSIM::measure_work_trampoline, dev, 0);
+	}
 }
 
 void
@@ -973,6 +992,26 @@ ACCELSIM::mag_measure_trampoline(void *arg)
 	//PX4_INFO("ACCELSIM::mag_measure_trampoline");
 	ACCELSIM *dev = (ACCELSIM *)arg;
 
+	/* skip this tick if the last measurement has not started yet */
+	if (dev->_mag_work.worker == nullptr) {
+		work_queue(POOLWORK, &dev->_mag_work, (worker_t)&ACCELSIM::mag_measure_work_trampoline, dev, 0);
+	}
+}
+
+void
+ACCELSIM::measure_work_trampoline(void *arg)
+{
+	ACCELSIM *dev = (ACCELSIM *)arg;
+
+	/* make another measurement */
+	dev->measure();
+}
+
+void
+ACCELSIM::mag_measure_work_trampoline(void *arg)
+{
+	ACCELSIM *dev = (ACCELSIM *)arg;
+
 	/* make another measurement */
 	dev->mag_measure();
 }
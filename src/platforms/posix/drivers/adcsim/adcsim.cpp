@@ -43,6 +43,7 @@
 #include <px4_config.h>
 #include <px4_time.h>
 #include <px4_adc.h>
+#include <px4_workqueue.h>
 #include <board_config.h>
 #include <drivers/device/device.h>
 
@@ -85,14 +86,18 @@ private:
 	static const hrt_abstime _tickrate = 10000;	/**< 100Hz base rate */
 	
 	hrt_call		_call;
+	work_s			_work;
 	perf_counter_t		_sample_perf;
 
 	unsigned		_channel_count;
 	adc_msg_s		*_samples;		/**< sample buffer */
 
-	/** work trampoline */
+	/** hrt trampoline, queues _tick() on the worker pool */
 	static void		_tick_trampoline(void *arg);
 
+	/** work trampoline */
+	static void		_tick_work_trampoline(void *arg);
+
 	/** worker function */
 	void			_tick();
 
@@ -111,6 +116,8 @@ private:
 
 ADCSIM::ADCSIM(uint32_t channels) :
 	VDev("adcsim", ADCSIM0_DEVICE_PATH),
+	_call{},
+	_work{},
 	_sample_perf(perf_alloc(PC_ELAPSED, "adc_samples")),
 	_channel_count(0),
 	_samples(nullptr)
@@ -192,11 +199,23 @@ int
 ADCSIM::close_last(device::file_t *filp)
 {
 	hrt_cancel(&_call);
+	work_cancel(POOLWORK, &_work);
 	return 0;
 }
 
 void
 ADCSIM::_tick_trampoline(void *arg)
+{
+	ADCSIM *dev = reinterpret_cast<ADCSIM *>(arg);
+
+	/* skip this tick if the last one has not started yet */
+	if (dev->_work.worker == nullptr) {
+		work_queue(POOLWORK, &dev->_work, (worker_t)&ADCSIM::_tick_work_trampoline, dev, 0);
+	}
+}
+
+void
+ADCSIM::_tick_work_trampoline(void *arg)
 {
 	(reinterpret_cast<ADCSIM *>(arg))->_tick();
 }
@@ -343,13 +343,13 @@ Airspeed::start()
 	_reports->flush();
 
 	/* schedule a cycle to start things */
-	work_queue(HPWORK, &_work, (worker_t)&Airspeed::cycle_trampoline, this, 1);
+	work_queue(POOLWORK, &_work, (worker_t)&Airspeed::cycle_trampoline, this, 1);
 }
 
 void
 Airspeed::stop()
 {
-	work_cancel(HPWORK, &_work);
+	work_cancel(POOLWORK, &_work);
 }
 
 void
@@ -514,13 +514,13 @@ BAROSIM::start_cycle()
 	_reports->flush();
 
 	/* schedule a cycle to start things */
-	work_queue(HPWORK, &_work, (worker_t)&BAROSIM::cycle_trampoline, this, 1);
+	work_queue(POOLWORK, &_work, (worker_t)&BAROSIM::cycle_trampoline, this, 1);
 }
 
 void
 BAROSIM::stop_cycle()
 {
-	work_cancel(HPWORK, &_work);
+	work_cancel(POOLWORK, &_work);
 }
 
 void
@@ -562,7 +562,7 @@ BAROSIM::cycle()
 		    (_measure_ticks > USEC2TICK(BAROSIM_CONVERSION_INTERVAL))) {
 
 			/* schedule a fresh cycle call when we are ready to measure again */
-			work_queue(HPWORK,
+			work_queue(POOLWORK,
 				   &_work,
 				   (worker_t)&BAROSIM::cycle_trampoline,
 				   this,
@@ -587,7 +587,7 @@ BAROSIM::cycle()
 	_collect_phase = true;
 
 	/* schedule a fresh cycle call when the measurement is done */
-	work_queue(HPWORK,
+	work_queue(POOLWORK,
 		   &_work,
 		   (worker_t)&BAROSIM::cycle_trampoline,
 		   this,
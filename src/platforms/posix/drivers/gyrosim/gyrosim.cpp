@@ -43,6 +43,7 @@
 
 #include <px4_config.h>
 #include <px4_getopt.h>
+#include <px4_workqueue.h>
 
 #include <sys/types.h>
 #include <stdint.h>
@@ -173,6 +174,15 @@
 
 #define GYROSIM_ONE_G					9.80665f
 
+/*
+  FIFO mode: the simulated sensor queues every sample at the sample
+  rate in a FIFO the size of the MPU6000 one, and each poll reads all
+  of them in bursts of up to GYROSIM_FIFO_MAX_SAMPLES samples.
+ */
+#define GYROSIM_FIFO_SIZE				1024
+#define GYROSIM_FIFO_MAX_SAMPLES			16
+#define GYROSIM_FIFO_DEFAULT_POLL_RATE			250
+
 #ifdef PX4_SPI_BUS_EXT
 #define EXTERNAL_BUS PX4_SPI_BUS_EXT
 #else
@@ -192,7 +202,7 @@ class GYROSIM_gyro;
 class GYROSIM : public device::VDev
 {
 public:
-	GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation);
+	GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation, bool fifo = false);
 	virtual ~GYROSIM();
 
 	virtual int		init();
@@ -220,6 +230,7 @@ private:
 
 	struct hrt_call		_call;
 	unsigned		_call_interval;
+	struct work_s		_work;
 
 	ringbuffer::RingBuffer	*_accel_reports;
 
@@ -244,6 +255,7 @@ private:
 	perf_counter_t		_bad_registers;
 	perf_counter_t		_good_transfers;
 	perf_counter_t		_reset_retries;
+	perf_counter_t		_fifo_overflows;
 	perf_counter_t		_system_latency_perf;
 	perf_counter_t		_controller_latency_perf;
 
@@ -262,6 +274,13 @@ private:
 	// last temperature reading for print_info()
 	float			_last_temperature;
 
+	// drain the simulated sensor FIFO rather than read the latest sample
+	bool			_fifo;
+
+	// simulated sensor FIFO, filled at the sample rate
+	struct hrt_call		_sample_call;
+	ringbuffer::RingBuffer	*_fifo_samples;
+
 	/**
 	 * Start automatic measurement.
 	 */
@@ -284,17 +303,49 @@ private:
 	 * generic hrt wrapper yet.
 	 *
 	 * Called by the HRT in interrupt context at the specified rate if
-	 * automatic polling is enabled.
+	 * automatic polling is enabled, queues the measurement on the
+	 * worker pool.
 	 *
 	 * @param arg		Instance pointer for the driver that is polling.
 	 */
 	static void		measure_trampoline(void *arg);
 
+	/**
+	 * Static trampoline from the work queue context.
+	 *
+	 * @param arg		Instance pointer for the driver that is polling.
+	 */
+	static void		measure_work_trampoline(void *arg);
+
 	/**
 	 * Fetch measurements from the sensor and update the report buffers.
 	 */
 	void			measure();
 
+	/**
+	 * Fetch all samples queued in the sensor FIFO and update the report
+	 * buffers, with timestamps spaced at the sample rate.
+	 */
+	void			measure_fifo();
+
+	/**
+	 * Empty the sensor FIFO, after it overflowed.
+	 */
+	void			reset_fifo();
+
+	/**
+	 * Static trampoline from the hrt_call context, called at the sample
+	 * rate in FIFO mode to queue a sample like the sensor would.
+	 *
+	 * @param arg		Instance pointer for the driver.
+	 */
+	static void		sample_trampoline(void *arg);
+
+	/**
+	 * Queue the current simulator sample in the sensor FIFO.
+	 */
+	void			sample();
+
 	/**
 	 * Read a register from the GYROSIM
 	 *
@@ -367,6 +418,17 @@ private:
 	*/
 	void _set_sample_rate(unsigned desired_sample_rate_hz);
 
+	/*
+	  rate the software filters run at, every sample in FIFO mode
+	 */
+	float _filter_sample_rate();
+
+	/*
+	  longest poll interval in microseconds that drains the FIFO
+	  before it overflows at the current sample rate
+	 */
+	unsigned _fifo_max_interval();
+
 	/* do not allow to copy this class due to pointer data members */
 	GYROSIM(const GYROSIM&);
 	GYROSIM operator=(const GYROSIM&);
@@ -387,8 +449,49 @@ private:
 		uint8_t		gyro_y[2];
 		uint8_t		gyro_z[2];
 	};
+
+	/**
+	 * One sample as queued in the FIFO, in register order.
+	 */
+	struct MPUFIFOSample {
+		uint8_t		accel_x[2];
+		uint8_t		accel_y[2];
+		uint8_t		accel_z[2];
+		uint8_t		temp[2];
+		uint8_t		gyro_x[2];
+		uint8_t		gyro_y[2];
+		uint8_t		gyro_z[2];
+	};
+
+	/**
+	 * FIFO burst read, command byte followed by the samples.
+	 */
+	struct MPUFIFOReport {
+		uint8_t		cmd;
+		MPUFIFOSample	samples[GYROSIM_FIFO_MAX_SAMPLES];
+	};
 #pragma pack(pop)
 
+	/**
+	 * A sample converted to native byte order.
+	 */
+	struct Report {
+		int16_t		accel_x;
+		int16_t		accel_y;
+		int16_t		accel_z;
+		int16_t		temp;
+		int16_t		gyro_x;
+		int16_t		gyro_y;
+		int16_t		gyro_z;
+	};
+
+	struct MPUFIFOReport	_fifo_report;
+
+	/**
+	 * Scale, filter, queue and publish one sample.
+	 */
+	void			process_sample(Report &report, hrt_abstime timestamp);
+
 	uint8_t _regdata[108];
 };
 
@@ -425,12 +528,13 @@ private:
 /** driver 'main' command */
 extern "C" { __EXPORT int gyrosim_main(int argc, char *argv[]); }
 
-GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation) :
+GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation rotation, bool fifo) :
 	VDev("GYROSIM", path_accel),
 	_gyro(new GYROSIM_gyro(this, path_gyro)),
 	_product(GYROSIMES_REV_C4),
 	_call{},
 	_call_interval(0),
+	_work{},
 	_accel_reports(nullptr),
 	_accel_scale{},
 	_accel_range_scale(0.0f),
@@ -450,6 +554,7 @@ GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation ro
 	_bad_registers(perf_alloc(PC_COUNT, "gyrosim_bad_registers")),
 	_good_transfers(perf_alloc(PC_COUNT, "gyrosim_good_transfers")),
 	_reset_retries(perf_alloc(PC_COUNT, "gyrosim_reset_retries")),
+	_fifo_overflows(perf_alloc(PC_COUNT, "gyrosim_fifo_overflows")),
 	_system_latency_perf(perf_alloc_once(PC_ELAPSED, "sys_latency")),
 	_controller_latency_perf(perf_alloc_once(PC_ELAPSED, "ctrl_latency")),
 	_register_wait(0),
@@ -461,7 +566,11 @@ GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation ro
 	_gyro_filter_y(GYROSIM_GYRO_DEFAULT_RATE, GYROSIM_GYRO_DEFAULT_DRIVER_FILTER_FREQ),
 	_gyro_filter_z(GYROSIM_GYRO_DEFAULT_RATE, GYROSIM_GYRO_DEFAULT_DRIVER_FILTER_FREQ),
 	_rotation(rotation),
-	_last_temperature(0)
+	_last_temperature(0),
+	_fifo(fifo),
+	_sample_call{},
+	_fifo_samples(nullptr),
+	_fifo_report{}
 {
 	// disable debug() calls
 	_debug_enabled = false;
@@ -489,12 +598,15 @@ GYROSIM::GYROSIM(const char *path_accel, const char *path_gyro, enum Rotation ro
 	_gyro_scale.z_scale  = 1.0f;
 
 	memset(&_call, 0, sizeof(_call));
+	memset(&_work, 0, sizeof(_work));
+	memset(&_sample_call, 0, sizeof(_sample_call));
 }
 
 GYROSIM::~GYROSIM()
 {
 	/* make sure we are truly inactive */
 	stop();
+	hrt_cancel(&_sample_call);
 
 	/* delete the gyro subdriver */
 	delete _gyro;
@@ -504,6 +616,8 @@ GYROSIM::~GYROSIM()
 		delete _accel_reports;
 	if (_gyro_reports != nullptr)
 		delete _gyro_reports;
+	if (_fifo_samples != nullptr)
+		delete _fifo_samples;
 
 	if (_accel_class_instance != -1)
 		unregister_class_devname(ACCEL_BASE_DEVICE_PATH, _accel_class_instance);
@@ -515,6 +629,7 @@ GYROSIM::~GYROSIM()
 	perf_free(_bad_transfers);
 	perf_free(_bad_registers);
 	perf_free(_good_transfers);
+	perf_free(_fifo_overflows);
 }
 
 int
@@ -531,19 +646,27 @@ GYROSIM::init()
 		return ret;
 	}
 
-	/* allocate basic report buffers */
-	_accel_reports = new ringbuffer::RingBuffer(2, sizeof(accel_report));
+	/* allocate basic report buffers, deep enough for a FIFO burst in FIFO mode */
+	_accel_reports = new ringbuffer::RingBuffer(_fifo ? GYROSIM_FIFO_MAX_SAMPLES : 2, sizeof(accel_report));
 	if (_accel_reports == nullptr) {
 		PX4_WARN("_accel_reports creation failed");
 		goto out;
 	}
 
-	_gyro_reports = new ringbuffer::RingBuffer(2, sizeof(gyro_report));
+	_gyro_reports = new ringbuffer::RingBuffer(_fifo ? GYROSIM_FIFO_MAX_SAMPLES : 2, sizeof(gyro_report));
 	if (_gyro_reports == nullptr) {
 		PX4_WARN("_gyro_reports creation failed");
 		goto out;
 	}
 
+	if (_fifo) {
+		_fifo_samples = new ringbuffer::RingBuffer(GYROSIM_FIFO_SIZE / sizeof(MPUFIFOSample), sizeof(MPUFIFOSample));
+		if (_fifo_samples == nullptr) {
+			PX4_WARN("_fifo_samples creation failed");
+			goto out;
+		}
+	}
+
 	if (reset() != OK) {
 		PX4_WARN("reset failed");
 		goto out;
@@ -575,6 +698,11 @@ GYROSIM::init()
 
 	_accel_class_instance = register_class_devname(ACCEL_BASE_DEVICE_PATH);
 
+	if (_fifo) {
+		/* let the FIFO collect the first sample */
+		usleep(2000);
+	}
+
 	measure();
 
 	/* advertise sensor topic, measure manually to initialize valid report */
@@ -582,8 +710,15 @@ GYROSIM::init()
 	_accel_reports->get(&arp);
 
 	/* measurement will have generated a report, publish */
-	_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
-		&_accel_orb_class_instance, ORB_PRIO_HIGH);
+	if (_fifo) {
+		/* queue every sample of a burst for the subscribers */
+		_accel_topic = orb_advertise_multi_queue(ORB_ID(sensor_accel), &arp,
+			&_accel_orb_class_instance, ORB_PRIO_HIGH, GYROSIM_FIFO_MAX_SAMPLES);
+
+	} else {
+		_accel_topic = orb_advertise_multi(ORB_ID(sensor_accel), &arp,
+			&_accel_orb_class_instance, ORB_PRIO_HIGH);
+	}
 
 	if (_accel_topic == nullptr) {
 		PX4_WARN("ADVERT FAIL");
@@ -594,8 +729,14 @@ GYROSIM::init()
 	struct gyro_report grp;
 	_gyro_reports->get(&grp);
 
-	_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
-		&_gyro->_gyro_orb_class_instance, ORB_PRIO_HIGH);
+	if (_fifo) {
+		_gyro->_gyro_topic = orb_advertise_multi_queue(ORB_ID(sensor_gyro), &grp,
+			&_gyro->_gyro_orb_class_instance, ORB_PRIO_HIGH, GYROSIM_FIFO_MAX_SAMPLES);
+
+	} else {
+		_gyro->_gyro_topic = orb_advertise_multi(ORB_ID(sensor_gyro), &grp,
+			&_gyro->_gyro_orb_class_instance, ORB_PRIO_HIGH);
+	}
 
 	if (_gyro->_gyro_topic == nullptr) {
 		PX4_WARN("ADVERT FAIL");
@@ -607,6 +748,14 @@ out:
 
 int GYROSIM::reset()
 {
+	if (_fifo) {
+		/* restart the simulated sensor with an empty FIFO */
+		hrt_cancel(&_sample_call);
+		_fifo_samples->flush();
+		hrt_call_every(&_sample_call, 1000000 / _sample_rate, 1000000 / _sample_rate,
+			       (hrt_callout)&GYROSIM::sample_trampoline, this);
+	}
+
 	return OK;
 }
 
@@ -628,6 +777,21 @@ GYROSIM::transfer(uint8_t *send, uint8_t *recv, unsigned len)
 		// skip cmd and status bytes
 		sim->getMPUReport(&recv[2], len-2);
 	}
+	else if (cmd == (MPUREG_FIFO_COUNTH | DIR_READ))
+	{
+		// number of bytes queued in the simulated FIFO
+		unsigned bytes = (_fifo_samples != nullptr) ? _fifo_samples->count() * sizeof(MPUFIFOSample) : 0;
+		recv[1] = bytes >> 8;
+		recv[2] = bytes & 0xff;
+	}
+	else if (cmd == (MPUREG_FIFO_R_W | DIR_READ))
+	{
+		// burst read of whole samples, an empty FIFO reads as zero
+		for (unsigned i = 1; i + sizeof(MPUFIFOSample) <= len; i += sizeof(MPUFIFOSample)) {
+			if (_fifo_samples == nullptr || !_fifo_samples->get(&recv[i], sizeof(MPUFIFOSample)))
+				memset(&recv[i], 0, sizeof(MPUFIFOSample));
+		}
+	}
 	else if (cmd & DIR_READ)
 	{
 		PX4_DEBUG("Reading %u bytes from register %u", len-1, reg);
@@ -658,6 +822,43 @@ GYROSIM::_set_sample_rate(unsigned desired_sample_rate_hz)
 	if(div<1) div=1;
 	write_reg(MPUREG_SMPLRT_DIV, div-1);
 	_sample_rate = 1000 / div;
+
+	if (_fifo) {
+		/* a faster sample rate fills the FIFO sooner, keep polling often enough */
+		if (_call_interval > _fifo_max_interval()) {
+			_call_interval = _fifo_max_interval();
+			_call.period = _call_interval;
+		}
+
+		/* XXX this is a bit shady, but no other way to adjust... */
+		_sample_call.period = 1000000 / _sample_rate;
+
+		// the software filters see every sample
+		float sample_rate = _filter_sample_rate();
+		_accel_filter_x.set_cutoff_frequency(sample_rate, _accel_filter_x.get_cutoff_freq());
+		_accel_filter_y.set_cutoff_frequency(sample_rate, _accel_filter_y.get_cutoff_freq());
+		_accel_filter_z.set_cutoff_frequency(sample_rate, _accel_filter_z.get_cutoff_freq());
+		_gyro_filter_x.set_cutoff_frequency(sample_rate, _gyro_filter_x.get_cutoff_freq());
+		_gyro_filter_y.set_cutoff_frequency(sample_rate, _gyro_filter_y.get_cutoff_freq());
+		_gyro_filter_z.set_cutoff_frequency(sample_rate, _gyro_filter_z.get_cutoff_freq());
+	}
+}
+
+float
+GYROSIM::_filter_sample_rate()
+{
+	if (_fifo) {
+		return _sample_rate;
+	}
+
+	return 1.0e6f / _call_interval;
+}
+
+unsigned
+GYROSIM::_fifo_max_interval()
+{
+	/* one sample of margin, a full FIFO counts as overflowed */
+	return (GYROSIM_FIFO_SIZE / sizeof(MPUFIFOSample) - 1) * 1000000 / _sample_rate;
 }
 
 /*
@@ -864,6 +1065,10 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 
 				/* switching to manual polling */
 			case SENSOR_POLLRATE_MANUAL:
+				/* reads spaced arbitrarily apart would overflow the FIFO */
+				if (_fifo)
+					return -EINVAL;
+
 				stop();
 				_call_interval = 0;
 				return OK;
@@ -880,7 +1085,9 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 				return ioctl(filp, SENSORIOCSPOLLRATE, 1000);
 
 			case SENSOR_POLLRATE_DEFAULT:
-				return ioctl(filp, SENSORIOCSPOLLRATE, GYROSIM_ACCEL_DEFAULT_RATE);
+				/* in FIFO mode every poll delivers the samples since the last one */
+				return ioctl(filp, SENSORIOCSPOLLRATE,
+					     _fifo ? GYROSIM_FIFO_DEFAULT_POLL_RATE : GYROSIM_ACCEL_DEFAULT_RATE);
 
 				/* adjust to a legal polling interval in Hz */
 			default: {
@@ -894,9 +1101,17 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 					if (ticks < 1000)
 						return -EINVAL;
 
+					/* poll at least as often as the FIFO needs draining */
+					if (_fifo && ticks > _fifo_max_interval())
+						ticks = _fifo_max_interval();
+
+					/* update interval for next measurement */
+					/* XXX this is a bit shady, but no other way to adjust... */
+					_call.period = _call_interval = ticks;
+
 					// adjust filters
 					float cutoff_freq_hz = _accel_filter_x.get_cutoff_freq();
-					float sample_rate = 1.0e6f/ticks;
+					float sample_rate = _filter_sample_rate();
 					_set_dlpf_filter(cutoff_freq_hz);
 					_accel_filter_x.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
 					_accel_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz);
@@ -909,10 +1124,6 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 					_gyro_filter_y.set_cutoff_frequency(sample_rate, cutoff_freq_hz_gyro);
 					_gyro_filter_z.set_cutoff_frequency(sample_rate, cutoff_freq_hz_gyro);
 
-					/* update interval for next measurement */
-					/* XXX this is a bit shady, but no other way to adjust... */
-					_call.period = _call_interval = ticks;
-
 					/* if we need to start the poll state machine, do it */
 					if (want_start)
 						start();
@@ -957,9 +1168,9 @@ GYROSIM::ioctl(device::file_t *filp, int cmd, unsigned long arg)
 		// set hardware filtering
 		_set_dlpf_filter(arg);
 		// set software filtering
-		_accel_filter_x.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_accel_filter_y.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_accel_filter_z.set_cutoff_frequency(1.0e6f / _call_interval, arg);
+		_accel_filter_x.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_accel_filter_y.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_accel_filter_z.set_cutoff_frequency(_filter_sample_rate(), arg);
 		return OK;
 
 	case ACCELIOCSSCALE:
@@ -1033,9 +1244,9 @@ GYROSIM::gyro_ioctl(device::file_t *filp, int cmd, unsigned long arg)
 	case GYROIOCSLOWPASS:
 		// set hardware filtering
 		_set_dlpf_filter(arg);
-		_gyro_filter_x.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_gyro_filter_y.set_cutoff_frequency(1.0e6f / _call_interval, arg);
-		_gyro_filter_z.set_cutoff_frequency(1.0e6f / _call_interval, arg);
+		_gyro_filter_x.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_gyro_filter_y.set_cutoff_frequency(_filter_sample_rate(), arg);
+		_gyro_filter_z.set_cutoff_frequency(_filter_sample_rate(), arg);
 		return OK;
 
 	case GYROIOCSSCALE:
@@ -1179,6 +1390,7 @@ void
 GYROSIM::stop()
 {
 	hrt_cancel(&_call);
+	work_cancel(POOLWORK, &_work);
 }
 
 void
@@ -1186,23 +1398,53 @@ GYROSIM::measure_trampoline(void *arg)
 {
 	GYROSIM *dev = reinterpret_cast<GYROSIM *>(arg);
 
+	/* skip this tick if the last measurement has not started yet */
+	if (dev->_work.worker == nullptr) {
+		work_queue(POOLWORK, &dev->_work, (worker_t)&GYROSIM::measure_work_trampoline, dev, 0);
+	}
+}
+
+void
+GYROSIM::measure_work_trampoline(void *arg)
+{
+	GYROSIM *dev = reinterpret_cast<GYROSIM *>(arg);
+
 	/* make another measurement */
 	dev->measure();
 }
 
+void
+GYROSIM::sample_trampoline(void *arg)
+{
+	GYROSIM *dev = reinterpret_cast<GYROSIM *>(arg);
+
+	dev->sample();
+}
+
+void
+GYROSIM::sample()
+{
+	struct MPUReport mpu_report;
+
+	mpu_report.cmd = DIR_READ | MPUREG_INT_STATUS;
+
+	if (OK != transfer((uint8_t *)&mpu_report, ((uint8_t *)&mpu_report), sizeof(mpu_report)))
+		return;
+
+	// like the sensor, a full FIFO drops new samples
+	_fifo_samples->put(&mpu_report.accel_x[0], sizeof(MPUFIFOSample));
+}
+
 void
 GYROSIM::measure()
 {
+	if (_fifo) {
+		measure_fifo();
+		return;
+	}
+
 	struct MPUReport mpu_report;
-	struct Report {
-		int16_t		accel_x;
-		int16_t		accel_y;
-		int16_t		accel_z;
-		int16_t		temp;
-		int16_t		gyro_x;
-		int16_t		gyro_y;
-		int16_t		gyro_z;
-	} report;
+	Report report;
 
 	/* start measuring */
 	perf_begin(_sample_perf);
@@ -1259,7 +1501,135 @@ GYROSIM::measure()
 		return;
 	}
 
+	process_sample(report, hrt_absolute_time());
+
+	/* notify anyone waiting for data */
+	poll_notify(POLLIN);
+	_gyro->parent_poll_notify();
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+GYROSIM::measure_fifo()
+{
+	/* start measuring */
+	perf_begin(_sample_perf);
 
+	/*
+	 * Read how many bytes are queued, the newest sample was taken
+	 * at most one sample interval ago.
+	 */
+	uint8_t count[3] = { (uint8_t)(MPUREG_FIFO_COUNTH | DIR_READ), 0, 0 };
+
+	if (OK != transfer(count, count, sizeof(count))) {
+		perf_count(_bad_transfers);
+		perf_end(_sample_perf);
+		return;
+	}
+
+	hrt_abstime now = hrt_absolute_time();
+	unsigned bytes = (count[1] << 8) | count[2];
+
+	if (bytes > GYROSIM_FIFO_SIZE - sizeof(MPUFIFOSample)) {
+		// samples were lost, start over
+		perf_count(_fifo_overflows);
+		reset_fifo();
+		perf_end(_sample_perf);
+		return;
+	}
+
+	unsigned samples = bytes / sizeof(MPUFIFOSample);
+
+	if (samples == 0) {
+		// no new sample since the last poll
+		perf_end(_sample_perf);
+		return;
+	}
+
+	const hrt_abstime interval = 1000000 / _sample_rate;
+	unsigned index = 0;
+	bool published = false;
+
+	/*
+	 * Fetch the samples in as few transfers as possible.
+	 */
+	while (index < samples) {
+		unsigned burst = samples - index;
+
+		if (burst > GYROSIM_FIFO_MAX_SAMPLES)
+			burst = GYROSIM_FIFO_MAX_SAMPLES;
+
+		_fifo_report.cmd = DIR_READ | MPUREG_FIFO_R_W;
+
+		if (OK != transfer((uint8_t *)&_fifo_report, (uint8_t *)&_fifo_report,
+				   1 + burst * sizeof(MPUFIFOSample))) {
+			perf_count(_bad_transfers);
+			break;
+		}
+
+		for (unsigned i = 0; i < burst; i++, index++) {
+			MPUFIFOSample &sample = _fifo_report.samples[i];
+			Report report;
+
+			/*
+			 * Convert from big to little endian
+			 */
+			report.accel_x = int16_t_from_bytes(sample.accel_x);
+			report.accel_y = int16_t_from_bytes(sample.accel_y);
+			report.accel_z = int16_t_from_bytes(sample.accel_z);
+
+			report.temp = int16_t_from_bytes(sample.temp);
+
+			report.gyro_x = int16_t_from_bytes(sample.gyro_x);
+			report.gyro_y = int16_t_from_bytes(sample.gyro_y);
+			report.gyro_z = int16_t_from_bytes(sample.gyro_z);
+
+			if (report.accel_x == 0 &&
+			    report.accel_y == 0 &&
+			    report.accel_z == 0 &&
+			    report.temp == 0 &&
+			    report.gyro_x == 0 &&
+			    report.gyro_y == 0 &&
+			    report.gyro_z == 0) {
+				// all zero data - probably a VDev bus error
+				perf_count(_bad_transfers);
+				continue;
+			}
+
+			perf_count(_good_transfers);
+
+			if (_register_wait != 0) {
+				// still drain the FIFO, but don't return any data yet
+				_register_wait--;
+				continue;
+			}
+
+			process_sample(report, now - (samples - 1 - index) * interval);
+			published = true;
+		}
+	}
+
+	if (published) {
+		/* notify anyone waiting for data */
+		poll_notify(POLLIN);
+		_gyro->parent_poll_notify();
+	}
+
+	/* stop measuring */
+	perf_end(_sample_perf);
+}
+
+void
+GYROSIM::reset_fifo()
+{
+	_fifo_samples->flush();
+}
+
+void
+GYROSIM::process_sample(Report &report, hrt_abstime timestamp)
+{
 	/*
 	 * Swap axes and negate y
 	 */
@@ -1286,7 +1656,7 @@ GYROSIM::measure()
 	/*
 	 * Adjust and scale results to m/s^2.
 	 */
-	grb.timestamp = arb.timestamp = hrt_absolute_time();
+	grb.timestamp = arb.timestamp = timestamp;
 
 	// report the error count as the sum of the number of bad
 	// transfers and bad register reads. This allows the higher
@@ -1367,10 +1737,6 @@ GYROSIM::measure()
 	_accel_reports->force(&arb);
 	_gyro_reports->force(&grb);
 
-	/* notify anyone waiting for data */
-	poll_notify(POLLIN);
-	_gyro->parent_poll_notify();
-
 	if (!(_pub_blocked)) {
 		/* log the time of this report */
 		perf_begin(_controller_latency_perf);
@@ -1383,9 +1749,6 @@ GYROSIM::measure()
 		/* publish it */
 		orb_publish(ORB_ID(sensor_gyro), _gyro->_gyro_topic, &grb);
 	}
-
-	/* stop measuring */
-	perf_end(_sample_perf);
 }
 
 void
@@ -1398,8 +1761,15 @@ GYROSIM::print_info()
 	perf_print_counter(_bad_registers);
 	perf_print_counter(_good_transfers);
 	perf_print_counter(_reset_retries);
+	perf_print_counter(_fifo_overflows);
 	_accel_reports->print_info("accel queue");
 	_gyro_reports->print_info("gyro queue");
+
+	if (_fifo) {
+		_fifo_samples->print_info("sensor FIFO");
+	}
+
+	PX4_INFO("mode: %s", _fifo ? "FIFO" : "data registers");
 	PX4_WARN("temperature: %.1f", (double)_last_temperature);
 }
 
@@ -1492,7 +1862,7 @@ namespace gyrosim
 
 GYROSIM	*g_dev_sim; // on simulated bus
 
-int	start(enum Rotation);
+int	start(enum Rotation, bool fifo);
 int	stop();
 int	test();
 int	reset();
@@ -1507,7 +1877,7 @@ void	usage();
  * or failed to detect the sensor.
  */
 int
-start(enum Rotation rotation)
+start(enum Rotation rotation, bool fifo)
 {
 	int fd;
         GYROSIM **g_dev_ptr = &g_dev_sim;
@@ -1521,7 +1891,7 @@ start(enum Rotation rotation)
 	}
 
 	/* create the driver */
-	*g_dev_ptr = new GYROSIM(path_accel, path_gyro, rotation);
+	*g_dev_ptr = new GYROSIM(path_accel, path_gyro, rotation, fifo);
 
 	if (*g_dev_ptr == nullptr)
 		goto fail;
@@ -1597,10 +1967,15 @@ test()
 		return 1;
 	}
 
-	/* reset to manual polling */
+	/* reset to manual polling, FIFO mode refuses it and keeps polling itself */
 	if (px4_ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_MANUAL) < 0) {
-		PX4_ERR("reset to manual polling");
-		return 1;
+		if (px4_ioctl(fd, SENSORIOCSPOLLRATE, SENSOR_POLLRATE_DEFAULT) < 0) {
+			PX4_ERR("reset to default polling");
+			return 1;
+		}
+
+		/* let a report arrive before the demand read */
+		usleep(20000);
 	}
 
 	/* do a simple demand read */
@@ -1730,6 +2105,7 @@ usage()
 	PX4_WARN("missing command: try 'start', 'info', 'test', 'stop', 'reset', 'regdump'");
 	PX4_WARN("options:");
 	PX4_WARN("    -R rotation");
+	PX4_WARN("    -f (drain the sensor FIFO in bursts)");
 }
 
 } // namespace
@@ -1739,16 +2115,20 @@ gyrosim_main(int argc, char *argv[])
 {
 	int ch;
 	enum Rotation rotation = ROTATION_NONE;
+	bool fifo = false;
 	int ret;
 
 	/* jump over start/off/etc and look at options first */
 	int myoptind = 1;
 	const char *myoptarg = NULL;
-	while ((ch = px4_getopt(argc, argv, "R:", &myoptind, &myoptarg)) != EOF) {
+	while ((ch = px4_getopt(argc, argv, "R:f", &myoptind, &myoptarg)) != EOF) {
 		switch (ch) {
 		case 'R':
 			rotation = (enum Rotation)atoi(optarg);
 			break;
+		case 'f':
+			fifo = true;
+			break;
 		default:
 			gyrosim::usage();
 			return 0;
@@ -1762,7 +2142,7 @@ gyrosim_main(int argc, char *argv[])
 
 	 */
 	if (!strcmp(verb, "start")) {
-		ret = gyrosim::start(rotation);
+		ret = gyrosim::start(rotation, fifo);
 	}
 
 	else if (!strcmp(verb, "stop")) {
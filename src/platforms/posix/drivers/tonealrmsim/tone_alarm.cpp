@@ -211,7 +211,8 @@ ToneAlarm::ToneAlarm() :
 	_default_tune_number(0),
 	_user_tune(nullptr),
 	_tune(nullptr),
-	_next(nullptr)
+	_next(nullptr),
+	_note_call{}
 {
 	// enable debug() calls
 	//_debug_enabled = true;
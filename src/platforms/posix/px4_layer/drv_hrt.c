@@ -35,17 +35,28 @@
  * @file drv_hrt.c
  *
  * High-resolution timer with callouts and timekeeping.
+ *
+ * Callouts are kept in a hierarchical timer wheel: HRT_WHEEL_LEVELS levels of
+ * HRT_WHEEL_SLOTS slots, level 0 slots being one tick of 2^HRT_WHEEL_TICK_SHIFT us
+ * and every level above covering a whole revolution of the one below.  Entries
+ * are filed by their deadline tick, so entering and cancelling a callout is
+ * O(1), and the entries of a higher level slot move down when the level below
+ * starts the revolution that slot covers.
+ *
+ * A dispatcher thread sleeps until the earliest deadline on a CLOCK_MONOTONIC
+ * condition variable and is woken up when an earlier callout is entered.
  */
 
-#include <px4_workqueue.h>
+#include <px4_tasks.h>
 #include <drivers/drv_hrt.h>
-#include <semaphore.h>
+#include <systemlib/perf_counter.h>
+#include <pthread.h>
 #include <time.h>
+#ifdef __PX4_LINUX
+#include <sys/prctl.h>
+#endif
 #include <string.h>
 #include <inttypes.h>
-#include "hrt_work.h"
-
-static struct sq_queue_s	callout_queue;
 
 /* latency histogram */
 #define LATENCY_BUCKET_COUNT 8
@@ -53,28 +64,41 @@ __EXPORT const uint16_t latency_bucket_count = LATENCY_BUCKET_COUNT;
 __EXPORT const uint16_t	latency_buckets[LATENCY_BUCKET_COUNT] = { 1, 2, 5, 10, 20, 50, 100, 1000 };
 __EXPORT uint32_t	latency_counters[LATENCY_BUCKET_COUNT + 1];
 
-static void		hrt_call_reschedule(void);
-
 // Intervals in usec
 #define HRT_INTERVAL_MIN	50
 #define HRT_INTERVAL_MAX	50000000
 
-static sem_t 	_hrt_lock;
-static struct work_s	_hrt_work;
+/* 64 us ticks, 64 slots per level, 4 levels cover 2^30 us (about 18 minutes) */
+#define HRT_WHEEL_TICK_SHIFT	6
+#define HRT_WHEEL_LEVEL_BITS	6
+#define HRT_WHEEL_SLOTS		(1 << HRT_WHEEL_LEVEL_BITS)
+#define HRT_WHEEL_SLOT_MASK	(HRT_WHEEL_SLOTS - 1)
+#define HRT_WHEEL_LEVELS	4
+#define HRT_WHEEL_RANGE		(1ULL << (HRT_WHEEL_LEVEL_BITS * HRT_WHEEL_LEVELS))
 
-static void
-hrt_call_invoke(void);
+/* slot list heads, circular with the head as sentinel */
+static struct dq_entry_s	wheel[HRT_WHEEL_LEVELS][HRT_WHEEL_SLOTS];
+
+/* bit n set if slot n of the level is not empty */
+static uint64_t		wheel_occupied[HRT_WHEEL_LEVELS];
+
+/* the current tick, all ticks before it have been expired */
+static uint64_t		wheel_tick;
+
+static pthread_mutex_t	_hrt_lock;
+static pthread_cond_t	_hrt_cond;
+static hrt_abstime	_hrt_wakeup;		/* deadline the dispatcher sleeps until, 0 if it is awake */
+static px4_task_t	_hrt_task = -1;
+static perf_counter_t	_hrt_latency_perf;
 
 static void hrt_lock(void)
 {
-	//printf("hrt_lock\n");
-	sem_wait(&_hrt_lock);
+	pthread_mutex_lock(&_hrt_lock);
 }
 
 static void hrt_unlock(void)
 {
-	//printf("hrt_unlock\n");
-	sem_post(&_hrt_lock);
+	pthread_mutex_unlock(&_hrt_lock);
 }
 
 /*
@@ -101,6 +125,15 @@ hrt_abstime ts_to_abstime(struct timespec *ts)
 	return result;
 }
 
+/*
+ * Convert absolute time to a timespec.
+ */
+void	abstime_to_ts(struct timespec *ts, hrt_abstime abstime)
+{
+	ts->tv_sec = abstime / 1000000;
+	ts->tv_nsec = (abstime % 1000000) * 1000;
+}
+
 /*
  * Compute the delta between a timestamp taken in the past
  * and now.
@@ -125,6 +158,193 @@ hrt_abstime hrt_store_absolute_time(volatile hrt_abstime *now)
 	return ts;
 }
 
+static inline uint64_t
+rotate_right(uint64_t bits, unsigned n)
+{
+	n &= 63;
+	return (n == 0) ? bits : (bits >> n) | (bits << (64 - n));
+}
+
+static void
+wheel_insert(struct hrt_call *entry)
+{
+	uint64_t tick = entry->deadline >> HRT_WHEEL_TICK_SHIFT;
+
+	/* overdue entries expire with the current tick */
+	if (tick < wheel_tick) {
+		tick = wheel_tick;
+	}
+
+	/* too far out, park it in the last slot in range, it is filed again from there */
+	if (tick - wheel_tick >= HRT_WHEEL_RANGE) {
+		tick = wheel_tick + HRT_WHEEL_RANGE - 1;
+	}
+
+	uint64_t delta = tick - wheel_tick;
+	unsigned level = 0;
+
+	while (level < HRT_WHEEL_LEVELS - 1 && delta >= (1ULL << (HRT_WHEEL_LEVEL_BITS * (level + 1)))) {
+		level++;
+	}
+
+	unsigned slot = (tick >> (HRT_WHEEL_LEVEL_BITS * level)) & HRT_WHEEL_SLOT_MASK;
+	struct dq_entry_s *head = &wheel[level][slot];
+
+	entry->link.flink = head;
+	entry->link.blink = head->blink;
+	head->blink->flink = &entry->link;
+	head->blink = &entry->link;
+
+	wheel_occupied[level] |= 1ULL << slot;
+}
+
+static void
+wheel_remove(struct hrt_call *entry)
+{
+	struct dq_entry_s *prev = entry->link.blink;
+	struct dq_entry_s *next = entry->link.flink;
+
+	prev->flink = next;
+	next->blink = prev;
+
+	entry->link.flink = NULL;
+	entry->link.blink = NULL;
+
+	/* only the head is left, clear the slot's bit */
+	if (prev == next) {
+		unsigned index = prev - &wheel[0][0];
+		wheel_occupied[index / HRT_WHEEL_SLOTS] &= ~(1ULL << (index % HRT_WHEEL_SLOTS));
+	}
+}
+
+/*
+ * Return the next tick from the current one on at which a level 0 slot has
+ * entries or a higher level slot has to move down, UINT64_MAX if the wheel
+ * is empty.  *cascade is set if it is the latter.
+ */
+static uint64_t
+wheel_next_tick(bool *cascade)
+{
+	uint64_t next = UINT64_MAX;
+
+	*cascade = false;
+
+	if (wheel_occupied[0] != 0) {
+		unsigned index = wheel_tick & HRT_WHEEL_SLOT_MASK;
+		next = wheel_tick + __builtin_ctzll(rotate_right(wheel_occupied[0], index));
+	}
+
+	for (unsigned level = 1; level < HRT_WHEEL_LEVELS; level++) {
+		if (wheel_occupied[level] == 0) {
+			continue;
+		}
+
+		/* the current slot moved down already, it is one revolution away */
+		unsigned shift = HRT_WHEEL_LEVEL_BITS * level;
+		unsigned index = (wheel_tick >> shift) & HRT_WHEEL_SLOT_MASK;
+		uint64_t distance = __builtin_ctzll(rotate_right(wheel_occupied[level], index + 1)) + 1;
+		uint64_t tick = ((wheel_tick >> shift) + distance) << shift;
+
+		if (tick <= next) {
+			next = tick;
+			*cascade = true;
+		}
+	}
+
+	return next;
+}
+
+/*
+ * Move to the given tick and file the entries of the higher level slots
+ * starting there into the levels below.
+ */
+static void
+wheel_advance(uint64_t tick)
+{
+	wheel_tick = tick;
+
+	for (unsigned level = 1; level < HRT_WHEEL_LEVELS; level++) {
+		unsigned shift = HRT_WHEEL_LEVEL_BITS * level;
+
+		if ((tick & ((1ULL << shift) - 1)) != 0) {
+			break;
+		}
+
+		unsigned slot = (tick >> shift) & HRT_WHEEL_SLOT_MASK;
+		struct dq_entry_s *head = &wheel[level][slot];
+
+		while (head->flink != head) {
+			struct hrt_call *entry = (struct hrt_call *)head->flink;
+			wheel_remove(entry);
+			wheel_insert(entry);
+		}
+	}
+}
+
+/*
+ * Remove and return an entry whose deadline has passed, NULL if there is none.
+ */
+static struct hrt_call *
+wheel_expire(hrt_abstime now)
+{
+	uint64_t now_tick = now >> HRT_WHEEL_TICK_SHIFT;
+
+	for (;;) {
+		struct dq_entry_s *head = &wheel[0][wheel_tick & HRT_WHEEL_SLOT_MASK];
+
+		for (struct dq_entry_s *link = head->flink; link != head; link = link->flink) {
+			struct hrt_call *entry = (struct hrt_call *)link;
+
+			if (entry->deadline <= now) {
+				wheel_remove(entry);
+				return entry;
+			}
+		}
+
+		if (wheel_tick >= now_tick) {
+			return NULL;
+		}
+
+		/* the current slot is empty, skip ahead to where there is something to do */
+		bool cascade;
+		uint64_t next = wheel_next_tick(&cascade);
+
+		wheel_advance((next < now_tick) ? next : now_tick);
+	}
+}
+
+/*
+ * Return the earliest deadline in the wheel, or the time at which a higher
+ * level slot moves down if that is earlier.
+ */
+static hrt_abstime
+wheel_next_deadline(void)
+{
+	bool cascade;
+	uint64_t tick = wheel_next_tick(&cascade);
+
+	if (tick == UINT64_MAX) {
+		return UINT64_MAX;
+	}
+
+	if (cascade) {
+		return tick << HRT_WHEEL_TICK_SHIFT;
+	}
+
+	/* all entries of a level 0 slot fall into the same tick */
+	struct dq_entry_s *head = &wheel[0][tick & HRT_WHEEL_SLOT_MASK];
+	hrt_abstime deadline = UINT64_MAX;
+
+	for (struct dq_entry_s *link = head->flink; link != head; link = link->flink) {
+		struct hrt_call *entry = (struct hrt_call *)link;
+
+		if (entry->deadline < deadline) {
+			deadline = entry->deadline;
+		}
+	}
+
+	return deadline;
+}
 
 /*
  * If this returns true, the entry has been invoked and removed from the callout list,
@@ -143,7 +363,12 @@ bool	hrt_called(struct hrt_call *entry)
 void	hrt_cancel(struct hrt_call *entry)
 {
 	hrt_lock();
-	sq_rem(&entry->link, &callout_queue);
+
+	/* the entry must have been zeroed, see hrt_call_internal() */
+	if (entry->link.flink != NULL) {
+		wheel_remove(entry);
+	}
+
 	entry->deadline = 0;
 
 	/* if this is a periodic call being removed by the callout, prevent it from
@@ -151,7 +376,6 @@ void	hrt_cancel(struct hrt_call *entry)
 	 */
 	entry->period = 0;
 	hrt_unlock();
-	// endif
 }
 
 /*
@@ -174,136 +398,179 @@ void	hrt_call_delay(struct hrt_call *entry, hrt_abstime delay)
 	entry->deadline = hrt_absolute_time() + delay;
 }
 
-/*
- * Initialise the HRT.
- */
-void	hrt_init(void)
+static void
+hrt_call_enter(struct hrt_call *entry)
 {
-	//printf("hrt_init\n");
-	sq_init(&callout_queue);
-	sem_init(&_hrt_lock, 0, 1);
-	memset(&_hrt_work, 0, sizeof(_hrt_work));
+	wheel_insert(entry);
+
+	/* wake up the dispatcher if it sleeps past the new deadline */
+	if (_hrt_wakeup != 0 && entry->deadline < _hrt_wakeup) {
+		pthread_cond_signal(&_hrt_cond);
+	}
 }
 
 static void
-hrt_call_enter(struct hrt_call *entry)
+hrt_latency_update(hrt_abstime latency)
 {
-	struct hrt_call	*call, *next;
+	unsigned index;
 
-	//PX4_INFO("hrt_call_enter");
-	call = (struct hrt_call *)sq_peek(&callout_queue);
+	perf_set(_hrt_latency_perf, (int64_t)latency);
 
-	if ((call == NULL) || (entry->deadline < call->deadline)) {
-		sq_addfirst(&entry->link, &callout_queue);
-		//if (call != NULL) PX4_INFO("call enter at head, reschedule (%lu %lu)", entry->deadline, call->deadline);
-		/* we changed the next deadline, reschedule the timer event */
-		hrt_call_reschedule();
+	for (index = 0; index < LATENCY_BUCKET_COUNT; index++) {
+		if (latency <= latency_buckets[index]) {
+			break;
+		}
+	}
 
-	} else {
-		do {
-			next = (struct hrt_call *)sq_next(&call->link);
+	latency_counters[index]++;
+}
 
-			if ((next == NULL) || (entry->deadline < next->deadline)) {
-				//lldbg("call enter after head\n");
-				sq_addafter(&call->link, &entry->link, &callout_queue);
-				break;
-			}
-		} while ((call = next) != NULL);
+/*
+ * Run an expired callout, called and returning with the lock held.
+ */
+static void
+hrt_call_invoke(struct hrt_call *call, hrt_abstime now)
+{
+	/* save the intended deadline for periodic calls */
+	hrt_abstime deadline = call->deadline;
+
+	hrt_latency_update(now - deadline);
+
+	/* zero the deadline, as the call has occurred */
+	call->deadline = 0;
+
+	/* invoke the callout (if there is one) */
+	if (call->callout) {
+		// Unlock so we don't deadlock in callback
+		hrt_unlock();
+
+		call->callout(call->arg);
+
+		hrt_lock();
 	}
 
-	//PX4_INFO("scheduled");
+	/* if the callout has a non-zero period, it has to be re-entered,
+	 * unless it entered itself again from the callout
+	 */
+	if (call->period != 0 && call->link.flink == NULL) {
+		// re-check call->deadline to allow for
+		// callouts to re-schedule themselves
+		// using hrt_call_delay()
+		if (call->deadline <= now) {
+			call->deadline = deadline + call->period;
+		}
+
+		hrt_call_enter(call);
+	}
 }
 
 /**
- * Timer interrupt handler
+ * Dispatcher thread
  *
- * This routine simulates a timer interrupt handler
+ * This routine takes the place of the timer interrupt handler.
  */
-static void 
-hrt_tim_isr(void *p)
+static int
+hrt_dispatcher(int argc, char *argv[])
 {
-
-	//PX4_INFO("hrt_tim_isr");
-	/* run any callouts that have met their deadline */
-	hrt_call_invoke();
+#ifdef __PX4_LINUX
+	/* the default 50 us timer slack would show up as callout latency */
+	prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
 
 	hrt_lock();
 
-	/* and schedule the next interrupt */
-	hrt_call_reschedule();
+	for (;;) {
+		hrt_abstime now = hrt_absolute_time();
+
+		/* run any callouts that have met their deadline */
+		struct hrt_call *call = wheel_expire(now);
+
+		if (call != NULL) {
+			hrt_call_invoke(call, now);
+			continue;
+		}
+
+		/* and sleep until the next one */
+		hrt_abstime deadline = wheel_next_deadline();
+
+		if (deadline > now + HRT_INTERVAL_MAX) {
+			deadline = now + HRT_INTERVAL_MAX;
+		}
+
+		struct timespec ts;
+		abstime_to_ts(&ts, deadline);
+
+		_hrt_wakeup = deadline;
+		pthread_cond_timedwait(&_hrt_cond, &_hrt_lock, &ts);
+		_hrt_wakeup = 0;
+	}
 
 	hrt_unlock();
+
+	return PX4_OK;
 }
 
-/**
- * Reschedule the next timer interrupt.
- *
- * This routine must be called with interrupts disabled.
+/*
+ * Initialise the HRT.
  */
-static void
-hrt_call_reschedule()
+void	hrt_init(void)
 {
-	hrt_abstime	now = hrt_absolute_time();
-	hrt_abstime	delay = HRT_INTERVAL_MAX;
-	struct hrt_call	*next = (struct hrt_call *)sq_peek(&callout_queue);
-	hrt_abstime	deadline = now + HRT_INTERVAL_MAX;
-
-	//PX4_INFO("hrt_call_reschedule");
-	
-	/*
-	 * Determine what the next deadline will be.
-	 *
-	 * Note that we ensure that this will be within the counter
-	 * period, so that when we truncate all but the low 16 bits
-	 * the next time the compare matches it will be the deadline
-	 * we want.
-	 *
-	 * It is important for accurate timekeeping that the compare
-	 * interrupt fires sufficiently often that the base_time update in
-	 * hrt_absolute_time runs at least once per timer period.
-	 */
-	if (next != NULL) {
-		//lldbg("entry in queue\n");
-		if (next->deadline <= (now + HRT_INTERVAL_MIN)) {
-			//lldbg("pre-expired\n");
-			/* set a minimal deadline so that we call ASAP */
-			delay = HRT_INTERVAL_MIN;
-
-		} else if (next->deadline < deadline) {
-			//lldbg("due soon\n");
-			delay = next->deadline - now;
+	pthread_condattr_t attr;
+
+	for (unsigned level = 0; level < HRT_WHEEL_LEVELS; level++) {
+		for (unsigned slot = 0; slot < HRT_WHEEL_SLOTS; slot++) {
+			wheel[level][slot].flink = &wheel[level][slot];
+			wheel[level][slot].blink = &wheel[level][slot];
 		}
+
+		wheel_occupied[level] = 0;
 	}
 
-	// There is no timer ISR, so simulate one by putting an event on the 
-	// high priority work queue
+	wheel_tick = hrt_absolute_time() >> HRT_WHEEL_TICK_SHIFT;
+	_hrt_wakeup = 0;
+
+	pthread_mutex_init(&_hrt_lock, NULL);
+
+	/* sleep on the clock hrt_absolute_time() reads */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&_hrt_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	_hrt_latency_perf = perf_alloc(PC_HISTOGRAM, "hrt_latency");
 
-	// Remove the existing expiry and update with the new expiry
-	hrt_work_cancel(&_hrt_work);
+	_hrt_task = px4_task_spawn_cmd("hrt_disp",
+				       SCHED_DEFAULT,
+				       SCHED_PRIORITY_MAX,
+				       2000,
+				       hrt_dispatcher,
+				       (char *const *)NULL);
 
-        hrt_work_queue(&_hrt_work, (worker_t)&hrt_tim_isr, NULL, delay);
+	if (_hrt_task < 0) {
+		PX4_ERR("hrt_init: failed to start dispatcher");
+	}
 }
 
 static void
 hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime interval, hrt_callout callout, void *arg)
 {
-	//PX4_INFO("hrt_call_internal deadline=%lu interval = %lu", deadline, interval);
 	hrt_lock();
-	//PX4_INFO("hrt_call_internal after lock");
+
 	/* if the entry is currently queued, remove it */
-	/* note that we are using a potentially uninitialised
-	   entry->link here, but it is safe as sq_rem() doesn't
-	   dereference the passed node unless it is found in the
-	   list. So we potentially waste a bit of time searching the
-	   queue for the uninitialised entry->link but we don't do
-	   anything actually unsafe.
+	/* note that unlike the old sorted list, which searched the queue
+	   for the entry, the wheel unlinks it through its own link
+	   pointers. An uninitialised entry is therefore NOT allowed, it
+	   has to be zeroed (static storage, hrt_call_init() or a value
+	   initialiser) before it is first passed in here.
 	*/
-	if (entry->deadline != 0)
-		sq_rem(&entry->link, &callout_queue);
+	if (entry->link.flink != NULL) {
+		wheel_remove(entry);
+	}
 
-	if (interval < HRT_INTERVAL_MIN) {
+	if (interval != 0 && interval < HRT_INTERVAL_MIN) {
 		PX4_ERR("hrt_call_internal interval too short: %" PRIu64, interval);
 	}
+
 	entry->deadline = deadline;
 	entry->period = interval;
 	entry->callout = callout;
@@ -321,7 +588,6 @@ hrt_call_internal(struct hrt_call *entry, hrt_abstime deadline, hrt_abstime inte
  */
 void	hrt_call_after(struct hrt_call *entry, hrt_abstime delay, hrt_callout callout, void *arg)
 {
-	//printf("hrt_call_after\n");
 	hrt_call_internal(entry,
 			  hrt_absolute_time() + delay,
 			  0,
@@ -351,66 +617,3 @@ void	hrt_call_at(struct hrt_call *entry, hrt_abstime calltime, hrt_callout callo
 {
 	hrt_call_internal(entry, calltime, 0, callout, arg);
 }
-
-#if 0
-/*
- * Convert absolute time to a timespec.
- */
-void	abstime_to_ts(struct timespec *ts, hrt_abstime abstime);
-#endif
-
-static void
-hrt_call_invoke(void)
-{
-	struct hrt_call	*call;
-	hrt_abstime deadline;
-
-	hrt_lock();
-	while (true) {
-		/* get the current time */
-		hrt_abstime now = hrt_absolute_time();
-
-		call = (struct hrt_call *)sq_peek(&callout_queue);
-
-		if (call == NULL)
-			break;
-
-		if (call->deadline > now)
-			break;
-
-		sq_rem(&call->link, &callout_queue);
-		//PX4_INFO("call pop");
-
-		/* save the intended deadline for periodic calls */
-		deadline = call->deadline;
-
-		/* zero the deadline, as the call has occurred */
-		call->deadline = 0;
-
-		/* invoke the callout (if there is one) */
-		if (call->callout) {
-			// Unlock so we don't deadlock in callback
-			hrt_unlock();
-
-			//PX4_INFO("call %p: %p(%p)", call, call->callout, call->arg);
-			call->callout(call->arg);
-
-			hrt_lock();
-		}
-
-		/* if the callout has a non-zero period, it has to be re-entered */
-		if (call->period != 0) {
-			// re-check call->deadline to allow for
-			// callouts to re-schedule themselves
-			// using hrt_call_delay()
-			if (call->deadline <= now) {
-				call->deadline = deadline + call->period;
-				//PX4_INFO("call deadline set to %lu now=%lu", call->deadline,  now);
-			}
-
-			hrt_call_enter(call);
-		}
-	}
-	hrt_unlock();
-}
-
@@ -48,6 +48,7 @@
 #include <drivers/drv_hrt.h>
 #include <px4_workqueue.h>
 #include "hrt_work.h"
+#include "work_pqueue.h"
 
 #ifdef CONFIG_SCHED_WORKQUEUE
 
@@ -113,17 +114,19 @@ int hrt_work_queue(struct work_s *work, worker_t worker, void *arg, uint32_t del
   work->arg    = arg;              /* Callback argument */
   work->delay  = delay;            /* Delay until work performed */
 
-  /* Now, time-tag that entry and put it in the work queue.  This must be
-   * done with interrupts disabled.  This permits this function to be called
-   * from with task logic or interrupt handlers.
+  /* Now, time-tag that entry and put it in the work queue.  This permits
+   * this function to be called from any task.
    */
 
   hrt_work_lock();
   work->qtime  = hrt_absolute_time(); /* Time work queued */
-  //PX4_INFO("hrt work_queue adding work delay=%u time=%lu", delay, work->qtime);
 
-  dq_addlast((dq_entry_t *)work, &wqueue->q);
-  px4_task_kill(wqueue->pid, SIGCONT);      /* Wake up the worker thread */
+  if (work_insert(&wqueue->q, work))
+    {
+      /* Wake up the worker thread, it sleeps until the previous head is due */
+
+      pthread_cond_signal(&_hrt_work_cond);
+    }
 
   hrt_work_unlock();
   return PX4_OK;
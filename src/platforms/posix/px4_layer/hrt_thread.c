@@ -46,7 +46,9 @@
 #include <queue.h>
 #include <px4_workqueue.h>
 #include <drivers/drv_hrt.h>
+#include <systemlib/perf_counter.h>
 #include "hrt_work.h"
+#include "work_pqueue.h"
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -66,7 +68,11 @@ struct wqueue_s g_hrt_work;
 /****************************************************************************
  * Private Variables
  ****************************************************************************/
-sem_t _hrt_work_lock;
+pthread_mutex_t _hrt_work_lock;
+pthread_cond_t _hrt_work_cond;
+
+/* How late work runs after it is due */
+static perf_counter_t _hrt_work_latency;
 
 /****************************************************************************
  * Private Functions
@@ -93,99 +99,68 @@ static void hrt_work_process()
   volatile FAR struct work_s *work;
   worker_t  worker;
   FAR void *arg;
-  uint64_t elapsed;
-  uint32_t remaining;
-  uint32_t next;
+  uint64_t now;
+  uint64_t due = 0;
+  struct timespec ts;
 
-  /* Then process queued work.  We need to keep interrupts disabled while
-   * we process items in the work list.
+  /* Then process queued work.  The queue is ordered by due time, so only
+   * the head needs to be looked at.
    */
 
-  /* Default to sleeping for 1 sec */
-  next  = 1000000; 
-
   hrt_work_lock();
 
-  work  = (FAR struct work_s *)wqueue->q.head;
-  while (work)
+  while ((work = (FAR struct work_s *)wqueue->q.head) != NULL &&
+         (due = work_due(work)) <= (now = hrt_absolute_time()))
     {
-      /* Is this work ready?  It is ready if there is no delay or if
-       * the delay has elapsed. qtime is the time that the work was added
-       * to the work queue.  It will always be greater than or equal to
-       * zero.  Therefore a delay of zero will always execute immediately.
-       */
-
-      elapsed = hrt_absolute_time() - work->qtime;
-      //PX4_INFO("hrt work_process: in usec elapsed=%lu delay=%u work=%p", elapsed, work->delay, work);
-      if (elapsed >= work->delay)
-        {
-          /* Remove the ready-to-execute work from the list */
+      /* Remove the ready-to-execute work from the list */
 
-          (void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
-	  //PX4_INFO("Dequeued work=%p", work);
+      (void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
 
-          /* Extract the work description from the entry (in case the work
-           * instance by the re-used after it has been de-queued).
-           */
-
-          worker = work->worker;
-          arg    = work->arg;
+      /* Extract the work description from the entry (in case the work
+       * instance by the re-used after it has been de-queued).
+       */
 
-          /* Mark the work as no longer being queued */
+      worker = work->worker;
+      arg    = work->arg;
 
-          work->worker = NULL;
+      /* Mark the work as no longer being queued */
 
-          /* Do the work.  Re-enable interrupts while the work is being
-           * performed... we don't have any idea how long that will take!
-           */
+      work->worker = NULL;
 
-          hrt_work_unlock();
-	  if (!worker) {
-             PX4_ERR("MESSED UP: worker = 0");
-          }
-          else {
-            worker(arg);
-          }
+      perf_set(_hrt_work_latency, (int64_t)(now - due));
 
-          /* Now, unfortunately, since we re-enabled interrupts we don't
-           * know the state of the work list and we will have to start
-           * back at the head of the list.
-           */
+      /* Do the work.  Unlock while the work is being performed... we
+       * don't have any idea how long that will take!
+       */
 
-          hrt_work_lock();
-          work  = (FAR struct work_s *)wqueue->q.head;
+      hrt_work_unlock();
+      if (!worker)
+        {
+          PX4_ERR("MESSED UP: worker = 0");
         }
       else
         {
-          /* This one is not ready.. will it be ready before the next
-           * scheduled wakeup interval?
-           */
-
-          /* Here: elapsed < work->delay */
-          remaining = work->delay - elapsed;
-          //PX4_INFO("remaining=%u delay=%u elapsed=%lu", remaining, work->delay, elapsed);
-          if (remaining < next)
-            {
-              /* Yes.. Then schedule to wake up when the work is ready */
-
-              next = remaining;
-            }
-              
-          /* Then try the next in the list. */
-
-          work = (FAR struct work_s *)work->dq.flink;
-          //PX4_INFO("next %u work %p", next, work);
+          worker(arg);
         }
+
+      hrt_work_lock();
     }
 
-  /* Wait awhile to check the work list.  We will wait here until either
-   * the time elapses or until we are awakened by a signal.
+  /* Wait until the head is due or until hrt_work_queue() puts new work at the
+   * head.
    */
-  hrt_work_unlock();
 
-  /* might sleep less if a signal received and new item was queued */
-  //PX4_INFO("Sleeping for %u usec", next);
-  usleep(next);
+  if (work == NULL)
+    {
+      pthread_cond_wait(&_hrt_work_cond, &_hrt_work_lock);
+    }
+  else
+    {
+      abstime_to_ts(&ts, due);
+      pthread_cond_timedwait(&_hrt_work_cond, &_hrt_work_lock, &ts);
+    }
+
+  hrt_work_unlock();
 }
 
 /****************************************************************************
@@ -215,6 +190,8 @@ static void hrt_work_process()
 
 static int work_hrtthread(int argc, char *argv[])
 {
+  work_set_timer_slack();
+
   /* Loop forever */
 
   for (;;)
@@ -242,7 +219,16 @@ static int work_hrtthread(int argc, char *argv[])
 
 void hrt_work_queue_init(void)
 {
-	sem_init(&_hrt_work_lock, 0, 1);
+	pthread_condattr_t attr;
+
+	/* wait on the clock the due times are taken from */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_mutex_init(&_hrt_work_lock, NULL);
+	pthread_cond_init(&_hrt_work_cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	_hrt_work_latency = perf_alloc(PC_HISTOGRAM, "wq_hrt_latency");
 
 	// Create high priority worker thread
 	g_hrt_work.pid = px4_task_spawn_cmd("wkr_hrt",
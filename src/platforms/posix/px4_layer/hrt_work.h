@@ -32,14 +32,15 @@
  ****************************************************************************/
 
 #include <px4_log.h>
-#include <semaphore.h>
+#include <pthread.h>
 #include <px4_workqueue.h>
 
 #pragma once
 
 __BEGIN_DECLS
 
-extern sem_t _hrt_work_lock;
+extern pthread_mutex_t _hrt_work_lock;
+extern pthread_cond_t _hrt_work_cond;	/* signalled when work is queued at the head */
 extern struct wqueue_s g_hrt_work;
 
 void hrt_work_queue_init(void);
@@ -52,13 +53,13 @@ inline void hrt_work_unlock(void);
 inline void hrt_work_lock()
 {
 	//PX4_INFO("hrt_work_lock");
-	sem_wait(&_hrt_work_lock);
+	pthread_mutex_lock(&_hrt_work_lock);
 }
 
 inline void hrt_work_unlock()
 {
 	//PX4_INFO("hrt_work_unlock");
-	sem_post(&_hrt_work_lock);
+	pthread_mutex_unlock(&_hrt_work_lock);
 }
 
 __END_DECLS
@@ -44,6 +44,7 @@ SRCS		 = 	\
 			work_thread.c \
 			work_queue.c \
 			work_cancel.c \
+			work_pool.c \
 			lib_crc32.c \
 			drv_hrt.c \
 			queue.c \
@@ -40,6 +40,7 @@
 #include <px4_defines.h>
 #include <px4_middleware.h>
 #include <px4_workqueue.h>
+#include <px4_tasks.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -63,6 +64,7 @@ void init_once(void);
 
 void init_once(void)
 {
+	px4_tasks_init();
 	work_queues_init();
 	hrt_work_queue_init();
 	hrt_init();
@@ -35,8 +35,16 @@
 /**
  * @file px4_posix_tasks.c
  * Implementation of existing task API for Linux
+ *
+ * Tasks are threads of the one process. Every task records its kernel
+ * thread id and the scheduling it actually got, so that px4_task_stats()
+ * can report per task CPU time and run queue delay for top.
  */
 
+#if defined(__PX4_LINUX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE	/* pthread_attr_setaffinity_np */
+#endif
+
 #include <px4_log.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -48,39 +56,82 @@
 #include <sched.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
+#include <alloca.h>
+#include <malloc.h>
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/syscall.h>
 #include <string>
 
 #include <px4_tasks.h>
 
 #define MAX_CMD_LEN 100
 
+/* stack size of every task while memory is locked, the NuttX sizes passed in do not fit glibc */
+#define PX4_LOCKED_STACK_SIZE (256 * 1024)
+
 #define PX4_MAX_TASKS 100
 struct task_entry
 {
 	pthread_t pid;
+	pid_t tid;		// kernel thread id, 0 until the task runs
 	std::string name;
 	bool isused;
-	task_entry() : isused(false) {}
+	int policy;		// scheduling in effect, SCHED_OTHER if real-time was refused
+	int priority;
+	bool rt_refused;
+	uint32_t cpu_mask;	// CPUs the task may run on, 0 if not pinned
+	task_entry() : pid(0), tid(0), isused(false), policy(SCHED_OTHER), priority(0), rt_refused(false), cpu_mask(0) {}
 };
 
 static task_entry taskmap[PX4_MAX_TASKS];
+static pthread_mutex_t task_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool memory_locked = false;
+static size_t prefault_stack_size = 0;
 
 typedef struct 
 {
 	px4_main_t entry;
+	int index;
 	int argc;
 	char *argv[];
 	// strings are allocated after the 
 } pthdata_t;
 
+/*
+ * Touch the top of the stack of the calling task, so that it does not page
+ * fault later on in its loop.
+ */
+static void __attribute__((noinline)) prefault_stack(size_t size)
+{
+	volatile char *stack = (volatile char *)alloca(size);
+	long page = sysconf(_SC_PAGESIZE);
+
+	for (size_t i = 0; i < size; i += page) {
+		stack[i] = 0;
+	}
+}
+
 static void *entry_adapter ( void *ptr )
 {
 	pthdata_t *data;            
 	data = (pthdata_t *) ptr;  
 
+	pthread_mutex_lock(&task_mutex);
+	taskmap[data->index].pid = pthread_self();
+#ifdef __PX4_LINUX
+	taskmap[data->index].tid = syscall(SYS_gettid);
+#endif
+	pthread_mutex_unlock(&task_mutex);
+
+	if (prefault_stack_size > 0) {
+		prefault_stack(prefault_stack_size);
+	}
+
 	data->entry(data->argc, data->argv);
 	free(ptr);
 	PX4_DEBUG("Before px4_task_exit");
@@ -96,6 +147,99 @@ px4_systemreset(bool to_bootloader)
 	PX4_WARN("Called px4_system_reset");
 }
 
+void px4_tasks_init(void)
+{
+	const char *lock = getenv("PX4_MLOCKALL");
+	const char *prefault = getenv("PX4_PREFAULT_STACK");
+
+	if (lock != NULL && atoi(lock) != 0) {
+		/* keep freed heap mapped rather than faulting it in again */
+		mallopt(M_TRIM_THRESHOLD, -1);
+		mallopt(M_MMAP_MAX, 0);
+
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+			memory_locked = true;
+
+		} else {
+			PX4_WARN("px4_tasks_init: mlockall failed (%d), memory is not locked", errno);
+		}
+	}
+
+	if (prefault != NULL) {
+		prefault_stack_size = strtoul(prefault, NULL, 0) * 1024;
+	}
+
+	// the stack size tasks are created with, see px4_task_spawn_cmd
+	size_t stack_size = PX4_LOCKED_STACK_SIZE;
+
+	if (!memory_locked) {
+		pthread_attr_t attr;
+
+		if (pthread_attr_init(&attr) == 0) {
+			if (pthread_attr_getstacksize(&attr, &stack_size) != 0) {
+				stack_size = PX4_LOCKED_STACK_SIZE;
+			}
+
+			pthread_attr_destroy(&attr);
+		}
+	}
+
+	// leave half of the stack for the frames below and the task itself
+	if (prefault_stack_size > stack_size / 2) {
+		prefault_stack_size = stack_size / 2;
+	}
+}
+
+/*
+ * Default CPU mask of a task from PX4_TASK_AFFINITY=name=mask[,name=mask...],
+ * where the name "*" matches every task, 0 if none applies.
+ */
+static uint32_t task_affinity_default(const char *name)
+{
+	const char *spec = getenv("PX4_TASK_AFFINITY");
+	uint32_t mask = 0;
+	size_t len = strlen(name);
+
+	while (spec != NULL && *spec != '\0') {
+		const char *equal = strchr(spec, '=');
+
+		if (equal == NULL) {
+			break;
+		}
+
+		size_t key_len = equal - spec;
+
+		if (key_len == len && strncmp(spec, name, len) == 0) {
+			return strtoul(equal + 1, NULL, 0);
+		}
+
+		if (key_len == 1 && *spec == '*') {
+			mask = strtoul(equal + 1, NULL, 0);
+		}
+
+		spec = strchr(equal, ',');
+
+		if (spec != NULL) {
+			spec++;
+		}
+	}
+
+	return mask;
+}
+
+#ifdef __PX4_LINUX
+static void cpu_mask_to_set(uint32_t cpu_mask, cpu_set_t *set)
+{
+	CPU_ZERO(set);
+
+	for (unsigned cpu = 0; cpu < 32; cpu++) {
+		if (cpu_mask & (1u << cpu)) {
+			CPU_SET(cpu, set);
+		}
+	}
+}
+#endif
+
 px4_task_t px4_task_spawn_cmd(const char *name, int scheduler, int priority, int stack_size, px4_main_t entry, char * const argv[])
 {
 	int rv;
@@ -109,6 +253,7 @@ px4_task_t px4_task_spawn_cmd(const char *name, int scheduler, int priority, int
         pthread_t task;
 	pthread_attr_t attr;
 	struct sched_param param;
+	uint32_t cpu_mask = task_affinity_default(name);
 
 	// Calculate argc
 	while (p != (char *)0) {
@@ -129,7 +274,6 @@ px4_task_t px4_task_spawn_cmd(const char *name, int scheduler, int priority, int
 	taskdata->argc = argc;
 
 	for (i=0; i<argc; i++) {
-		printf("arg %d %s\n", i, argv[i]);
 		taskdata->argv[i] = (char *)offset;
 		strcpy((char *)offset, argv[i]);
 		offset+=strlen(argv[i])+1;
@@ -137,20 +281,41 @@ px4_task_t px4_task_spawn_cmd(const char *name, int scheduler, int priority, int
 	// Must add NULL at end of argv
 	taskdata->argv[argc] = (char *)0;
 
+	// Reserve the task slot before the task can run and look itself up
+	pthread_mutex_lock(&task_mutex);
+	for (i=0; i<PX4_MAX_TASKS; ++i) {
+		if (taskmap[i].isused == false) {
+			taskmap[i] = task_entry();
+			taskmap[i].name = name;
+			taskmap[i].isused = true;
+			taskmap[i].policy = scheduler;
+			taskmap[i].priority = priority;
+			taskmap[i].cpu_mask = cpu_mask;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&task_mutex);
+
+	if (i>=PX4_MAX_TASKS) {
+		free(taskdata);
+		return -ENOSPC;
+	}
+	taskdata->index = i;
+
 	rv = pthread_attr_init(&attr);
 	if (rv != 0) {
 		PX4_WARN("px4_task_spawn_cmd: failed to init thread attrs");
-		return (rv < 0) ? rv : -rv;
+		goto fail;
 	}
 	rv = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
 	if (rv != 0) {
 		PX4_WARN("px4_task_spawn_cmd: failed to set inherit sched");
-		return (rv < 0) ? rv : -rv;
+		goto fail_attr;
 	}
 	rv = pthread_attr_setschedpolicy(&attr, scheduler);
 	if (rv != 0) {
 		PX4_WARN("px4_task_spawn_cmd: failed to set sched policy");
-		return (rv < 0) ? rv : -rv;
+		goto fail_attr;
 	}
 
 	param.sched_priority = priority;
@@ -158,37 +323,167 @@ px4_task_t px4_task_spawn_cmd(const char *name, int scheduler, int priority, int
 	rv = pthread_attr_setschedparam(&attr, &param);
 	if (rv != 0) {
 		PX4_WARN("px4_task_spawn_cmd: failed to set sched param");
-		return (rv < 0) ? rv : -rv;
+		goto fail_attr;
 	}
 
-        rv = pthread_create (&task, &attr, &entry_adapter, (void *) taskdata);
-	if (rv != 0) {
+	if (memory_locked) {
+		// all of a locked stack is resident, do not lock the 8 MB default
+		pthread_attr_setstacksize(&attr, PX4_LOCKED_STACK_SIZE);
+	}
 
-		if (rv == EPERM) {
-			//printf("WARNING: NOT RUNING AS ROOT, UNABLE TO RUN REALTIME THREADS\n");
-        		rv = pthread_create (&task, NULL, &entry_adapter, (void *) taskdata);
-			if (rv != 0) {
-				PX4_ERR("px4_task_spawn_cmd: failed to create thread %d %d\n", rv, errno);
-				return (rv < 0) ? rv : -rv;
-			}
-		}
-		else {
-			return (rv < 0) ? rv : -rv;
+#ifdef __PX4_LINUX
+	if (cpu_mask != 0) {
+		cpu_set_t cpus;
+		cpu_mask_to_set(cpu_mask, &cpus);
+		rv = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+		if (rv != 0) {
+			PX4_WARN("px4_task_spawn_cmd: %s: failed to set affinity 0x%x", name, cpu_mask);
+			pthread_mutex_lock(&task_mutex);
+			taskmap[i].cpu_mask = 0;
+			pthread_mutex_unlock(&task_mutex);
 		}
 	}
+#endif
 
-	for (i=0; i<PX4_MAX_TASKS; ++i) {
-		if (taskmap[i].isused == false) {
-			taskmap[i].pid = task;
-			taskmap[i].name = name;
-			taskmap[i].isused = true;
-			break;
+        rv = pthread_create (&task, &attr, &entry_adapter, (void *) taskdata);
+	if (rv == EPERM && scheduler != SCHED_OTHER) {
+		// No permission for real-time scheduling: keep the other attributes, and say so
+		static bool warned = false;
+		if (!warned) {
+			PX4_WARN("px4_task_spawn_cmd: not permitted to use real-time scheduling, tasks run with SCHED_OTHER");
+			warned = true;
 		}
+
+		pthread_mutex_lock(&task_mutex);
+		taskmap[i].policy = SCHED_OTHER;
+		taskmap[i].priority = 0;
+		taskmap[i].rt_refused = true;
+		pthread_mutex_unlock(&task_mutex);
+
+		param.sched_priority = 0;
+		pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+		pthread_attr_setschedparam(&attr, &param);
+        	rv = pthread_create (&task, &attr, &entry_adapter, (void *) taskdata);
 	}
-	if (i>=PX4_MAX_TASKS) {
-		return -ENOSPC;
+	if (rv != 0) {
+		PX4_ERR("px4_task_spawn_cmd: failed to create thread %d %d\n", rv, errno);
+		goto fail_attr;
 	}
+
+	// entry_adapter records the pid itself: by now the task may already have
+	// exited and its slot been handed to another spawn
+	pthread_attr_destroy(&attr);
+
         return i;
+
+fail_attr:
+	pthread_attr_destroy(&attr);
+fail:
+	free(taskdata);
+	pthread_mutex_lock(&task_mutex);
+	taskmap[i].isused = false;
+	pthread_mutex_unlock(&task_mutex);
+	return (rv < 0) ? rv : -rv;
+}
+
+int px4_task_set_affinity(px4_task_t id, uint32_t cpu_mask)
+{
+#ifdef __PX4_LINUX
+	cpu_set_t cpus;
+	int rv = -EINVAL;
+
+	if (cpu_mask == 0) {
+		// any CPU
+		cpu_mask = ~0u;
+	}
+	cpu_mask_to_set(cpu_mask, &cpus);
+
+	pthread_mutex_lock(&task_mutex);
+	if (id >= 0 && id < PX4_MAX_TASKS && taskmap[id].isused) {
+		rv = -pthread_setaffinity_np(taskmap[id].pid, sizeof(cpus), &cpus);
+		if (rv == 0) {
+			taskmap[id].cpu_mask = (cpu_mask == ~0u) ? 0 : cpu_mask;
+		}
+	}
+	pthread_mutex_unlock(&task_mutex);
+
+	return rv;
+#else
+	return -ENOSYS;
+#endif
+}
+
+/*
+ * Read the time a thread waited on a run queue and the number of times it
+ * was scheduled from /proc, needs a kernel with CONFIG_SCHEDSTATS.
+ */
+static bool task_schedstat(pid_t tid, uint64_t *run_delay, uint64_t *wakeups)
+{
+#ifdef __PX4_LINUX
+	char path[48];
+	unsigned long long runtime_ns, delay_ns, slices;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", (int)tid);
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL) {
+		return false;
+	}
+
+	int n = fscanf(f, "%llu %llu %llu", &runtime_ns, &delay_ns, &slices);
+	fclose(f);
+
+	if (n != 3) {
+		return false;
+	}
+
+	*run_delay = delay_ns / 1000;
+	*wakeups = slices;
+	return true;
+#else
+	return false;
+#endif
+}
+
+int px4_task_stats(px4_task_stats_t *stats, int max)
+{
+	int count = 0;
+
+	pthread_mutex_lock(&task_mutex);
+
+	for (int i=0; i<PX4_MAX_TASKS && count<max; ++i) {
+		if (!taskmap[i].isused || taskmap[i].tid == 0) {
+			continue;
+		}
+
+		px4_task_stats_t *s = &stats[count];
+		clockid_t clock;
+		struct timespec ts;
+
+		// the CPU time clock of the task, what CLOCK_THREAD_CPUTIME_ID is within it
+		if (pthread_getcpuclockid(taskmap[i].pid, &clock) != 0 || clock_gettime(clock, &ts) != 0) {
+			continue;
+		}
+
+		s->id = i;
+		strncpy(s->name, taskmap[i].name.c_str(), sizeof(s->name) - 1);
+		s->name[sizeof(s->name) - 1] = '\0';
+		s->policy = taskmap[i].policy;
+		s->priority = taskmap[i].priority;
+		s->rt_refused = taskmap[i].rt_refused;
+		s->cpu_mask = taskmap[i].cpu_mask;
+		s->cpu_time = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+		s->schedstat = task_schedstat(taskmap[i].tid, &s->run_delay, &s->wakeups);
+		if (!s->schedstat) {
+			s->run_delay = 0;
+			s->wakeups = 0;
+		}
+		count++;
+	}
+
+	pthread_mutex_unlock(&task_mutex);
+
+	return count;
 }
 
 int px4_task_delete(px4_task_t id)
@@ -197,21 +492,23 @@ int px4_task_delete(px4_task_t id)
 	pthread_t pid;
 	PX4_WARN("Called px4_task_delete");
 
-	if (id < PX4_MAX_TASKS && taskmap[id].isused)
+	pthread_mutex_lock(&task_mutex);
+	if (id < PX4_MAX_TASKS && taskmap[id].isused) {
 		pid = taskmap[id].pid;
-	else
+	} else {
+		pthread_mutex_unlock(&task_mutex);
 		return -EINVAL;
+	}
+	taskmap[id].isused = false;
+	pthread_mutex_unlock(&task_mutex);
 
 	// If current thread then exit, otherwise cancel
         if (pthread_self() == pid) {
-		taskmap[id].isused = false;
 		pthread_exit(0);
 	} else {
 		rv = pthread_cancel(pid);
 	}
 
-	taskmap[id].isused = false;
-
 	return rv;
 }
 
@@ -221,12 +518,14 @@ void px4_task_exit(int ret)
 	pthread_t pid = pthread_self();
 
 	// Get pthread ID from the opaque ID
+	pthread_mutex_lock(&task_mutex);
 	for (i=0; i<PX4_MAX_TASKS; ++i) {
-		if (taskmap[i].pid == pid) {
+		if (taskmap[i].isused && taskmap[i].pid == pid) {
 			taskmap[i].isused = false;
 			break;
 		}
 	}
+	pthread_mutex_unlock(&task_mutex);
 	if (i>=PX4_MAX_TASKS)  {
 		PX4_ERR("px4_task_exit: self task not found!");
 	}
@@ -260,6 +559,7 @@ void px4_show_tasks()
 	int count = 0;
 
 	PX4_INFO("Active Tasks:");
+	pthread_mutex_lock(&task_mutex);
 	for (idx=0; idx < PX4_MAX_TASKS; idx++)
 	{
 		if (taskmap[idx].isused) {
@@ -267,6 +567,7 @@ void px4_show_tasks()
 			count++;
 		}
 	}
+	pthread_mutex_unlock(&task_mutex);
 	if (count == 0)
 		PX4_INFO("   No running tasks");
 
@@ -42,6 +42,7 @@
 #include <queue.h>
 #include <px4_workqueue.h>
 #include "work_lock.h"
+#include "work_pool.h"
 
 #ifdef CONFIG_SCHED_WORKQUEUE
 
@@ -88,9 +89,21 @@
 
 int work_cancel(int qid, struct work_s *work)
 {
-  struct wqueue_s *wqueue = &g_work[qid];
+  struct wqueue_s *wqueue;
 
-  //DEBUGASSERT(work != NULL && (unsigned)qid < NWORKERS);
+  //DEBUGASSERT(work != NULL && (unsigned)qid <= NWORKERS);
+
+  if (qid == POOLWORK)
+    {
+      if (work_pool_enabled())
+        {
+          return work_pool_cancel(work);
+        }
+
+      qid = HPWORK;
+    }
+
+  wqueue = &g_work[qid];
 
   /* Cancelling the work is simply a matter of removing the work structure
    * from the work queue.  This must be done with interrupts disabled because
@@ -31,23 +31,23 @@
  *
  ****************************************************************************/
 
-#include <semaphore.h>
+#include <pthread.h>
 #include <stdio.h>
 
 #pragma once
-extern sem_t _work_lock[];
+extern pthread_mutex_t _work_lock[];
+extern pthread_cond_t _work_cond[];	/* signalled when work is queued at the head */
 
 inline void work_lock(int id);
 inline void work_lock(int id)
 {
 	//printf("work_lock %d\n", id);
-	sem_wait(&_work_lock[id]);
+	pthread_mutex_lock(&_work_lock[id]);
 }
 
 inline void work_unlock(int id);
 inline void work_unlock(int id)
 {
 	//printf("work_unlock %d\n", id);
-	sem_post(&_work_lock[id]);
+	pthread_mutex_unlock(&_work_lock[id]);
 }
-
@@ -0,0 +1,418 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file work_pool.c
+ *
+ * Pool of worker threads behind the POOLWORK queue.
+ *
+ * Every worker has its own queue ordered by due time.  Work queued from a
+ * worker stays on that worker, other work is spread round robin.  A worker
+ * with nothing due in its own queue steals due work from the queue of a
+ * worker that is busy running something else.
+ *
+ * Work never runs concurrently with itself: work queued while it runs goes
+ * to the queue of the worker running it, and is never stolen from there
+ * while it still runs.
+ */
+
+#ifdef __PX4_LINUX
+#define _GNU_SOURCE	/* pthread_setaffinity_np */
+#endif
+
+#include <px4_config.h>
+#include <px4_defines.h>
+#include <px4_tasks.h>
+#include <px4_log.h>
+#include <drivers/drv_hrt.h>
+#include <systemlib/perf_counter.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "work_pool.h"
+#include "work_pqueue.h"
+
+#ifdef CONFIG_SCHED_WORKQUEUE
+
+#define WORK_POOL_MAX		32
+
+struct work_pool_worker {
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct dq_queue_s	q;		/* pending work, ordered by due time */
+	struct work_s		*running;	/* work being run, read by the other workers */
+	hrt_abstime		wakeup;		/* time the worker sleeps until, 0 while it is awake */
+	int			cpu;		/* CPU the worker is pinned to, -1 if none */
+};
+
+static struct work_pool_worker	_pool[WORK_POOL_MAX];
+static unsigned			_pool_size;
+static unsigned			_pool_next;		/* round robin index for work queued from outside */
+static unsigned			_pool_generation;	/* bumped when a busy worker has pending work */
+static __thread struct work_pool_worker *_pool_self;
+
+static perf_counter_t		_pool_latency;
+static perf_counter_t		_pool_steals;
+
+static struct work_s *pool_running(struct work_pool_worker *w)
+{
+	return __atomic_load_n(&w->running, __ATOMIC_SEQ_CST);
+}
+
+static void pool_set_running(struct work_pool_worker *w, struct work_s *work)
+{
+	__atomic_store_n(&w->running, work, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * A busy worker has pending work: wake up a sleeping worker to look at it.
+ */
+static void pool_wake_thief(struct work_pool_worker *busy)
+{
+	__atomic_add_fetch(&_pool_generation, 1, __ATOMIC_SEQ_CST);
+
+	for (unsigned i = 0; i < _pool_size; i++) {
+		struct work_pool_worker *w = &_pool[i];
+
+		if (w == busy) {
+			continue;
+		}
+
+		pthread_mutex_lock(&w->lock);
+		bool sleeping = (w->wakeup != 0);
+
+		if (sleeping) {
+			pthread_cond_signal(&w->cond);
+		}
+
+		pthread_mutex_unlock(&w->lock);
+
+		if (sleeping) {
+			break;
+		}
+	}
+}
+
+/*
+ * Take the head of a queue if it is due and not running, called with the
+ * queue's lock held.  The work is marked as running on self before it is
+ * marked as no longer queued, from then on it may be queued again.
+ */
+static struct work_s *pool_take(struct work_pool_worker *self, struct work_pool_worker *owner, hrt_abstime now,
+				worker_t *worker, void **arg)
+{
+	struct work_s *work = (struct work_s *)owner->q.head;
+
+	if (work == NULL || work_due(work) > now || work == pool_running(owner)) {
+		return NULL;
+	}
+
+	dq_rem(&work->dq, &owner->q);
+	pool_set_running(self, work);
+	perf_set(_pool_latency, (int64_t)(now - work_due(work)));
+
+	*worker = work->worker;
+	*arg = work->arg;
+	work->worker = NULL;
+
+	return work;
+}
+
+/*
+ * Steal due work from a busy worker.  Returns NULL if there is none, and the
+ * earliest time work of a busy worker is due in *next.
+ */
+static struct work_s *pool_steal(struct work_pool_worker *self, hrt_abstime now, hrt_abstime *next,
+				 worker_t *worker, void **arg)
+{
+	*next = UINT64_MAX;
+
+	for (unsigned i = 0; i < _pool_size; i++) {
+		struct work_pool_worker *w = &_pool[i];
+
+		/* idle workers run their own work */
+		if (w == self || pool_running(w) == NULL) {
+			continue;
+		}
+
+		pthread_mutex_lock(&w->lock);
+		struct work_s *work = pool_take(self, w, now, worker, arg);
+
+		if (work == NULL && w->q.head != NULL) {
+			hrt_abstime due = work_due((struct work_s *)w->q.head);
+
+			if (due < *next) {
+				*next = due;
+			}
+		}
+
+		pthread_mutex_unlock(&w->lock);
+
+		if (work != NULL) {
+			perf_count(_pool_steals);
+			return work;
+		}
+	}
+
+	return NULL;
+}
+
+static void pool_run(struct work_pool_worker *self, worker_t worker, void *arg)
+{
+	if (worker == NULL) {
+		PX4_ERR("work pool: worker = 0");
+
+	} else {
+		worker(arg);
+	}
+
+	pool_set_running(self, NULL);
+}
+
+static int work_pool_thread(int argc, char *argv[])
+{
+	/* the worker index is the last argument */
+	struct work_pool_worker *self = &_pool[atoi(argv[argc - 1])];
+
+	_pool_self = self;
+	work_set_timer_slack();
+
+#ifdef __PX4_LINUX
+
+	if (self->cpu >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(self->cpu, &cpus);
+
+		if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+			PX4_WARN("work pool: could not pin worker to CPU %d", self->cpu);
+		}
+	}
+
+#endif
+
+	for (;;) {
+		unsigned generation = __atomic_load_n(&_pool_generation, __ATOMIC_SEQ_CST);
+		hrt_abstime now = hrt_absolute_time();
+		hrt_abstime steal_next;
+		worker_t worker;
+		void *arg;
+
+		/* own work first */
+		pthread_mutex_lock(&self->lock);
+		struct work_s *work = pool_take(self, self, now, &worker, &arg);
+		bool pending = (work != NULL && self->q.head != NULL);
+		pthread_mutex_unlock(&self->lock);
+
+		if (work != NULL) {
+			if (pending) {
+				pool_wake_thief(self);
+			}
+
+			pool_run(self, worker, arg);
+			continue;
+		}
+
+		work = pool_steal(self, now, &steal_next, &worker, &arg);
+
+		if (work != NULL) {
+			pool_run(self, worker, arg);
+			continue;
+		}
+
+		/* sleep until the own head or the head of a busy worker is due */
+		pthread_mutex_lock(&self->lock);
+
+		hrt_abstime deadline = steal_next;
+
+		if (self->q.head != NULL && work_due((struct work_s *)self->q.head) < deadline) {
+			deadline = work_due((struct work_s *)self->q.head);
+		}
+
+		if (deadline > hrt_absolute_time() &&
+		    generation == __atomic_load_n(&_pool_generation, __ATOMIC_SEQ_CST)) {
+			self->wakeup = deadline;
+
+			if (deadline == UINT64_MAX) {
+				pthread_cond_wait(&self->cond, &self->lock);
+
+			} else {
+				struct timespec ts;
+				abstime_to_ts(&ts, deadline);
+				pthread_cond_timedwait(&self->cond, &self->lock, &ts);
+			}
+
+			self->wakeup = 0;
+		}
+
+		pthread_mutex_unlock(&self->lock);
+	}
+
+	return PX4_OK;
+}
+
+void work_pool_init(void)
+{
+	const char *size = getenv("PX4_WORK_POOL");
+	const char *affinity = getenv("PX4_WORK_POOL_AFFINITY");
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_condattr_t attr;
+
+	if (cpus < 1) {
+		cpus = 1;
+	}
+
+	_pool_size = (size != NULL) ? (unsigned)atoi(size) : (unsigned)cpus;
+
+	if (_pool_size > WORK_POOL_MAX) {
+		_pool_size = WORK_POOL_MAX;
+	}
+
+	if (_pool_size == 0) {
+		return;
+	}
+
+	_pool_latency = perf_alloc(PC_HISTOGRAM, "wq_pool_latency");
+	_pool_steals = perf_alloc(PC_COUNT, "wq_pool_steals");
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	for (unsigned i = 0; i < _pool_size; i++) {
+		struct work_pool_worker *w = &_pool[i];
+
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->cond, &attr);
+		dq_init(&w->q);
+		w->running = NULL;
+		w->wakeup = 0;
+		w->cpu = (affinity != NULL && atoi(affinity) != 0) ? (int)(i % cpus) : -1;
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	for (unsigned i = 0; i < _pool_size; i++) {
+		char index[12];	/* any unsigned */
+		char *const argv[] = { index, NULL };
+		snprintf(index, sizeof(index), "%u", i);
+
+		/* between the high and low priority queues */
+		if (px4_task_spawn_cmd("wkr_pool",
+				       SCHED_DEFAULT,
+				       SCHED_PRIORITY_MAX - 2,
+				       2000,
+				       work_pool_thread,
+				       argv) < 0) {
+			PX4_ERR("work pool: failed to start worker %u", i);
+		}
+	}
+
+	PX4_INFO("work pool: %u workers%s", _pool_size, (_pool[0].cpu >= 0) ? ", pinned" : "");
+}
+
+bool work_pool_enabled(void)
+{
+	return _pool_size > 0;
+}
+
+int work_pool_queue(struct work_s *work, worker_t worker, void *arg, uint32_t delay)
+{
+	struct work_pool_worker *target = NULL;
+
+	/* work queued while it runs stays on its worker, so it never runs concurrently with itself */
+	for (unsigned i = 0; i < _pool_size; i++) {
+		if (pool_running(&_pool[i]) == work) {
+			target = &_pool[i];
+			break;
+		}
+	}
+
+	if (target == NULL) {
+		target = (_pool_self != NULL) ? _pool_self :
+			 &_pool[__atomic_fetch_add(&_pool_next, 1, __ATOMIC_RELAXED) % _pool_size];
+	}
+
+	pthread_mutex_lock(&target->lock);
+
+	work->worker = worker;
+	work->arg    = arg;
+	work->delay  = delay;
+	work->qtime  = hrt_absolute_time();
+	work->pool   = target - _pool;
+
+	if (work_insert(&target->q, work) && target->wakeup != 0) {
+		pthread_cond_signal(&target->cond);
+	}
+
+	bool busy = (pool_running(target) != NULL && target != _pool_self);
+
+	pthread_mutex_unlock(&target->lock);
+
+	if (busy) {
+		pool_wake_thief(target);
+	}
+
+	return PX4_OK;
+}
+
+int work_pool_cancel(struct work_s *work)
+{
+	for (;;) {
+		if (work->worker == NULL) {
+			return PX4_OK;
+		}
+
+		struct work_pool_worker *w = &_pool[work->pool];
+
+		pthread_mutex_lock(&w->lock);
+
+		/* it may have run and been queued on another worker meanwhile */
+		bool queued_here = (work->worker != NULL && &_pool[work->pool] == w);
+
+		if (queued_here) {
+			dq_rem(&work->dq, &w->q);
+			work->worker = NULL;
+		}
+
+		pthread_mutex_unlock(&w->lock);
+
+		if (queued_here || work->worker == NULL) {
+			return PX4_OK;
+		}
+	}
+}
+
+#endif /* CONFIG_SCHED_WORKQUEUE */
@@ -0,0 +1,67 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file work_pool.h
+ *
+ * Pool of worker threads behind the POOLWORK queue.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <px4_workqueue.h>
+
+__BEGIN_DECLS
+
+/*
+ * Start the pool.  The number of workers is taken from the PX4_WORK_POOL
+ * environment variable and defaults to the number of online CPUs, 0 sends
+ * POOLWORK work to HPWORK.  PX4_WORK_POOL_AFFINITY=1 pins worker n to CPU n.
+ */
+void work_pool_init(void);
+
+/*
+ * Return true if the pool is running, else POOLWORK is served by HPWORK.
+ */
+bool work_pool_enabled(void);
+
+/*
+ * Queue and cancel work on the pool, see work_queue() and work_cancel().
+ * The delay is in microseconds.
+ */
+int work_pool_queue(struct work_s *work, worker_t worker, void *arg, uint32_t delay);
+int work_pool_cancel(struct work_s *work);
+
+__END_DECLS
@@ -0,0 +1,108 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file work_pqueue.h
+ *
+ * Due time ordering shared by the POSIX work queues.
+ *
+ * The pending work of a queue is kept sorted by due time, so the worker only
+ * looks at the head and can sleep until exactly that time.  work->delay is kept
+ * in microseconds, work->qtime is the hrt_absolute_time() the work was queued at.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <queue.h>
+#include <px4_workqueue.h>
+#ifdef __PX4_LINUX
+#include <sys/prctl.h>
+#endif
+
+__BEGIN_DECLS
+
+/*
+ * Called by a worker thread before it starts processing, so that it wakes up
+ * close to the due time instead of up to the default 50 us timer slack later.
+ */
+static inline void work_set_timer_slack(void)
+{
+#ifdef __PX4_LINUX
+	prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+}
+
+static inline uint64_t work_due(volatile const struct work_s *work)
+{
+	return work->qtime + work->delay;
+}
+
+/*
+ * Insert work behind all work due at the same time or earlier.  The search
+ * starts at the tail as most work is re-queued with a similar delay.
+ *
+ * Returns true if the work is now at the head of the queue.
+ */
+static inline bool work_insert(struct dq_queue_s *q, struct work_s *work)
+{
+	uint64_t due = work_due(work);
+	struct dq_entry_s *prev = q->tail;
+
+	while (prev != NULL && work_due((struct work_s *)prev) > due) {
+		prev = prev->blink;
+	}
+
+	work->dq.blink = prev;
+
+	if (prev == NULL) {
+		work->dq.flink = q->head;
+		q->head = &work->dq;
+
+	} else {
+		work->dq.flink = prev->flink;
+		prev->flink = &work->dq;
+	}
+
+	if (work->dq.flink == NULL) {
+		q->tail = &work->dq;
+
+	} else {
+		work->dq.flink->blink = &work->dq;
+	}
+
+	return prev == NULL;
+}
+
+__END_DECLS
@@ -46,7 +46,10 @@
 #include <stdio.h>
 #include <semaphore.h>
 #include <px4_workqueue.h>
+#include <drivers/drv_hrt.h>
 #include "work_lock.h"
+#include "work_pqueue.h"
+#include "work_pool.h"
 
 #ifdef CONFIG_SCHED_WORKQUEUE
 
@@ -105,26 +108,50 @@
 
 int work_queue(int qid, struct work_s *work, worker_t worker, void *arg, uint32_t delay)
 {
-  struct wqueue_s *wqueue = &g_work[qid];
+  struct wqueue_s *wqueue;
 
-  //DEBUGASSERT(work != NULL && (unsigned)qid < NWORKERS);
+  //DEBUGASSERT(work != NULL && (unsigned)qid <= NWORKERS);
+
+  /* Delay until work performed, kept in microseconds to order the queue */
+
+  uint64_t delay_us = (uint64_t)delay * USEC_PER_TICK;
+
+  if (delay_us > UINT32_MAX)
+    {
+      delay_us = UINT32_MAX;
+    }
+
+  if (qid == POOLWORK)
+    {
+      if (work_pool_enabled())
+        {
+          return work_pool_queue(work, worker, arg, (uint32_t)delay_us);
+        }
+
+      qid = HPWORK;
+    }
+
+  wqueue = &g_work[qid];
 
   /* First, initialize the work structure */
 
   work->worker = worker;           /* Work callback */
   work->arg    = arg;              /* Callback argument */
-  work->delay  = delay;            /* Delay until work performed */
+  work->delay  = (uint32_t)delay_us;
 
-  /* Now, time-tag that entry and put it in the work queue.  This must be
-   * done with interrupts disabled.  This permits this function to be called
-   * from with task logic or interrupt handlers.
+  /* Now, time-tag that entry and put it in the work queue.  This permits
+   * this function to be called from any task.
    */
 
   work_lock(qid);
-  work->qtime  = clock_systimer(); /* Time work queued */
+  work->qtime  = hrt_absolute_time(); /* Time work queued */
+
+  if (work_insert(&wqueue->q, work))
+    {
+      /* Wake up the worker thread, it sleeps until the previous head is due */
 
-  dq_addlast((dq_entry_t *)work, &wqueue->q);
-  px4_task_kill(wqueue->pid, SIGCONT);      /* Wake up the worker thread */
+      pthread_cond_signal(&_work_cond[qid]);
+    }
 
   work_unlock(qid);
   return PX4_OK;
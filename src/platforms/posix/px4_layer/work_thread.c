@@ -45,7 +45,10 @@
 #include <queue.h>
 #include <px4_workqueue.h>
 #include <drivers/drv_hrt.h>
+#include <systemlib/perf_counter.h>
 #include "work_lock.h"
+#include "work_pqueue.h"
+#include "work_pool.h"
 
 #ifdef CONFIG_SCHED_WORKQUEUE
 
@@ -67,7 +70,11 @@ struct wqueue_s g_work[NWORKERS];
 /****************************************************************************
  * Private Variables
  ****************************************************************************/
-sem_t _work_lock[NWORKERS];
+pthread_mutex_t _work_lock[NWORKERS];
+pthread_cond_t _work_cond[NWORKERS];
+
+/* How late work runs after it is due */
+static perf_counter_t _work_latency[NWORKERS];
 
 /****************************************************************************
  * Private Functions
@@ -92,93 +99,68 @@ static void work_process(FAR struct wqueue_s *wqueue, int lock_id)
   volatile FAR struct work_s *work;
   worker_t  worker;
   FAR void *arg;
-  uint64_t elapsed;
-  uint32_t remaining;
-  uint32_t next;
+  uint64_t now;
+  uint64_t due = 0;
+  struct timespec ts;
 
-  /* Then process queued work.  We need to keep interrupts disabled while
-   * we process items in the work list.
+  /* Then process queued work.  The queue is ordered by due time, so only
+   * the head needs to be looked at.
    */
 
-  next  = CONFIG_SCHED_WORKPERIOD;
-
   work_lock(lock_id);
 
-  work  = (FAR struct work_s *)wqueue->q.head;
-  while (work)
+  while ((work = (FAR struct work_s *)wqueue->q.head) != NULL &&
+         (due = work_due(work)) <= (now = hrt_absolute_time()))
     {
-      /* Is this work ready?  It is ready if there is no delay or if
-       * the delay has elapsed. qtime is the time that the work was added
-       * to the work queue.  It will always be greater than or equal to
-       * zero.  Therefore a delay of zero will always execute immediately.
-       */
+      /* Remove the ready-to-execute work from the list */
 
-      elapsed = USEC2TICK(clock_systimer() - work->qtime);
-      //PX4_INFO("work_process: queue=%p in ticks elapsed=%lu delay=%u time=%u", wqueue, elapsed, work->delay,clock_systimer());
-      if (elapsed >= work->delay)
-        {
-          /* Remove the ready-to-execute work from the list */
+      (void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
 
-          (void)dq_rem((struct dq_entry_s *)work, &wqueue->q);
-
-          /* Extract the work description from the entry (in case the work
-           * instance by the re-used after it has been de-queued).
-           */
-
-          worker = work->worker;
-          arg    = work->arg;
+      /* Extract the work description from the entry (in case the work
+       * instance by the re-used after it has been de-queued).
+       */
 
-          /* Mark the work as no longer being queued */
+      worker = work->worker;
+      arg    = work->arg;
 
-          work->worker = NULL;
+      /* Mark the work as no longer being queued */
 
-          /* Do the work.  Re-enable interrupts while the work is being
-           * performed... we don't have any idea how long that will take!
-           */
+      work->worker = NULL;
 
-          work_unlock(lock_id);
-	  if (!worker) {
-             PX4_ERR("MESSED UP: worker = 0");
-          }
-          else {
-            worker(arg);
-          }
+      perf_set(_work_latency[lock_id], (int64_t)(now - due));
 
-          /* Now, unfortunately, since we re-enabled interrupts we don't
-           * know the state of the work list and we will have to start
-           * back at the head of the list.
-           */
+      /* Do the work.  Unlock while the work is being performed... we
+       * don't have any idea how long that will take!
+       */
 
-          work_lock(lock_id);
-          work  = (FAR struct work_s *)wqueue->q.head;
+      work_unlock(lock_id);
+      if (!worker)
+        {
+          PX4_ERR("MESSED UP: worker = 0");
         }
       else
         {
-          /* This one is not ready.. will it be ready before the next
-           * scheduled wakeup interval?
-           */
-
-          /* Here: elapsed < work->delay */
-          remaining = USEC_PER_TICK*(work->delay - elapsed);
-          if (remaining < next)
-            {
-              /* Yes.. Then schedule to wake up when the work is ready */
-
-              next = remaining;
-            }
-              
-          /* Then try the next in the list. */
-
-          work = (FAR struct work_s *)work->dq.flink;
+          worker(arg);
         }
+
+      work_lock(lock_id);
     }
 
-  /* Wait awhile to check the work list.  We will wait here until either
-   * the time elapses or until we are awakened by a signal.
+  /* Wait until the head is due or until work_queue() puts new work at the
+   * head.
    */
-  work_unlock(lock_id);
 
-  usleep(next);
+  if (work == NULL)
+    {
+      pthread_cond_wait(&_work_cond[lock_id], &_work_lock[lock_id]);
+    }
+  else
+    {
+      abstime_to_ts(&ts, due);
+      pthread_cond_timedwait(&_work_cond[lock_id], &_work_lock[lock_id], &ts);
+    }
+
+  work_unlock(lock_id);
 }
 
 /****************************************************************************
@@ -186,11 +168,21 @@ static void work_process(FAR struct wqueue_s *wqueue, int lock_id)
  ****************************************************************************/
 void work_queues_init(void)
 {
-	sem_init(&_work_lock[HPWORK], 0, 1);
-	sem_init(&_work_lock[LPWORK], 0, 1);
-#ifdef CONFIG_SCHED_USRWORK
-	sem_init(&_work_lock[USRWORK], 0, 1);
-#endif
+	pthread_condattr_t attr;
+
+	/* wait on the clock the due times are taken from */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	for (int i = 0; i < NWORKERS; i++) {
+		pthread_mutex_init(&_work_lock[i], NULL);
+		pthread_cond_init(&_work_cond[i], &attr);
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	_work_latency[HPWORK] = perf_alloc(PC_HISTOGRAM, "wq_hp_latency");
+	_work_latency[LPWORK] = perf_alloc(PC_HISTOGRAM, "wq_lp_latency");
 
 	// Create high priority worker thread
 	g_work[HPWORK].pid = px4_task_spawn_cmd("wkr_high",
@@ -208,6 +200,9 @@ void work_queues_init(void)
 			       work_lpthread,
 			       (char* const*)NULL);
 
+	// Create the worker pool
+	work_pool_init();
+
 }
 
 /****************************************************************************
@@ -245,6 +240,8 @@ void work_queues_init(void)
 
 int work_hpthread(int argc, char *argv[])
 {
+  work_set_timer_slack();
+
   /* Loop forever */
 
   for (;;)
@@ -274,6 +271,8 @@ int work_hpthread(int argc, char *argv[])
 
 int work_lpthread(int argc, char *argv[])
 {
+  work_set_timer_slack();
+
   /* Loop forever */
 
   for (;;)
@@ -304,6 +303,8 @@ int work_lpthread(int argc, char *argv[])
 
 int work_usrthread(int argc, char *argv[])
 {
+  work_set_timer_slack();
+
   /* Loop forever */
 
   for (;;)
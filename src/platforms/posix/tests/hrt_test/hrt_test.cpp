@@ -42,8 +42,10 @@
 #include <px4_time.h>
 #include <drivers/drv_hrt.h>
 #include "hrt_test.h"
+#include <systemlib/perf_counter.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 px4::AppState HRTTest::appState;
 
@@ -60,6 +62,68 @@ static void timer_expired(void *arg)
 	}
 }
 
+/* background callouts keeping the timer wheel busy during the jitter test */
+#define LOAD_CALLOUTS 1000
+static struct hrt_call load[LOAD_CALLOUTS];
+static struct hrt_call periodic;
+static struct hrt_call fence;
+static volatile unsigned periodic_count;
+static volatile bool load_running;
+
+static void load_expired(void *arg)
+{
+	struct hrt_call *call = (struct hrt_call *)arg;
+
+	/* a re-arm racing hrt_cancel() would leave the callout queued */
+	if (load_running) {
+		hrt_call_after(call, 1000 + rand() % 100000, load_expired, arg);
+	}
+}
+
+static void periodic_expired(void *arg)
+{
+	periodic_count++;
+}
+
+static void jitter_test()
+{
+	perf_counter_t latency = perf_find("hrt_latency");
+
+	if (latency == NULL) {
+		PX4_INFO("no hrt_latency counter\n");
+		return;
+	}
+
+	load_running = true;
+
+	for (int i = 0; i < LOAD_CALLOUTS; i++) {
+		hrt_call_after(&load[i], rand() % 100000, load_expired, &load[i]);
+	}
+
+	perf_reset(latency);
+	hrt_call_every(&periodic, 1000, 1000, periodic_expired, NULL);
+	sleep(2);
+	hrt_cancel(&periodic);
+
+	/* stop the re-arming, then let a callout in progress finish: callouts
+	 * run one after the other, so it is done once the fence has fired
+	 */
+	load_running = false;
+	hrt_call_after(&fence, 0, NULL, NULL);
+
+	while (!hrt_called(&fence)) {
+		usleep(1000);
+	}
+
+	for (int i = 0; i < LOAD_CALLOUTS; i++) {
+		hrt_cancel(&load[i]);
+	}
+
+	PX4_INFO("1 kHz callout with %d other callouts: %u calls in 2 s\n", LOAD_CALLOUTS, periodic_count);
+	perf_print_counter(latency);
+	perf_print_histogram_fd(1, latency);
+}
+
 int HRTTest::main()
 {
 	appState.setRunning(true);
@@ -86,5 +150,7 @@ int HRTTest::main()
 	hrt_cancel(&t1);
 	PX4_INFO("HRT_CALL + %d\n", hrt_called(&t1));
 
+	jitter_test();
+
 	return 0;
 }
@@ -44,6 +44,7 @@
 #include "vcdevtest_example.h"
 #include <drivers/drv_device.h>
 #include <drivers/device/device.h>
+#include <drivers/drv_hrt.h>
 #include <unistd.h>
 #include <stdio.h>
 
@@ -84,7 +85,7 @@ static int writer_main(int argc, char *argv[])
 
 class VCDevNode : public VDev {
 public:
-	VCDevNode() : VDev("vcdevtest", TESTDEV) {};
+	VCDevNode(const char *devname = TESTDEV) : VDev("vcdevtest", devname) {};
 
 	~VCDevNode() {}
 
@@ -124,6 +125,128 @@ static int test_pub_block(int fd, unsigned long blocked)
 	return 0;
 }
 
+#define BENCH_NODES		32
+#define BENCH_ITERATIONS	1000
+#define BENCH_DEVNAME_LEN	24
+
+static char bench_devnames[BENCH_NODES][BENCH_DEVNAME_LEN];
+static int bench_fds[BENCH_NODES];
+static volatile hrt_abstime bench_notify_time;
+
+static int bench_writer_main(int argc, char *argv[])
+{
+	char buf[1] = { '1' };
+
+	// Notify a different node on every iteration at 1 kHz
+	for (int i = 0; i < BENCH_ITERATIONS; i++) {
+		usleep(1000);
+		bench_notify_time = hrt_absolute_time();
+		px4_write(bench_fds[i % BENCH_NODES], buf, 1);
+	}
+
+	return 0;
+}
+
+int VCDevExample::bench()
+{
+	VCDevNode *nodes[BENCH_NODES] = {};
+	px4_pollfd_struct_t fds[BENCH_NODES];
+	int ret = 0;
+
+	for (int i = 0; i < BENCH_NODES; i++) {
+		bench_fds[i] = -1;
+	}
+
+	for (int i = 0; i < BENCH_NODES; i++) {
+		snprintf(bench_devnames[i], BENCH_DEVNAME_LEN, "%s_bench%d", TESTDEV, i);
+		nodes[i] = new VCDevNode(bench_devnames[i]);
+
+		if (nodes[i] == 0 || nodes[i]->init() != PX4_OK) {
+			PX4_INFO("Failed to init bench node %d", i);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		bench_fds[i] = px4_open(bench_devnames[i], PX4_F_RDONLY);
+
+		if (bench_fds[i] < 0) {
+			PX4_INFO("Open failed %d %d", bench_fds[i], px4_errno);
+			ret = -px4_errno;
+			goto out;
+		}
+
+		fds[i].fd = bench_fds[i];
+		fds[i].events = POLLIN;
+	}
+
+	{
+		// Per-call overhead of a poll that times out immediately
+		hrt_abstime start = hrt_absolute_time();
+
+		for (int i = 0; i < BENCH_ITERATIONS; i++) {
+			px4_poll(fds, BENCH_NODES, 0);
+		}
+
+		hrt_abstime elapsed = hrt_elapsed_time(&start);
+		PX4_INFO("poll overhead: %d fds, %.2f us/call",
+			 BENCH_NODES, (double)elapsed / BENCH_ITERATIONS);
+	}
+
+	{
+		// Wake latency from poll_notify() to px4_poll() returning, 1 kHz writer
+		hrt_abstime lat_min = UINT64_MAX, lat_max = 0, lat_sum = 0;
+		unsigned wakeups = 0, timeouts = 0;
+
+		bench_notify_time = 0;
+
+		(void)px4_task_spawn_cmd("vcdevtest_bench",
+					 SCHED_DEFAULT,
+					 SCHED_PRIORITY_MAX - 6,
+					 2000,
+					 bench_writer_main,
+					 (char* const*)NULL);
+
+		while (wakeups + timeouts < BENCH_ITERATIONS && timeouts < 100) {
+			int pret = px4_poll(fds, BENCH_NODES, 10);
+			hrt_abstime now = hrt_absolute_time();
+
+			if (pret <= 0) {
+				timeouts++;
+				continue;
+			}
+
+			hrt_abstime lat = now - bench_notify_time;
+			lat_min = (lat < lat_min) ? lat : lat_min;
+			lat_max = (lat > lat_max) ? lat : lat_max;
+			lat_sum += lat;
+			wakeups++;
+		}
+
+		if (wakeups > 0) {
+			PX4_INFO("poll wake latency: %u wakeups, %u timeouts, min %llu us, avg %.2f us, max %llu us",
+				 wakeups, timeouts, (unsigned long long)lat_min,
+				 (double)lat_sum / wakeups, (unsigned long long)lat_max);
+
+		} else {
+			PX4_INFO("poll wake latency: no wakeups - FAIL");
+		}
+	}
+
+out:
+
+	for (int i = 0; i < BENCH_NODES; i++) {
+		if (nodes[i]) {
+			if (bench_fds[i] >= 0) {
+				px4_close(bench_fds[i]);
+			}
+
+			delete nodes[i];
+		}
+	}
+
+	return ret;
+}
+
 int VCDevExample::main()
 {
 	appState.setRunning(true);
@@ -51,6 +51,8 @@ public:
 
 	int main();
 
+	int bench();
+
 	static px4::AppState appState; /* track requests to terminate app */
 
 private:
@@ -41,6 +41,7 @@
 #include <px4_app.h>
 #include "vcdevtest_example.h"
 #include <stdio.h>
+#include <string.h>
 
 int PX4_MAIN(int argc, char **argv)
 {
@@ -48,7 +49,13 @@ int PX4_MAIN(int argc, char **argv)
 
 	printf("vcdevtest\n");
 	VCDevExample vcdevtest;
-	vcdevtest.main();
+
+	if (argc > 0 && !strcmp(argv[0], "bench")) {
+		vcdevtest.bench();
+
+	} else {
+		vcdevtest.main();
+	}
 
 	printf("goodbye\n");
 	return 0;
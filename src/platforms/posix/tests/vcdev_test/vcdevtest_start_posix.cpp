@@ -52,7 +52,7 @@ int vcdevtest_main(int argc, char *argv[])
 {
 	
 	if (argc < 2) {
-		printf("usage: vcdevtest {start|stop|status}\n");
+		printf("usage: vcdevtest {start [bench]|stop|status}\n");
 		return 1;
 	}
 
@@ -90,6 +90,6 @@ int vcdevtest_main(int argc, char *argv[])
 		return 0;
 	}
 
-	printf("usage: vcdevtest_main {start|stop|status}\n");
+	printf("usage: vcdevtest_main {start [bench]|stop|status}\n");
 	return 1;
 }
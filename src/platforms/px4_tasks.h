@@ -80,6 +80,24 @@ typedef struct {
 	int argc;
 	char **argv;
 } px4_task_args_t;
+
+#if !defined(__PX4_QURT)
+#include <stdint.h>
+
+/** Accounting of a task since it started, see px4_task_stats() */
+typedef struct {
+	px4_task_t id;
+	char name[24];
+	int policy;		/**< scheduling policy in effect */
+	int priority;		/**< priority in effect */
+	bool rt_refused;	/**< real-time scheduling was asked for but not permitted */
+	uint32_t cpu_mask;	/**< CPUs the task may run on, 0 if any */
+	uint64_t cpu_time;	/**< CPU time used in us */
+	bool schedstat;		/**< run_delay and wakeups are known */
+	uint64_t run_delay;	/**< time spent waiting for a CPU while runnable in us */
+	uint64_t wakeups;	/**< number of times the task was put on a CPU */
+} px4_task_stats_t;
+#endif
 #else
 #error "No target OS defined"
 #endif
@@ -111,5 +129,21 @@ __EXPORT void px4_task_exit(int ret);
 /** Show a list of running tasks **/
 __EXPORT void px4_show_tasks(void);
 
+#if (defined(__PX4_POSIX) && !defined(__PX4_QURT))
+/**
+ * Apply the process wide settings from the environment before the first
+ * task is spawned: PX4_MLOCKALL=1 locks all memory, PX4_PREFAULT_STACK=<KiB>
+ * makes every task touch that much of its stack when it starts.
+ * PX4_TASK_AFFINITY=<name>=<mask>[,...] is applied when a task is spawned.
+ */
+__EXPORT void px4_tasks_init(void);
+
+/** Pin a task to the CPUs in cpu_mask (bit n is CPU n), 0 for any CPU **/
+__EXPORT int px4_task_set_affinity(px4_task_t id, uint32_t cpu_mask);
+
+/** Fill in the accounting of up to max running tasks, returns the number filled in **/
+__EXPORT int px4_task_stats(px4_task_stats_t *stats, int max);
+#endif
+
 __END_DECLS
 
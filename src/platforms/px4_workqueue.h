@@ -52,6 +52,13 @@ __BEGIN_DECLS
 #define LPWORK 1
 #define NWORKERS 2
 
+#if defined(__PX4_QURT)
+#define POOLWORK HPWORK
+#else
+/* Pool of worker threads, work may run on any of them but never concurrently with itself */
+#define POOLWORK NWORKERS
+#endif
+
 struct wqueue_s
 {
   pid_t             pid; /* The task ID of the worker thread */
@@ -71,6 +78,9 @@ struct work_s
   void *arg;             /* Callback argument */
   uint64_t  qtime;       /* Time work queued */
   uint32_t  delay;       /* Delay until work performed */
+#if !defined(__PX4_QURT)
+  int32_t   pool;        /* POOLWORK worker queue the work is on */
+#endif
 };
 
 /****************************************************************************
@@ -37,10 +37,16 @@
 
 
 #include <px4_config.h>
+#include <px4_tasks.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <drivers/drv_hrt.h>
+#include <uORB/uORB.h>
+#include <uORB/topics/perf_counter.h>
+
 #include "systemlib/perf_counter.h"
 
 
@@ -48,10 +54,106 @@
  * Definitions
  ****************************************************************************/
 
+/* default time to publish all counters once */
+#define PERF_STREAM_INTERVAL_MS		5000
+
+/* longest interval, the sleep time in microseconds has to fit an unsigned */
+#define PERF_STREAM_INTERVAL_MAX_MS	3600000
+
+/* counters are published one at a time, a short queue is enough for readers */
+#define PERF_STREAM_QUEUE_SIZE		8
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+/* set by 'perf stream' before spawning the task, cleared by the task on exit */
+static volatile bool perf_stream_running = false;
+static volatile bool perf_stream_should_exit = false;
+static unsigned perf_stream_interval_ms = PERF_STREAM_INTERVAL_MS;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/**
+ * Sleep in short slices so a stop request is noticed promptly.
+ */
+static void
+perf_stream_sleep(unsigned us)
+{
+	while (us > 0 && !perf_stream_should_exit) {
+		unsigned slice = (us > 100000) ? 100000 : us;
+		usleep(slice);
+		us -= slice;
+	}
+}
+
+/**
+ * Publish all counters on the perf_counter topic, one at a time spread over
+ * the stream interval so readers never see a burst.
+ *
+ * Counters may be freed while streaming, so no handle is kept between
+ * samples: each sample is copied by position under the counter list lock.
+ */
+static int
+perf_stream_main(int argc, char *argv[])
+{
+	struct perf_counter_s report;
+	orb_advert_t pub = NULL;
+	unsigned index = 0;
+
+	while (!perf_stream_should_exit) {
+		struct perf_counter_snapshot_s snapshot;
+
+		memset(&report, 0, sizeof(report));
+
+		unsigned count = perf_snapshot_index(index, &snapshot, (char *)report.name, sizeof(report.name));
+
+		if (count == 0) {
+			perf_stream_sleep(perf_stream_interval_ms * 1000);
+			continue;
+		}
+
+		if (index >= count) {
+			/* counters were freed, start over */
+			index = 0;
+			continue;
+		}
+
+		report.timestamp = hrt_absolute_time();
+		report.index = index;
+		report.count = count;
+		report.type = snapshot.type;
+		report.event_count = snapshot.event_count;
+		report.event_overruns = snapshot.event_overruns;
+		report.time_total = snapshot.time_total;
+		report.time_least = snapshot.time_least;
+		report.time_most = snapshot.time_most;
+		report.mean = snapshot.mean;
+		report.rms = snapshot.rms;
+		report.p50 = snapshot.p50;
+		report.p99 = snapshot.p99;
+		report.p999 = snapshot.p999;
+
+		if (pub == NULL) {
+			pub = orb_advertise_queue(ORB_ID(perf_counter), &report, PERF_STREAM_QUEUE_SIZE);
+
+		} else {
+			orb_publish(ORB_ID(perf_counter), pub, &report);
+		}
+
+		index = (index + 1 < count) ? index + 1 : 0;
+
+		perf_stream_sleep(perf_stream_interval_ms * 1000 / count);
+	}
+
+	perf_stream_running = false;
+
+	return 0;
+}
+
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -73,9 +175,79 @@ int perf_main(int argc, char *argv[])
 			perf_print_latency(0 /* stdout */);
 			fflush(stdout);
 			return 0;
+
+		} else if (strcmp(argv[1], "stream") == 0) {
+			if (argc > 2 && strcmp(argv[2], "stop") == 0) {
+				if (!perf_stream_running) {
+					return 0;
+				}
+
+				perf_stream_should_exit = true;
+
+				/* wait for the task to exit, so a following start does not race it */
+				for (unsigned i = 0; perf_stream_running && i < 50; i++) {
+					usleep(20000);
+				}
+
+				if (perf_stream_running) {
+					printf("perf_stream did not stop\n");
+					return -1;
+				}
+
+				return 0;
+			}
+
+			if (argc > 2) {
+				char *end;
+				unsigned long interval_ms = strtoul(argv[2], &end, 10);
+
+				if (*end != '\0' || interval_ms > PERF_STREAM_INTERVAL_MAX_MS) {
+					printf("interval must be 0 to %u ms\n", PERF_STREAM_INTERVAL_MAX_MS);
+					return -1;
+				}
+
+				perf_stream_interval_ms = (interval_ms == 0) ? PERF_STREAM_INTERVAL_MS : interval_ms;
+			}
+
+			if (perf_stream_running) {
+				if (perf_stream_should_exit) {
+					printf("perf_stream is stopping\n");
+					return -1;
+				}
+
+				return 0;
+			}
+
+			perf_stream_should_exit = false;
+			perf_stream_running = true;
+
+			if (px4_task_spawn_cmd("perf_stream",
+					       SCHED_DEFAULT,
+					       SCHED_PRIORITY_MIN + 5,
+					       1200,
+					       perf_stream_main,
+					       NULL) < 0) {
+				perf_stream_running = false;
+				printf("failed to start perf_stream\n");
+				return -1;
+			}
+
+			return 0;
+
+		} else if (strcmp(argv[1], "histogram") == 0 && argc > 2) {
+			perf_counter_t handle = perf_find(argv[2]);
+
+			if (handle == NULL) {
+				printf("no counter named %s\n", argv[2]);
+				return -1;
+			}
+
+			perf_print_histogram_fd(0 /* stdout */, handle);
+			fflush(stdout);
+			return 0;
 		}
 
-		printf("Usage: perf [reset | latency]\n");
+		printf("Usage: perf [reset | latency | histogram <name> | stream [<interval ms> | stop]]\n");
 		return -1;
 	}
 
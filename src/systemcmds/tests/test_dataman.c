@@ -42,6 +42,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -59,6 +60,8 @@
 
 #include "dataman/dataman.h"
 
+extern int dataman_main(int argc, char *argv[]);
+
 static sem_t *sems;
 
 static int
@@ -146,6 +149,144 @@ fail:
 	return -1;
 }
 
+/* fill buffer with a pattern that differs for every item */
+static void
+fill_item(char *buffer, unsigned len, unsigned index)
+{
+	for (unsigned i = 0; i < len; i++) {
+		buffer[i] = (char)(index * 7 + i);
+	}
+}
+
+/* check an item written with fill_item() */
+static int
+check_item(dm_item_t item, unsigned index, unsigned len, const char *what)
+{
+	char expected[DM_MAX_DATA_SIZE];
+	char buffer[DM_MAX_DATA_SIZE];
+
+	fill_item(expected, len, index);
+
+	if (dm_read(item, index, buffer, sizeof(buffer)) != (ssize_t)len || memcmp(buffer, expected, len) != 0) {
+		warnx("%s: item %u mismatch", what, index);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Items reach the file and come back after a dataman restart, with or without the RAM cache */
+static int
+test_write_back(void)
+{
+	char buffer[DM_MAX_DATA_SIZE];
+	const char *stop_argv[] = { "dataman", "stop", NULL };
+	const char *start_argv[] = { "dataman", "start", NULL };
+
+	/* read straight after a write, served from the cache when there is one */
+	fill_item(buffer, 40, 0);
+
+	if (dm_write(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, DM_PERSIST_POWER_ON_RESET, buffer, 40) != 40 ||
+	    check_item(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, 40, "read after write") != 0) {
+		return -1;
+	}
+
+	if (dm_flush() != 0) {
+		warnx("flush failed");
+		return -1;
+	}
+
+	/* left dirty, stopping dataman has to write it back */
+	fill_item(buffer, 60, 1);
+
+	if (dm_write(DM_KEY_WAYPOINTS_OFFBOARD_1, 1, DM_PERSIST_POWER_ON_RESET, buffer, 60) != 60) {
+		warnx("write before stop failed");
+		return -1;
+	}
+
+	/* stop returns once the file is closed, start reloads it */
+	dataman_main(2, (char **)stop_argv);
+
+	if (dataman_main(2, (char **)start_argv) != 0) {
+		warnx("dataman restart failed");
+		return -1;
+	}
+
+	if (check_item(DM_KEY_WAYPOINTS_OFFBOARD_1, 0, 40, "flushed item after restart") != 0 ||
+	    check_item(DM_KEY_WAYPOINTS_OFFBOARD_1, 1, 60, "stop written item after restart") != 0) {
+		return -1;
+	}
+
+	dm_clear(DM_KEY_WAYPOINTS_OFFBOARD_1);
+	warnx("write back and reload pass");
+	return 0;
+}
+
+/* Range transfers agree with single item ones and are all or nothing at the end of an item type */
+static int
+test_range(void)
+{
+	char buffer[12 * 30];
+	char item[DM_MAX_DATA_SIZE];
+	unsigned i;
+
+	dm_clear(DM_KEY_WAYPOINTS_OFFBOARD_1);
+
+	/* a range read sees the same bytes as single item writes and stops at the first empty item */
+	for (i = 10; i < 20; i++) {
+		fill_item(item, 30, i);
+
+		if (dm_write(DM_KEY_WAYPOINTS_OFFBOARD_1, i, DM_PERSIST_IN_FLIGHT_RESET, item, 30) != 30) {
+			warnx("range: single write %u failed", i);
+			return -1;
+		}
+	}
+
+	if (dm_read_range(DM_KEY_WAYPOINTS_OFFBOARD_1, 10, 12, buffer, 30) != 10) {
+		warnx("range: read after single writes returned a wrong count");
+		return -1;
+	}
+
+	for (i = 0; i < 10; i++) {
+		fill_item(item, 30, 10 + i);
+
+		if (memcmp(buffer + i * 30, item, 30) != 0) {
+			warnx("range: read after single writes, item %u mismatch", 10 + i);
+			return -1;
+		}
+	}
+
+	/* a range past the last index is refused without touching the items that do exist */
+	fill_item(item, 30, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 2);
+
+	if (dm_write(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 2, DM_PERSIST_IN_FLIGHT_RESET, item, 30) != 30) {
+		warnx("range: write of the last items failed");
+		return -1;
+	}
+
+	memset(buffer, 0x55, sizeof(buffer));
+
+	if (dm_write_range(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 2, 4,
+			   DM_PERSIST_IN_FLIGHT_RESET, buffer, 30) >= 0) {
+		warnx("range: write past the end was accepted");
+		return -1;
+	}
+
+	if (dm_read_range(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 2, 4, buffer, 30) >= 0) {
+		warnx("range: read past the end was accepted");
+		return -1;
+	}
+
+	if (check_item(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 2, 30, "range: partial write") != 0 ||
+	    dm_read(DM_KEY_WAYPOINTS_OFFBOARD_1, DM_KEY_WAYPOINTS_OFFBOARD_1_MAX - 1, item, sizeof(item)) != 0) {
+		return -1;
+	}
+
+	dm_clear(DM_KEY_WAYPOINTS_OFFBOARD_1);
+	warnx("range pass");
+	return 0;
+}
+
 int test_dataman(int argc, char *argv[])
 {
 	int i, num_tasks = 4;
@@ -202,5 +343,13 @@ int test_dataman(int argc, char *argv[])
 		}
 	}
 
+	if (test_write_back() != 0) {
+		return -1;
+	}
+
+	if (test_range() != 0) {
+		return -1;
+	}
+
 	return 0;
 }
@@ -189,6 +189,8 @@ int test_hrt(int argc, char *argv[])
 	int i;
 	struct timeval tv1, tv2;
 
+	hrt_call_init(&call);
+
 	printf("start-time (hrt, sec/usec), end-time (hrt, sec/usec), microseconds per half second\n");
 
 	for (i = 0; i < 10; i++) {
@@ -38,6 +38,8 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <drivers/drv_hrt.h>
 #include "systemlib/err.h"
 #include "systemlib/param/param.h"
 #include "tests.h"
@@ -46,6 +48,60 @@
 #define PARAM_MAGIC2 0xa5a5a5a5
 PARAM_DEFINE_INT32(test, PARAM_MAGIC1);
 
+/**
+ * Time looking up every parameter by name, as done at boot and on every
+ * parameter update, against a plain linear scan of the parameter table.
+ */
+static void
+test_param_lookup_timing(void)
+{
+	unsigned count = param_count();
+	unsigned found = 0;
+
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++) {
+		if (param_find_no_notification(param_name(param_for_index(i))) == param_for_index(i)) {
+			found++;
+		}
+	}
+
+	hrt_abstime hashed = hrt_elapsed_time(&start);
+
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++) {
+		const char *name = param_name(param_for_index(i));
+
+		for (unsigned j = 0; j < count; j++) {
+			if (!strcmp(param_name(param_for_index(j)), name)) {
+				break;
+			}
+		}
+	}
+
+	hrt_abstime linear = hrt_elapsed_time(&start);
+
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < count; i++) {
+		int32_t val;
+
+		if (param_size(param_for_index(i)) <= sizeof(val)) {
+			param_get(param_for_index(i), &val);
+		}
+	}
+
+	hrt_abstime get = hrt_elapsed_time(&start);
+
+	warnx("%u params: find %u us (linear scan %u us), get %u us",
+	      count, (unsigned)hashed, (unsigned)linear, (unsigned)get);
+
+	if (found != count) {
+		errx(1, "found %u of %u parameters by name", found, count);
+	}
+}
+
 int
 test_param(int argc, char *argv[])
 {
@@ -91,6 +147,8 @@ test_param(int argc, char *argv[])
 		errx(1, "parameter value mismatch after write");
 	}
 
+	test_param_lookup_timing();
+
 	warnx("parameter test PASS");
 
 	return 0;
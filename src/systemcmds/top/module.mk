@@ -36,7 +36,12 @@
 #
 
 MODULE_COMMAND	 = top
+
+ifeq ($(PX4_TARGET_OS),nuttx)
 SRCS		 = top.c
+else
+SRCS		 = top_posix.c
+endif
 
 MODULE_STACKSIZE = 1700
 
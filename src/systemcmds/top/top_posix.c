@@ -0,0 +1,241 @@
+/****************************************************************************
+ *
+ *   Copyright (c) 2015 PX4 Development Team. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ * 3. Neither the name PX4 nor the names of its contributors may be
+ *    used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************/
+
+/**
+ * @file top_posix.c
+ * Tool similar to UNIX top command, for the tasks of the POSIX build
+ *
+ * CPU load comes from the CPU time clock of every task. The wait columns
+ * are the time a task sat on a run queue each time it was put on a CPU,
+ * averaged over the last interval and the worst interval seen, they need a
+ * kernel with CONFIG_SCHEDSTATS.
+ */
+
+#include <px4_config.h>
+#include <px4_tasks.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <drivers/drv_hrt.h>
+
+#define CL "\033[K" // clear line
+
+#define TOP_MAX_TASKS 100
+
+/**
+ * Start the top application.
+ */
+__EXPORT int top_main(int argc, char *argv[]);
+
+struct top_task {
+	char name[24];
+	bool valid;
+	uint64_t cpu_time;
+	uint64_t run_delay;
+	uint64_t wakeups;
+	uint64_t max_wait;
+};
+
+static const char *
+policy_name(const px4_task_stats_t *s)
+{
+	if (s->rt_refused) {
+		return "OTHER!";
+	}
+
+	switch (s->policy) {
+	case SCHED_FIFO:  return "FIFO";
+
+	case SCHED_RR:    return "RR";
+
+	case SCHED_OTHER: return "OTHER";
+
+	default:
+		return "?";
+	}
+}
+
+static uint64_t
+process_cpu_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+int
+top_main(int argc, char *argv[])
+{
+	static struct top_task last[TOP_MAX_TASKS];
+	static px4_task_stats_t stats[TOP_MAX_TASKS];
+
+	bool once = (argc > 1 && !strcmp(argv[1], "once"));
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+	memset(last, 0, sizeof(last));
+
+	hrt_abstime interval_start_time = hrt_absolute_time();
+	uint64_t process_start_time = process_cpu_time();
+
+	/* first sample, loads are over the interval to the next one */
+	int count = px4_task_stats(stats, TOP_MAX_TASKS);
+
+	for (int i = 0; i < count; i++) {
+		struct top_task *t = &last[stats[i].id];
+		strcpy(t->name, stats[i].name);
+		t->valid = true;
+		t->cpu_time = stats[i].cpu_time;
+		t->run_delay = stats[i].run_delay;
+		t->wakeups = stats[i].wakeups;
+	}
+
+	if (!once) {
+		/* clear screen */
+		printf("\033[2J");
+	}
+
+	for (;;) {
+		/* Sleep 200 ms waiting for user input five times ~ 1s */
+		for (int k = 0; k < 5; k++) {
+			char c;
+
+			struct pollfd fds;
+			int ret;
+			fds.fd = 0; /* stdin */
+			fds.events = POLLIN;
+			ret = once ? 0 : poll(&fds, 1, 0);
+
+			if (ret > 0) {
+
+				read(0, &c, 1);
+
+				switch (c) {
+				case 0x03: // ctrl-c
+				case 0x1b: // esc
+				case 'c':
+				case 'q':
+					return OK;
+					/* not reached */
+				}
+			}
+
+			usleep(200000);
+		}
+
+		hrt_abstime new_time = hrt_absolute_time();
+		uint64_t process_time = process_cpu_time();
+		float interval_us = (float)(new_time - interval_start_time);
+		float process_load = (float)(process_time - process_start_time) / interval_us;
+
+		count = px4_task_stats(stats, TOP_MAX_TASKS);
+
+		if (!once) {
+			printf("\033[H"); /* move cursor home */
+		}
+
+		printf(CL "Tasks: %d total\n", count);
+		printf(CL "CPU usage: %.2f%% of %ld CPUs\n", (double)(process_load * 100.f / cpus), cpus);
+		printf(CL "Uptime: %.3fs\n\n", (double)new_time / 1000000.0);
+
+		/* header for task list */
+		printf(CL "%4s %-16s %8s %7s %8s %8s %-6s %4s %8s\n",
+		       "ID", "COMMAND", "CPU(ms)", "CPU(%)", "WAIT(us)", "MAXW(us)", "POLICY", "PRIO", "CPUS");
+
+		for (int i = 0; i < count; i++) {
+			px4_task_stats_t *s = &stats[i];
+			struct top_task *t = &last[s->id];
+
+			/* a task that started during the interval, possibly in a reused slot */
+			if (!t->valid || strcmp(t->name, s->name) || s->cpu_time < t->cpu_time) {
+				memset(t, 0, sizeof(*t));
+				strcpy(t->name, s->name);
+			}
+
+			float load = (float)(s->cpu_time - t->cpu_time) / interval_us;
+			uint64_t wakeups = s->wakeups - t->wakeups;
+			uint64_t wait = (wakeups > 0) ? (s->run_delay - t->run_delay) / wakeups : 0;
+
+			if (wait > t->max_wait) {
+				t->max_wait = wait;
+			}
+
+			printf(CL "%4d %-16s %8llu %7.2f ",
+			       s->id,
+			       s->name,
+			       (unsigned long long)(s->cpu_time / 1000),
+			       (double)(load * 100.f));
+
+			if (s->schedstat) {
+				printf("%8llu %8llu ", (unsigned long long)wait, (unsigned long long)t->max_wait);
+
+			} else {
+				printf("%8s %8s ", "-", "-");
+			}
+
+			printf("%-6s %4d ", policy_name(s), s->priority);
+
+			if (s->cpu_mask != 0) {
+				printf("%8x\n", s->cpu_mask);
+
+			} else {
+				printf("%8s\n", "any");
+			}
+
+			t->valid = true;
+			t->cpu_time = s->cpu_time;
+			t->run_delay = s->run_delay;
+			t->wakeups = s->wakeups;
+		}
+
+		/* clear what is left of a longer list */
+		if (!once) {
+			printf("\033[J");
+		}
+
+		fflush(stdout);
+
+		if (once) {
+			return OK;
+		}
+
+		interval_start_time = new_time;
+		process_start_time = process_time;
+	}
+
+	return OK;
+}
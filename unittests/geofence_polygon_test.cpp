@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <drivers/drv_hrt.h>
+
+#include <navigator/geofence_polygon.h>
+
+#include "gtest/gtest.h"
+
+/* The PNPOLY test on raw coordinates, as Geofence::inside_polygon() did it on the dataman vertices */
+static bool pnpoly(const std::vector<float> &lat, const std::vector<float> &lon, double plat, double plon)
+{
+	bool c = false;
+
+	for (size_t i = 0, j = lat.size() - 1; i < lat.size(); j = i++) {
+		if (((double)lon[i] >= plon) != ((double)lon[j] >= plon) &&
+		    (plat <= (double)(lat[j] - lat[i]) * (plon - (double)lon[i]) /
+		     (double)(lon[j] - lon[i]) + (double)lat[i])) {
+			c = !c;
+		}
+	}
+
+	return c;
+}
+
+/* star shaped fence around 47.3977N 8.5456E with alternating radii, roughly 1km across */
+static void make_star(std::vector<float> &lat, std::vector<float> &lon, unsigned count)
+{
+	lat.clear();
+	lon.clear();
+
+	for (unsigned i = 0; i < count; i++) {
+		double angle = 2.0 * M_PI * i / count;
+		double radius = (i % 2) ? 0.004 : 0.006 + 0.001 * sin(7.0 * angle);
+		lat.push_back(47.3977 + radius * sin(angle));
+		lon.push_back(8.5456 + radius * cos(angle) * 1.5);
+	}
+}
+
+static void random_point(double *lat, double *lon)
+{
+	*lat = 47.3977 + 0.016 * (rand() / (double)RAND_MAX - 0.5);
+	*lon = 8.5456 + 0.024 * (rand() / (double)RAND_MAX - 0.5);
+}
+
+TEST(GeofencePolygonTest, Square)
+{
+	const float lat[] = { 47.0f, 47.0f, 47.01f, 47.01f };
+	const float lon[] = { 8.0f, 8.01f, 8.01f, 8.0f };
+	GeofencePolygon polygon;
+
+	ASSERT_FALSE(polygon.build(lat, lon, 2));
+	ASSERT_TRUE(polygon.empty());
+	ASSERT_TRUE(polygon.build(lat, lon, 4));
+	ASSERT_FALSE(polygon.indexed());
+
+	EXPECT_TRUE(polygon.inside(47.005, 8.005));
+	EXPECT_FALSE(polygon.inside(47.02, 8.005));
+	EXPECT_FALSE(polygon.inside(46.99, 8.005));
+	EXPECT_FALSE(polygon.inside(47.005, 8.02));
+	EXPECT_FALSE(polygon.inside(47.005, 7.99));
+
+	polygon.clear();
+	EXPECT_FALSE(polygon.inside(47.005, 8.005));
+}
+
+TEST(GeofencePolygonTest, MatchesPnpoly)
+{
+	static const unsigned counts[] = { 5, 16, 40, 1000 };
+	std::vector<float> lat, lon;
+
+	srand(1);
+
+	for (unsigned c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		make_star(lat, lon, counts[c]);
+
+		GeofencePolygon polygon;
+		ASSERT_TRUE(polygon.build(lat.data(), lon.data(), lat.size()));
+		EXPECT_EQ(counts[c] >= GeofencePolygon::INDEX_MIN_EDGES, polygon.indexed());
+
+		unsigned inside = 0, mismatches = 0;
+		const unsigned points = 20000;
+
+		for (unsigned i = 0; i < points; i++) {
+			double plat, plon;
+			random_point(&plat, &plon);
+			bool expected = pnpoly(lat, lon, plat, plon);
+
+			inside += expected;
+			mismatches += (polygon.inside(plat, plon) != expected);
+		}
+
+		/* both inside and outside points were tested */
+		EXPECT_GT(inside, points / 10);
+		EXPECT_LT(inside, points - points / 10);
+
+		/* only points within float rounding of an edge may come out differently */
+		EXPECT_LE(mismatches, points / 10000) << counts[c] << " vertices";
+	}
+}
+
+TEST(GeofencePolygonTest, Benchmark)
+{
+	std::vector<float> lat, lon;
+	make_star(lat, lon, 1000);
+
+	GeofencePolygon polygon;
+	ASSERT_TRUE(polygon.build(lat.data(), lon.data(), lat.size()));
+
+	const unsigned points = 20000;
+	std::vector<double> plat(points), plon(points);
+	srand(2);
+
+	for (unsigned i = 0; i < points; i++) {
+		random_point(&plat[i], &plon[i]);
+	}
+
+	unsigned inside_ref = 0, inside_index = 0;
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < points; i++) {
+		inside_ref += pnpoly(lat, lon, plat[i], plon[i]);
+	}
+
+	hrt_abstime ref_time = hrt_elapsed_time(&start);
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < points; i++) {
+		inside_index += polygon.inside(plat[i], plon[i]);
+	}
+
+	hrt_abstime index_time = hrt_elapsed_time(&start);
+
+	printf("1000 vertex fence: PNPOLY on raw vertices %.2f us/check, edge table with index %.3f us/check\n",
+	       (double)ref_time / points, (double)index_time / points);
+
+	EXPECT_NEAR(inside_ref, inside_index, 2);
+	EXPECT_LT(index_time, ref_time);
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include <drivers/drv_hrt.h>
+
+#include <navigator/geofence_zones.h>
+
+#include "gtest/gtest.h"
+
+/* meters per degree of latitude on the sphere the geofence uses */
+static const double METERS_PER_DEGREE = 6371000.0 * M_PI / 180.0;
+
+/* square of side 2 * half_size meters around a center */
+static void make_square(float *lat, float *lon, double clat, double clon, double half_size)
+{
+	double dlat = half_size / METERS_PER_DEGREE;
+	double dlon = dlat / cos(clat * M_PI / 180.0);
+
+	lat[0] = clat - dlat; lon[0] = clon - dlon;
+	lat[1] = clat - dlat; lon[1] = clon + dlon;
+	lat[2] = clat + dlat; lon[2] = clon + dlon;
+	lat[3] = clat + dlat; lon[3] = clon - dlon;
+}
+
+/* point offset north and east of a reference in meters */
+static void offset(double clat, double clon, double north, double east, double *lat, double *lon)
+{
+	*lat = clat + north / METERS_PER_DEGREE;
+	*lon = clon + east / (METERS_PER_DEGREE * cos(clat * M_PI / 180.0));
+}
+
+TEST(GeofenceZonesTest, InclusionWithHoles)
+{
+	const double clat = 47.3977, clon = 8.5456;
+	float lat[4], lon[4];
+	GeofenceZones zones;
+	double plat, plon;
+
+	EXPECT_TRUE(zones.empty());
+	EXPECT_TRUE(zones.inside(clat, clon));
+	EXPECT_TRUE(isinf(zones.distance(clat, clon)));
+
+	/* 1km square to stay in, with a 100m circle and a 100m square to stay out of */
+	make_square(lat, lon, clat, clon, 500.0);
+	ASSERT_TRUE(zones.add_polygon(true, lat, lon, 4));
+	ASSERT_TRUE(zones.add_circle(false, clat, clon, 50.0f));
+	offset(clat, clon, 300.0, 0.0, &plat, &plon);
+	make_square(lat, lon, plat, plon, 50.0);
+	ASSERT_TRUE(zones.add_polygon(false, lat, lon, 4));
+	ASSERT_FALSE(zones.add_circle(false, clat, clon, 0.0f));
+	ASSERT_FALSE(zones.add_polygon(false, lat, lon, 2));
+
+	/* in the circle */
+	offset(clat, clon, 0.0, 20.0, &plat, &plon);
+	EXPECT_FALSE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), -30.0f, 0.5f);
+
+	/* between the circle and the outer boundary */
+	offset(clat, clon, 0.0, 200.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 150.0f, 0.5f);
+
+	offset(clat, clon, 0.0, 480.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 20.0f, 0.5f);
+
+	/* in the square hole */
+	offset(clat, clon, 310.0, 0.0, &plat, &plon);
+	EXPECT_FALSE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), -40.0f, 0.5f);
+
+	/* next to the square hole */
+	offset(clat, clon, 300.0, 80.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 30.0f, 0.5f);
+
+	/* outside of everything */
+	offset(clat, clon, 0.0, -600.0, &plat, &plon);
+	EXPECT_FALSE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), -100.0f, 0.5f);
+
+	zones.clear();
+	EXPECT_TRUE(zones.empty());
+	EXPECT_TRUE(zones.inside(plat, plon));
+}
+
+TEST(GeofenceZonesTest, UnionOfInclusions)
+{
+	const double clat = 47.3977, clon = 8.5456;
+	GeofenceZones zones;
+	double plat, plon;
+
+	/* two overlapping circles, the allowed area is their union */
+	ASSERT_TRUE(zones.add_circle(true, clat, clon, 100.0f));
+	offset(clat, clon, 0.0, 150.0, &plat, &plon);
+	ASSERT_TRUE(zones.add_circle(true, plat, plon, 100.0f));
+
+	offset(clat, clon, 0.0, 200.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 50.0f, 0.5f);
+
+	offset(clat, clon, 0.0, -80.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 20.0f, 0.5f);
+
+	offset(clat, clon, 0.0, 260.0, &plat, &plon);
+	EXPECT_FALSE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), -10.0f, 0.5f);
+
+	/* exclusion zones only, everything else is allowed */
+	zones.clear();
+	ASSERT_TRUE(zones.add_circle(false, clat, clon, 100.0f));
+
+	offset(clat, clon, 130.0, 0.0, &plat, &plon);
+	EXPECT_TRUE(zones.inside(plat, plon));
+	EXPECT_NEAR(zones.distance(plat, plon), 30.0f, 0.5f);
+}
+
+TEST(GeofenceZonesTest, DistanceMatchesSign)
+{
+	const double clat = 47.3977, clon = 8.5456;
+	float lat[4], lon[4];
+	GeofenceZones zones;
+
+	make_square(lat, lon, clat, clon, 500.0);
+	ASSERT_TRUE(zones.add_polygon(true, lat, lon, 4));
+	ASSERT_TRUE(zones.add_circle(false, clat, clon, 120.0f));
+	ASSERT_TRUE(zones.add_circle(true, clat + 0.006, clon, 200.0f));
+
+	srand(1);
+
+	for (unsigned i = 0; i < 20000; i++) {
+		double plat, plon;
+		offset(clat, clon, 1600.0 * (rand() / (double)RAND_MAX - 0.5), 1600.0 * (rand() / (double)RAND_MAX - 0.5),
+		       &plat, &plon);
+		float distance = zones.distance(plat, plon);
+
+		/* points within float rounding of a boundary may come out either way */
+		if (fabsf(distance) > 0.5f) {
+			ASSERT_EQ(zones.inside(plat, plon), distance > 0.0f) << plat << " " << plon << " " << distance;
+		}
+	}
+}
+
+TEST(GeofenceZonesTest, Benchmark)
+{
+	const double clat = 47.3977, clon = 8.5456;
+	float lat[4], lon[4];
+	GeofenceZones zones;
+
+	/* a large inclusion square with the maximum number of small exclusion zones spread over it */
+	make_square(lat, lon, clat, clon, 2000.0);
+	ASSERT_TRUE(zones.add_polygon(true, lat, lon, 4));
+
+	for (unsigned i = 1; i < GeofenceZones::MAX_POLYGONS; i++) {
+		double plat, plon;
+		offset(clat, clon, 400.0 * i - 1600.0, 1000.0, &plat, &plon);
+		make_square(lat, lon, plat, plon, 50.0);
+		ASSERT_TRUE(zones.add_polygon(false, lat, lon, 4));
+	}
+
+	for (unsigned i = 0; i < GeofenceZones::MAX_CIRCLES; i++) {
+		double plat, plon;
+		offset(clat, clon, 200.0 * i - 1600.0, -1000.0, &plat, &plon);
+		ASSERT_TRUE(zones.add_circle(false, plat, plon, 50.0f));
+	}
+
+	const unsigned points = 20000;
+	std::vector<double> plat(points), plon(points);
+	srand(2);
+
+	for (unsigned i = 0; i < points; i++) {
+		offset(clat, clon, 4000.0 * (rand() / (double)RAND_MAX - 0.5), 4000.0 * (rand() / (double)RAND_MAX - 0.5),
+		       &plat[i], &plon[i]);
+	}
+
+	unsigned inside = 0;
+	hrt_abstime start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < points; i++) {
+		inside += zones.inside(plat[i], plon[i]);
+	}
+
+	hrt_abstime inside_time = hrt_elapsed_time(&start);
+	double sum = 0.0;
+	start = hrt_absolute_time();
+
+	for (unsigned i = 0; i < points; i++) {
+		sum += zones.distance(plat[i], plon[i]);
+	}
+
+	hrt_abstime distance_time = hrt_elapsed_time(&start);
+
+	printf("%u polygons, %u circles: inside %.3f us/check, signed distance %.3f us/check\n",
+	       GeofenceZones::MAX_POLYGONS, GeofenceZones::MAX_CIRCLES,
+	       (double)inside_time / points, (double)distance_time / points);
+
+	EXPECT_GT(inside, points / 2);
+	EXPECT_GT(sum, 0.0);
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <mavlink/mavlink_command_queue.h>
+
+#include "gtest/gtest.h"
+
+TEST(MavlinkCommandQueueTest, Order)
+{
+	MavlinkCommandQueue queue;
+	MavlinkCommandQueue::command cmd;
+
+	ASSERT_FALSE(queue.pop(&cmd));
+
+	uint32_t ticket;
+	ASSERT_TRUE(queue.push("HEARTBEAT", 1.0f, &ticket));
+	ASSERT_TRUE(queue.push("ATTITUDE", 50.0f));
+	ASSERT_FALSE(queue.is_done(ticket));
+
+	ASSERT_TRUE(queue.pop(&cmd));
+	ASSERT_STREQ("HEARTBEAT", cmd.stream_name);
+	ASSERT_EQ(1.0f, cmd.rate);
+
+	/* not applied until the consumer says so */
+	ASSERT_FALSE(queue.is_done(ticket));
+	queue.complete();
+	ASSERT_TRUE(queue.is_done(ticket));
+
+	ASSERT_TRUE(queue.pop(&cmd));
+	ASSERT_STREQ("ATTITUDE", cmd.stream_name);
+	ASSERT_FALSE(queue.pop(&cmd));
+}
+
+TEST(MavlinkCommandQueueTest, Bounded)
+{
+	MavlinkCommandQueue queue;
+	MavlinkCommandQueue::command cmd;
+	char name[MavlinkCommandQueue::NAME_LEN];
+
+	for (unsigned i = 0; i < MavlinkCommandQueue::CAPACITY; i++) {
+		snprintf(name, sizeof(name), "S%u", i);
+		ASSERT_TRUE(queue.push(name, (float)i));
+	}
+
+	ASSERT_FALSE(queue.push("FULL", 1.0f));
+	ASSERT_EQ(1u, queue.get_dropped());
+
+	/* freeing one slot makes room for exactly one more */
+	ASSERT_TRUE(queue.pop(&cmd));
+	ASSERT_STREQ("S0", cmd.stream_name);
+	ASSERT_TRUE(queue.push("LATE", 1.0f));
+	ASSERT_FALSE(queue.push("FULL", 1.0f));
+
+	char too_long[MavlinkCommandQueue::NAME_LEN + 1];
+	memset(too_long, 'X', sizeof(too_long) - 1);
+	too_long[sizeof(too_long) - 1] = '\0';
+
+	while (queue.pop(&cmd)) {}
+
+	ASSERT_FALSE(queue.push(too_long, 1.0f));
+}
+
+TEST(MavlinkCommandQueueTest, Batch)
+{
+	MavlinkCommandQueue queue;
+	MavlinkCommandQueue::command cmd;
+
+	const char *names[] = { "GPS_RAW_INT", "VFR_HUD", "ATTITUDE" };
+	const float rates[] = { 5.0f, 4.0f, 0.0f };
+
+	/* leave room for two only, the batch must not be split */
+	for (unsigned i = 0; i < MavlinkCommandQueue::CAPACITY - 2; i++) {
+		ASSERT_TRUE(queue.push("FILL", 1.0f));
+	}
+
+	ASSERT_FALSE(queue.push(names, rates, 3));
+	ASSERT_TRUE(queue.pop(&cmd));
+
+	uint32_t ticket;
+	ASSERT_TRUE(queue.push(names, rates, 3, &ticket));
+
+	unsigned fill = 0;
+
+	while (queue.pop(&cmd) && strcmp(cmd.stream_name, "FILL") == 0) {
+		fill++;
+	}
+
+	ASSERT_EQ(MavlinkCommandQueue::CAPACITY - 3, fill);
+	ASSERT_STREQ("GPS_RAW_INT", cmd.stream_name);
+	ASSERT_TRUE(queue.pop(&cmd));
+	ASSERT_STREQ("VFR_HUD", cmd.stream_name);
+	queue.complete();
+	ASSERT_FALSE(queue.is_done(ticket));
+
+	ASSERT_TRUE(queue.pop(&cmd));
+	ASSERT_STREQ("ATTITUDE", cmd.stream_name);
+	ASSERT_EQ(0.0f, cmd.rate);
+	queue.complete();
+	ASSERT_TRUE(queue.is_done(ticket));
+}
+
+/* several producers, e.g. receiver threads and the shell, against one main loop */
+static const unsigned producers = 4;
+static const unsigned per_producer = 5000;
+
+static void *producer(void *arg)
+{
+	MavlinkCommandQueue *queue = (MavlinkCommandQueue *)arg;
+	static unsigned next_id = 0;
+	unsigned id = __sync_fetch_and_add(&next_id, 1);
+	char name[MavlinkCommandQueue::NAME_LEN];
+
+	for (unsigned i = 0; i < per_producer;) {
+		snprintf(name, sizeof(name), "P%u", id);
+
+		/* never blocks, retry when the consumer is behind */
+		if (queue->push(name, (float)i)) {
+			i++;
+
+		} else {
+			sched_yield();
+		}
+	}
+
+	return nullptr;
+}
+
+TEST(MavlinkCommandQueueTest, Concurrent)
+{
+	MavlinkCommandQueue queue;
+	pthread_t threads[producers];
+
+	for (unsigned i = 0; i < producers; i++) {
+		ASSERT_EQ(0, pthread_create(&threads[i], nullptr, producer, &queue));
+	}
+
+	float last[producers];
+
+	for (unsigned i = 0; i < producers; i++) {
+		last[i] = -1.0f;
+	}
+
+	MavlinkCommandQueue::command cmd;
+	unsigned received = 0;
+
+	while (received < producers * per_producer) {
+		if (!queue.pop(&cmd)) {
+			sched_yield();
+			continue;
+		}
+
+		unsigned id;
+		ASSERT_EQ(1, sscanf(cmd.stream_name, "P%u", &id));
+		ASSERT_LT(id, producers);
+
+		/* per producer FIFO, nothing lost, nothing torn */
+		ASSERT_EQ(last[id] + 1.0f, cmd.rate);
+		last[id] = cmd.rate;
+		received++;
+	}
+
+	queue.complete();
+
+	for (unsigned i = 0; i < producers; i++) {
+		pthread_join(threads[i], nullptr);
+	}
+
+	ASSERT_FALSE(queue.pop(&cmd));
+}
@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <drivers/drv_hrt.h>
+
+#include <mavlink/mavlink_frame_parser.h>
+
+#include "gtest/gtest.h"
+
+/* per byte CRC as in the MAVLink checksum.h */
+static void crc_accumulate_byte(uint8_t data, uint16_t *crc)
+{
+	uint8_t tmp = data ^ (uint8_t)(*crc & 0xff);
+	tmp ^= (tmp << 4);
+	*crc = (*crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+/*
+ * The per byte state machine of mavlink_parse_char(), MAVLink 1.0, including
+ * the copy of the whole message struct it does for every frame.
+ */
+class ByteParser
+{
+public:
+	ByteParser(const uint8_t *crc_extra) : _crc_extra(crc_extra), _state(0), _len(0), _idx(0), _crc(0), _frame(), _msg() {}
+
+	bool parse_char(uint8_t c)
+	{
+		switch (_state) {
+		case 0:
+			if (c == MavlinkFrameParser::STX) {
+				_crc = 0xFFFF;
+				_idx = 0;
+				_frame[_idx++] = c;
+				_state = 1;
+			}
+
+			return false;
+
+		case 1:
+			_len = c;
+			_frame[_idx++] = c;
+			crc_accumulate_byte(c, &_crc);
+			_state = 2;
+			return false;
+
+		case 2:
+			_frame[_idx++] = c;
+			crc_accumulate_byte(c, &_crc);
+
+			if (_idx == MavlinkFrameParser::HEADER_LEN + _len) {
+				_state = 3;
+			}
+
+			return false;
+
+		case 3:
+			crc_accumulate_byte(_crc_extra[_frame[5]], &_crc);
+
+			if (c != (uint8_t)(_crc & 0xFF)) {
+				_state = 0;
+				return false;
+			}
+
+			_frame[_idx++] = c;
+			_state = 4;
+			return false;
+
+		default:
+			_state = 0;
+
+			if (c != (uint8_t)(_crc >> 8)) {
+				return false;
+			}
+
+			_frame[_idx++] = c;
+			memcpy(_msg, _frame, sizeof(_msg));
+			return true;
+		}
+	}
+
+	const uint8_t *frame() const { return _frame; }
+	unsigned len() const { return _idx; }
+
+private:
+	const uint8_t *_crc_extra;
+	int _state;
+	unsigned _len;
+	unsigned _idx;
+	uint16_t _crc;
+	uint8_t _frame[MavlinkFrameParser::MAX_FRAME_LEN + 9];	///< sizeof(mavlink_message_t)
+	uint8_t _msg[MavlinkFrameParser::MAX_FRAME_LEN + 9];
+};
+
+static uint8_t crc_extra[256];
+
+static void init_crc_extra()
+{
+	srand(42);
+
+	for (unsigned i = 0; i < 256; i++) {
+		crc_extra[i] = rand() & 0xFF;
+	}
+}
+
+static void append_frame(std::vector<uint8_t> &out, uint8_t seq, uint8_t msgid, uint8_t len)
+{
+	size_t start = out.size();
+	out.push_back(MavlinkFrameParser::STX);
+	out.push_back(len);
+	out.push_back(seq);
+	out.push_back(1);
+	out.push_back(1);
+	out.push_back(msgid);
+
+	for (unsigned i = 0; i < len; i++) {
+		/* plenty of start bytes inside payloads */
+		out.push_back((rand() % 8 == 0) ? MavlinkFrameParser::STX : rand() & 0xFF);
+	}
+
+	uint16_t crc = 0xFFFF;
+
+	for (size_t i = start + 1; i < out.size(); i++) {
+		crc_accumulate_byte(out[i], &crc);
+	}
+
+	crc_accumulate_byte(crc_extra[msgid], &crc);
+	out.push_back(crc & 0xFF);
+	out.push_back(crc >> 8);
+}
+
+/*
+ * A telemetry like byte stream: a mix of short and long messages, and
+ * optionally line noise and corrupted frames in between.
+ */
+static void make_capture(std::vector<uint8_t> &out, std::vector<size_t> &valid, unsigned frames, bool noisy)
+{
+	static const uint8_t lengths[] = { 9, 28, 31, 20, 30, 36, 42, 51, 255 };
+
+	for (unsigned i = 0; i < frames; i++) {
+		if (noisy && rand() % 10 == 0) {
+			unsigned garbage = rand() % 40;
+
+			for (unsigned j = 0; j < garbage; j++) {
+				out.push_back(rand() & 0xFF);
+			}
+		}
+
+		size_t start = out.size();
+		append_frame(out, i & 0xFF, rand() & 0xFF, lengths[rand() % sizeof(lengths)]);
+
+		if (noisy && rand() % 20 == 0) {
+			/* flip a bit anywhere after the start byte */
+			out[start + 1 + rand() % (out.size() - start - 1)] ^= 1 << (rand() % 8);
+
+		} else {
+			valid.push_back(start);
+		}
+	}
+}
+
+/* stands in for the message the receiver fills from each frame */
+static uint8_t msg_payload[MavlinkFrameParser::MAX_FRAME_LEN];
+
+static unsigned parse_in_chunks(MavlinkFrameParser &parser, const std::vector<uint8_t> &data, unsigned chunk,
+				std::vector<size_t> *found)
+{
+	unsigned count = 0;
+
+	for (size_t pos = 0; pos < data.size(); pos += chunk) {
+		size_t n = (data.size() - pos < chunk) ? data.size() - pos : chunk;
+		parser.feed(&data[pos], n);
+
+		const uint8_t *frame;
+		unsigned len;
+
+		while (parser.next(&frame, &len)) {
+			if (found != nullptr) {
+				/* identify the frame by its position in the stream, frames come in order */
+				const uint8_t *p = &data[0];
+				size_t off;
+
+				if (frame >= p && frame < p + data.size()) {
+					off = frame - p;
+
+				} else {
+					/* returned from the carry buffer */
+					off = found->empty() ? 0 : found->back() + 1;
+
+					while (off + len <= data.size() && memcmp(&data[off], frame, len) != 0) {
+						off++;
+					}
+				}
+
+				found->push_back(off);
+			}
+
+			memcpy(msg_payload, frame, len);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+TEST(MavlinkFrameParserTest, Crc)
+{
+	uint8_t buf[300];
+
+	for (unsigned i = 0; i < sizeof(buf); i++) {
+		buf[i] = rand() & 0xFF;
+	}
+
+	uint16_t crc = 0xFFFF;
+
+	for (unsigned i = 0; i < sizeof(buf); i++) {
+		crc_accumulate_byte(buf[i], &crc);
+	}
+
+	ASSERT_EQ(crc, MavlinkFrameParser::crc_accumulate(0xFFFF, buf, sizeof(buf)));
+}
+
+TEST(MavlinkFrameParserTest, CleanStream)
+{
+	init_crc_extra();
+
+	std::vector<uint8_t> data;
+	std::vector<size_t> valid;
+	make_capture(data, valid, 2000, false);
+
+	/* UART sized reads, a datagram, everything at once, and one byte at a time */
+	static const unsigned chunks[] = { 1, 7, 32, 128, 1500, 1000000 };
+
+	for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+		MavlinkFrameParser parser(crc_extra);
+		std::vector<size_t> found;
+		parse_in_chunks(parser, data, chunks[c], &found);
+
+		ASSERT_EQ(valid, found) << "chunk " << chunks[c];
+		ASSERT_EQ(0u, parser.get_crc_errors());
+		ASSERT_EQ(0u, parser.get_skipped_bytes());
+	}
+}
+
+TEST(MavlinkFrameParserTest, NoisyStream)
+{
+	init_crc_extra();
+
+	std::vector<uint8_t> data;
+	std::vector<size_t> valid;
+	make_capture(data, valid, 5000, true);
+
+	/* the byte parser does not rescan a rejected frame, it finds at most as much */
+	ByteParser reference(crc_extra);
+	unsigned reference_frames = 0;
+
+	for (size_t i = 0; i < data.size(); i++) {
+		if (reference.parse_char(data[i])) {
+			reference_frames++;
+		}
+	}
+
+	static const unsigned chunks[] = { 1, 5, 32, 1500 };
+
+	for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+		MavlinkFrameParser parser(crc_extra);
+		std::vector<size_t> found;
+		parse_in_chunks(parser, data, chunks[c], &found);
+
+		ASSERT_EQ(valid, found) << "chunk " << chunks[c];
+		ASSERT_GE(found.size(), reference_frames);
+		ASSERT_GT(parser.get_crc_errors(), 0u);
+	}
+}
+
+TEST(MavlinkFrameParserTest, Benchmark)
+{
+	init_crc_extra();
+
+	std::vector<uint8_t> data;
+
+	/*
+	 * A raw capture, e.g. a telemetry log, can be given with MAVLINK_CAPTURE.
+	 * Anything between the frames, like log timestamps, is skipped.
+	 */
+	const char *path = getenv("MAVLINK_CAPTURE");
+
+	if (path != nullptr) {
+		FILE *fp = fopen(path, "rb");
+		ASSERT_TRUE(fp != nullptr);
+		uint8_t buf[4096];
+		size_t n;
+
+		while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+			data.insert(data.end(), buf, buf + n);
+		}
+
+		fclose(fp);
+
+	} else {
+		std::vector<size_t> valid;
+		make_capture(data, valid, 20000, false);
+	}
+
+	static const unsigned chunks[] = { 32, 1500 };
+	const unsigned rounds = 5;
+
+	for (unsigned c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+		unsigned byte_frames = 0;
+		hrt_abstime start = hrt_absolute_time();
+
+		for (unsigned r = 0; r < rounds; r++) {
+			ByteParser reference(crc_extra);
+
+			for (size_t i = 0; i < data.size(); i++) {
+				if (reference.parse_char(data[i])) {
+					byte_frames++;
+				}
+			}
+		}
+
+		hrt_abstime byte_time = hrt_absolute_time() - start;
+
+		unsigned bulk_frames = 0;
+		start = hrt_absolute_time();
+
+		for (unsigned r = 0; r < rounds; r++) {
+			MavlinkFrameParser parser(crc_extra);
+			bulk_frames += parse_in_chunks(parser, data, chunks[c], nullptr);
+		}
+
+		hrt_abstime bulk_time = hrt_absolute_time() - start;
+
+		ASSERT_GE(bulk_frames, byte_frames);
+
+		double mbytes = (double)data.size() * rounds / 1e6;
+		printf("%u byte reads: parse_char %.1f MB/s, frame parser %.1f MB/s\n", chunks[c],
+		       mbytes / (byte_time > 0 ? byte_time : 1) * 1e6, mbytes / (bulk_time > 0 ? bulk_time : 1) * 1e6);
+	}
+}
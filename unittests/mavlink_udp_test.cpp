@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <drivers/drv_hrt.h>
+
+#include <mavlink/mavlink_udp_batch.h>
+
+#include "gtest/gtest.h"
+
+/* loopback socket standing in for the GCS */
+static int open_receiver(unsigned short &port)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		return -1;
+	}
+
+	int rcvbuf = 4 * 1024 * 1024;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	/* poll-free draining below */
+	struct timeval tv = { 0, 100000 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	socklen_t len = sizeof(addr);
+	getsockname(fd, (struct sockaddr *)&addr, &len);
+	port = ntohs(addr.sin_port);
+
+	return fd;
+}
+
+static unsigned drain(int fd, unsigned expected)
+{
+	uint8_t buf[1500];
+	unsigned received = 0;
+
+	while (received < expected && recv(fd, buf, sizeof(buf), 0) > 0) {
+		received++;
+	}
+
+	return received;
+}
+
+static uint64_t thread_cpu_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+TEST(MavlinkUDPTest, BatchDelivery)
+{
+	unsigned short port;
+	int rx = open_receiver(port);
+	ASSERT_GE(rx, 0);
+
+	MavlinkUDPBatch batch;
+	ASSERT_EQ(batch.open(0, "127.0.0.1", port), 0);
+
+	const unsigned count = 100;
+	uint8_t packet[MavlinkUDPBatch::MAX_PACKET_LEN];
+
+	for (unsigned i = 0; i < count; i++) {
+		unsigned len = 8 + (i * 7) % 256;
+		memset(packet, i, len);
+		ASSERT_TRUE(batch.add(packet, len));
+	}
+
+	ASSERT_FALSE(batch.add(packet, MavlinkUDPBatch::MAX_PACKET_LEN + 1));
+
+	ASSERT_EQ(batch.flush(), 0u);
+	ASSERT_EQ(batch.queued(), 0u);
+	ASSERT_EQ(batch.get_sent(), count);
+
+	/* three full batches flushed by add() plus the final flush */
+	ASSERT_EQ(batch.get_syscalls(), (count + MavlinkUDPBatch::MAX_PACKETS - 1) / MavlinkUDPBatch::MAX_PACKETS);
+
+	/* datagrams arrive whole and in order */
+	for (unsigned i = 0; i < count; i++) {
+		uint8_t buf[1500];
+		ssize_t len = recv(rx, buf, sizeof(buf), 0);
+		ASSERT_EQ(len, (ssize_t)(8 + (i * 7) % 256));
+		ASSERT_EQ(buf[0], (uint8_t)i);
+		ASSERT_EQ(buf[len - 1], (uint8_t)i);
+	}
+
+	close(rx);
+}
+
+TEST(MavlinkUDPTest, BatchDropped)
+{
+	/* never opened, the socket refuses every datagram */
+	MavlinkUDPBatch batch;
+
+	const unsigned count = MavlinkUDPBatch::MAX_PACKETS + 8;
+	uint8_t packet[64] = {};
+
+	for (unsigned i = 0; i < count; i++) {
+		ASSERT_TRUE(batch.add(packet, sizeof(packet)));
+	}
+
+	/* includes the datagrams dropped by the flush inside add() */
+	ASSERT_EQ(batch.flush(), count);
+	ASSERT_EQ(batch.flush(), 0u);
+	ASSERT_EQ(batch.get_sent(), 0u);
+	ASSERT_EQ(batch.get_dropped(), count);
+}
+
+TEST(MavlinkUDPTest, BatchBenchmark)
+{
+	unsigned short port;
+	int rx = open_receiver(port);
+	ASSERT_GE(rx, 0);
+
+	/* an ATTITUDE message is 36 bytes on the wire */
+	const unsigned packet_len = 36;
+	const unsigned round = 512;
+	const unsigned rounds = 40;
+	uint8_t packet[packet_len] = {};
+
+	/* batch size 1 is the old one send per message behaviour */
+	const unsigned batch_sizes[] = { 1, 8, MavlinkUDPBatch::MAX_PACKETS };
+
+	for (unsigned b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+		MavlinkUDPBatch batch;
+		ASSERT_EQ(batch.open(0, "127.0.0.1", port), 0);
+
+		uint64_t cpu = 0;
+		hrt_abstime elapsed = 0;
+		unsigned received = 0;
+
+		for (unsigned r = 0; r < rounds; r++) {
+			uint64_t cpu_start = thread_cpu_ns();
+			hrt_abstime start = hrt_absolute_time();
+
+			for (unsigned i = 0; i < round; i++) {
+				batch.add(packet, packet_len);
+
+				if (batch.queued() == batch_sizes[b]) {
+					batch.flush();
+				}
+			}
+
+			batch.flush();
+
+			elapsed += hrt_absolute_time() - start;
+			cpu += thread_cpu_ns() - cpu_start;
+
+			/* keep the receive buffer from overflowing, not timed */
+			received += drain(rx, round);
+		}
+
+		unsigned messages = round * rounds;
+		EXPECT_EQ(batch.get_sent(), messages);
+		EXPECT_EQ(received, messages);
+
+		printf("batch %2u: %8.0f msgs/s, %6.1f us CPU per 1000 msgs, %u send calls\n", batch_sizes[b],
+		       messages * 1e6 / (elapsed > 0 ? elapsed : 1), cpu / 1000.0 / (messages / 1000.0),
+		       (unsigned)batch.get_syscalls());
+	}
+
+	close(rx);
+}
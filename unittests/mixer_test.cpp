@@ -1,12 +1,293 @@
 #include <systemlib/mixer/mixer.h>
+#include <systemlib/mixer/mixer_multirotor.generated.h>
 #include <systemlib/err.h>
+#include <px4iofirmware/protocol.h>
+#include <math.h>
+#include <drivers/drv_hrt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../../src/systemcmds/tests/tests.h"
 
 #include "gtest/gtest.h"
 
+/* control group 0 as seen by the mixer callback */
+static float mixer_controls[4];
+
+static int mixer_callback(uintptr_t handle, uint8_t control_group, uint8_t control_index, float &control)
+{
+	if (control_group != 0 || control_index >= 4) {
+		return -1;
+	}
+
+	control = mixer_controls[control_index];
+	return 0;
+}
+
+/* control vectors spanning the full input range, including saturation */
+static void fill_controls(float *controls, unsigned count)
+{
+	srand(42);
+
+	for (unsigned i = 0; i < count * 4; i++) {
+		controls[i] = (rand() / (float)RAND_MAX) * 2.4f - 1.2f;
+	}
+}
+
+static const struct {
+	const char *name;
+	const char *spec;
+	unsigned rotors;
+	const MultirotorMixer::RotorTable *table;
+} mixer_geometries[] = {
+	{ "4x", "R: 4x 10000 10000 10000 1000\n", 4, &_config_quad_x },
+	{ "6x", "R: 6x 10000 10000 10000 1000\n", 6, &_config_hex_x },
+	{ "8x", "R: 8x 10000 10000 10000 1000\n", 8, &_config_octa_x },
+};
+
+/* idle speed of the geometries above, shifted to the output range */
+static const float mixer_idle_speed = -1.0f + 0.1f * 2.0f;
+
+static float reference_constrain(float val, float min, float max)
+{
+	return (val < min) ? min : ((val > max) ? max : val);
+}
+
+/*
+ * The original per-rotor multirotor mix, as a reference for the SIMD kernels.
+ * Roll, pitch and yaw scales are 1, as in the geometries above.
+ */
+static unsigned reference_mix(const MultirotorMixer::RotorTable *t, unsigned rotor_count, const float *controls,
+			      float *outputs, uint16_t *status_reg)
+{
+	float roll = reference_constrain(controls[0], -1.0f, 1.0f);
+	float pitch = reference_constrain(controls[1], -1.0f, 1.0f);
+	float yaw = reference_constrain(controls[2], -1.0f, 1.0f);
+	float thrust = reference_constrain(controls[3], 0.0f, 1.0f);
+	float min_out = 0.0f;
+	float max_out = 0.0f;
+
+	*status_reg = 0;
+
+	float thrust_increase_factor = 1.5f;
+	float thrust_decrease_factor = 0.6f;
+
+	for (unsigned i = 0; i < rotor_count; i++) {
+		float out = roll * t->roll_scale[i] + pitch * t->pitch_scale[i] + thrust;
+
+		out *= t->out_scale[i];
+
+		if (out < min_out) {
+			min_out = out;
+		}
+
+		if (out > max_out) {
+			max_out = out;
+		}
+
+		outputs[i] = out;
+	}
+
+	float boost = 0.0f;
+	float roll_pitch_scale = 1.0f;
+
+	if (min_out < 0.0f && max_out < 1.0f && -min_out <= 1.0f - max_out) {
+		float max_thrust_diff = thrust * thrust_increase_factor - thrust;
+
+		if (max_thrust_diff >= -min_out) {
+			boost = -min_out;
+
+		} else {
+			boost = max_thrust_diff;
+			roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+		}
+
+	} else if (max_out > 1.0f && min_out > 0.0f && min_out >= max_out - 1.0f) {
+		float max_thrust_diff = thrust - thrust_decrease_factor * thrust;
+
+		if (max_thrust_diff >= max_out - 1.0f) {
+			boost = -(max_out - 1.0f);
+
+		} else {
+			boost = -max_thrust_diff;
+			roll_pitch_scale = (1 - (thrust + boost)) / (max_out - thrust);
+		}
+
+	} else if (min_out < 0.0f && max_out < 1.0f && -min_out > 1.0f - max_out) {
+		float max_thrust_diff = thrust * thrust_increase_factor - thrust;
+		boost = reference_constrain(-min_out - (1.0f - max_out) / 2.0f, 0.0f, max_thrust_diff);
+		roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+
+	} else if (max_out > 1.0f && min_out > 0.0f && min_out < max_out - 1.0f) {
+		float max_thrust_diff = thrust - thrust_decrease_factor * thrust;
+		boost = reference_constrain(-(max_out - 1.0f - min_out) / 2.0f, -max_thrust_diff, 0.0f);
+		roll_pitch_scale = (1 - (thrust + boost)) / (max_out - thrust);
+
+	} else if (min_out < 0.0f && max_out > 1.0f) {
+		boost = reference_constrain(-(max_out - 1.0f + min_out) / 2.0f, thrust_decrease_factor * thrust - thrust,
+					    thrust_increase_factor * thrust - thrust);
+		roll_pitch_scale = (thrust + boost) / (thrust - min_out);
+	}
+
+	if (min_out < 0.0f) {
+		*status_reg |= PX4IO_P_STATUS_MIXER_LOWER_LIMIT;
+	}
+
+	if (max_out > 0.0f) {
+		*status_reg |= PX4IO_P_STATUS_MIXER_UPPER_LIMIT;
+	}
+
+	for (unsigned i = 0; i < rotor_count; i++) {
+		float out = (roll * t->roll_scale[i] + pitch * t->pitch_scale[i]) * roll_pitch_scale +
+			    yaw * t->yaw_scale[i] + thrust + boost;
+
+		out *= t->out_scale[i];
+
+		if (out < 0.0f) {
+			yaw = -((roll * t->roll_scale[i] + pitch * t->pitch_scale[i]) * roll_pitch_scale + thrust + boost) /
+			      t->yaw_scale[i];
+			*status_reg |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
+
+		} else if (out > 1.0f) {
+			float thrust_reduction = fminf(0.15f, out - 1.0f);
+			thrust -= thrust_reduction;
+			yaw = (1.0f - ((roll * t->roll_scale[i] + pitch * t->pitch_scale[i]) * roll_pitch_scale + thrust + boost)) /
+			      t->yaw_scale[i];
+			*status_reg |= PX4IO_P_STATUS_MIXER_YAW_LIMIT;
+		}
+	}
+
+	for (unsigned i = 0; i < rotor_count; i++) {
+		outputs[i] = (roll * t->roll_scale[i] + pitch * t->pitch_scale[i]) * roll_pitch_scale +
+			     yaw * t->yaw_scale[i] + thrust + boost;
+
+		outputs[i] = reference_constrain(mixer_idle_speed + (outputs[i] * (1.0f - mixer_idle_speed)),
+						 mixer_idle_speed, 1.0f);
+	}
+
+	return rotor_count;
+}
+
+static MultirotorMixer *load_geometry(unsigned g)
+{
+	unsigned buflen = strlen(mixer_geometries[g].spec);
+	return MultirotorMixer::from_text(mixer_callback, 0, mixer_geometries[g].spec, buflen);
+}
 
 TEST(MixerTest, Mixer)
 {
 	char *args[] = {"empty", "../ROMFS/px4fmu_common/mixers/IO_pass.mix", "../ROMFS/px4fmu_common/mixers/quad_w.main.mix"};
 	ASSERT_EQ(test_mixer(3, args), 0) << "IO_pass.mix failed";
 }
+
+/* control vectors at and beyond the corners of the input range, each one sets a limit flag */
+static const float saturating_controls[][4] = {
+	{  0.0f,  0.0f,  0.0f,  1.0f },
+	{  0.5f,  0.0f,  0.0f,  0.0f },
+	{  1.0f,  0.0f,  0.0f,  1.0f },
+	{ -1.0f,  0.0f,  0.0f,  0.0f },
+	{  1.0f,  1.0f,  1.0f,  1.0f },
+	{ -1.0f, -1.0f, -1.0f,  0.05f },
+	{  0.0f,  0.0f,  1.0f,  0.5f },
+	{  0.0f,  0.0f, -1.0f,  0.95f },
+	{  0.8f, -0.8f,  0.5f,  0.9f },
+	{  2.0f, -2.0f,  2.0f,  2.0f },
+};
+
+TEST(MixerTest, MultirotorBatch)
+{
+	const unsigned saturating = sizeof(saturating_controls) / sizeof(saturating_controls[0]);
+	const unsigned count = 1000;
+	float controls[count * 4];
+	fill_controls(controls, count);
+	memcpy(controls, saturating_controls, sizeof(saturating_controls));
+
+	for (unsigned g = 0; g < sizeof(mixer_geometries) / sizeof(mixer_geometries[0]); g++) {
+		MultirotorMixer *mixer = load_geometry(g);
+		ASSERT_NE(mixer, nullptr) << mixer_geometries[g].name;
+		const unsigned rotors = mixer_geometries[g].rotors;
+
+		float batch[count * MultirotorMixer::MAX_ROTORS];
+		uint16_t batch_status[count];
+
+		ASSERT_EQ(mixer->mix_batch(controls, count, batch, count * rotors, batch_status), count);
+
+		/* a short output array stops the batch at a whole vector */
+		ASSERT_EQ(mixer->mix_batch(controls, count, batch, 3 * rotors + 1, nullptr), 3u);
+
+		for (unsigned i = 0; i < count; i++) {
+			float outputs[MultirotorMixer::MAX_ROTORS];
+			uint16_t status;
+
+			for (unsigned j = 0; j < 4; j++) {
+				mixer_controls[j] = controls[i * 4 + j];
+			}
+
+			ASSERT_EQ(mixer->mix(outputs, MultirotorMixer::MAX_ROTORS, &status), rotors);
+			ASSERT_EQ(status, batch_status[i]) << mixer_geometries[g].name << " vector " << i;
+
+			/* the SIMD kernels against the original scalar mix */
+			float expected[MultirotorMixer::MAX_ROTORS];
+			uint16_t expected_status;
+
+			ASSERT_EQ(reference_mix(mixer_geometries[g].table, rotors, &controls[i * 4], expected, &expected_status), rotors);
+			ASSERT_EQ(expected_status, status) << mixer_geometries[g].name << " vector " << i;
+
+			if (i < saturating) {
+				ASSERT_NE(expected_status, 0) << mixer_geometries[g].name << " vector " << i;
+			}
+
+			for (unsigned j = 0; j < rotors; j++) {
+				ASSERT_EQ(outputs[j], batch[i * rotors + j]) << mixer_geometries[g].name << " vector " << i;
+				/* the kernels may round differently, e.g. when contracting to fused multiply-adds */
+				ASSERT_NEAR(expected[j], outputs[j], 1e-5f) << mixer_geometries[g].name << " vector " << i;
+				ASSERT_GE(outputs[j], -0.8f);
+				ASSERT_LE(outputs[j], 1.0f);
+			}
+		}
+
+		delete mixer;
+	}
+}
+
+TEST(MixerTest, MultirotorBenchmark)
+{
+	const unsigned count = 1000;
+	const unsigned rounds = 100;
+	float controls[count * 4];
+	float outputs[count * MultirotorMixer::MAX_ROTORS];
+	fill_controls(controls, count);
+
+	for (unsigned g = 0; g < sizeof(mixer_geometries) / sizeof(mixer_geometries[0]); g++) {
+		MultirotorMixer *mixer = load_geometry(g);
+		ASSERT_NE(mixer, nullptr) << mixer_geometries[g].name;
+
+		/* single mixes through the control callback, as the output drivers do */
+		hrt_abstime start = hrt_absolute_time();
+
+		for (unsigned r = 0; r < rounds; r++) {
+			for (unsigned i = 0; i < count; i++) {
+				for (unsigned j = 0; j < 4; j++) {
+					mixer_controls[j] = controls[i * 4 + j];
+				}
+
+				mixer->mix(outputs, MultirotorMixer::MAX_ROTORS, nullptr);
+			}
+		}
+
+		hrt_abstime single = hrt_absolute_time() - start;
+
+		start = hrt_absolute_time();
+
+		for (unsigned r = 0; r < rounds; r++) {
+			mixer->mix_batch(controls, count, outputs, sizeof(outputs) / sizeof(outputs[0]), nullptr);
+		}
+
+		hrt_abstime batch = hrt_absolute_time() - start;
+
+		printf("%s: mix %.1f ns, mix_batch %.1f ns per control vector\n", mixer_geometries[g].name,
+		       single * 1000.0 / (count * rounds), batch * 1000.0 / (count * rounds));
+
+		delete mixer;
+	}
+}
@@ -1,6 +1,10 @@
 #include <systemlib/visibility.h>
 #include <systemlib/param/param.h>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "gtest/gtest.h"
 
 /*
@@ -149,4 +153,215 @@ TEST(ParamTest, ResetAllExcludesWildcard)
 	_assert_parameter_int_value((param_t)1, 4);
 	_assert_parameter_int_value((param_t)2, 50);
 	_assert_parameter_int_value((param_t)3, 50);
-}
\ No newline at end of file
+}
+
+TEST(ParamTest, FindAll)
+{
+	_add_parameters();
+
+	ASSERT_EQ((param_t)0, param_find("TEST_1"));
+	ASSERT_EQ((param_t)1, param_find("TEST_2"));
+	ASSERT_EQ((param_t)2, param_find("RC_X"));
+	ASSERT_EQ((param_t)3, param_find("RC2_X"));
+	ASSERT_EQ(PARAM_INVALID, param_find("RC3_X"));
+	ASSERT_EQ(PARAM_INVALID, param_find(""));
+}
+
+TEST(ParamTest, SetOutOfOrder)
+{
+	_add_parameters();
+	param_reset_all();
+
+	int32_t value = 33;
+	param_set((param_t)3, &value);
+	value = 11;
+	param_set((param_t)1, &value);
+	value = 22;
+	param_set((param_t)2, &value);
+	value = 0;
+	param_set((param_t)0, &value);
+
+	_assert_parameter_int_value((param_t)0, 0);
+	_assert_parameter_int_value((param_t)1, 11);
+	_assert_parameter_int_value((param_t)2, 22);
+	_assert_parameter_int_value((param_t)3, 33);
+
+	param_reset((param_t)2);
+
+	_assert_parameter_int_value((param_t)1, 11);
+	_assert_parameter_int_value((param_t)2, 8);
+	_assert_parameter_int_value((param_t)3, 33);
+}
+
+static off_t _file_size(const char *path)
+{
+	struct stat st;
+	return (stat(path, &st) == 0) ? st.st_size : -1;
+}
+
+static const char *_journal_path = "param_test_journal.bson";
+static const char *_export_path = "param_test_export.bson";
+
+class ParamJournalTest : public ::testing::Test
+{
+protected:
+	virtual void TearDown()
+	{
+		/* also runs when an assertion bails out of the test body */
+		param_set_default_file(NULL);
+		unlink(_journal_path);
+		unlink(_export_path);
+	}
+};
+
+TEST_F(ParamJournalTest, SaveLoad)
+{
+	const char *path = _journal_path;
+
+	_add_parameters();
+	param_reset_all();
+	unlink(path);
+	param_set_default_file(path);
+
+	/* first save writes the whole file */
+	int32_t value = 10;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	off_t size = _file_size(path);
+
+	/* later saves append only the changed values */
+	value = 20;
+	param_set((param_t)2, &value);
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_GT(_file_size(path), size);
+	size = _file_size(path);
+
+	value = 30;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_GT(_file_size(path), size);
+	size = _file_size(path);
+
+	/* nothing changed, nothing written */
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_EQ(size, _file_size(path));
+
+	param_reset_all();
+	ASSERT_EQ(0, param_load_default());
+
+	_assert_parameter_int_value((param_t)0, 30);
+	_assert_parameter_int_value((param_t)1, 4);
+	_assert_parameter_int_value((param_t)2, 20);
+	_assert_parameter_int_value((param_t)3, 16);
+
+	/* appending after a load continues the journal */
+	value = 40;
+	param_set((param_t)3, &value);
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_GT(_file_size(path), size);
+
+	/* a reset cannot be journalled, the file is compacted */
+	param_reset((param_t)2);
+	ASSERT_EQ(0, param_save_default());
+
+	param_reset_all();
+	ASSERT_EQ(0, param_load_default());
+
+	_assert_parameter_int_value((param_t)0, 30);
+	_assert_parameter_int_value((param_t)2, 8);
+	_assert_parameter_int_value((param_t)3, 40);
+}
+
+TEST_F(ParamJournalTest, CompactsRelativeToDocument)
+{
+	const char *path = _journal_path;
+
+	_add_parameters();
+	param_reset_all();
+	unlink(path);
+	param_set_default_file(path);
+
+	int32_t value = 1;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	off_t base = _file_size(path);
+
+	/* the journal is compacted instead of growing without bound, a rewrite
+	 * leaves the file size as is, so the size stays within the document,
+	 * its journal room and one record
+	 */
+	for (value = 2; value < 1000; value++) {
+		param_set((param_t)0, &value);
+		ASSERT_EQ(0, param_save_default());
+		ASSERT_LE(_file_size(path), 2 * base + 2048 + 64);
+	}
+
+	param_reset_all();
+	ASSERT_EQ(0, param_load_default());
+	_assert_parameter_int_value((param_t)0, value - 1);
+}
+
+TEST_F(ParamJournalTest, ExportKeepsValuesUnsaved)
+{
+	const char *path = _journal_path;
+
+	_add_parameters();
+	param_reset_all();
+	unlink(path);
+	param_set_default_file(path);
+
+	int32_t value = 1;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+
+	/* like 'param save <file>': exporting elsewhere must not hide the change from the default file */
+	value = 2;
+	param_set((param_t)0, &value);
+	int fd = open(_export_path, O_WRONLY | O_CREAT, 0666);
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(0, param_export(fd, false));
+	close(fd);
+	ASSERT_TRUE(param_value_unsaved((param_t)0));
+
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_FALSE(param_value_unsaved((param_t)0));
+
+	param_reset_all();
+	ASSERT_EQ(0, param_load_default());
+	_assert_parameter_int_value((param_t)0, 2);
+}
+
+TEST_F(ParamJournalTest, LoadDefaultFileContinuesJournal)
+{
+	const char *path = _journal_path;
+
+	_add_parameters();
+	param_reset_all();
+	unlink(path);
+	param_set_default_file(path);
+
+	int32_t value = 1;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	value = 2;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	off_t size = _file_size(path);
+
+	/* like 'param load' at boot, through an fd rather than param_load_default */
+	int fd = open(path, O_RDONLY);
+	ASSERT_GE(fd, 0);
+	ASSERT_EQ(0, param_load(fd));
+	close(fd);
+	_assert_parameter_int_value((param_t)0, 2);
+
+	/* a rewrite would compact into the same size, an append grows the file */
+	value = 3;
+	param_set((param_t)0, &value);
+	ASSERT_EQ(0, param_save_default());
+	ASSERT_GT(_file_size(path), size);
+
+	param_reset_all();
+	ASSERT_EQ(0, param_load_default());
+	_assert_parameter_int_value((param_t)0, 3);
+}